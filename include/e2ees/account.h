@@ -65,7 +65,8 @@ int generate_signed_pre_key(
 );
 
 /**
- * @brief Lookup an one-time pre-key with a given public key
+ * @brief Lookup an one-time pre-key with a given ID in constant time. If the one-time pre-key
+ * is not in the account, it is loaded by db_handler.load_one_time_pre_key if provided.
  *
  * @param account The account for looking up the one-time pre-key
  * @param one_time_pre_key_id The one-time pre-key id to be matched
@@ -90,6 +91,15 @@ int generate_opks(
     uint32_t e2ees_pack_id, uint32_t cur_opk_id
 );
 
+/**
+ * @brief Append new one-time pre-keys to an account without copying them.
+ * The account takes the ownership of src and the keys in it.
+ *
+ * @param account The account to be processed
+ * @param src The new one-time pre-key list with ids after the existing ones
+ * @param src_num The number of the new one-time pre-keys
+ * @return 0 if success
+ */
 int insert_opks(E2ees__Account *account, E2ees__OneTimePreKey **src, size_t src_num);
 
 /**
@@ -27,6 +27,7 @@
 extern "C" {
 #endif
 
+#include "e2ees/crypto.h"
 #include "e2ees/e2ees.h"
 
 typedef struct account_cacheer {
@@ -39,6 +40,15 @@ typedef struct account_cacheer {
     struct account_cacheer *next;
 } account_cacheer;
 
+/**
+ * @brief A signature that has been verified, identified by the digest of
+ * the public key, the message and the signature.
+ */
+typedef struct verified_signature_cacheer {
+    const ds_suite_t *ds_suite;
+    uint8_t digest[SHA256_OUTPUT_LENGTH];
+} verified_signature_cacheer;
+
 void store_account_into_cache(E2ees__Account *account);
 
 void load_version_from_cache(char **version_out, E2ees__E2eeAddress *address);
@@ -51,6 +61,24 @@ void load_signed_pre_key_from_cache(E2ees__SignedPreKey **signed_pre_key_out, E2
 
 void load_server_public_key_from_cache(ProtobufCBinaryData *server_public_key, E2ees__E2eeAddress *address);
 
+/**
+ * @brief Check if a signature has been verified before.
+ * The cache is direct-mapped with E2EES_VERIFIED_SIGNATURE_CACHE_SIZE slots.
+ *
+ * @param ds_suite The digital signature suite that verified the signature
+ * @param digest The digest of the public key, the message and the signature
+ * @return true if the signature is found
+ */
+bool load_verified_signature_from_cache(const ds_suite_t *ds_suite, const uint8_t *digest);
+
+/**
+ * @brief Remember a successfully verified signature.
+ *
+ * @param ds_suite The digital signature suite that verified the signature
+ * @param digest The digest of the public key, the message and the signature
+ */
+void store_verified_signature_into_cache(const ds_suite_t *ds_suite, const uint8_t *digest);
+
 void free_account_cacheer_list();
 
 #ifdef __cplusplus
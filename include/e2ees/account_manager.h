@@ -75,6 +75,7 @@ int consume_publish_spk_response(
 
 /**
  * @brief Create a SupplyOpksRequest message to be sent to server.
+ * The new one-time pre-keys are added to the account and saved to db before the request is sent.
  *
  * @param request_out
  * @param account
@@ -89,13 +90,14 @@ int produce_supply_opks_request(
 
 /**
  * @brief Process an incoming SupplyOpksResponse message.
+ * The new one-time pre-keys are saved to db by produce_supply_opks_request(),
+ * so the account can be loaded without its one-time pre-keys.
  *
  * @param account
- * @param opks_num
  * @param response
  * @return 0 if success
  */
-int consume_supply_opks_response(E2ees__Account *account, uint32_t opks_num, E2ees__SupplyOpksResponse *response);
+int consume_supply_opks_response(E2ees__Account *account, E2ees__SupplyOpksResponse *response);
 
 /**
  * @brief Process an incoming SupplyOpksMsg message.
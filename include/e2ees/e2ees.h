@@ -114,6 +114,26 @@ extern "C" {
 #define E2EES_SIGNED_PRE_KEY_EXPIRATION_MS                    604800000 // 7 days
 #define E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM                    100
 #define E2EES_INVITE_WAITING_TIME_MS                          60000     // 1 minute
+#define E2EES_PENDING_PLAINTEXT_MAX_NUM                       1024
+#define E2EES_PENDING_PLAINTEXT_PAGE_SIZE                     64
+#define E2EES_PENDING_REQUEST_RETRY_BASE_MS                   1000      // 1 second
+#define E2EES_PENDING_REQUEST_RETRY_MAX_MS                    60000     // 1 minute
+#define E2EES_PENDING_REQUEST_REPLAY_MAX_WORKERS              8
+#define E2EES_RESUME_CONNECTION_MAX_WORKERS                   8
+#define E2EES_GROUP_DISTRIBUTION_MAX_WORKERS                  8
+#define E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL               32
+#define E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL                 1024
+#define E2EES_GROUP_MSG_MAX_SKIPPED_KEYS                      64
+#define E2EES_GROUP_SEND_MAX_IN_FLIGHT                        8
+#define E2EES_GROUP_SHARED_CHAIN_KEYS                         128
+#define E2EES_GROUP_INFO_MAX_DELTAS                           16
+#define E2EES_SESSION_ESTABLISHMENT_MAX_WORKERS               8
+#define E2EES_PRE_KEY_BUNDLE_VERIFICATION_MAX_WORKERS         8
+#define E2EES_VERIFIED_SIGNATURE_CACHE_SIZE                   1024
+#define E2EES_SIGNED_PRE_KEY_ROTATION_LEAD_MS                 3600000   // 1 hour
+#define E2EES_KEY_MAINTENANCE_RETRY_MS                        60000     // 1 minute
+#define E2EES_KEY_MAINTENANCE_MAX_WORKERS                     8
+#define E2EES_END_DRAIN_TIMEOUT_MS                            5000      // 5 seconds
 
 #define E2EES_PACK_ALG_DS_CURVE25519                          0
 #define E2EES_PACK_ALG_DS_MLDSA44                             1
@@ -468,8 +488,100 @@ typedef struct e2ees_common_handler_t {
      */
     void (*gen_rand)(uint8_t *rand_data, size_t rand_data_len);
     void (*gen_uuid)(uint8_t uuid[E2EES_UUID_LEN]);
+
+    // optional
+    /**
+     * @brief run tasks on the worker pool of the host and return after all tasks are done,
+     *        the db and proto handlers should be thread-safe if this handler is provided,
+     *        the tasks are run one by one if this handler is NULL
+     * @param task the task function
+     * @param task_args the argument of each task
+     * @param task_num number of tasks
+     * @param max_concurrency maximum number of tasks running at the same time
+     */
+    void (*run_tasks)(void (*task)(void *), void **task_args, size_t task_num, size_t max_concurrency);
+    /**
+     * @brief run a task once on a thread of the host after delay_ms, this is used to rotate
+     *        the signed pre-keys and generate the one-time pre-keys without holding up the
+     *        message processing. Leave it NULL to run the key maintenance inline.
+     * @param task the task function
+     * @param task_arg the argument of the task
+     * @param delay_ms the delay in milliseconds before the task is run
+     */
+    void (*schedule_task)(void (*task)(void *), void *task_arg, int64_t delay_ms);
 } e2ees_common_handler_t;
 
+/**
+ * @brief Type definition of account header.
+ * It carries what is needed to decide whether an account has work to resume,
+ * without unpacking the key pairs.
+ */
+typedef struct e2ees_account_header_t {
+    E2ees__E2eeAddress *address;
+    uint32_t e2ees_pack_id;
+    size_t pending_request_num;
+    size_t session_establishment_num;   // number of unfinished session establishments
+} e2ees_account_header_t;
+
+/**
+ * @brief Type definition of session header.
+ * It carries the session metadata without the ratchet payload.
+ * The field session is left NULL by the db handler and is only
+ * set when the full session has already been unpacked.
+ */
+typedef struct e2ees_session_header_t {
+    char *session_id;
+    E2ees__E2eeAddress *our_address;
+    E2ees__E2eeAddress *their_address;
+    int64_t invite_t;
+    protobuf_c_boolean responded;
+    E2ees__Session *session;
+} e2ees_session_header_t;
+
+/**
+ * @brief Type definition of pending plaintext.
+ * The sequence number is monotonic for each (from, to) pair.
+ */
+typedef struct e2ees_pending_plaintext_t {
+    uint64_t seq;
+    uint8_t *plaintext_data;
+    size_t plaintext_data_len;
+    E2ees__NotifLevel notif_level;
+} e2ees_pending_plaintext_t;
+
+/**
+ * @brief Type definition of session establishment step.
+ */
+typedef enum e2ees_session_establishment_step_t {
+    E2EES_SESSION_ESTABLISHMENT_STEP_GET_PRE_KEY_BUNDLE = 1,   // fetching the pre-key bundles of the peer user
+    E2EES_SESSION_ESTABLISHMENT_STEP_INVITE = 2,               // the outbound session is created, inviting the peer device
+    E2EES_SESSION_ESTABLISHMENT_STEP_WAIT_ACCEPT = 3,          // the peer device is invited, waiting for its accept message
+    E2EES_SESSION_ESTABLISHMENT_STEP_SEND_PENDING = 4          // the peer device has accepted, sending the pending plaintext
+} e2ees_session_establishment_step_t;
+
+/**
+ * @brief Type definition of session establishment.
+ * The device id of their_address is NULL at the step of fetching the pre-key bundles.
+ */
+typedef struct e2ees_session_establishment_t {
+    E2ees__E2eeAddress *their_address;
+    e2ees_session_establishment_step_t step;
+    int64_t updated_ts;
+} e2ees_session_establishment_t;
+
+/**
+ * @brief Type definition of group msg filter.
+ * It is a pre-validated set of recipients for filtered group msgs, built once and reused.
+ * The lists are sorted and free of duplicates, so the same sets of recipients always
+ * produce the same requests. The addresses are lent to the requests instead of being copied.
+ */
+typedef struct e2ees_group_msg_filter_t {
+    E2ees__E2eeAddress **allow_list;
+    size_t allow_list_len;
+    E2ees__E2eeAddress **deny_list;
+    size_t deny_list_len;
+} e2ees_group_msg_filter_t;
+
 /**
  * @brief Type definition of database handler.
  */
@@ -685,7 +797,9 @@ typedef struct e2ees_db_handler_t {
         E2ees__GroupSession *group_session
     );
     /**
-     * @brief delete group sessions by address
+     * @brief delete group sessions by address,
+     *        together with the group info record of the owner if the group info handlers are provided
+     *        and the decrypted sequences of the sessions
      * @param session_owner_address
      * @param group_address
      */
@@ -694,7 +808,9 @@ typedef struct e2ees_db_handler_t {
         E2ees__E2eeAddress *group_address
     );
     /**
-     * @brief delete group sessions by session id
+     * @brief delete group sessions by session id,
+     *        together with the group info version and the decrypted sequence of the session and
+     *        the group info records of the owner that no group session refers to any more
      * @param session_owner_address
      * @param group_session_id
      */
@@ -790,8 +906,387 @@ typedef struct e2ees_db_handler_t {
         E2ees__E2eeAddress *user_address,
         char *request_id
     );
+    // optional handlers
+    /**
+     * @brief find the headers of the lastest outbound session of each device
+     *        that are related to their_user_id and their_domain, the ratchet is not loaded.
+     *        Leave it NULL to fall back to load_outbound_sessions.
+     * @param our_address
+     * @param their_user_id
+     * @param their_domain
+     * @param session_headers
+     * @return number of loaded session headers
+     */
+    size_t (*load_outbound_session_headers)(
+        E2ees__E2eeAddress *our_address,
+        const char *their_user_id,
+        const char *their_domain,
+        e2ees_session_header_t **session_headers
+    );
+    /**
+     * @brief append plaintext data to the pending outbox of (from_address, to_address).
+     *        The data stored by store_pending_plaintext_data should also be kept in the same outbox.
+     *        Leave the outbox handlers NULL to fall back to the pending plaintext handlers.
+     * @param from_address
+     * @param to_address
+     * @param plaintext_data
+     * @param plaintext_data_len
+     * @param notif_level
+     * @return the assigned sequence number, 0 if failed
+     */
+    uint64_t (*append_pending_plaintext_data)(
+        E2ees__E2eeAddress *from_address,
+        E2ees__E2eeAddress *to_address,
+        uint8_t *plaintext_data,
+        size_t plaintext_data_len,
+        E2ees__NotifLevel notif_level
+    );
+    /**
+     * @brief count the pending plaintext data in the outbox
+     * @param from_address
+     * @param to_address
+     * @return number of pending plaintext data
+     */
+    size_t (*count_pending_plaintext_data)(
+        E2ees__E2eeAddress *from_address,
+        E2ees__E2eeAddress *to_address
+    );
+    /**
+     * @brief load a page of pending plaintext data in ascending sequence order
+     * @param from_address
+     * @param to_address
+     * @param after_seq only the data with a greater sequence number are loaded
+     * @param max_num
+     * @param pending_plaintext_list
+     * @return number of loaded pending plaintext data
+     */
+    size_t (*load_pending_plaintext_data_page)(
+        E2ees__E2eeAddress *from_address,
+        E2ees__E2eeAddress *to_address,
+        uint64_t after_seq,
+        size_t max_num,
+        e2ees_pending_plaintext_t **pending_plaintext_list
+    );
+    /**
+     * @brief delete the pending plaintext data with sequence number in [first_seq, last_seq],
+     *        deleting a range that has been deleted has no effect
+     * @param from_address
+     * @param to_address
+     * @param first_seq
+     * @param last_seq
+     */
+    void (*unload_pending_plaintext_data_range)(
+        E2ees__E2eeAddress *from_address,
+        E2ees__E2eeAddress *to_address,
+        uint64_t first_seq,
+        uint64_t last_seq
+    );
+    /**
+     * @brief load the headers of all accounts from db
+     * @param account_headers
+     * @return number of loaded account headers
+     */
+    size_t (*load_account_headers)(
+        e2ees_account_header_t **account_headers
+    );
+    /**
+     * @brief load the identity key of the account given by the user address,
+     *        without loading the other keys of the account
+     * @param user_address
+     * @param identity_key
+     */
+    void (*load_identity_key)(
+        E2ees__E2eeAddress *user_address,
+        E2ees__IdentityKey **identity_key
+    );
+    /**
+     * @brief load an one-time pre-key of the account given by the user address and opk_id
+     * @param user_address
+     * @param one_time_pre_key_id
+     * @param one_time_pre_key
+     */
+    void (*load_one_time_pre_key)(
+        E2ees__E2eeAddress *user_address,
+        uint32_t one_time_pre_key_id,
+        E2ees__OneTimePreKey **one_time_pre_key
+    );
+    /**
+     * @brief find all outbound sessions from our_address to the devices of the given users in one query.
+     *        Leave it NULL to fall back to load_outbound_sessions for each user.
+     * @param our_address
+     * @param their_users
+     * @param their_users_num
+     * @param outbound_sessions
+     * @return number of loaded outbound sessions
+     */
+    size_t (*load_outbound_sessions_by_users)(
+        E2ees__E2eeAddress *our_address,
+        E2ees__GroupMember **their_users,
+        size_t their_users_num,
+        E2ees__Session ***outbound_sessions
+    );
+    /**
+     * @brief store the group info of an owner as a full record of the given version,
+     *        the deltas of the group info up to this version can be dropped.
+     *        Provide all of the group info handlers, including the group session info version
+     *        handlers, to keep the member list out of the group sessions, which then only carry
+     *        the group name and address.
+     * @param owner_address
+     * @param group_info
+     * @param version
+     */
+    void (*store_group_info)(
+        E2ees__E2eeAddress *owner_address,
+        E2ees__GroupInfo *group_info,
+        uint64_t version
+    );
+    /**
+     * @brief append a membership change of the given version to the group info of an owner
+     * @param owner_address
+     * @param version
+     * @param added a group info with the group address and the added members
+     * @param removed a group info with the group address and the removed members
+     */
+    void (*store_group_info_delta)(
+        E2ees__E2eeAddress *owner_address,
+        uint64_t version,
+        E2ees__GroupInfo *added,
+        E2ees__GroupInfo *removed
+    );
+    /**
+     * @brief load the latest full record of the group info of an owner
+     *        and the deltas after it in ascending version order
+     * @param owner_address
+     * @param group_address
+     * @param group_info NULL if there is no record
+     * @param version the version of the full record
+     * @param added_list
+     * @param removed_list
+     * @return number of loaded deltas
+     */
+    size_t (*load_group_info)(
+        E2ees__E2eeAddress *owner_address,
+        E2ees__E2eeAddress *group_address,
+        E2ees__GroupInfo **group_info,
+        uint64_t *version,
+        E2ees__GroupInfo ***added_list,
+        E2ees__GroupInfo ***removed_list
+    );
+    /**
+     * @brief append a reference to a shared payload to the pending outbox of (from_address, to_address).
+     *        The payload is stored once for each (from_address, payload_hash) and counted by its references,
+     *        it is deleted together with the last reference unloaded by the outbox handlers.
+     *        The pending plaintext loaders should return the payload in place of the reference.
+     *        Leave it NULL to fall back to append_pending_plaintext_data.
+     * @param from_address
+     * @param to_address
+     * @param payload_hash
+     * @param payload_hash_len
+     * @param payload
+     * @param payload_len
+     * @param notif_level
+     * @return the assigned sequence number, 0 if failed
+     */
+    uint64_t (*append_pending_payload_ref)(
+        E2ees__E2eeAddress *from_address,
+        E2ees__E2eeAddress *to_address,
+        const uint8_t *payload_hash,
+        size_t payload_hash_len,
+        uint8_t *payload,
+        size_t payload_len,
+        E2ees__NotifLevel notif_level
+    );
+    /**
+     * @brief store the step of the session establishment from our_address to their_address,
+     *        replacing the stored step if any.
+     *        Provide all of the session establishment handlers to resume the unfinished
+     *        session establishments in resume_connection().
+     * @param our_address
+     * @param their_address
+     * @param step
+     * @param updated_ts
+     */
+    void (*store_session_establishment)(
+        E2ees__E2eeAddress *our_address,
+        E2ees__E2eeAddress *their_address,
+        uint32_t step,
+        int64_t updated_ts
+    );
+    /**
+     * @brief load the unfinished session establishments of our_address
+     * @param our_address
+     * @param session_establishments
+     * @return number of loaded session establishments
+     */
+    size_t (*load_session_establishments)(
+        E2ees__E2eeAddress *our_address,
+        e2ees_session_establishment_t **session_establishments
+    );
+    /**
+     * @brief delete the session establishment from our_address to their_address
+     * @param our_address
+     * @param their_address
+     */
+    void (*unload_session_establishment)(
+        E2ees__E2eeAddress *our_address,
+        E2ees__E2eeAddress *their_address
+    );
+    /**
+     * @brief load account from db by giving user address without the one-time pre-keys,
+     *        which are loaded one by one with load_one_time_pre_key when they are used.
+     *        Leave it NULL to fall back to load_account_by_address.
+     * @param user_address
+     * @param account
+     */
+    void (*load_account_without_opks)(
+        E2ees__E2eeAddress *user_address,
+        E2ees__Account **account
+    );
+    /**
+     * @brief store the version of the group info record that the member list of a group session is at,
+     *        replacing the stored version if any. It belongs to the group info handlers.
+     * @param owner_address
+     * @param group_session_id
+     * @param version
+     */
+    void (*store_group_session_info_version)(
+        E2ees__E2eeAddress *owner_address,
+        const char *group_session_id,
+        uint64_t version
+    );
+    /**
+     * @brief load the version of the group info record that the member list of a group session is at
+     * @param owner_address
+     * @param group_session_id
+     * @return the version, 0 if there is none
+     */
+    uint64_t (*load_group_session_info_version)(
+        E2ees__E2eeAddress *owner_address,
+        const char *group_session_id
+    );
+    /**
+     * @brief raise the stored sequence that an inbound group session of an owner has been decrypted up to,
+     *        a lower sequence does not replace the stored one. It is stored before a decrypted group message
+     *        is handed over, while the whole chain state is written back in batches.
+     *        Leave it NULL to write back the chain state before every decrypted group message is handed over.
+     * @param owner_address
+     * @param group_session_id
+     * @param sequence
+     */
+    void (*store_group_session_sequence)(
+        E2ees__E2eeAddress *owner_address,
+        const char *group_session_id,
+        uint32_t sequence
+    );
+    /**
+     * @brief load the sequence that an inbound group session of an owner has been decrypted up to
+     * @param owner_address
+     * @param group_session_id
+     * @return the sequence, 0 if there is none
+     */
+    uint32_t (*load_group_session_sequence)(
+        E2ees__E2eeAddress *owner_address,
+        const char *group_session_id
+    );
+    /**
+     * @brief raise the stored next one-time pre-key id of account after the supplied one-time pre-keys
+     *        are added, a lower id does not replace the stored one.
+     *        Leave it NULL to load the account with its one-time pre-keys when supplying more.
+     * @param user_address
+     * @param next_one_time_pre_key_id
+     */
+    void (*update_next_one_time_pre_key_id)(
+        E2ees__E2eeAddress *user_address,
+        uint32_t next_one_time_pre_key_id
+    );
+    /**
+     * @brief store the part of a complete inbound group session that is the same for all of its owners,
+     *        the associated data and the group seed, once for each (session_id, sender, chain_id),
+     *        and refer the group session of owner_address to it. A reference that the owner already has is kept.
+     *        The reference is dropped together with the owner's group session, and the shared part together
+     *        with its last reference. Provide both of the shared group session handlers to store the inbound
+     *        group sessions of the owners without their associated data and group seed.
+     * @param owner_address
+     * @param chain_id the digest of the associated data and the initial chain state
+     * @param shared_group_session
+     */
+    void (*store_shared_group_session)(
+        E2ees__E2eeAddress *owner_address,
+        const ProtobufCBinaryData *chain_id,
+        E2ees__GroupSession *shared_group_session
+    );
+    /**
+     * @brief load the shared part of the inbound group session that owner_address refers to
+     * @param sender_address
+     * @param owner_address
+     * @param session_id
+     * @param chain_id
+     * @param shared_group_session NULL if the owner has no reference
+     */
+    void (*load_shared_group_session)(
+        E2ees__E2eeAddress *sender_address,
+        E2ees__E2eeAddress *owner_address,
+        const char *session_id,
+        ProtobufCBinaryData *chain_id,
+        E2ees__GroupSession **shared_group_session
+    );
+    /**
+     * @brief store the message key of a skipped sequence of an inbound group session,
+     *        and keep only the keys of the last E2EES_GROUP_MSG_MAX_SKIPPED_KEYS sequences of the session.
+     *        The keys are dropped together with the group session.
+     *        Provide both of the skipped key handlers to keep the skipped keys over a restart.
+     * @param owner_address
+     * @param sender_address
+     * @param session_id
+     * @param sequence
+     * @param msg_key
+     */
+    void (*store_skipped_group_msg_key)(
+        E2ees__E2eeAddress *owner_address,
+        E2ees__E2eeAddress *sender_address,
+        const char *session_id,
+        uint32_t sequence,
+        const ProtobufCBinaryData *msg_key
+    );
+    /**
+     * @brief load and delete the message key of a skipped sequence of an inbound group session
+     * @param owner_address
+     * @param sender_address
+     * @param session_id
+     * @param sequence
+     * @param msg_key_out
+     * @return true if the key is found
+     */
+    bool (*take_skipped_group_msg_key)(
+        E2ees__E2eeAddress *owner_address,
+        E2ees__E2eeAddress *sender_address,
+        const char *session_id,
+        uint32_t sequence,
+        ProtobufCBinaryData *msg_key_out
+    );
+    /**
+     * @brief count one more replay attempt of a pending request, the count is deleted together with the request.
+     *        Leave it NULL to count the attempts in memory, where they are lost when the process exits.
+     * @param user_address
+     * @param request_id
+     * @return the attempt count including this one
+     */
+    uint32_t (*add_pending_request_attempt)(
+        E2ees__E2eeAddress *user_address,
+        char *request_id
+    );
 } e2ees_db_handler_t;
 
+/**
+ * @brief Type definition of the completion of an asynchronous send_one2one_msg request.
+ * It is called exactly once for each submitted request, from any thread.
+ * The ownership of the response is passed to the library, NULL if the request could not be delivered.
+ */
+typedef void (*e2ees_send_one2one_msg_completion_t)(
+    void *context,
+    E2ees__SendOne2oneMsgResponse *response
+);
+
 /**
  * @brief Type definition of protocol handler.
  */
@@ -960,6 +1455,78 @@ typedef struct e2ees_proto_handler_t {
         const char *auth,
         E2ees__ConsumeProtoMsgRequest *request
     );
+    // optional handlers
+    /**
+     * @brief Send a batch of one2one messages in one round trip.
+     *        Leave it NULL to fall back to send_one2one_msg for each request.
+     * @param from
+     * @param auth
+     * @param requests
+     * @param request_num
+     * @return an array of request_num responses in the order of requests
+     */
+    E2ees__SendOne2oneMsgResponse **(*send_one2one_msgs)(
+        E2ees__E2eeAddress *from,
+        const char *auth,
+        E2ees__SendOne2oneMsgRequest **requests,
+        size_t request_num
+    );
+    /**
+     * @brief Invite a batch of devices in one round trip.
+     *        Leave it NULL to fall back to invite for each request.
+     * @param from
+     * @param auth
+     * @param requests
+     * @param request_num
+     * @return an array of request_num responses in the order of requests
+     */
+    E2ees__InviteResponse **(*invites)(
+        E2ees__E2eeAddress *from,
+        const char *auth,
+        E2ees__InviteRequest **requests,
+        size_t request_num
+    );
+    /**
+     * @brief Submit a one2one message without waiting for the response.
+     *        The request stays valid until the completion is called, which may happen before returning.
+     *        Leave it NULL to fall back to send_one2one_msg.
+     * @param from
+     * @param auth
+     * @param request
+     * @param completion
+     * @param context the first argument of the completion
+     * @return 0 if the request is submitted, the completion will not be called otherwise
+     */
+    int (*send_one2one_msg_async)(
+        E2ees__E2eeAddress *from,
+        const char *auth,
+        E2ees__SendOne2oneMsgRequest *request,
+        e2ees_send_one2one_msg_completion_t completion,
+        void *context
+    );
+    /**
+     * @brief Call the completions of the submitted one2one messages that have been answered,
+     *        on the calling thread and without blocking. e2ees_end() calls it while it waits for
+     *        the outstanding messages, for hosts that call the completions from their event loop.
+     *        Leave it NULL if the completions are called from other threads.
+     * @return number of called completions
+     */
+    size_t (*complete_one2one_msgs)();
+    /**
+     * @brief Consume a batch of ProtoMsgs in one round trip.
+     *        Leave it NULL to fall back to consume_proto_msg for each request.
+     * @param from
+     * @param auth
+     * @param requests
+     * @param request_num
+     * @return an array of request_num responses in the order of requests
+     */
+    E2ees__ConsumeProtoMsgResponse **(*consume_proto_msgs)(
+        E2ees__E2eeAddress *from,
+        const char *auth,
+        E2ees__ConsumeProtoMsgRequest **requests,
+        size_t request_num
+    );
 } e2ees_proto_handler_t;
 
 typedef struct e2ees_event_handler_t {
@@ -1111,6 +1678,20 @@ typedef struct e2ees_event_handler_t {
         E2ees__GroupMember **removed_group_members,
         size_t removed_group_members_num
     );
+    // optional
+    /**
+     * @brief notify the progress of resuming connection
+     * @param user_address
+     * @param result E2EES_RESULT_SUCC or E2EES_RESULT_FAIL
+     * @param resumed_num number of accounts that have been resumed
+     * @param total_num number of accounts to be resumed
+     */
+    void (*on_account_resumed)(
+        E2ees__E2eeAddress *user_address,
+        int result,
+        size_t resumed_num,
+        size_t total_num
+    );
 } e2ees_event_handler_t;
 
 /**
@@ -1179,6 +1760,9 @@ void e2ees_begin(e2ees_plugin_t *plugin);
 
 /**
  * @brief The ending function for terminating E2EE Security.
+ * It waits up to E2EES_END_DRAIN_TIMEOUT_MS for the submitted one2one messages to be completed,
+ * and the cached group chain states are written back, so the proto and db handlers should still
+ * be available. The completions that come after it returns are dropped.
  */
 void e2ees_end();
 
@@ -1316,6 +1900,17 @@ void e2ees_notify_group_members_removed(
     E2ees__GroupMember **removed_group_members, size_t removed_group_members_num
 );
 
+/**
+ * @brief Event for notifying that an account is resumed.
+ * @param user_address
+ * @param result
+ * @param resumed_num
+ * @param total_num
+ */
+void e2ees_notify_account_resumed(
+    E2ees__E2eeAddress *user_address, int result, size_t resumed_num, size_t total_num
+);
+
 #ifdef __cplusplus
 }
 #endif
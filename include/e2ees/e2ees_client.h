@@ -92,7 +92,11 @@ E2ees__InviteResponse *new_invite(
  * @param notif_level
  * @param plaintext_data
  * @param plaintext_data_len
- * @return E2ees__SendOne2oneMsgResponse *
+ * @return E2ees__SendOne2oneMsgResponse *, the response code is
+ *         RESPONSE_CODE_OK if the message has been sent to at least one session,
+ *         RESPONSE_CODE_SERVICE_UNAVAILABLE if it is neither sent nor queued for any session,
+ *         or RESPONSE_CODE_REQUEST_TIMEOUT if it is queued; each device whose full outbox drops
+ *         the message is reported through a BAD_PENDING_PLAINTEXT log
  */
 E2ees__SendOne2oneMsgResponse *send_one2one_msg(
     E2ees__E2eeAddress *from, const char *to_user_id, const char *to_domain,
@@ -229,6 +233,50 @@ int send_group_msg_with_filter(
     size_t deny_list_len
 );
 
+/**
+ * @brief Send group msg with a group msg filter built by new_group_msg_filter().
+ * The filter is validated once and its addresses are not copied for each msg.
+ * @param response_out
+ * @param sender_address
+ * @param group_address
+ * @param notif_level
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @param filter
+ * @return 0 if success
+ */
+int send_group_msg_with_recipient_filter(
+    E2ees__SendGroupMsgResponse **response_out,
+    E2ees__E2eeAddress *sender_address, E2ees__E2eeAddress *group_address,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    const e2ees_group_msg_filter_t *filter
+);
+
+/**
+ * @brief Send a batch of group msgs without waiting for each other's acks.
+ * The sequences are reserved up front and at most E2EES_GROUP_SEND_MAX_IN_FLIGHT
+ * msgs are encrypted and sent at the same time. A msg that fails to be sent is
+ * kept as a pending request and its response is NULL.
+ * @param responses_out the responses in the order of the plaintexts, msg_num of them
+ * @param sender_address
+ * @param group_address
+ * @param notif_level
+ * @param plaintext_data_list
+ * @param plaintext_data_len_list
+ * @param msg_num
+ * @return 0 if all of the msgs are sent
+ */
+int send_group_msgs(
+    E2ees__SendGroupMsgResponse ***responses_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *group_address,
+    uint32_t notif_level,
+    const uint8_t **plaintext_data_list,
+    const size_t *plaintext_data_len_list,
+    size_t msg_num
+);
+
 /**
  * @brief Send consume_proto_msg request to server.
  * @param sender_address
@@ -245,8 +293,21 @@ E2ees__ConsumeProtoMsgResponse *consume_proto_msg(E2ees__E2eeAddress *sender_add
  */
 E2ees__ConsumeProtoMsgResponse *process_proto_msg(uint8_t *proto_msg_data, size_t proto_msg_data_len);
 
+/**
+ * @brief Resend the pending requests of all accounts.
+ * The accounts are resumed on the worker pool of the host if common_handler.run_tasks
+ * is provided, and the progress is notified by event_handler.on_account_resumed.
+ */
 void resume_connection();
 
+/**
+ * @brief Rotate the signed pre-keys that are due for all accounts.
+ * A host scheduler can call this periodically, or provide common_handler.schedule_task
+ * so that the next pass is scheduled when the earliest signed pre-key is due.
+ * @return number of rotated signed pre-keys
+ */
+size_t maintain_keys();
+
 #ifdef __cplusplus
 }
 #endif
@@ -64,6 +64,20 @@ int invite_internal(
     E2ees__Session *outbound_session
 );
 
+/**
+ * @brief Send the invite requests of several outbound sessions with the same owner.
+ *        The requests are submitted in one batch if the proto handler supports it.
+ * @param response_list The output responses, one for each session
+ * @param outbound_sessions
+ * @param outbound_sessions_num
+ * @return number of invites that succeeded
+ */
+size_t invite_sessions_internal(
+    E2ees__InviteResponse **response_list,
+    E2ees__Session **outbound_sessions,
+    size_t outbound_sessions_num
+);
+
 /**
  * @brief Send accept request to server.
  * @param response_out
@@ -121,6 +135,79 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg_internal(
     const uint8_t *plaintext_data, size_t plaintext_data_len
 );
 
+/**
+ * @brief Consume the response of a sent one2one_msg request, and keep the request
+ * as a pending request if it is not delivered.
+ * @param outbound_session
+ * @param send_one2one_msg_request
+ * @param response
+ * @return E2ees__SendOne2oneMsgResponse *
+ */
+E2ees__SendOne2oneMsgResponse *complete_send_one2one_msg_internal(
+    E2ees__Session *outbound_session,
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request,
+    E2ees__SendOne2oneMsgResponse *response
+);
+
+/**
+ * @brief Submit a one2one_msg request through proto_handler.send_one2one_msg_async.
+ * The session state is stored right away, and the completion keeps the request
+ * as a pending request if it is not delivered.
+ * @param outbound_session
+ * @param auth
+ * @param send_one2one_msg_request the ownership is passed to the library
+ */
+void send_one2one_msg_request_async_internal(
+    E2ees__Session *outbound_session,
+    const char *auth,
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request
+);
+
+/**
+ * @brief Send one2one_msg without waiting for the response if the proto handler supports it,
+ * otherwise the same as send_one2one_msg_internal.
+ * @param outbound_session
+ * @param notif_level
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @return 0 if the request is sent or submitted
+ */
+int send_one2one_msg_async_internal(
+    E2ees__Session *outbound_session,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len
+);
+
+/**
+ * @brief Get the number of submitted one2one_msg requests that are not completed yet.
+ * @return number of outstanding requests
+ */
+size_t count_outstanding_one2one_msgs_internal();
+
+/**
+ * @brief Wait for the submitted one2one_msg requests to be completed. The completions are run
+ * by proto_handler.complete_one2one_msgs if it is provided, otherwise they are expected from
+ * other threads.
+ * @param timeout_ms
+ * @return number of requests that are still outstanding after timeout_ms
+ */
+size_t wait_outstanding_one2one_msgs_internal(int64_t timeout_ms);
+
+/**
+ * @brief Run tasks on the worker pool of the host, or one by one if
+ * common_handler.run_tasks is not provided.
+ * @param task
+ * @param task_args
+ * @param task_num
+ * @param max_concurrency
+ */
+void run_tasks_internal(
+    void (*task)(void *),
+    void **task_args,
+    size_t task_num,
+    size_t max_concurrency
+);
+
 /**
  * @brief Send add_group_member_device request to server.
  * @param response_out
@@ -136,15 +223,55 @@ int add_group_member_device_internal(
     E2ees__E2eeAddress *new_device_address
 );
 
+/**
+ * @brief Append pending plain text data to the outbox of (from, to) without size limit.
+ * @param from
+ * @param to
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @param notif_level
+ * @return 0 if success
+ */
+int store_pending_plaintext_data_internal(
+    E2ees__E2eeAddress *from,
+    E2ees__E2eeAddress *to,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len,
+    E2ees__NotifLevel notif_level
+);
+
+/**
+ * @brief Append plain text data shared by many recipients to the outbox of (from, to).
+ * The data is stored once for all the recipients if the db supports shared payloads.
+ * It is refused like the common plain text data when the outbox holds E2EES_PENDING_PLAINTEXT_MAX_NUM entries.
+ * @param from
+ * @param to
+ * @param payload_hash the SHA-256 hash of plaintext_data, computed once by the caller
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @param notif_level
+ * @return 0 if success, -1 if the outbox is full
+ */
+int store_pending_shared_plaintext_data_internal(
+    E2ees__E2eeAddress *from,
+    E2ees__E2eeAddress *to,
+    const uint8_t *payload_hash,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len,
+    E2ees__NotifLevel notif_level
+);
+
 /**
  * @brief Store pending plain text data to db.
+ * The outbox of (from, to) is bounded by E2EES_PENDING_PLAINTEXT_MAX_NUM.
  * @param from
  * @param to
  * @param common_plaintext_data
  * @param common_plaintext_data_len
  * @param notif_level
+ * @return 0 if success, -1 if the outbox is full
 */
-void store_pending_common_plaintext_data_internal(
+int store_pending_common_plaintext_data_internal(
     E2ees__E2eeAddress *from,
     E2ees__E2eeAddress *to,
     uint8_t *common_plaintext_data,
@@ -170,6 +297,162 @@ void store_pending_request_internal(
     size_t request_arg_list_len
 );
 
+/**
+ * @brief Send the pending plain text data of an outbound session in order.
+ * @param outbound_session
+ */
+void send_pending_plaintext_data_internal(E2ees__Session *outbound_session);
+
+/**
+ * @brief Load the outbound session headers without unpacking the ratchets.
+ * Fall back to load_outbound_sessions if the db handler does not support it.
+ * @param session_headers_out
+ * @param our_address
+ * @param their_user_id
+ * @param their_domain
+ * @return number of loaded session headers
+ */
+size_t load_outbound_session_headers_internal(
+    e2ees_session_header_t **session_headers_out,
+    E2ees__E2eeAddress *our_address,
+    const char *their_user_id,
+    const char *their_domain
+);
+
+/**
+ * @brief Load the full outbound session of a given session header.
+ * The caller takes the ownership of the returned session.
+ * @param session_header
+ * @return the outbound session, or NULL if it is no longer the lastest one
+ */
+E2ees__Session *load_outbound_session_by_header_internal(
+    e2ees_session_header_t *session_header
+);
+
+/**
+ * @brief Verify a signature, or skip the verification if the same signature
+ * has been verified with the same public key before.
+ * @param ds_suite
+ * @param signature
+ * @param signature_len
+ * @param msg
+ * @param msg_len
+ * @param public_key
+ * @return 0 if success
+ */
+int verify_signature_internal(
+    const ds_suite_t *ds_suite,
+    const uint8_t *signature, size_t signature_len,
+    const uint8_t *msg, size_t msg_len,
+    const uint8_t *public_key
+);
+
+/**
+ * @brief Load the identity key of a given account without loading the whole account.
+ * The account cache is checked first, then the db handler load_identity_key,
+ * and load_account_by_address is only used if the db handler does not support it.
+ * The caller takes the ownership of the returned identity key.
+ * @param identity_key_out
+ * @param user_address
+ * @return E2EES_RESULT_SUCC or E2EES_RESULT_FAIL
+ */
+int load_identity_key_internal(
+    E2ees__IdentityKey **identity_key_out,
+    E2ees__E2eeAddress *user_address
+);
+
+/**
+ * @brief Load an account without its one-time pre-keys. The one-time pre-keys of
+ * post-quantum packs are large, so they are left in the db and lookup_one_time_pre_key
+ * loads the one that is used. The whole account is loaded if the db handler does not
+ * support load_account_without_opks and load_one_time_pre_key.
+ * The caller takes the ownership of the returned account.
+ * @param account_out
+ * @param user_address
+ * @return E2EES_RESULT_SUCC or E2EES_RESULT_FAIL
+ */
+int load_account_without_opks_internal(
+    E2ees__Account **account_out,
+    E2ees__E2eeAddress *user_address
+);
+
+/**
+ * @brief Load the group info record of an owner and apply its deltas.
+ * The caller takes the ownership of the returned group info.
+ * @param group_info_out
+ * @param version_out
+ * @param owner_address
+ * @param group_address
+ * @return E2EES_RESULT_SUCC if the record is found
+ */
+int load_group_info_internal(
+    E2ees__GroupInfo **group_info_out,
+    uint64_t *version_out,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address
+);
+
+/**
+ * @brief Store a group session. If the db handler supports group info records,
+ * a membership change is stored once as a delta of the owner's group info record
+ * and the group session is stored without its member list. A member list that was
+ * taken from an older version of the record than the latest one is not stored.
+ * If the db handler supports shared group sessions, the associated data and the group seed
+ * of a complete inbound group session are stored once for all of its owners.
+ * @param group_session
+ */
+void store_group_session_internal(E2ees__GroupSession *group_session);
+
+/**
+ * @brief Fill in the associated data and the group seed of a group session
+ * that has been stored without them from the shared group session.
+ * @param group_session
+ * @param chain_id_out the id of the shared chain, NULL if not needed
+ * @return true if the shared group session is found
+ */
+bool fill_shared_group_session_internal(E2ees__GroupSession *group_session, ProtobufCBinaryData *chain_id_out);
+
+/**
+ * @brief Load a group session by address with its member list.
+ * @param sender_address
+ * @param owner_address
+ * @param group_address
+ * @param group_session_out
+ */
+void load_group_session_by_address_internal(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address,
+    E2ees__GroupSession **group_session_out
+);
+
+/**
+ * @brief Load a group session by id with its member list.
+ * @param sender_address
+ * @param owner_address
+ * @param session_id
+ * @param group_session_out
+ */
+void load_group_session_by_id_internal(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    char *session_id,
+    E2ees__GroupSession **group_session_out
+);
+
+/**
+ * @brief Load all of the group sessions of an owner in a group with their member lists.
+ * @param owner_address
+ * @param group_address
+ * @param group_sessions_out
+ * @return number of loaded group sessions
+ */
+size_t load_group_sessions_internal(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address,
+    E2ees__GroupSession ***group_sessions_out
+);
+
 /**
  * @brief Resume connection with a given account.
  * @param account
@@ -40,6 +40,42 @@ void advance_group_chain_key(
     ProtobufCBinaryData *chain_key
 );
 
+/**
+ * @brief Advance the chain key of group session to a target sequence.
+ * If the sender's checkpoint lies between the current and the target sequence,
+ * the chain key jumps to the checkpoint and only the remaining distance is stepped.
+ *
+ * @param cipher_suite
+ * @param chain_key
+ * @param sequence
+ * @param target_sequence
+ * @param checkpoint_chain_key NULL or empty if there is no checkpoint
+ * @param checkpoint_sequence
+ */
+void advance_group_chain_key_to_sequence(
+    const cipher_suite_t *cipher_suite,
+    ProtobufCBinaryData *chain_key,
+    uint32_t *sequence,
+    uint32_t target_sequence,
+    const ProtobufCBinaryData *checkpoint_chain_key,
+    uint32_t checkpoint_sequence
+);
+
+/**
+ * @brief Get the digest that identifies the chain of an inbound group session,
+ * which is taken over the associated data and the chain key and sequence that the session starts with.
+ * The owners that get the same chain from the sender get the same digest.
+ *
+ * @param cipher_suite
+ * @param inbound_group_session
+ * @param chain_id_out
+ */
+void get_group_chain_id(
+    const cipher_suite_t *cipher_suite,
+    const E2ees__GroupSession *inbound_group_session,
+    ProtobufCBinaryData *chain_id_out
+);
+
 /**
  * @brief Create group message key.
  *
@@ -199,6 +235,56 @@ int new_and_complete_inbound_group_session_with_chain_key(
     ProtobufCBinaryData *their_chain_key
 );
 
+/**
+ * @brief Send the current chain state of an outbound group session to the group members
+ * as a checkpoint. It is published every E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL messages.
+ *
+ * @param outbound_group_session
+ */
+int publish_group_chain_checkpoint(
+    E2ees__GroupSession *outbound_group_session
+);
+
+/**
+ * @brief Check if a group ratchet state is a chain checkpoint,
+ * which neither adds members nor carries any member info.
+ *
+ * @param group_update_key_bundle
+ * @return true if it is a checkpoint
+ */
+bool is_group_chain_checkpoint(
+    const E2ees__GroupUpdateKeyBundle *group_update_key_bundle
+);
+
+/**
+ * @brief Sign a chain checkpoint with the sender's signing key.
+ * The signature covers the sequence, the chain key and the session ID,
+ * and is appended to the chain key of the checkpoint.
+ *
+ * @param checkpoint
+ * @param sign_private_key
+ * @return E2EES_RESULT_SUCC if the checkpoint is signed
+ */
+int sign_group_chain_checkpoint(
+    E2ees__GroupUpdateKeyBundle *checkpoint,
+    const ProtobufCBinaryData *sign_private_key
+);
+
+/**
+ * @brief Keep a chain checkpoint from the sender of an inbound group session.
+ * The checkpoint is dropped unless it was sent by the session's sender
+ * and carries a valid signature of the session's signing key.
+ *
+ * @param group_update_key_bundle
+ * @param from_address the address the checkpoint was received from
+ * @param user_address
+ */
+int consume_group_chain_checkpoint(
+    E2ees__GroupUpdateKeyBundle *group_update_key_bundle,
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *user_address
+);
+
 /**
  * @brief Create and complete an inbound group session with other's ratchet state.
  *
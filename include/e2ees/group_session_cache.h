@@ -0,0 +1,269 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef GROUP_SESSION_CACHE_H_
+#define GROUP_SESSION_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "e2ees/e2ees.h"
+
+/**
+ * @brief The message key of a skipped sequence, kept for a message that is still in flight.
+ */
+typedef struct group_msg_skipped_key {
+    uint32_t sequence;
+    ProtobufCBinaryData msg_key;
+    struct group_msg_skipped_key *next;
+} group_msg_skipped_key;
+
+/**
+ * @brief The chain state of an inbound group session kept in memory.
+ *
+ * Only the fields that are needed for decrypting a group message are kept.
+ * The member list stays in the database and is only unpacked by the group
+ * management paths, which flush the cache before loading the session.
+ * The chain state is written back to the database once every
+ * E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL messages, and only the sequence is
+ * stored in between, which moves the chain forward when the session is cached again.
+ * A chain checkpoint published by the sender is kept until the chain reaches it.
+ * The message keys of the last E2EES_GROUP_MSG_MAX_SKIPPED_KEYS skipped sequences
+ * are kept, so that a message overtaken by a later one from a pipelined sender can
+ * still be decrypted. They are kept in the database if it supports skipped keys,
+ * and in the cache otherwise, where they are lost on a restart or a flush.
+ */
+typedef struct group_session_cacheer {
+    char *session_id;
+    E2ees__E2eeAddress *sender_address;
+    E2ees__E2eeAddress *owner_address;
+    E2ees__E2eeAddress *group_address;
+    uint32_t e2ees_pack_id;
+    ProtobufCBinaryData chain_key;
+    uint32_t sequence;
+    ProtobufCBinaryData associated_data;
+    ProtobufCBinaryData chain_id;
+    uint32_t stored_sequence;
+    ProtobufCBinaryData checkpoint_chain_key;
+    uint32_t checkpoint_sequence;
+    group_msg_skipped_key *skipped_keys;
+    size_t skipped_keys_num;
+    struct group_session_cacheer *next;
+} group_session_cacheer;
+
+/**
+ * @brief Get a copy of the chain state of an inbound group session.
+ * The session is loaded from the database on the first access.
+ *
+ * @param cacheer_out
+ * @param sender_address
+ * @param owner_address
+ * @param session_id
+ * @return E2EES_RESULT_SUCC if the session is found
+ */
+int load_group_session_cacheer(
+    group_session_cacheer **cacheer_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id
+);
+
+/**
+ * @brief Put the advanced chain state back into the cache,
+ * and write it back to the database if it is due. Otherwise only the sequence is stored,
+ * or the chain state is written back anyway if the db does not store the sequence.
+ * Call it before handing over the decrypted message, so that the message is not
+ * decrypted again after a restart.
+ *
+ * @param cacheer the copy returned by load_group_session_cacheer()
+ */
+void update_group_session_cacheer(group_session_cacheer *cacheer);
+
+/**
+ * @brief Keep a chain checkpoint published by the sender of an inbound group session.
+ * The checkpoint is ignored if the chain has already reached it or the signing key
+ * does not match the session.
+ *
+ * @param sender_address
+ * @param owner_address
+ * @param session_id
+ * @param sign_public_key
+ * @param checkpoint_chain_key
+ * @param checkpoint_sequence
+ * @return E2EES_RESULT_SUCC if the checkpoint is kept
+ */
+int store_group_chain_checkpoint(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    const ProtobufCBinaryData *sign_public_key,
+    const ProtobufCBinaryData *checkpoint_chain_key,
+    uint32_t checkpoint_sequence
+);
+
+/**
+ * @brief Keep the message key of a skipped sequence of an inbound group session.
+ * The oldest key is dropped once E2EES_GROUP_MSG_MAX_SKIPPED_KEYS keys are kept.
+ * The key is stored through the db handler if it supports skipped keys.
+ *
+ * @param sender_address
+ * @param owner_address
+ * @param session_id
+ * @param sequence
+ * @param msg_key
+ */
+void store_group_msg_skipped_key(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *msg_key
+);
+
+/**
+ * @brief Take out the message key of a skipped sequence of an inbound group session.
+ *
+ * @param msg_key_out
+ * @param sender_address
+ * @param owner_address
+ * @param session_id
+ * @param sequence
+ * @return E2EES_RESULT_SUCC if the key is found
+ */
+int take_group_msg_skipped_key(
+    ProtobufCBinaryData *msg_key_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    uint32_t sequence
+);
+
+/**
+ * @brief Turn on or off the chain state shared by the owners hosted in this process.
+ *
+ * Every owner of an inbound group session derives the same chain keys from the
+ * same sender. With sharing on, a chain key derived for one owner is kept by
+ * (session_id, sender, chain_id) and taken by the other owners instead of being derived
+ * again, while the cached session of each owner stays its cursor over the chain.
+ * The chain id is the one of the shared group session in the database, or is taken
+ * over the associated data and the chain state loaded, so a chain that is only
+ * reused under the same session id and sender is never taken for another one.
+ * A chain key is shared only after a message has been decrypted with it.
+ * It is off by default.
+ *
+ * @param enabled
+ */
+void set_group_chain_sharing(bool enabled);
+
+/**
+ * @brief Get the shared chain key of a sequence if an owner has derived it.
+ *
+ * @param chain_key_out replaced only if the key is found
+ * @param sender_address
+ * @param session_id
+ * @param chain_id the chain id of the cached session, the key is not shared if empty
+ * @param sequence
+ * @return true if the key is found
+ */
+bool load_shared_group_chain_key(
+    ProtobufCBinaryData *chain_key_out,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    const ProtobufCBinaryData *chain_id,
+    uint32_t sequence
+);
+
+/**
+ * @brief Share the chain key of a sequence with the other owners.
+ * The last E2EES_GROUP_SHARED_CHAIN_KEYS sequences are kept.
+ *
+ * @param sender_address
+ * @param session_id
+ * @param chain_id the chain id of the cached session, the key is not shared if empty
+ * @param sequence
+ * @param chain_key
+ */
+void store_shared_group_chain_key(
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    const ProtobufCBinaryData *chain_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *chain_key
+);
+
+/**
+ * @brief Get a copy of the cached group info record of an owner.
+ *
+ * @param group_info_out
+ * @param version_out
+ * @param owner_address
+ * @param group_address
+ * @return E2EES_RESULT_SUCC if the record is cached
+ */
+int load_group_info_cacheer(
+    E2ees__GroupInfo **group_info_out,
+    uint64_t *version_out,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address
+);
+
+/**
+ * @brief Cache a copy of the latest group info record of an owner.
+ *
+ * @param owner_address
+ * @param group_info
+ * @param version
+ */
+void update_group_info_cacheer(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__GroupInfo *group_info,
+    uint64_t version
+);
+
+/**
+ * @brief Write back and drop all of the cached inbound group sessions of an owner.
+ * This should be called before loading, renewing or unloading the group sessions of the owner.
+ * The shared chains that no owner has a cursor on any more and the cached group
+ * info records of the owner are dropped too.
+ *
+ * @param owner_address
+ */
+void flush_group_session_cache(E2ees__E2eeAddress *owner_address);
+
+/**
+ * @brief Release a copy returned by load_group_session_cacheer().
+ *
+ * @param cacheer
+ */
+void free_group_session_cacheer(group_session_cacheer **cacheer);
+
+/**
+ * @brief Write back and release all of the cached inbound group sessions.
+ */
+void free_group_session_cache();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* GROUP_SESSION_CACHE_H_ */
@@ -235,6 +235,109 @@ bool consume_leave_group_msg(
     E2ees__LeaveGroupMsg *msg
 );
 
+/**
+ * @brief Reserve the sequences of a number of group messages.
+ * The chain key of the outbound group session is advanced and stored before the
+ * messages are sent, so that several messages can be in flight at the same time.
+ * @param outbound_group_session_out the outbound group session after the reservation
+ * @param chain_keys_out the chain keys of the reserved sequences
+ * @param first_sequence_out the first reserved sequence
+ * @param sender_address
+ * @param group_address
+ * @param msg_num
+ * @return 0 if success
+ */
+int reserve_group_msg_sequences(
+    E2ees__GroupSession **outbound_group_session_out,
+    ProtobufCBinaryData **chain_keys_out,
+    uint32_t *first_sequence_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *group_address,
+    size_t msg_num
+);
+
+/**
+ * @brief Create a SendGroupMsgRequest message with a reserved sequence.
+ * @param request_out
+ * @param outbound_group_session
+ * @param chain_key the chain key of the reserved sequence
+ * @param sequence the reserved sequence
+ * @param notif_level
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @param allow_list
+ * @param allow_list_len
+ * @param deny_list
+ * @param deny_list_len
+ * @return 0 if success
+ */
+int produce_send_group_msg_request_by_sequence(
+    E2ees__SendGroupMsgRequest **request_out,
+    E2ees__GroupSession *outbound_group_session,
+    const ProtobufCBinaryData *chain_key,
+    uint32_t sequence,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    E2ees__E2eeAddress **allow_list,
+    size_t allow_list_len,
+    E2ees__E2eeAddress **deny_list,
+    size_t deny_list_len
+);
+
+/**
+ * @brief Validate and copy the allow list and deny list of filtered group msgs once.
+ * The copied lists are sorted and the duplicated addresses are dropped.
+ * @param filter_out
+ * @param allow_list
+ * @param allow_list_len
+ * @param deny_list
+ * @param deny_list_len
+ * @return 0 if success
+ */
+int new_group_msg_filter(
+    e2ees_group_msg_filter_t **filter_out,
+    E2ees__E2eeAddress **allow_list,
+    size_t allow_list_len,
+    E2ees__E2eeAddress **deny_list,
+    size_t deny_list_len
+);
+
+/**
+ * @brief Release a group msg filter.
+ * @param filter
+ */
+void free_group_msg_filter(e2ees_group_msg_filter_t **filter);
+
+/**
+ * @brief Create a SendGroupMsgRequest message with a reserved sequence and a group msg filter.
+ * The request borrows the addresses of the filter, so it must be released with
+ * free_send_group_msg_request_with_filter() while the filter is still alive.
+ * @param request_out
+ * @param outbound_group_session
+ * @param chain_key the chain key of the reserved sequence
+ * @param sequence the reserved sequence
+ * @param notif_level
+ * @param plaintext_data
+ * @param plaintext_data_len
+ * @param filter
+ * @return 0 if success
+ */
+int produce_send_group_msg_request_with_filter(
+    E2ees__SendGroupMsgRequest **request_out,
+    E2ees__GroupSession *outbound_group_session,
+    const ProtobufCBinaryData *chain_key,
+    uint32_t sequence,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    const e2ees_group_msg_filter_t *filter
+);
+
+/**
+ * @brief Give the borrowed addresses back to the filter and release the request.
+ * @param request
+ */
+void free_send_group_msg_request_with_filter(E2ees__SendGroupMsgRequest **request);
+
 /**
  * @brief Create a SendGroupMsgRequest message to be sent to server.
  * @param request_out
@@ -261,12 +364,16 @@ int produce_send_group_msg_request(
 
 /**
  * @brief Process an incoming SendGroupMsgResponse message.
+ * The chain key has been advanced when the sequence was reserved. A request that
+ * was produced before the reservation moves the outbound group session past it.
  * @param outbound_group_session
+ * @param request
  * @param response
  * @return 0 if success
  */
 int consume_send_group_msg_response(
     E2ees__GroupSession *outbound_group_session,
+    E2ees__SendGroupMsgRequest *request,
     E2ees__SendGroupMsgResponse *response
 );
 
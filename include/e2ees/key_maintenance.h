@@ -0,0 +1,75 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef KEY_MAINTENANCE_H_
+#define KEY_MAINTENANCE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "e2ees/e2ees.h"
+
+/**
+ * @brief Generate a new signed pre-key for the account and publish it.
+ * The new signed pre-key is saved by consume_publish_spk_response.
+ *
+ * @param account
+ * @return 0 if success
+ */
+int rotate_signed_pre_key(E2ees__Account *account);
+
+/**
+ * @brief Rotate the signed pre-keys of all accounts that expire within
+ * E2EES_SIGNED_PRE_KEY_ROTATION_LEAD_MS on the worker pool. If the host provides
+ * common_handler.schedule_task, the next pass is scheduled when the earliest
+ * signed pre-key is due.
+ *
+ * @return number of rotated signed pre-keys
+ */
+size_t run_key_maintenance();
+
+/**
+ * @brief Schedule a key maintenance pass on the host after delay_ms.
+ * Only one pass is scheduled at a time.
+ *
+ * @param delay_ms
+ * @return true if the pass is scheduled, false if schedule_task is not provided
+ */
+bool schedule_key_maintenance(int64_t delay_ms);
+
+/**
+ * @brief Supply a number of one-time pre-keys to the server. The keys are generated
+ * on the host by common_handler.schedule_task if provided, otherwise right away.
+ * The supplies of an account are run one after another, so the one-time pre-key ids
+ * are not reused.
+ *
+ * @param address
+ * @param opks_num
+ */
+void schedule_supply_opks(E2ees__E2eeAddress *address, uint32_t opks_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* KEY_MAINTENANCE_H_ */
@@ -74,6 +74,7 @@ enum LogCode {
   BAD_GROUP_INFO = 6007,
   BAD_GROUP_SEED = 6008,
   BAD_GROUP_CHAIN_KEY = 6009,
+  BAD_GROUP_MSG_OVERTAKEN = 6010,
   BAD_GROUP_PRE_KEY_BUNDLE = 6101,
   BAD_GROUP_UPDATE_KEY_BUNDLE = 6102,
 
@@ -129,6 +130,7 @@ enum LogCode {
 
   // plaintext
   BAD_PLAINTEXT = 8001,
+  BAD_PENDING_PLAINTEXT = 8002,
 
   // server signature
   BAD_SERVER_SIGNATURE = 9001,
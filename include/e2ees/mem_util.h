@@ -423,8 +423,62 @@ void copy_remove_group_members_msg(E2ees__RemoveGroupMembersMsg **dest, E2ees__R
  */
 void copy_leave_group_msg(E2ees__LeaveGroupMsg **dest, E2ees__LeaveGroupMsg *src);
 
+/**
+ * @brief A hash index of group members keyed by (user_id, domain).
+ *
+ * members keeps the insertion order for serialization. The members
+ * themselves are not owned by the index.
+ */
+typedef struct group_member_index_t {
+    E2ees__GroupMember **members;
+    size_t members_num;
+    size_t members_capacity;
+    size_t *slots;
+    uint32_t *slot_hashes;
+    size_t slots_num;
+} group_member_index_t;
+
+/**
+ * @brief Build a group member index. A member that appears more than once is only indexed once.
+ *
+ * @param index
+ * @param members
+ * @param members_num
+ */
+void init_group_member_index(group_member_index_t *index, E2ees__GroupMember **members, size_t members_num);
+
+/**
+ * @brief Find a group member in the index.
+ *
+ * @param index
+ * @param user_id
+ * @param domain
+ * @param position_out the position of the member in index->members, can be NULL
+ * @return true if the member is found
+ */
+bool find_group_member_in_index(
+    const group_member_index_t *index, const char *user_id, const char *domain, size_t *position_out
+);
+
+/**
+ * @brief Append a group member to the index if it is not there yet.
+ *
+ * @param index
+ * @param member
+ * @return true if the member is appended
+ */
+bool insert_group_member_into_index(group_member_index_t *index, E2ees__GroupMember *member);
+
+/**
+ * @brief Release the memory of a group member index, the indexed members are not released.
+ *
+ * @param index
+ */
+void free_group_member_index(group_member_index_t *index);
+
 /**
  * @brief Add new E2ees__GroupMember array to dest.
+ * The members that are already in old_group_info are skipped.
  *
  * @param dest
  * @param old_group_info
@@ -440,6 +494,7 @@ void add_group_members_to_group_info(
 
 /**
  * @brief Remove some E2ees__GroupMember from old_group_info.
+ * The members are matched by user_id and domain in any order.
  *
  * @param dest
  * @param old_group_info
@@ -486,7 +541,7 @@ size_t member_info_to_group_members(
 void free_e2ee_addresses(E2ees__E2eeAddress ***dest, size_t e2ee_addresses_num);
 
 /**
- * @brief Release memory of E2ees__InviteResponse array.
+ * @brief Release memory of E2ees__InviteResponse array, skipping the entries left NULL.
  *
  * @param dest
  * @param invite_response_num
@@ -501,6 +556,38 @@ void free_invite_response_list(E2ees__InviteResponse ***dest, size_t invite_resp
  */
 void free_group_members(E2ees__GroupMember ***dest, size_t group_members_num);
 
+/**
+ * @brief Release memory of e2ees_session_header_t array.
+ *
+ * @param dest
+ * @param session_headers_num
+ */
+void free_session_headers(e2ees_session_header_t **dest, size_t session_headers_num);
+
+/**
+ * @brief Release memory of e2ees_pending_plaintext_t array.
+ *
+ * @param dest
+ * @param pending_plaintext_num
+ */
+void free_pending_plaintext_list(e2ees_pending_plaintext_t **dest, size_t pending_plaintext_num);
+
+/**
+ * @brief Release memory of e2ees_session_establishment_t array.
+ *
+ * @param dest
+ * @param session_establishments_num
+ */
+void free_session_establishments(e2ees_session_establishment_t **dest, size_t session_establishments_num);
+
+/**
+ * @brief Release memory of e2ees_account_header_t array.
+ *
+ * @param dest
+ * @param account_headers_num
+ */
+void free_account_headers(e2ees_account_header_t **dest, size_t account_headers_num);
+
 /**
  * @brief Release memory of ProtobufCBinaryData.
  *
@@ -0,0 +1,143 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef PENDING_REQUEST_CACHE_H_
+#define PENDING_REQUEST_CACHE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "e2ees/e2ees.h"
+
+typedef struct pending_request_backoff {
+    E2ees__E2eeAddress *address;
+    uint8_t request_type;
+    uint32_t failures;
+    int64_t next_retry_ts;
+    struct pending_request_backoff *next;
+} pending_request_backoff;
+
+typedef struct pending_request_retry {
+    E2ees__E2eeAddress *address;
+    struct pending_request_retry *next;
+} pending_request_retry;
+
+typedef struct pending_request_attempt {
+    char *request_id;
+    uint32_t attempts;
+    struct pending_request_attempt *next;
+} pending_request_attempt;
+
+/**
+ * @brief Get the base retry interval of a given pending request type.
+ *
+ * @param request_type
+ * @return the interval in milliseconds
+ */
+int64_t get_pending_request_retry_base_ms(uint8_t request_type);
+
+/**
+ * @brief Check if the pending requests of a given type can be replayed now.
+ *
+ * @param address
+ * @param request_type
+ * @param now
+ * @return true if the backoff time has passed
+ */
+bool is_pending_request_type_ready(E2ees__E2eeAddress *address, uint8_t request_type, int64_t now);
+
+/**
+ * @brief Record a failed replay of a given type and double the backoff time.
+ *
+ * @param address
+ * @param request_type
+ * @param now
+ */
+void mark_pending_request_type_failed(E2ees__E2eeAddress *address, uint8_t request_type, int64_t now);
+
+/**
+ * @brief Record a successful replay of a given type and reset the backoff time.
+ *
+ * @param address
+ * @param request_type
+ */
+void mark_pending_request_type_succeeded(E2ees__E2eeAddress *address, uint8_t request_type);
+
+/**
+ * @brief Get the earliest time that a backed-off type of an account can be replayed.
+ *
+ * @param address
+ * @return the time in milliseconds, INT64_MAX if no type is backed off
+ */
+int64_t get_pending_request_next_retry_ts(E2ees__E2eeAddress *address);
+
+/**
+ * @brief Mark a retry of the pending requests of an account as scheduled.
+ * Only one retry is scheduled for each account at a time.
+ *
+ * @param address
+ * @return true if no retry has been scheduled for the account
+ */
+bool mark_pending_request_retry_scheduled(E2ees__E2eeAddress *address);
+
+/**
+ * @brief Clear the scheduled mark of an account when its retry is run.
+ *
+ * @param address
+ */
+void clear_pending_request_retry_scheduled(E2ees__E2eeAddress *address);
+
+/**
+ * @brief Increase the attempt count of a pending request in memory,
+ *        used when the db handler does not count the attempts.
+ *
+ * @param request_id
+ * @return the attempt count after increasing
+ */
+uint32_t increase_pending_request_attempts(const char *request_id);
+
+/**
+ * @brief Get the attempt count of a pending request.
+ *
+ * @param request_id
+ * @return the attempt count
+ */
+uint32_t get_pending_request_attempts(const char *request_id);
+
+/**
+ * @brief Forget the attempt count of a pending request that has been unloaded.
+ *
+ * @param request_id
+ */
+void remove_pending_request_attempts(const char *request_id);
+
+/**
+ * @brief Release all of the cached backoff states and attempt counts.
+ */
+void free_pending_request_cache();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PENDING_REQUEST_CACHE_H_ */
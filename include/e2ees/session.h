@@ -68,6 +68,24 @@ typedef struct session_suite_t {
         E2ees__Session **,
         E2ees__AcceptMsg *
     );
+
+    /**
+     * @brief Create new outbound sessions for several pre-key bundles at once.
+     *        Optional, leave it NULL to call new_outbound_session for each bundle.
+     *        The bundles share one e2ees pack.
+     *
+     * @param response_list The output invite responses, one for each bundle, NULL if it failed
+     * @param from The sender's address
+     * @param their_pre_key_bundles Their pre-key bundles
+     * @param their_pre_key_bundles_num The number of pre-key bundles
+     * @return number of sessions that have been created and invited
+     */
+    size_t (*new_outbound_sessions)(
+        E2ees__InviteResponse **,
+        E2ees__E2eeAddress *,
+        E2ees__PreKeyBundle **,
+        size_t
+    );
 } session_suite_t;
 
 /* common */
@@ -118,6 +136,13 @@ int pqc_new_outbound_session_v2(
     E2ees__PreKeyBundle *their_pre_key_bundle
 );
 
+size_t pqc_new_outbound_sessions(
+    E2ees__InviteResponse **response_list,
+    E2ees__E2eeAddress *from,
+    E2ees__PreKeyBundle **their_pre_key_bundles,
+    size_t their_pre_key_bundles_num
+);
+
 int pqc_new_inbound_session(
     E2ees__Session **inbound_session_out,
     E2ees__Account *local_account,
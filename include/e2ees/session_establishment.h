@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SESSION_ESTABLISHMENT_H_
+#define SESSION_ESTABLISHMENT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "e2ees/e2ees.h"
+
+/**
+ * @brief Keep the step of the session establishment from our_address to their_address,
+ * so that an interrupted session establishment can be resumed from this step.
+ * Nothing is kept if the db does not provide the session establishment handlers.
+ *
+ * @param our_address
+ * @param their_address
+ * @param step
+ */
+void store_session_establishment_step(
+    E2ees__E2eeAddress *our_address,
+    E2ees__E2eeAddress *their_address,
+    e2ees_session_establishment_step_t step
+);
+
+/**
+ * @brief Drop the session establishment from our_address to their_address
+ * when it is finished or there is nothing left to resume.
+ *
+ * @param our_address
+ * @param their_address
+ */
+void finish_session_establishment(
+    E2ees__E2eeAddress *our_address,
+    E2ees__E2eeAddress *their_address
+);
+
+/**
+ * @brief Move an unfinished session establishment forward from its stored step.
+ *
+ * @param account
+ * @param session_establishment
+ * @return 0 if success
+ */
+int advance_session_establishment(
+    E2ees__Account *account,
+    e2ees_session_establishment_t *session_establishment
+);
+
+/**
+ * @brief Resume the unfinished session establishments of an account on the worker pool.
+ *
+ * @param account
+ * @return number of resumed session establishments
+ */
+size_t resume_session_establishments(E2ees__Account *account);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SESSION_ESTABLISHMENT_H_ */
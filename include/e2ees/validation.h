@@ -17,6 +17,8 @@ bool is_valid_cipher_suite(const cipher_suite_t *cipher_suite);
 
 bool is_valid_e2ees_pack_id(uint32_t e2ees_pack_id);
 
+bool is_valid_session_suite(const struct session_suite_t *session_suite);
+
 bool is_valid_protobuf(const ProtobufCBinaryData *src);
 
 bool is_valid_protobuf_list(ProtobufCBinaryData *src, size_t len);
@@ -24,12 +24,11 @@
 #include "e2ees/account_manager.h"
 #include "e2ees/cipher.h"
 #include "e2ees/e2ees_client_internal.h"
+#include "e2ees/key_maintenance.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/validation.h"
 
 void account_begin() {
-    int ret = E2EES_RESULT_SUCC;
-
     // load accounts that may be null
     E2ees__Account **accounts = NULL;
     size_t account_num = get_e2ees_plugin()->db_handler.load_accounts(&accounts);
@@ -41,29 +40,10 @@ void account_begin() {
         cur_account = accounts[i];
 
         if (is_valid_registered_account(cur_account)) {
-            // check if the signed pre-key expired
+            // check if the signed pre-key expired, it is rotated later if the host can schedule it
             now = get_e2ees_plugin()->common_handler.gen_ts();
-            if (now > cur_account->signed_pre_key->ttl) {
-                uint32_t e2ees_pack_id = cur_account->e2ees_pack_id;
-                uint32_t cur_spk_id = cur_account->signed_pre_key->spk_id;
-                E2ees__SignedPreKey *signed_pre_key = NULL;
-                uint8_t *identity_private_key = cur_account->identity_key->sign_key_pair->private_key.data;
-                // generate a new pair of signed pre-key
-                ret = generate_signed_pre_key(&signed_pre_key, e2ees_pack_id, cur_spk_id, identity_private_key);
-
-                if (ret == E2EES_RESULT_SUCC) {
-                    // release the old signed pre-key
-                    e2ees__signed_pre_key__free_unpacked(cur_account->signed_pre_key, NULL);
-                    cur_account->signed_pre_key = signed_pre_key;
-
-                    E2ees__PublishSpkResponse *response = NULL;
-                    ret = publish_spk_internal(&response, cur_account);
-                    // release
-                    if (response != NULL) {
-                        e2ees__publish_spk_response__free_unpacked(response, NULL);
-                        response = NULL;
-                    }
-                }
+            if (now > cur_account->signed_pre_key->ttl && get_e2ees_plugin()->common_handler.schedule_task == NULL) {
+                rotate_signed_pre_key(cur_account);
             }
 
             // check and remove signed pre-keys (keep last two)
@@ -87,6 +67,10 @@ void account_begin() {
     if (accounts != NULL) {
         free_mem((void **)&accounts, sizeof(E2ees__Account *) * account_num);
     }
+
+    if (account_num > 0) {
+        schedule_key_maintenance(0);
+    }
 }
 
 void account_end() {
@@ -313,26 +297,95 @@ int generate_signed_pre_key(
     return ret;
 }
 
-E2ees__OneTimePreKey *lookup_one_time_pre_key(E2ees__Account *account, uint32_t one_time_pre_key_id) {
-    E2ees__OneTimePreKey **cur = account->one_time_pre_key_list;
-    if (cur == NULL) {
-        // there is no one-tme pre-keys in the account
-        e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "lookup_one_time_pre_key() opk not found");
+static E2ees__OneTimePreKey *load_one_time_pre_key_into_account(E2ees__Account *account, uint32_t one_time_pre_key_id) {
+    if (get_e2ees_plugin()->db_handler.load_one_time_pre_key == NULL) {
         return NULL;
     }
 
-    size_t i;
-    for (i = 0; i < account->n_one_time_pre_key_list; i++) {
-        if (cur[i] != NULL) {
-            if (cur[i]->opk_id == one_time_pre_key_id) {
-                return cur[i];
-            }
+    E2ees__OneTimePreKey *one_time_pre_key = NULL;
+    get_e2ees_plugin()->db_handler.load_one_time_pre_key(account->address, one_time_pre_key_id, &one_time_pre_key);
+    if (!is_valid_one_time_pre_key(one_time_pre_key)) {
+        if (one_time_pre_key != NULL) {
+            e2ees__one_time_pre_key__free_unpacked(one_time_pre_key, NULL);
+        }
+        return NULL;
+    }
+
+    // the account takes the ownership so that it can be marked as used later,
+    // the list is kept in the order of the ids so that it can be searched
+    size_t n_one_time_pre_key_list = account->n_one_time_pre_key_list;
+    account->one_time_pre_key_list = (E2ees__OneTimePreKey **)realloc(
+        account->one_time_pre_key_list, sizeof(E2ees__OneTimePreKey *) * (n_one_time_pre_key_list + 1)
+    );
+    size_t pos = n_one_time_pre_key_list;
+    while (pos > 0 && account->one_time_pre_key_list[pos - 1]->opk_id > one_time_pre_key_id) {
+        pos--;
+    }
+    memmove(
+        &(account->one_time_pre_key_list[pos + 1]), &(account->one_time_pre_key_list[pos]),
+        sizeof(E2ees__OneTimePreKey *) * (n_one_time_pre_key_list - pos)
+    );
+    account->one_time_pre_key_list[pos] = one_time_pre_key;
+    account->n_one_time_pre_key_list = n_one_time_pre_key_list + 1;
+
+    return one_time_pre_key;
+}
+
+/**
+ * The one-time pre-keys are generated with consecutive ids and appended in
+ * order, so the offset from the first id is the position of a key unless some
+ * of them were not loaded. In that case the sorted list is binary searched.
+ * Returns n_one_time_pre_key_list if the id is not in the list.
+ */
+static size_t find_one_time_pre_key(E2ees__Account *account, uint32_t one_time_pre_key_id) {
+    E2ees__OneTimePreKey **cur = account->one_time_pre_key_list;
+    size_t n = account->n_one_time_pre_key_list;
+
+    if (cur == NULL || n == 0 || cur[0] == NULL) {
+        return n;
+    }
+
+    uint32_t first_opk_id = cur[0]->opk_id;
+    if (one_time_pre_key_id < first_opk_id) {
+        return n;
+    }
+    size_t i = (size_t)(one_time_pre_key_id - first_opk_id);
+    if (i < n && cur[i] != NULL && cur[i]->opk_id == one_time_pre_key_id) {
+        return i;
+    }
+
+    size_t low = 0, high = i < n ? i : n;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (cur[mid] == NULL) {
+            e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "find_one_time_pre_key() the number of opks does not match");
+            return n;
+        }
+        if (cur[mid]->opk_id == one_time_pre_key_id) {
+            return mid;
+        } else if (cur[mid]->opk_id < one_time_pre_key_id) {
+            low = mid + 1;
         } else {
-            e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "lookup_one_time_pre_key() the number of opks does not match");
-            break;
+            high = mid;
         }
     }
-    return NULL;
+    return n;
+}
+
+E2ees__OneTimePreKey *lookup_one_time_pre_key(E2ees__Account *account, uint32_t one_time_pre_key_id) {
+    E2ees__OneTimePreKey *one_time_pre_key = NULL;
+
+    size_t i = find_one_time_pre_key(account, one_time_pre_key_id);
+    if (i < account->n_one_time_pre_key_list) {
+        return account->one_time_pre_key_list[i];
+    }
+
+    // the account may be loaded without all of its one-time pre-keys
+    one_time_pre_key = load_one_time_pre_key_into_account(account, one_time_pre_key_id);
+    if (one_time_pre_key == NULL) {
+        e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "lookup_one_time_pre_key() opk not found");
+    }
+    return one_time_pre_key;
 }
 
 int generate_opks(
@@ -410,13 +463,8 @@ int generate_opks(
 int insert_opks(E2ees__Account *account, E2ees__OneTimePreKey **src, size_t src_num) {
     int ret = E2EES_RESULT_SUCC;
 
-    size_t i, j;
     size_t old_opk_num;
     size_t new_opk_num;
-    E2ees__OneTimePreKey **temp_one_time_pre_key_list = NULL;
-    E2ees__OneTimePreKey **cur_one_time_pre_key_list = NULL;
-    E2ees__OneTimePreKey *cur_one_time_pre_key = NULL;
-    E2ees__KeyPair *cur_key_pair = NULL;
 
     if (is_valid_one_time_pre_key_list(account->one_time_pre_key_list, account->n_one_time_pre_key_list)) {
         old_opk_num = account->n_one_time_pre_key_list;
@@ -425,100 +473,47 @@ int insert_opks(E2ees__Account *account, E2ees__OneTimePreKey **src, size_t src_
         e2ees_notify_log(NULL, BAD_ONE_TIME_PRE_KEY, "insert_opks()");
         ret = E2EES_RESULT_FAIL;
     }
+    if (src == NULL || src_num == 0) {
+        e2ees_notify_log(NULL, BAD_ONE_TIME_PRE_KEY, "insert_opks() no one-time pre-keys");
+        ret = E2EES_RESULT_FAIL;
+    }
 
     if (ret == E2EES_RESULT_SUCC) {
         if (old_opk_num == 0) {
             // there is no one-tme pre-keys in the account
             account->one_time_pre_key_list = src;
-            account->n_one_time_pre_key_list = src_num;
-            account->next_one_time_pre_key_id = src[src_num - 1]->opk_id + 1;
         } else {
-            // there are several one-time pre-keys in the account
-            temp_one_time_pre_key_list = (E2ees__OneTimePreKey **)malloc(sizeof(E2ees__OneTimePreKey *) * new_opk_num);
-
-            cur_one_time_pre_key_list = account->one_time_pre_key_list;
-            for (i = 0; i < old_opk_num; i++) {
-                temp_one_time_pre_key_list[i] = (E2ees__OneTimePreKey *)malloc(sizeof(E2ees__OneTimePreKey));
-                e2ees__one_time_pre_key__init(temp_one_time_pre_key_list[i]);
-
-                cur_one_time_pre_key = cur_one_time_pre_key_list[i];
-                temp_one_time_pre_key_list[i]->opk_id = cur_one_time_pre_key->opk_id;
-                temp_one_time_pre_key_list[i]->used = cur_one_time_pre_key->used;
-                temp_one_time_pre_key_list[i]->key_pair = (E2ees__KeyPair *)malloc(sizeof(E2ees__KeyPair));
-                cur_key_pair = temp_one_time_pre_key_list[i]->key_pair;
-                e2ees__key_pair__init(cur_key_pair);
-                copy_protobuf_from_protobuf(&(cur_key_pair->private_key), &(cur_one_time_pre_key->key_pair->private_key));
-                copy_protobuf_from_protobuf(&(cur_key_pair->public_key), &(cur_one_time_pre_key->key_pair->public_key));
-
-                // release the old data
-                e2ees__one_time_pre_key__free_unpacked(cur_one_time_pre_key, NULL);
-                cur_one_time_pre_key = NULL;
-            }
-            free_mem((void **)&(cur_one_time_pre_key_list), sizeof(E2ees__OneTimePreKey *) * old_opk_num);
-
-            for (i = 0; i < src_num; i++) {
-                j = old_opk_num + i;
-                temp_one_time_pre_key_list[j] = (E2ees__OneTimePreKey *)malloc(sizeof(E2ees__OneTimePreKey));
-                e2ees__one_time_pre_key__init(temp_one_time_pre_key_list[j]);
-
-                cur_one_time_pre_key = src[i];
-                temp_one_time_pre_key_list[j]->opk_id = cur_one_time_pre_key->opk_id;
-                temp_one_time_pre_key_list[j]->used = cur_one_time_pre_key->used;
-                temp_one_time_pre_key_list[j]->key_pair = (E2ees__KeyPair *)malloc(sizeof(E2ees__KeyPair));
-                cur_key_pair = temp_one_time_pre_key_list[j]->key_pair;
-                e2ees__key_pair__init(cur_key_pair);
-                copy_protobuf_from_protobuf(&(cur_key_pair->private_key), &(cur_one_time_pre_key->key_pair->private_key));
-                copy_protobuf_from_protobuf(&(cur_key_pair->public_key), &(cur_one_time_pre_key->key_pair->public_key));
-            }
-
-            account->one_time_pre_key_list = temp_one_time_pre_key_list;
-            account->n_one_time_pre_key_list = new_opk_num;
-            account->next_one_time_pre_key_id = src[src_num - 1]->opk_id + 1;
+            // there are several one-time pre-keys in the account, the new keys are moved to the end of the list
+            account->one_time_pre_key_list = (E2ees__OneTimePreKey **)realloc(
+                account->one_time_pre_key_list, sizeof(E2ees__OneTimePreKey *) * new_opk_num
+            );
+            memcpy(&(account->one_time_pre_key_list[old_opk_num]), src, sizeof(E2ees__OneTimePreKey *) * src_num);
+            free_mem((void **)&src, sizeof(E2ees__OneTimePreKey *) * src_num);
         }
+        account->n_one_time_pre_key_list = new_opk_num;
+        account->next_one_time_pre_key_id = account->one_time_pre_key_list[new_opk_num - 1]->opk_id + 1;
     }
 
     return ret;
 }
 
 int mark_opk_as_used(E2ees__Account *account, uint32_t id) {
-    E2ees__OneTimePreKey **cur = account->one_time_pre_key_list;
-    if (cur == NULL) {
+    if (account->one_time_pre_key_list == NULL) {
         // there is no one-tme pre-keys in the account
         e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "mark_opk_as_used() opk not found");
         return -1;
     }
 
-    size_t i;
-    for (i = 0; i < account->n_one_time_pre_key_list; i++) {
-        if (cur[i] != NULL) {
-            if (cur[i]->opk_id == id) {
-                cur[i]->used = true;
-                return cur[i]->opk_id;
-            }
-        } else {
-            e2ees_notify_log(account->address, BAD_ONE_TIME_PRE_KEY, "mark_opk_as_used() the number of opks does not match");
-            break;
-        }
+    size_t i = find_one_time_pre_key(account, id);
+    if (i < account->n_one_time_pre_key_list) {
+        account->one_time_pre_key_list[i]->used = true;
+        return account->one_time_pre_key_list[i]->opk_id;
     }
 
     e2ees_notify_log(account->address, BAD_REMOVE_OPK, "mark_opk_as_used() opk id not found");
     return -1;
 }
 
-static void copy_one_time_pre_key_list(E2ees__OneTimePreKey **dest, E2ees__OneTimePreKey **src, size_t num) {
-    size_t i;
-    for (i = 0; i < num; i++) {
-        dest[i] = (E2ees__OneTimePreKey *)malloc(sizeof(E2ees__OneTimePreKey));
-        e2ees__one_time_pre_key__init(dest[i]);
-        dest[i]->opk_id = src[i]->opk_id;
-        dest[i]->used = src[i]->used;
-        dest[i]->key_pair = (E2ees__KeyPair *)malloc(sizeof(E2ees__KeyPair));
-        e2ees__key_pair__init(dest[i]->key_pair);
-        copy_protobuf_from_protobuf(&(dest[i]->key_pair->private_key), &(src[i]->key_pair->private_key));
-        copy_protobuf_from_protobuf(&(dest[i]->key_pair->public_key), &(src[i]->key_pair->public_key));
-    }
-}
-
 void free_one_time_pre_key(E2ees__Account *account) {
     size_t used_num = 0;
     size_t new_num;
@@ -534,23 +529,26 @@ void free_one_time_pre_key(E2ees__Account *account) {
                 }
             }
         }
-        // we release the "used" one-time pre-keys if there are many
+        // we release the "used" one-time pre-keys if there are many, the rest are moved ahead
         if (used_num >= 60) {
             new_num = account->n_one_time_pre_key_list - used_num;
-            E2ees__OneTimePreKey **new_one_time_pre_key_list = NULL;
-            if (new_num > 0) {
-                new_one_time_pre_key_list = (E2ees__OneTimePreKey **)malloc(sizeof(E2ees__OneTimePreKey *) * new_num);
-                E2ees__OneTimePreKey **temp = &(account->one_time_pre_key_list[used_num]);
-                copy_one_time_pre_key_list(new_one_time_pre_key_list, temp, new_num);
-            }
             for (i = 0; i < account->n_one_time_pre_key_list; i++) {
                 get_e2ees_plugin()->db_handler.remove_one_time_pre_key(account->address, account->one_time_pre_key_list[i]->opk_id);
+            }
+            for (i = 0; i < used_num; i++) {
                 e2ees__one_time_pre_key__free_unpacked(account->one_time_pre_key_list[i], NULL);
                 account->one_time_pre_key_list[i] = NULL;
             }
-            free_mem((void **)&(account->one_time_pre_key_list), sizeof(E2ees__OneTimePreKey *) * account->n_one_time_pre_key_list);
             if (new_num > 0) {
-                account->one_time_pre_key_list = new_one_time_pre_key_list;
+                memmove(
+                    account->one_time_pre_key_list, &(account->one_time_pre_key_list[used_num]),
+                    sizeof(E2ees__OneTimePreKey *) * new_num
+                );
+                account->one_time_pre_key_list = (E2ees__OneTimePreKey **)realloc(
+                    account->one_time_pre_key_list, sizeof(E2ees__OneTimePreKey *) * new_num
+                );
+            } else {
+                free_mem((void **)&(account->one_time_pre_key_list), sizeof(E2ees__OneTimePreKey *) * used_num);
             }
             account->n_one_time_pre_key_list = new_num;
         }
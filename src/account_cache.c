@@ -22,10 +22,13 @@
 #include <string.h>
 
 #include "e2ees/mem_util.h"
+#include "spin_lock.h"
 
 static account_cacheer *account_cacheer_list = NULL;
+static e2ees_spin_lock_t account_cache_lock = E2EES_SPIN_LOCK_INIT;
+static verified_signature_cacheer verified_signature_cache[E2EES_VERIFIED_SIGNATURE_CACHE_SIZE];
 
-void store_account_into_cache(E2ees__Account *account) {
+static void store_account_into_cache_locked(E2ees__Account *account) {
     if (account_cacheer_list == NULL) {
         account_cacheer_list = (account_cacheer *)malloc(sizeof(account_cacheer));
         account_cacheer_list->version = strdup(account->version);
@@ -69,63 +72,89 @@ void store_account_into_cache(E2ees__Account *account) {
     }
 }
 
-void load_version_from_cache(char **version_out, E2ees__E2eeAddress *address) {
+void store_account_into_cache(E2ees__Account *account) {
+    e2ees_spin_lock(&account_cache_lock);
+    store_account_into_cache_locked(account);
+    e2ees_spin_unlock(&account_cache_lock);
+}
+
+static account_cacheer *find_account_cacheer(E2ees__E2eeAddress *address) {
     account_cacheer *cur = account_cacheer_list;
     while (cur != NULL) {
         if (compare_address(cur->address, address)) {
-            *version_out = strdup(cur->version);
-            return;
+            return cur;
         }
         cur = cur->next;
     }
-    *version_out = NULL;
+    return NULL;
+}
+
+void load_version_from_cache(char **version_out, E2ees__E2eeAddress *address) {
+    e2ees_spin_lock(&account_cache_lock);
+    account_cacheer *cacheer = find_account_cacheer(address);
+    *version_out = (cacheer == NULL) ? NULL : strdup(cacheer->version);
+    e2ees_spin_unlock(&account_cache_lock);
 }
 
 void load_e2ees_pack_id_from_cache(uint32_t *e2ees_pack_id_out, E2ees__E2eeAddress *address) {
-    account_cacheer *cur = account_cacheer_list;
-    while (cur != NULL) {
-        if (compare_address(cur->address, address)) {
-            *e2ees_pack_id_out = cur->e2ees_pack_id;
-            return;
-        }
-        cur = cur->next;
-    }
-    *e2ees_pack_id_out = E2EES_PACK_ID_UNSPECIFIED;
+    e2ees_spin_lock(&account_cache_lock);
+    account_cacheer *cacheer = find_account_cacheer(address);
+    *e2ees_pack_id_out = (cacheer == NULL) ? E2EES_PACK_ID_UNSPECIFIED : cacheer->e2ees_pack_id;
+    e2ees_spin_unlock(&account_cache_lock);
 }
 
 void load_identity_key_from_cache(E2ees__IdentityKey **identity_key_out, E2ees__E2eeAddress *address) {
-    account_cacheer *cur = account_cacheer_list;
-    while (cur != NULL) {
-        if (compare_address(cur->address, address)) {
-            copy_ik_from_ik(identity_key_out, cur->identity_key);
-            return;
-        }
-        cur = cur->next;
+    e2ees_spin_lock(&account_cache_lock);
+    account_cacheer *cacheer = find_account_cacheer(address);
+    if (cacheer != NULL) {
+        copy_ik_from_ik(identity_key_out, cacheer->identity_key);
+    } else {
+        *identity_key_out = NULL;
     }
-    *identity_key_out = NULL;
+    e2ees_spin_unlock(&account_cache_lock);
 }
 
 void load_signed_pre_key_from_cache(E2ees__SignedPreKey **signed_pre_key_out, E2ees__E2eeAddress *address) {
-    account_cacheer *cur = account_cacheer_list;
-    while (cur != NULL) {
-        if (compare_address(cur->address, address)) {
-            copy_spk_from_spk(signed_pre_key_out, cur->signed_pre_key);
-            return;
-        }
-        cur = cur->next;
+    e2ees_spin_lock(&account_cache_lock);
+    account_cacheer *cacheer = find_account_cacheer(address);
+    if (cacheer != NULL) {
+        copy_spk_from_spk(signed_pre_key_out, cacheer->signed_pre_key);
+    } else {
+        *signed_pre_key_out = NULL;
     }
-    *signed_pre_key_out = NULL;
+    e2ees_spin_unlock(&account_cache_lock);
 }
 
 void load_server_public_key_from_cache(ProtobufCBinaryData *server_public_key, E2ees__E2eeAddress *address) {
-    account_cacheer *cur = account_cacheer_list;
-    while (cur != NULL) {
-        if (compare_address(cur->address, address)) {
-            copy_protobuf_from_protobuf(server_public_key, &(cur->server_public_key));
-            return;
-        }
-        cur = cur->next;
+    e2ees_spin_lock(&account_cache_lock);
+    account_cacheer *cacheer = find_account_cacheer(address);
+    if (cacheer != NULL) {
+        copy_protobuf_from_protobuf(server_public_key, &(cacheer->server_public_key));
     }
+    e2ees_spin_unlock(&account_cache_lock);
+}
+
+static size_t verified_signature_slot(const uint8_t *digest) {
+    size_t slot = ((size_t)digest[0] << 24) | ((size_t)digest[1] << 16) | ((size_t)digest[2] << 8) | (size_t)digest[3];
+    return slot % E2EES_VERIFIED_SIGNATURE_CACHE_SIZE;
+}
+
+bool load_verified_signature_from_cache(const ds_suite_t *ds_suite, const uint8_t *digest) {
+    e2ees_spin_lock(&account_cache_lock);
+    verified_signature_cacheer *cacheer = &(verified_signature_cache[verified_signature_slot(digest)]);
+    bool found = cacheer->ds_suite == ds_suite && memcmp(cacheer->digest, digest, SHA256_OUTPUT_LENGTH) == 0;
+    e2ees_spin_unlock(&account_cache_lock);
+
+    return found;
+}
+
+void store_verified_signature_into_cache(const ds_suite_t *ds_suite, const uint8_t *digest) {
+    e2ees_spin_lock(&account_cache_lock);
+    // a colliding signature simply takes over the slot
+    verified_signature_cacheer *cacheer = &(verified_signature_cache[verified_signature_slot(digest)]);
+    cacheer->ds_suite = ds_suite;
+    memcpy(cacheer->digest, digest, SHA256_OUTPUT_LENGTH);
+    e2ees_spin_unlock(&account_cache_lock);
 }
 
 static void free_account_cacheer(account_cacheer *cacheer) {
@@ -151,11 +180,16 @@ static void free_account_cacheer(account_cacheer *cacheer) {
 }
 
 void free_account_cacheer_list() {
+    e2ees_spin_lock(&account_cache_lock);
     account_cacheer *cur = account_cacheer_list;
     account_cacheer *temp;
     while (cur != NULL) {
         temp = cur;
         cur = cur->next;
         free_account_cacheer(temp);
+        free(temp);
     }
+    account_cacheer_list = NULL;
+    memset(verified_signature_cache, 0, sizeof(verified_signature_cache));
+    e2ees_spin_unlock(&account_cache_lock);
 }
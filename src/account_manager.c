@@ -25,6 +25,7 @@
 #include "e2ees/e2ees_client.h"
 #include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session.h"
+#include "e2ees/key_maintenance.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/validation.h"
 
@@ -276,6 +277,12 @@ int produce_supply_opks_request(
     if (is_valid_registered_account(account)) {
         e2ees_pack_id = account->e2ees_pack_id;
         cur_opk_id = account->next_one_time_pre_key_id;
+        // the new ids start after the one-time pre-keys that are still in the account
+        size_t i;
+        for (i = 0; i < account->n_one_time_pre_key_list; i++) {
+            if (account->one_time_pre_key_list[i]->opk_id >= cur_opk_id)
+                cur_opk_id = account->one_time_pre_key_list[i]->opk_id + 1;
+        }
     } else {
         e2ees_notify_log(NULL, BAD_ACCOUNT, "produce_supply_opks_request()");
         ret = E2EES_RESULT_FAIL;
@@ -305,13 +312,52 @@ int produce_supply_opks_request(
             copy_protobuf_from_protobuf(&(request->one_time_pre_key_public_list[i]->public_key), &(one_time_pre_key_list[i]->key_pair->public_key));
         }
 
+        // the account takes the ownership of the new one-time pre-keys
+        ret = insert_opks(account, one_time_pre_key_list, opks_num);
+        if (ret == E2EES_RESULT_SUCC) {
+            one_time_pre_key_list = NULL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // save to db before the public keys are published, so that the private keys
+        // are kept if the supply fails and is replayed from the pending request
+        uint32_t i;
+        for (i = 0; i < opks_num; i++) {
+            E2ees__OneTimePreKey *one_time_pre_key = lookup_one_time_pre_key(
+                account, request->one_time_pre_key_public_list[i]->opk_id
+            );
+            if (one_time_pre_key == NULL) {
+                ret = E2EES_RESULT_FAIL;
+                break;
+            }
+            get_e2ees_plugin()->db_handler.add_one_time_pre_key(account->address, one_time_pre_key);
+        }
+        if (get_e2ees_plugin()->db_handler.update_next_one_time_pre_key_id != NULL) {
+            get_e2ees_plugin()->db_handler.update_next_one_time_pre_key_id(account->address, account->next_one_time_pre_key_id);
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
         *request_out = request;
+    } else {
+        if (request != NULL) {
+            e2ees__supply_opks_request__free_unpacked(request, NULL);
+            request = NULL;
+        }
+        if (one_time_pre_key_list != NULL) {
+            uint32_t i;
+            for (i = 0; i < opks_num; i++) {
+                e2ees__one_time_pre_key__free_unpacked(one_time_pre_key_list[i], NULL);
+            }
+            free_mem((void **)&one_time_pre_key_list, sizeof(E2ees__OneTimePreKey *) * opks_num);
+        }
     }
 
     return ret;
 }
 
-int consume_supply_opks_response(E2ees__Account *account, uint32_t opks_num, E2ees__SupplyOpksResponse *response) {
+int consume_supply_opks_response(E2ees__Account *account, E2ees__SupplyOpksResponse *response) {
     int ret = E2EES_RESULT_SUCC;
 
     if (!is_valid_registered_account(account)) {
@@ -323,14 +369,8 @@ int consume_supply_opks_response(E2ees__Account *account, uint32_t opks_num, E2e
         ret = E2EES_RESULT_FAIL;
     }
 
-    if (ret == E2EES_RESULT_SUCC) {
-        size_t old_opks_num = account->n_one_time_pre_key_list - opks_num;
-        // save to db
-        size_t i;
-        for (i = 0; i < opks_num; i++) {
-            get_e2ees_plugin()->db_handler.add_one_time_pre_key(account->address, account->one_time_pre_key_list[old_opks_num + i]);
-        }
-    }
+    // the new one-time pre-keys were saved to db when the request was produced,
+    // so the account may be loaded without them when a pending request is replayed
 
     return ret;
 }
@@ -352,19 +392,18 @@ bool consume_supply_opks_msg(E2ees__E2eeAddress *receiver_address, E2ees__Supply
 
     uint32_t opks_num = msg->opks_num;
     E2ees__Account *account = NULL;
-    get_e2ees_plugin()->db_handler.load_account_by_address(receiver_address, &account);
+    load_account_without_opks_internal(&account, receiver_address);
 
     if (!is_valid_registered_account(account)) {
         e2ees_notify_log(receiver_address, BAD_ACCOUNT, "consume_supply_opks_msg()");
         return false;
     }
 
-    E2ees__SupplyOpksResponse *supply_opks_response = NULL;
-    supply_opks_internal(&supply_opks_response, account, opks_num);
+    // the key generation does not hold up the message processing if the host can schedule it
+    schedule_supply_opks(receiver_address, opks_num);
 
     // release
     free_proto(account);
-    free_proto(supply_opks_response);
 
     // done
     return true;
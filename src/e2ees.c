@@ -19,10 +19,15 @@
 #include "e2ees/e2ees.h"
 
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 
 #include "e2ees/account.h"
+#include "e2ees/e2ees_client_internal.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/mem_util.h"
+#include "e2ees/pending_request_cache.h"
+#include "spin_lock.h"
 
 extern struct ds_suite_t E2EES_CURVE25519_SIGN;
 extern struct ds_suite_t E2EES_MLDSA44;
@@ -62,13 +67,30 @@ extern struct kem_suite_t E2EES_MCELIECE8192128F;
 extern struct se_suite_t E2EES_AES256_SHA256;
 extern struct hash_suite_t E2EES_SHA256;
 
-cipher_suite_t E2EES_CIPHER_SUITE = { NULL, NULL, NULL };
-
-e2ees_pack_t E2EES_PACK = { NULL, NULL };
-
 extern struct session_suite_t E2EES_SESSION_ECC;
 extern struct session_suite_t E2EES_SESSION_PQC;
 
+/** Large enough to hold every supported combination of the algorithms. */
+#define E2EES_PACK_CACHE_SLOTS_IN_BITS 9
+#define E2EES_PACK_CACHE_SLOTS (1 << E2EES_PACK_CACHE_SLOTS_IN_BITS)
+
+/**
+ * @brief A resolved e2ees pack. Once a slot is filled it is never changed,
+ * so the returned pointers stay valid and can be shared by the worker threads.
+ */
+typedef struct e2ees_pack_cacheer {
+    uint32_t e2ees_pack_id_raw;
+    bool used;
+    cipher_suite_t cipher_suite;
+    e2ees_pack_t e2ees_pack;
+} e2ees_pack_cacheer;
+
+static e2ees_pack_cacheer e2ees_pack_cache[E2EES_PACK_CACHE_SLOTS];
+static e2ees_spin_lock_t e2ees_pack_cache_lock = E2EES_SPIN_LOCK_INIT;
+
+/** Unsupported ids are not cached, they are resolved into a per-thread slot instead. */
+static _Thread_local e2ees_pack_cacheer e2ees_pack_uncached;
+
 static e2ees_plugin_t *e2ees_plugin;
 
 void e2ees_begin(e2ees_plugin_t *plugin) {
@@ -77,8 +99,14 @@ void e2ees_begin(e2ees_plugin_t *plugin) {
 }
 
 void e2ees_end() {
+    // the completions of the submitted one2one messages still use the db handler,
+    // the ones that do not come in time are dropped after the plugin is detached
+    wait_outstanding_one2one_msgs_internal(E2EES_END_DRAIN_TIMEOUT_MS);
+    // write back the cached group chain states before the plugin is detached
+    free_group_session_cache();
     e2ees_plugin = NULL;
     account_end();
+    free_pending_request_cache();
 }
 
 e2ees_plugin_t *get_e2ees_plugin() { return e2ees_plugin; }
@@ -146,7 +174,7 @@ kem_suite_t *get_kem_suite(unsigned kem_id) {
         return &E2EES_MCELIECE348864F;
     } else if (kem_id == E2EES_PACK_ALG_KEM_MCELIECE460896) {
         return &E2EES_MCELIECE460896;
-    } else if (kem_id == E2EES_PACK_ALG_KEM_MCELIECE460896) {
+    } else if (kem_id == E2EES_PACK_ALG_KEM_MCELIECE460896F) {
         return &E2EES_MCELIECE460896F;
     } else if (kem_id == E2EES_PACK_ALG_KEM_MCELIECE6688128) {
         return &E2EES_MCELIECE6688128;
@@ -182,12 +210,7 @@ hash_suite_t *get_hash_suite(unsigned hash_id) {
 }
 
 cipher_suite_t *get_cipher_suite(e2ees_pack_id_t e2ees_pack_id) {
-    E2EES_CIPHER_SUITE.ds_suite = get_ds_suite(e2ees_pack_id.ds);
-    E2EES_CIPHER_SUITE.kem_suite = get_kem_suite(e2ees_pack_id.kem);
-    E2EES_CIPHER_SUITE.se_suite = get_se_suite(e2ees_pack_id.se);
-    E2EES_CIPHER_SUITE.hash_suite = get_hash_suite(e2ees_pack_id.hash);
-
-    return &E2EES_CIPHER_SUITE;
+    return get_e2ees_pack(e2ees_pack_id_to_raw(e2ees_pack_id))->cipher_suite;
 }
 
 uint32_t e2ees_pack_id_to_raw(e2ees_pack_id_t e2ees_pack_id) {
@@ -222,17 +245,76 @@ uint32_t gen_e2ees_pack_id_raw(
     return e2ees_pack_id_to_raw(e2ees_pack_id);
 }
 
-e2ees_pack_t *get_e2ees_pack(uint32_t e2ees_pack_id_raw) {
+static void resolve_e2ees_pack(e2ees_pack_cacheer *cacheer, uint32_t e2ees_pack_id_raw) {
     e2ees_pack_id_t e2ees_pack_id = raw_to_e2ees_pack_id(e2ees_pack_id_raw);
 
-    E2EES_PACK.cipher_suite = get_cipher_suite(e2ees_pack_id);
+    cacheer->e2ees_pack_id_raw = e2ees_pack_id_raw;
+    cacheer->cipher_suite.ds_suite = get_ds_suite(e2ees_pack_id.ds);
+    cacheer->cipher_suite.kem_suite = get_kem_suite(e2ees_pack_id.kem);
+    cacheer->cipher_suite.se_suite = get_se_suite(e2ees_pack_id.se);
+    cacheer->cipher_suite.hash_suite = get_hash_suite(e2ees_pack_id.hash);
+
+    cacheer->e2ees_pack.cipher_suite = &(cacheer->cipher_suite);
     if (e2ees_pack_id.kem != E2EES_PACK_ALG_KEM_CURVE25519) {
-        E2EES_PACK.session_suite = &E2EES_SESSION_PQC;
+        cacheer->e2ees_pack.session_suite = &E2EES_SESSION_PQC;
     } else {
-        E2EES_PACK.session_suite = &E2EES_SESSION_ECC;
+        cacheer->e2ees_pack.session_suite = &E2EES_SESSION_ECC;
     }
+}
 
-    return &E2EES_PACK;
+static size_t e2ees_pack_cache_slot(uint32_t e2ees_pack_id_raw) {
+    return (size_t)((uint32_t)(e2ees_pack_id_raw * 2654435761u) >> (32 - E2EES_PACK_CACHE_SLOTS_IN_BITS));
+}
+
+e2ees_pack_t *get_e2ees_pack(uint32_t e2ees_pack_id_raw) {
+    e2ees_pack_cacheer resolved;
+    e2ees_pack_cacheer *cur = NULL;
+    size_t start = e2ees_pack_cache_slot(e2ees_pack_id_raw);
+    size_t i, slot;
+
+    e2ees_spin_lock(&e2ees_pack_cache_lock);
+    for (i = 0; i < E2EES_PACK_CACHE_SLOTS; i++) {
+        slot = (start + i) % E2EES_PACK_CACHE_SLOTS;
+        if (!e2ees_pack_cache[slot].used)
+            break;
+        if (e2ees_pack_cache[slot].e2ees_pack_id_raw == e2ees_pack_id_raw) {
+            cur = &(e2ees_pack_cache[slot]);
+            break;
+        }
+    }
+    e2ees_spin_unlock(&e2ees_pack_cache_lock);
+    if (cur != NULL)
+        return &(cur->e2ees_pack);
+
+    resolve_e2ees_pack(&resolved, e2ees_pack_id_raw);
+    if (resolved.cipher_suite.ds_suite == NULL || resolved.cipher_suite.kem_suite == NULL
+        || resolved.cipher_suite.se_suite == NULL || resolved.cipher_suite.hash_suite == NULL) {
+        resolve_e2ees_pack(&e2ees_pack_uncached, e2ees_pack_id_raw);
+        return &(e2ees_pack_uncached.e2ees_pack);
+    }
+
+    e2ees_spin_lock(&e2ees_pack_cache_lock);
+    for (i = 0; i < E2EES_PACK_CACHE_SLOTS; i++) {
+        slot = (start + i) % E2EES_PACK_CACHE_SLOTS;
+        if (!e2ees_pack_cache[slot].used) {
+            // another thread may have filled the id since the lookup above
+            cur = &(e2ees_pack_cache[slot]);
+            resolve_e2ees_pack(cur, e2ees_pack_id_raw);
+            cur->used = true;
+            break;
+        }
+        if (e2ees_pack_cache[slot].e2ees_pack_id_raw == e2ees_pack_id_raw) {
+            cur = &(e2ees_pack_cache[slot]);
+            break;
+        }
+    }
+    e2ees_spin_unlock(&e2ees_pack_cache_lock);
+    if (cur != NULL)
+        return &(cur->e2ees_pack);
+
+    // the cache is full
+    resolve_e2ees_pack(&e2ees_pack_uncached, e2ees_pack_id_raw);
+    return &(e2ees_pack_uncached.e2ees_pack);
 }
 
 void e2ees_notify_log(E2ees__E2eeAddress *user_address, LogCode log_code, const char *msg_fmt, ...) {
@@ -329,3 +411,9 @@ void e2ees_notify_group_msg(
         );
 }
 
+void e2ees_notify_account_resumed(
+    E2ees__E2eeAddress *user_address, int result, size_t resumed_num, size_t total_num
+) {
+    if (e2ees_plugin != NULL && e2ees_plugin->event_handler.on_account_resumed != NULL)
+        e2ees_plugin->event_handler.on_account_resumed(user_address, result, resumed_num, total_num);
+}
@@ -18,6 +18,7 @@
  */
 #include "e2ees/e2ees_client.h"
 
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -30,7 +31,9 @@
 #include "e2ees/account_manager.h"
 #include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session_manager.h"
+#include "e2ees/key_maintenance.h"
 #include "e2ees/session.h"
+#include "e2ees/session_establishment.h"
 #include "e2ees/session_manager.h"
 
 int register_user(
@@ -159,6 +162,7 @@ E2ees__InviteResponse *invite(
     int ret = E2EES_RESULT_SUCC;
 
     char *auth = NULL;
+    E2ees__E2eeAddress *to = NULL;
     E2ees__InviteResponse *invite_response = NULL;
     E2ees__InviteResponse **invite_response_list = NULL;
     size_t invite_response_num = 0;
@@ -194,6 +198,16 @@ E2ees__InviteResponse *invite(
     // not just check outbound sessions in db currently.
 
     if (ret == E2EES_RESULT_SUCC) {
+        to = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+        e2ees__e2ee_address__init(to);
+        to->domain = strdup(to_domain);
+        E2ees__PeerUser *peer_user = (E2ees__PeerUser *)malloc(sizeof(E2ees__PeerUser));
+        e2ees__peer_user__init(peer_user);
+        peer_user->user_id = strdup(to_user_id);
+        to->peer_case = E2EES__E2EE_ADDRESS__PEER_USER;
+        to->user = peer_user;
+        store_session_establishment_step(from, to, E2EES_SESSION_ESTABLISHMENT_STEP_GET_PRE_KEY_BUNDLE);
+
         ret = get_pre_key_bundle_internal(
             &invite_response_list,
             &invite_response_num,
@@ -205,11 +219,16 @@ E2ees__InviteResponse *invite(
             true,
             NULL, 0
         );
+
+        // a failed request is kept as a pending request, the invited devices have their own steps
+        finish_session_establishment(from, to);
     }
 
     // release
     free_string(auth);
     free_invite_response_list(&invite_response_list, invite_response_num);
+    if (to != NULL)
+        e2ees__e2ee_address__free_unpacked(to, NULL);
 
     // done
     return invite_response;
@@ -240,8 +259,8 @@ E2ees__InviteResponse *invite(
 // }
 
 void send_sync_msg(E2ees__E2eeAddress *from, const uint8_t *plaintext_data, size_t plaintext_data_len) {
-    E2ees__Session **self_outbound_sessions = NULL;
-    size_t self_outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(from, from->user->user_id, from->domain, &self_outbound_sessions);
+    e2ees_session_header_t *self_session_headers = NULL;
+    size_t self_outbound_sessions_num = load_outbound_session_headers_internal(&self_session_headers, from, from->user->user_id, from->domain);
 
     if (self_outbound_sessions_num > 0) {
         e2ees_notify_log(
@@ -261,51 +280,54 @@ void send_sync_msg(E2ees__E2eeAddress *from, const uint8_t *plaintext_data, size
 
         size_t i;
         for (i = 0; i < self_outbound_sessions_num; i++) {
-            E2ees__Session *self_outbound_session = self_outbound_sessions[i];
+            e2ees_session_header_t *self_session_header = &(self_session_headers[i]);
             // if the device is different from the sender's
-            if (strcmp(self_outbound_session->their_address->user->device_id, from->user->device_id) != 0) {
-                if (self_outbound_session->responded == true) {
-                    // send syncing plaintext to server
-                    E2ees__SendOne2oneMsgResponse *sync_response = send_one2one_msg_internal(
-                        self_outbound_session,
-                        E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
-                        common_plaintext_data,
-                        common_plaintext_data_len
-                    );
-                    // release
-                    e2ees__send_one2one_msg_response__free_unpacked(sync_response, NULL);
+            if (strcmp(self_session_header->their_address->user->device_id, from->user->device_id) != 0) {
+                if (self_session_header->responded == true) {
+                    // only the sessions that will be used have their ratchets loaded
+                    E2ees__Session *self_outbound_session = load_outbound_session_by_header_internal(self_session_header);
+                    if (self_outbound_session != NULL) {
+                        // send syncing plaintext to server
+                        E2ees__SendOne2oneMsgResponse *sync_response = send_one2one_msg_internal(
+                            self_outbound_session,
+                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
+                            common_plaintext_data,
+                            common_plaintext_data_len
+                        );
+                        // release
+                        e2ees__send_one2one_msg_response__free_unpacked(sync_response, NULL);
+                        e2ees__session__free_unpacked(self_outbound_session, NULL);
+                    }
                 } else {
                     e2ees_notify_log(
                         from,
                         DEBUG_LOG,
                         "send_sync_msg(): outbound session[%s] (user_id:deviceid = %s, %s) not responded, store common_plaintext_data",
-                        self_outbound_session->session_id,
-                        self_outbound_session->their_address->user->user_id,
-                        self_outbound_session->their_address->user->device_id
+                        self_session_header->session_id,
+                        self_session_header->their_address->user->user_id,
+                        self_session_header->their_address->user->device_id
                     );
                     // store pending common_plaintext_data
                     store_pending_common_plaintext_data_internal(
-                        self_outbound_session->our_address,
-                        self_outbound_session->their_address,
+                        self_session_header->our_address,
+                        self_session_header->their_address,
                         common_plaintext_data,
                         common_plaintext_data_len,
                         E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL
                     );
                 }
             }
-            // release
-            e2ees__session__free_unpacked(self_outbound_session, NULL);
         }
 
         // release
         free_mem((void **)&common_plaintext_data, common_plaintext_data_len);
-        free_mem((void **)&self_outbound_sessions, sizeof(E2ees__Session *) * self_outbound_sessions_num);
+        free_session_headers(&self_session_headers, self_outbound_sessions_num);
     }
 }
 
 void send_sync_invite_msg(E2ees__E2eeAddress *from, const char *to_user_id, const char *to_domain, char **to_device_id_list, size_t to_device_num) {
-    E2ees__Session **self_outbound_sessions = NULL;
-    size_t self_outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(from, from->user->user_id, from->domain, &self_outbound_sessions);
+    e2ees_session_header_t *self_session_headers = NULL;
+    size_t self_outbound_sessions_num = load_outbound_session_headers_internal(&self_session_headers, from, from->user->user_id, from->domain);
 
     if (self_outbound_sessions_num > 0) {
         e2ees_notify_log(
@@ -336,46 +358,48 @@ void send_sync_invite_msg(E2ees__E2eeAddress *from, const char *to_user_id, cons
 
         size_t i;
         for (i = 0; i < self_outbound_sessions_num; i++) {
-            E2ees__Session *self_outbound_session = self_outbound_sessions[i];
+            e2ees_session_header_t *self_session_header = &(self_session_headers[i]);
             // if the device is different from the sender's
-            if (strcmp(self_outbound_session->their_address->user->device_id, from->user->device_id) != 0) {
-                if (self_outbound_session->responded == true) {
-                    // send syncing plaintext to server
-                    E2ees__SendOne2oneMsgResponse *sync_response = send_one2one_msg_internal(
-                        self_outbound_session,
-                        E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
-                        invite_msg_data,
-                        invite_msg_data_len
-                    );
-                    // release
-                    e2ees__send_one2one_msg_response__free_unpacked(sync_response, NULL);
+            if (strcmp(self_session_header->their_address->user->device_id, from->user->device_id) != 0) {
+                if (self_session_header->responded == true) {
+                    // only the sessions that will be used have their ratchets loaded
+                    E2ees__Session *self_outbound_session = load_outbound_session_by_header_internal(self_session_header);
+                    if (self_outbound_session != NULL) {
+                        // send syncing plaintext to server
+                        send_one2one_msg_async_internal(
+                            self_outbound_session,
+                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
+                            invite_msg_data,
+                            invite_msg_data_len
+                        );
+                        // release
+                        e2ees__session__free_unpacked(self_outbound_session, NULL);
+                    }
                 } else {
                     e2ees_notify_log(
                         from,
                         DEBUG_LOG,
                         "send_sync_msg(): outbound session[%s] (user_id:deviceid = %s, %s) not responded, store common_plaintext_data",
-                        self_outbound_session->session_id,
-                        self_outbound_session->their_address->user->user_id,
-                        self_outbound_session->their_address->user->device_id
+                        self_session_header->session_id,
+                        self_session_header->their_address->user->user_id,
+                        self_session_header->their_address->user->device_id
                     );
                     // store pending common_plaintext_data
-                    store_pending_common_plaintext_data_internal(
-                        self_outbound_session->our_address,
-                        self_outbound_session->their_address,
+                    store_pending_plaintext_data_internal(
+                        self_session_header->our_address,
+                        self_session_header->their_address,
                         invite_msg_data,
                         invite_msg_data_len,
                         E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL
                     );
                 }
             }
-            // release
-            e2ees__session__free_unpacked(self_outbound_session, NULL);
         }
 
         // release
         e2ees__plaintext__free_unpacked(plaintext, NULL);
         free_mem((void **)&invite_msg_data, invite_msg_data_len);
-        free_mem((void **)&self_outbound_sessions, sizeof(E2ees__Session *) * self_outbound_sessions_num);
+        free_session_headers(&self_session_headers, self_outbound_sessions_num);
     }
 }
 
@@ -393,9 +417,9 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg(
         &common_plaintext_data, &common_plaintext_data_len
     );
 
-    E2ees__Session **outbound_sessions = NULL;
-    size_t outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(from, to_user_id, to_domain, &outbound_sessions);
-    if (outbound_sessions_num == 0 || outbound_sessions == NULL) {
+    e2ees_session_header_t *session_headers = NULL;
+    size_t outbound_sessions_num = load_outbound_session_headers_internal(&session_headers, from, to_user_id, to_domain);
+    if (outbound_sessions_num == 0 || session_headers == NULL) {
         // save common_plaintext_data and will be resent after the first outbound session established
         e2ees_notify_log(
             from,
@@ -412,7 +436,7 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg(
         // no specific deviceId currently
         to->peer_case = E2EES__E2EE_ADDRESS__PEER_USER;
         to->user = peer_user;
-        store_pending_common_plaintext_data_internal(
+        int store_ret = store_pending_common_plaintext_data_internal(
             from,
             to,
             common_plaintext_data,
@@ -423,35 +447,55 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg(
         e2ees__e2ee_address__free_unpacked(to, NULL);
         free_mem((void **)&common_plaintext_data, common_plaintext_data_len);
         // done
+        // the outbox is full if the common_plaintext_data can not be stored
         E2ees__SendOne2oneMsgResponse *response = (E2ees__SendOne2oneMsgResponse *)malloc(sizeof(E2ees__SendOne2oneMsgResponse));
         e2ees__send_one2one_msg_response__init(response);
-        response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT;
+        response->code = (store_ret == E2EES_RESULT_SUCC ?
+            E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT : E2EES__RESPONSE_CODE__RESPONSE_CODE_SERVICE_UNAVAILABLE);
         return response;
     }
 
     size_t i;
     bool succ = false;
+    size_t queued_num = 0;
+    size_t dropped_num = 0;
     for (i = 0; i < outbound_sessions_num; i++) {
-        E2ees__Session *outbound_session = outbound_sessions[i];
-        if (outbound_session->responded == false) {
+        e2ees_session_header_t *session_header = &(session_headers[i]);
+        if (session_header->responded == false) {
             e2ees_notify_log(
                 from,
                 DEBUG_LOG,
                 "send_one2one_msg(): outbound session %zu of %zu [%s] not responded, store common_plaintext_data",
                 i+1,
                 outbound_sessions_num,
-                outbound_session->session_id
+                session_header->session_id
             );
             // store pending common_plaintext_data
-            store_pending_common_plaintext_data_internal(
-                outbound_session->our_address,
-                outbound_session->their_address,
-                common_plaintext_data,
-                common_plaintext_data_len,
-                notif_level
-            );
-            // release
-            e2ees__session__free_unpacked(outbound_session, NULL);
+            if (store_pending_common_plaintext_data_internal(
+                    session_header->our_address,
+                    session_header->their_address,
+                    common_plaintext_data,
+                    common_plaintext_data_len,
+                    notif_level
+                ) == E2EES_RESULT_SUCC) {
+                queued_num++;
+            } else {
+                // report the recipient that will not get this message
+                e2ees_notify_log(
+                    from,
+                    BAD_PENDING_PLAINTEXT,
+                    "send_one2one_msg(): dropped for device [%s], the outbox of session [%s] is full",
+                    session_header->their_address->user->device_id,
+                    session_header->session_id
+                );
+                dropped_num++;
+            }
+            continue;
+        }
+
+        // only the sessions that will be used have their ratchets loaded
+        E2ees__Session *outbound_session = load_outbound_session_by_header_internal(session_header);
+        if (outbound_session == NULL) {
             continue;
         }
 
@@ -480,16 +524,33 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg(
 
     // release
     free_mem((void **)&common_plaintext_data, common_plaintext_data_len);
-    free_mem((void **)&outbound_sessions, sizeof(E2ees__Session *) * outbound_sessions_num);
+    free_session_headers(&session_headers, outbound_sessions_num);
 
     // send the message to other self devices
     send_sync_msg(from, plaintext_data, plaintext_data_len);
 
+    if (dropped_num > 0) {
+        e2ees_notify_log(
+            from,
+            BAD_PENDING_PLAINTEXT,
+            "send_one2one_msg(): dropped for %zu of %zu outbound sessions, the outbox is full",
+            dropped_num,
+            outbound_sessions_num
+        );
+    }
+
     // done
-    // return ok response if there is at least one session sent successfully
+    // return ok response if there is at least one session sent successfully, the dropped recipients have been logged,
+    // or service unavailable response if the message is neither sent nor queued for any session
     E2ees__SendOne2oneMsgResponse *response = (E2ees__SendOne2oneMsgResponse *)malloc(sizeof(E2ees__SendOne2oneMsgResponse));
     e2ees__send_one2one_msg_response__init(response);
-    response->code = (succ ? E2EES__RESPONSE_CODE__RESPONSE_CODE_OK : E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT);
+    if (succ) {
+        response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
+    } else if (dropped_num > 0 && queued_num == 0) {
+        response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_SERVICE_UNAVAILABLE;
+    } else {
+        response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT;
+    }
     return response;
 }
 
@@ -525,7 +586,7 @@ int create_group(
         load_e2ees_pack_id_from_cache(&e2ees_pack_id, sender_address);
 
         if (e2ees_pack_id == E2EES_PACK_ID_UNSPECIFIED) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(sender_address, &account);
+            load_account_without_opks_internal(&account, sender_address);
             if (account == NULL) {
                 e2ees_notify_log(sender_address, BAD_ACCOUNT, "create_group()");
                 ret = E2EES_RESULT_FAIL;
@@ -594,7 +655,7 @@ int add_group_members(
         get_e2ees_plugin()->db_handler.load_auth(sender_address, &auth);
         if (auth != NULL) {
             if (is_valid_address(group_address)) {
-                get_e2ees_plugin()->db_handler.load_group_session_by_address(
+                load_group_session_by_address_internal(
                     sender_address, sender_address, group_address, &outbound_group_session
                 );
 
@@ -684,7 +745,7 @@ int remove_group_members(
         get_e2ees_plugin()->db_handler.load_auth(sender_address, &auth);
         if (auth != NULL) {
             if (is_valid_address(group_address)) {
-                get_e2ees_plugin()->db_handler.load_group_session_by_address(
+                load_group_session_by_address_internal(
                     sender_address, sender_address, group_address, &outbound_group_session
                 );
 
@@ -819,7 +880,7 @@ int leave_group(
     return ret;
 }
 
-int send_group_msg_with_filter(
+static int send_group_msg_internal(
     E2ees__SendGroupMsgResponse **response_out,
     E2ees__E2eeAddress *sender_address, E2ees__E2eeAddress *group_address,
     uint32_t notif_level,
@@ -827,37 +888,21 @@ int send_group_msg_with_filter(
     E2ees__E2eeAddress **allow_list,
     size_t allow_list_len,
     E2ees__E2eeAddress **deny_list,
-    size_t deny_list_len
+    size_t deny_list_len,
+    const e2ees_group_msg_filter_t *filter
 ) {
     int ret = E2EES_RESULT_SUCC;
 
     E2ees__SendGroupMsgRequest *send_group_msg_request = NULL;
     E2ees__SendGroupMsgResponse *response = NULL;
     E2ees__GroupSession *outbound_group_session = NULL;
+    ProtobufCBinaryData *chain_keys = NULL;
+    uint32_t sequence = 0;
     char *auth = NULL;
 
     if (is_valid_address(sender_address)) {
         get_e2ees_plugin()->db_handler.load_auth(sender_address, &auth);
-        if (auth != NULL) {
-            if (is_valid_address(group_address)) {
-                get_e2ees_plugin()->db_handler.load_group_session_by_address(
-                    sender_address, sender_address, group_address, &outbound_group_session
-                );
-
-                if (outbound_group_session == NULL) {
-                    e2ees_notify_log(
-                        sender_address,
-                        BAD_GROUP_SESSION,
-                        "send_group_msg() outbound_group_session does not exist, return a response with response code not found"
-                    );        
-                    response = (E2ees__SendGroupMsgResponse *)malloc(sizeof(E2ees__SendGroupMsgResponse));
-                    e2ees__send_group_msg_response__init(response);
-                    response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND;
-
-                    ret = E2EES_RESULT_FAIL;
-                }
-            }
-        } else {
+        if (auth == NULL) {
             e2ees_notify_log(sender_address, BAD_AUTH, "send_group_msg()");
             ret = E2EES_RESULT_FAIL;
         }
@@ -865,6 +910,10 @@ int send_group_msg_with_filter(
         e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
         ret = E2EES_RESULT_FAIL;
     }
+    if (!is_valid_address(group_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
+        ret = E2EES_RESULT_FAIL;
+    }
     if (plaintext_data == NULL) {
         e2ees_notify_log(NULL, BAD_PLAINTEXT, "send_group_msg()");
         ret = E2EES_RESULT_FAIL;
@@ -873,19 +922,41 @@ int send_group_msg_with_filter(
         e2ees_notify_log(NULL, BAD_PLAINTEXT, "send_group_msg()");
         ret = E2EES_RESULT_FAIL;
     }
-    if (!is_valid_address_list(allow_list, allow_list_len)) {
-        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
-        ret = E2EES_RESULT_FAIL;
-    }
-    if (!is_valid_address_list(deny_list, deny_list_len)) {
-        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
-        ret = E2EES_RESULT_FAIL;
-    }
 
     if (ret == E2EES_RESULT_SUCC) {
-        ret = produce_send_group_msg_request(
+        // the sequence is taken before sending, so a failed send never reuses its message key
+        ret = reserve_group_msg_sequences(
+            &outbound_group_session, &chain_keys, &sequence, sender_address, group_address, 1
+        );
+        if (ret != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(
+                sender_address,
+                BAD_GROUP_SESSION,
+                "send_group_msg() outbound_group_session does not exist, return a response with response code not found"
+            );
+            response = (E2ees__SendGroupMsgResponse *)malloc(sizeof(E2ees__SendGroupMsgResponse));
+            e2ees__send_group_msg_response__init(response);
+            response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC && filter != NULL) {
+        ret = produce_send_group_msg_request_with_filter(
+            &send_group_msg_request,
+            outbound_group_session,
+            &(chain_keys[0]),
+            sequence,
+            notif_level,
+            plaintext_data,
+            plaintext_data_len,
+            filter
+        );
+    } else if (ret == E2EES_RESULT_SUCC) {
+        ret = produce_send_group_msg_request_by_sequence(
             &send_group_msg_request,
             outbound_group_session,
+            &(chain_keys[0]),
+            sequence,
             notif_level,
             plaintext_data,
             plaintext_data_len,
@@ -913,33 +984,28 @@ int send_group_msg_with_filter(
         }
     }
 
-    if (ret == E2EES_RESULT_SUCC) {   
-        ret = consume_send_group_msg_response(outbound_group_session, response);
-        if (ret != 0) {
-            // // pack request to request_data
-            // size_t request_data_len = e2ees__send_group_msg_request__get_packed_size(request);
-            // uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
-            // e2ees__send_group_msg_request__pack(request, request_data);
-
-            // store_pending_request_internal(sender_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG, request_data, request_data_len, NULL, 0);
-            // // release
-            // free_mem((void **)&request_data, request_data_len);
-            // e2ees__send_group_msg_response__free_unpacked(response, NULL);
-
-            // // replace response code to enable another try
-            // response = (E2ees__SendGroupMsgResponse *)malloc(sizeof(E2ees__SendGroupMsgResponse));
-            // e2ees__send_group_msg_response__init(response);
-            // response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT;
-        }
+    if (ret == E2EES_RESULT_SUCC) {
+        ret = consume_send_group_msg_response(outbound_group_session, send_group_msg_request, response);
     }
 
     if (ret == E2EES_RESULT_SUCC) {
         *response_out = response;
+    } else if (response != NULL) {
+        e2ees__send_group_msg_response__free_unpacked(response, NULL);
+        response = NULL;
     }
 
     // release
     free_string(auth);
-    free_proto(send_group_msg_request);
+    if (filter != NULL) {
+        free_send_group_msg_request_with_filter(&send_group_msg_request);
+    } else {
+        free_proto(send_group_msg_request);
+    }
+    if (chain_keys != NULL) {
+        free_protobuf(&(chain_keys[0]));
+        free_mem((void **)&chain_keys, sizeof(ProtobufCBinaryData));
+    }
     if (outbound_group_session != NULL) {
         e2ees__group_session__free_unpacked(outbound_group_session, NULL);
         outbound_group_session = NULL;
@@ -949,6 +1015,56 @@ int send_group_msg_with_filter(
     return ret;
 }
 
+int send_group_msg_with_filter(
+    E2ees__SendGroupMsgResponse **response_out,
+    E2ees__E2eeAddress *sender_address, E2ees__E2eeAddress *group_address,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    E2ees__E2eeAddress **allow_list,
+    size_t allow_list_len,
+    E2ees__E2eeAddress **deny_list,
+    size_t deny_list_len
+) {
+    if (!is_valid_address_list(allow_list, allow_list_len)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
+        return E2EES_RESULT_FAIL;
+    }
+    if (!is_valid_address_list(deny_list, deny_list_len)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg()");
+        return E2EES_RESULT_FAIL;
+    }
+
+    return send_group_msg_internal(
+        response_out,
+        sender_address, group_address, notif_level,
+        plaintext_data, plaintext_data_len,
+        allow_list, allow_list_len, deny_list, deny_list_len,
+        NULL
+    );
+}
+
+int send_group_msg_with_recipient_filter(
+    E2ees__SendGroupMsgResponse **response_out,
+    E2ees__E2eeAddress *sender_address, E2ees__E2eeAddress *group_address,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    const e2ees_group_msg_filter_t *filter
+) {
+    if (filter == NULL) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msg_with_recipient_filter()");
+        return E2EES_RESULT_FAIL;
+    }
+
+    // the filter was validated when it was built
+    return send_group_msg_internal(
+        response_out,
+        sender_address, group_address, notif_level,
+        plaintext_data, plaintext_data_len,
+        NULL, 0, NULL, 0,
+        filter
+    );
+}
+
 int send_group_msg(
     E2ees__SendGroupMsgResponse **response_out,
     E2ees__E2eeAddress *sender_address,
@@ -965,6 +1081,165 @@ int send_group_msg(
     );
 }
 
+typedef struct group_msg_send_task_t {
+    E2ees__E2eeAddress *sender_address;
+    const char *auth;
+    E2ees__GroupSession *outbound_group_session;
+    const ProtobufCBinaryData *chain_key;
+    uint32_t sequence;
+    uint32_t notif_level;
+    const uint8_t *plaintext_data;
+    size_t plaintext_data_len;
+    E2ees__SendGroupMsgRequest *request;
+    E2ees__SendGroupMsgResponse *response;
+} group_msg_send_task_t;
+
+static void run_group_msg_send_task(void *arg) {
+    group_msg_send_task_t *task = (group_msg_send_task_t *)arg;
+
+    produce_send_group_msg_request_by_sequence(
+        &(task->request), task->outbound_group_session,
+        task->chain_key, task->sequence,
+        task->notif_level,
+        task->plaintext_data, task->plaintext_data_len,
+        NULL, 0, NULL, 0
+    );
+    if (task->request != NULL) {
+        task->response = get_e2ees_plugin()->proto_handler.send_group_msg(
+            task->sender_address, task->auth, task->request
+        );
+    }
+}
+
+int send_group_msgs(
+    E2ees__SendGroupMsgResponse ***responses_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *group_address,
+    uint32_t notif_level,
+    const uint8_t **plaintext_data_list,
+    const size_t *plaintext_data_len_list,
+    size_t msg_num
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    E2ees__GroupSession *outbound_group_session = NULL;
+    ProtobufCBinaryData *chain_keys = NULL;
+    uint32_t first_sequence = 0;
+    char *auth = NULL;
+    size_t i;
+
+    if (is_valid_address(sender_address)) {
+        get_e2ees_plugin()->db_handler.load_auth(sender_address, &auth);
+        if (auth == NULL) {
+            e2ees_notify_log(sender_address, BAD_AUTH, "send_group_msgs()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    } else {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msgs()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (!is_valid_address(group_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "send_group_msgs()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (plaintext_data_list == NULL || plaintext_data_len_list == NULL || msg_num == 0) {
+        e2ees_notify_log(NULL, BAD_PLAINTEXT, "send_group_msgs()");
+        ret = E2EES_RESULT_FAIL;
+    } else {
+        for (i = 0; i < msg_num; i++) {
+            if (plaintext_data_list[i] == NULL || plaintext_data_len_list[i] == 0) {
+                e2ees_notify_log(NULL, BAD_PLAINTEXT, "send_group_msgs()");
+                ret = E2EES_RESULT_FAIL;
+                break;
+            }
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // reserve all of the sequences at once, the messages do not wait for each other's acks
+        ret = reserve_group_msg_sequences(
+            &outbound_group_session, &chain_keys, &first_sequence, sender_address, group_address, msg_num
+        );
+        if (ret != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(sender_address, BAD_GROUP_SESSION, "send_group_msgs() outbound_group_session does not exist");
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        group_msg_send_task_t *tasks = (group_msg_send_task_t *)malloc(sizeof(group_msg_send_task_t) * msg_num);
+        void **task_args = (void **)malloc(sizeof(void *) * msg_num);
+        for (i = 0; i < msg_num; i++) {
+            tasks[i].sender_address = sender_address;
+            tasks[i].auth = auth;
+            tasks[i].outbound_group_session = outbound_group_session;
+            tasks[i].chain_key = &(chain_keys[i]);
+            tasks[i].sequence = first_sequence + (uint32_t)i;
+            tasks[i].notif_level = notif_level;
+            tasks[i].plaintext_data = plaintext_data_list[i];
+            tasks[i].plaintext_data_len = plaintext_data_len_list[i];
+            tasks[i].request = NULL;
+            tasks[i].response = NULL;
+            task_args[i] = &(tasks[i]);
+        }
+
+        // encrypt, sign and send with a bounded number of messages in flight
+        run_tasks_internal(run_group_msg_send_task, task_args, msg_num, E2EES_GROUP_SEND_MAX_IN_FLIGHT);
+
+        E2ees__SendGroupMsgResponse **responses = (E2ees__SendGroupMsgResponse **)malloc(sizeof(E2ees__SendGroupMsgResponse *) * msg_num);
+        for (i = 0; i < msg_num; i++) {
+            responses[i] = NULL;
+            if (tasks[i].request == NULL) {
+                ret = E2EES_RESULT_FAIL;
+            } else if (!is_valid_send_group_msg_response(tasks[i].response)) {
+                e2ees_notify_log(NULL, BAD_SEND_GROUP_MSG_RESPONSE, "send_group_msgs()");
+                ret = E2EES_RESULT_FAIL;
+                // pack request to request_data
+                size_t request_data_len = e2ees__send_group_msg_request__get_packed_size(tasks[i].request);
+                uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
+                e2ees__send_group_msg_request__pack(tasks[i].request, request_data);
+
+                store_pending_request_internal(sender_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG, request_data, request_data_len, NULL, 0);
+                // release
+                free_mem((void **)&request_data, request_data_len);
+            } else if (consume_send_group_msg_response(outbound_group_session, tasks[i].request, tasks[i].response) == E2EES_RESULT_SUCC) {
+                responses[i] = tasks[i].response;
+                tasks[i].response = NULL;
+            } else {
+                ret = E2EES_RESULT_FAIL;
+            }
+
+            // release
+            if (tasks[i].request != NULL) {
+                e2ees__send_group_msg_request__free_unpacked(tasks[i].request, NULL);
+            }
+            if (tasks[i].response != NULL) {
+                e2ees__send_group_msg_response__free_unpacked(tasks[i].response, NULL);
+            }
+        }
+        *responses_out = responses;
+
+        // release
+        free_mem((void **)&task_args, sizeof(void *) * msg_num);
+        free_mem((void **)&tasks, sizeof(group_msg_send_task_t) * msg_num);
+    }
+
+    // release
+    free_string(auth);
+    if (chain_keys != NULL) {
+        for (i = 0; i < msg_num; i++) {
+            free_protobuf(&(chain_keys[i]));
+        }
+        free_mem((void **)&chain_keys, sizeof(ProtobufCBinaryData) * msg_num);
+    }
+    if (outbound_group_session != NULL) {
+        e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+        outbound_group_session = NULL;
+    }
+
+    // done
+    return ret;
+}
+
 E2ees__ConsumeProtoMsgResponse *consume_proto_msg(E2ees__E2eeAddress *sender_address, const char *proto_msg_id) {
     char *auth = NULL;
     get_e2ees_plugin()->db_handler.load_auth(sender_address, &auth);
@@ -1113,21 +1388,90 @@ E2ees__ConsumeProtoMsgResponse *process_proto_msg(uint8_t *proto_msg_data, size_
     return response;
 }
 
+typedef struct resume_connection_task {
+    e2ees_account_header_t *account_header;
+    E2ees__Account *account;
+    atomic_size_t *resumed_num;
+    size_t total_num;
+} resume_connection_task;
+
+static void run_resume_connection_task(void *arg) {
+    resume_connection_task *task = (resume_connection_task *)arg;
+    int ret = E2EES_RESULT_SUCC;
+    E2ees__E2eeAddress *user_address = NULL;
+
+    if (task->account != NULL) {
+        user_address = task->account->address;
+        resume_connection_internal(task->account);
+    } else {
+        user_address = task->account_header->address;
+        // the full account is only loaded when there is something to resend or an unfinished session establishment
+        if (task->account_header->pending_request_num > 0 || task->account_header->session_establishment_num > 0) {
+            E2ees__Account *account = NULL;
+            load_account_without_opks_internal(&account, user_address);
+            if (account == NULL) {
+                e2ees_notify_log(user_address, BAD_ACCOUNT, "resume_connection() account not found");
+                ret = E2EES_RESULT_FAIL;
+            } else {
+                if (task->account_header->pending_request_num > 0) {
+                    resume_connection_internal(account);
+                } else {
+                    resume_session_establishments(account);
+                }
+                free_proto(account);
+            }
+        }
+    }
+
+    size_t resumed_num = atomic_fetch_add(task->resumed_num, 1) + 1;
+    e2ees_notify_account_resumed(user_address, ret, resumed_num, task->total_num);
+}
+
 void resume_connection() {
-    // loop on all accounts
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    e2ees_account_header_t *account_headers = NULL;
     E2ees__Account **accounts = NULL;
-    size_t account_num = get_e2ees_plugin()->db_handler.load_accounts(&accounts);
+    size_t account_num;
+    if (plugin->db_handler.load_account_headers != NULL) {
+        account_num = plugin->db_handler.load_account_headers(&account_headers);
+    } else {
+        account_num = plugin->db_handler.load_accounts(&accounts);
+    }
+    if (account_num == 0) {
+        return;
+    }
 
-    E2ees__Account *cur_account = NULL;
+    atomic_size_t resumed_num;
+    atomic_init(&resumed_num, 0);
+    resume_connection_task *tasks = (resume_connection_task *)malloc(sizeof(resume_connection_task) * account_num);
+    void **task_args = (void **)malloc(sizeof(void *) * account_num);
     size_t i;
     for (i = 0; i < account_num; i++) {
-        cur_account = accounts[i];
-        resume_connection_internal(cur_account);
-        // release
-        e2ees__account__free_unpacked(cur_account, NULL);
+        tasks[i].account_header = account_headers == NULL ? NULL : &(account_headers[i]);
+        tasks[i].account = accounts == NULL ? NULL : accounts[i];
+        tasks[i].resumed_num = &resumed_num;
+        tasks[i].total_num = account_num;
+        task_args[i] = &(tasks[i]);
     }
 
+    run_tasks_internal(run_resume_connection_task, task_args, account_num, E2EES_RESUME_CONNECTION_MAX_WORKERS);
+
     // release
-    if (accounts != NULL)
+    free_mem((void **)&task_args, sizeof(void *) * account_num);
+    free_mem((void **)&tasks, sizeof(resume_connection_task) * account_num);
+    if (account_headers != NULL) {
+        free_account_headers(&account_headers, account_num);
+    }
+    if (accounts != NULL) {
+        for (i = 0; i < account_num; i++) {
+            if (accounts[i] != NULL) {
+                e2ees__account__free_unpacked(accounts[i], NULL);
+            }
+        }
         free(accounts);
+    }
+}
+
+size_t maintain_keys() {
+    return run_key_maintenance();
 }
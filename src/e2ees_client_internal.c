@@ -1,10 +1,22 @@
 #include "e2ees/e2ees_client_internal.h"
 
+#include <stdatomic.h>
 #include <string.h>
-
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sched.h>
+#endif
+
+#include "e2ees/account_cache.h"
 #include "e2ees/account_manager.h"
+#include "e2ees/group_session.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/group_session_manager.h"
 #include "e2ees/mem_util.h"
+#include "e2ees/pending_request_cache.h"
+#include "e2ees/session_establishment.h"
 #include "e2ees/validation.h"
 #include "e2ees/session_manager.h"
 #include "e2ees/e2ees_client.h"
@@ -136,6 +148,35 @@ int get_pre_key_bundle_internal(
     return ret;
 }
 
+static int complete_invite_internal(
+    E2ees__E2eeAddress *user_address,
+    E2ees__InviteRequest *invite_request,
+    E2ees__InviteResponse *response
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    // an undelivered invite is replayed as a pending request, so we wait for the accept message either way
+    store_session_establishment_step(user_address, invite_request->msg->to, E2EES_SESSION_ESTABLISHMENT_STEP_WAIT_ACCEPT);
+
+    if (is_valid_invite_response(response)) {
+        ret = consume_invite_response(user_address, response);
+    } else {
+        // pack invite_request to request_data
+        size_t request_data_len = e2ees__invite_request__get_packed_size(invite_request);
+        uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
+        e2ees__invite_request__pack(invite_request, request_data);
+
+        // store the request_data into pending
+        store_pending_request_internal(
+            user_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_INVITE, request_data, request_data_len, NULL, 0
+        );
+        // release
+        free_mem((void **)&request_data, request_data_len);
+    }
+
+    return ret;
+}
+
 int invite_internal(
     E2ees__InviteResponse **response_out,
     E2ees__Session *outbound_session
@@ -164,23 +205,9 @@ int invite_internal(
     }
 
     if (ret == E2EES_RESULT_SUCC) {
+        store_session_establishment_step(user_address, outbound_session->their_address, E2EES_SESSION_ESTABLISHMENT_STEP_INVITE);
         response = get_e2ees_plugin()->proto_handler.invite(user_address, auth, invite_request);
-
-        if (is_valid_invite_response(response)) {
-            ret = consume_invite_response(user_address, response);
-        } else {
-            // pack invite_request to request_data
-            size_t request_data_len = e2ees__invite_request__get_packed_size(invite_request);
-            uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
-            e2ees__invite_request__pack(invite_request, request_data);
-
-            // store the request_data into pending
-            store_pending_request_internal(
-                user_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_INVITE, request_data, request_data_len, NULL, 0
-            );
-            // release
-            free_mem((void **)&request_data, request_data_len);
-        }
+        ret = complete_invite_internal(user_address, invite_request, response);
 
         // release
         free_string(auth);
@@ -195,6 +222,96 @@ int invite_internal(
     return ret;
 }
 
+size_t invite_sessions_internal(
+    E2ees__InviteResponse **response_list,
+    E2ees__Session **outbound_sessions,
+    size_t outbound_sessions_num
+) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    E2ees__E2eeAddress *user_address = NULL;
+    E2ees__InviteRequest **invite_requests = NULL;
+    E2ees__InviteResponse **responses = NULL;
+    char *auth = NULL;
+    size_t succ_num = 0;
+    size_t i;
+
+    for (i = 0; i < outbound_sessions_num; i++) {
+        response_list[i] = NULL;
+    }
+    if (outbound_sessions_num == 0)
+        return 0;
+
+    // all of the sessions belong to the same owner, so the auth is loaded once
+    user_address = outbound_sessions[0]->our_address;
+    plugin->db_handler.load_auth(user_address, &auth);
+    if (!is_valid_string(auth)) {
+        e2ees_notify_log(user_address, BAD_AUTH, "invite_sessions_internal()");
+        free_string(auth);
+        return 0;
+    }
+
+    invite_requests = (E2ees__InviteRequest **)malloc(sizeof(E2ees__InviteRequest *) * outbound_sessions_num);
+    for (i = 0; i < outbound_sessions_num; i++) {
+        invite_requests[i] = NULL;
+        if (!is_valid_uncompleted_session(outbound_sessions[i])
+            || !compare_address(outbound_sessions[i]->our_address, user_address)
+        ) {
+            e2ees_notify_log(user_address, BAD_SESSION, "invite_sessions_internal()");
+            continue;
+        }
+        if (produce_invite_request(&(invite_requests[i]), outbound_sessions[i]) == E2EES_RESULT_SUCC) {
+            store_session_establishment_step(user_address, outbound_sessions[i]->their_address, E2EES_SESSION_ESTABLISHMENT_STEP_INVITE);
+        }
+    }
+
+    if (plugin->proto_handler.invites != NULL) {
+        // submit the valid requests in one batch
+        E2ees__InviteRequest **batch = (E2ees__InviteRequest **)malloc(sizeof(E2ees__InviteRequest *) * outbound_sessions_num);
+        size_t *batch_positions = (size_t *)malloc(sizeof(size_t) * outbound_sessions_num);
+        size_t batch_num = 0;
+        for (i = 0; i < outbound_sessions_num; i++) {
+            if (invite_requests[i] != NULL) {
+                batch[batch_num] = invite_requests[i];
+                batch_positions[batch_num] = i;
+                batch_num++;
+            }
+        }
+        if (batch_num > 0) {
+            responses = plugin->proto_handler.invites(user_address, auth, batch, batch_num);
+            if (responses != NULL) {
+                for (i = 0; i < batch_num; i++) {
+                    response_list[batch_positions[i]] = responses[i];
+                }
+                free(responses);
+            }
+        }
+        free(batch);
+        free(batch_positions);
+    } else {
+        for (i = 0; i < outbound_sessions_num; i++) {
+            if (invite_requests[i] != NULL) {
+                response_list[i] = plugin->proto_handler.invite(user_address, auth, invite_requests[i]);
+            }
+        }
+    }
+
+    // consume the responses, the undelivered requests are kept as pending requests
+    for (i = 0; i < outbound_sessions_num; i++) {
+        if (invite_requests[i] == NULL)
+            continue;
+        if (complete_invite_internal(user_address, invite_requests[i], response_list[i]) == E2EES_RESULT_SUCC) {
+            succ_num++;
+        }
+        e2ees__invite_request__free_unpacked(invite_requests[i], NULL);
+    }
+
+    // release
+    free(invite_requests);
+    free_string(auth);
+
+    return succ_num;
+}
+
 int accept_internal(
     E2ees__AcceptResponse **response_out,
     uint32_t e2ees_pack_id,
@@ -338,7 +455,7 @@ int supply_opks_internal(
         response = get_e2ees_plugin()->proto_handler.supply_opks(account->address, account->auth, supply_opks_request);
 
         if (is_valid_supply_opks_response(response)) {
-            ret = consume_supply_opks_response(account, opks_num, response);
+            ret = consume_supply_opks_response(account, response);
         } else {
             // pack request to request_data
             size_t request_data_len = e2ees__supply_opks_request__get_packed_size(supply_opks_request);
@@ -384,6 +501,21 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg_internal(
 
     ret = produce_send_one2one_msg_request(&send_one2one_msg_request, outbound_session, notif_level, plaintext_data, plaintext_data_len);
     E2ees__SendOne2oneMsgResponse *response = get_e2ees_plugin()->proto_handler.send_one2one_msg(user_address, auth, send_one2one_msg_request);
+    response = complete_send_one2one_msg_internal(outbound_session, send_one2one_msg_request, response);
+
+    // release
+    free_string(auth);
+    free_proto(send_one2one_msg_request);
+
+    // done
+    return response;
+}
+
+E2ees__SendOne2oneMsgResponse *complete_send_one2one_msg_internal(
+    E2ees__Session *outbound_session,
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request,
+    E2ees__SendOne2oneMsgResponse *response
+) {
     bool succ = consume_send_one2one_msg_response(outbound_session, response);
     if (!succ) {
         // pack send_one2one_msg_request to request_data
@@ -398,20 +530,197 @@ E2ees__SendOne2oneMsgResponse *send_one2one_msg_internal(
 
         // release
         free_mem((void **)&request_data, request_data_len);
-        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
-        
+        if (response != NULL)
+            e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
+
         // replace response code to enable another try
         response = (E2ees__SendOne2oneMsgResponse *)malloc(sizeof(E2ees__SendOne2oneMsgResponse));
         e2ees__send_one2one_msg_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_REQUEST_TIMEOUT;
     }
 
+    // done
+    return response;
+}
+
+typedef struct send_one2one_msg_context_t {
+    E2ees__E2eeAddress *our_address;
+    E2ees__E2eeAddress *their_address;
+    E2ees__SendOne2oneMsgRequest *request;
+} send_one2one_msg_context_t;
+
+static atomic_size_t outstanding_one2one_msgs_num = 0;
+
+static void on_send_one2one_msg_completed(void *context, E2ees__SendOne2oneMsgResponse *response) {
+    send_one2one_msg_context_t *send_one2one_msg_context = (send_one2one_msg_context_t *)context;
+
+    if (get_e2ees_plugin() == NULL) {
+        // e2ees_end() has detached the plugin, so there is nowhere to keep the result
+    } else if (response != NULL && response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+        // user device is removed, we remove outbound_sessions
+        get_e2ees_plugin()->db_handler.unload_session(
+            send_one2one_msg_context->our_address, send_one2one_msg_context->their_address
+        );
+    } else if (response == NULL || response->code != E2EES__RESPONSE_CODE__RESPONSE_CODE_OK) {
+        // pack send_one2one_msg_request to request_data
+        size_t request_data_len = e2ees__send_one2one_msg_request__get_packed_size(send_one2one_msg_context->request);
+        uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
+        e2ees__send_one2one_msg_request__pack(send_one2one_msg_context->request, request_data);
+
+        store_pending_request_internal(
+            send_one2one_msg_context->our_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG,
+            request_data, request_data_len, NULL, 0
+        );
+
+        // release
+        free_mem((void **)&request_data, request_data_len);
+    }
+
+    // release
+    if (response != NULL)
+        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
+    e2ees__send_one2one_msg_request__free_unpacked(send_one2one_msg_context->request, NULL);
+    e2ees__e2ee_address__free_unpacked(send_one2one_msg_context->our_address, NULL);
+    e2ees__e2ee_address__free_unpacked(send_one2one_msg_context->their_address, NULL);
+    free(send_one2one_msg_context);
+
+    atomic_fetch_sub(&outstanding_one2one_msgs_num, 1);
+}
+
+static void submit_one2one_msg_request_async(
+    E2ees__Session *outbound_session,
+    const char *auth,
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request
+) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+
+    send_one2one_msg_context_t *send_one2one_msg_context = (send_one2one_msg_context_t *)malloc(sizeof(send_one2one_msg_context_t));
+    copy_address_from_address(&(send_one2one_msg_context->our_address), outbound_session->our_address);
+    copy_address_from_address(&(send_one2one_msg_context->their_address), outbound_session->their_address);
+    send_one2one_msg_context->request = send_one2one_msg_request;
+
+    atomic_fetch_add(&outstanding_one2one_msgs_num, 1);
+    int submitted = plugin->proto_handler.send_one2one_msg_async(
+        outbound_session->our_address, auth, send_one2one_msg_request,
+        on_send_one2one_msg_completed, send_one2one_msg_context
+    );
+    if (submitted != 0) {
+        // keep it as a pending request
+        on_send_one2one_msg_completed(send_one2one_msg_context, NULL);
+    }
+}
+
+void send_one2one_msg_request_async_internal(
+    E2ees__Session *outbound_session,
+    const char *auth,
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request
+) {
+    // the ratchet has moved forward, so the session state is kept before the response arrives
+    get_e2ees_plugin()->db_handler.store_session(outbound_session);
+
+    submit_one2one_msg_request_async(outbound_session, auth, send_one2one_msg_request);
+}
+
+int send_one2one_msg_async_internal(
+    E2ees__Session *outbound_session,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    if (get_e2ees_plugin()->proto_handler.send_one2one_msg_async == NULL) {
+        E2ees__SendOne2oneMsgResponse *response = send_one2one_msg_internal(
+            outbound_session, notif_level, plaintext_data, plaintext_data_len
+        );
+        if (response == NULL)
+            return E2EES_RESULT_FAIL;
+        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
+        return E2EES_RESULT_SUCC;
+    }
+
+    E2ees__SendOne2oneMsgRequest *send_one2one_msg_request = NULL;
+    char *auth = NULL;
+    get_e2ees_plugin()->db_handler.load_auth(outbound_session->our_address, &auth);
+
+    if (auth == NULL) {
+        e2ees_notify_log(outbound_session->our_address, BAD_AUTH, "send_one2one_msg_async_internal()");
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        ret = produce_send_one2one_msg_request(
+            &send_one2one_msg_request, outbound_session, notif_level, plaintext_data, plaintext_data_len
+        );
+        if (send_one2one_msg_request == NULL) {
+            e2ees_notify_log(outbound_session->our_address, BAD_MESSAGE_ENCRYPTION, "send_one2one_msg_async_internal()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        send_one2one_msg_request_async_internal(outbound_session, auth, send_one2one_msg_request);
+    } else if (send_one2one_msg_request != NULL) {
+        e2ees__send_one2one_msg_request__free_unpacked(send_one2one_msg_request, NULL);
+    }
+
     // release
     free_string(auth);
-    free_proto(send_one2one_msg_request);
 
     // done
-    return response;
+    return ret;
+}
+
+size_t count_outstanding_one2one_msgs_internal() {
+    return atomic_load(&outstanding_one2one_msgs_num);
+}
+
+static void yield_thread() {
+#if defined(_WIN32)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+size_t wait_outstanding_one2one_msgs_internal(int64_t timeout_ms) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    int64_t deadline = plugin->common_handler.gen_ts() + timeout_ms;
+
+    size_t outstanding_num;
+    while ((outstanding_num = count_outstanding_one2one_msgs_internal()) > 0) {
+        if (plugin->proto_handler.complete_one2one_msgs != NULL && plugin->proto_handler.complete_one2one_msgs() > 0) {
+            continue;
+        }
+        if (plugin->common_handler.gen_ts() >= deadline) {
+            break;
+        }
+        yield_thread();
+    }
+
+    if (outstanding_num > 0) {
+        e2ees_notify_log(NULL, DEBUG_LOG, "wait_outstanding_one2one_msgs_internal() %zu one2one messages are not completed", outstanding_num);
+    }
+    return outstanding_num;
+}
+
+void run_tasks_internal(
+    void (*task)(void *),
+    void **task_args,
+    size_t task_num,
+    size_t max_concurrency
+) {
+    if (task_num == 0)
+        return;
+
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    if (plugin->common_handler.run_tasks != NULL && task_num > 1) {
+        plugin->common_handler.run_tasks(task, task_args, task_num, max_concurrency);
+    } else {
+        size_t i;
+        for (i = 0; i < task_num; i++) {
+            task(task_args[i]);
+        }
+    }
 }
 
 int add_group_member_device_internal(
@@ -432,7 +741,7 @@ int add_group_member_device_internal(
 
         if (auth != NULL) {
             if (is_valid_address(group_address)) {
-                get_e2ees_plugin()->db_handler.load_group_session_by_address(
+                load_group_session_by_address_internal(
                     sender_address, sender_address, group_address, &outbound_group_session
                 );
 
@@ -505,25 +814,280 @@ int add_group_member_device_internal(
     return ret;
 }
 
-void store_pending_common_plaintext_data_internal(
+int store_pending_plaintext_data_internal(
     E2ees__E2eeAddress *from,
     E2ees__E2eeAddress *to,
-    uint8_t *common_plaintext_data,
-    size_t common_plaintext_data_len,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len,
     E2ees__NotifLevel notif_level
 ) {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->append_pending_plaintext_data != NULL) {
+        uint64_t seq = db_handler->append_pending_plaintext_data(
+            from, to, plaintext_data, plaintext_data_len, notif_level
+        );
+        if (seq == 0) {
+            e2ees_notify_log(from, BAD_PENDING_PLAINTEXT, "store_pending_plaintext_data_internal()");
+            return E2EES_RESULT_FAIL;
+        }
+        return E2EES_RESULT_SUCC;
+    }
+
     char *pending_plaintext_id = generate_uuid_str();
-    get_e2ees_plugin()->db_handler.store_pending_plaintext_data(
+    db_handler->store_pending_plaintext_data(
         from,
         to,
         pending_plaintext_id,
-        common_plaintext_data,
-        common_plaintext_data_len,
+        plaintext_data,
+        plaintext_data_len,
         notif_level
     );
 
     // release
     free(pending_plaintext_id);
+
+    return E2EES_RESULT_SUCC;
+}
+
+static bool is_pending_plaintext_outbox_full(E2ees__E2eeAddress *from, E2ees__E2eeAddress *to, const char *caller) {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->count_pending_plaintext_data == NULL) {
+        return false;
+    }
+    size_t pending_plaintext_num = db_handler->count_pending_plaintext_data(from, to);
+    if (pending_plaintext_num >= E2EES_PENDING_PLAINTEXT_MAX_NUM) {
+        // back-pressure, let the caller decide when to retry
+        e2ees_notify_log(from, BAD_PENDING_PLAINTEXT, "%s outbox is full: %zu", caller, pending_plaintext_num);
+        return true;
+    }
+    return false;
+}
+
+int store_pending_shared_plaintext_data_internal(
+    E2ees__E2eeAddress *from,
+    E2ees__E2eeAddress *to,
+    const uint8_t *payload_hash,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len,
+    E2ees__NotifLevel notif_level
+) {
+    if (is_pending_plaintext_outbox_full(from, to, "store_pending_shared_plaintext_data_internal()")) {
+        return E2EES_RESULT_FAIL;
+    }
+
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->append_pending_payload_ref == NULL) {
+        return store_pending_plaintext_data_internal(from, to, plaintext_data, plaintext_data_len, notif_level);
+    }
+
+    uint64_t seq = db_handler->append_pending_payload_ref(
+        from, to, payload_hash, SHA256_OUTPUT_LENGTH, plaintext_data, plaintext_data_len, notif_level
+    );
+    if (seq == 0) {
+        e2ees_notify_log(from, BAD_PENDING_PLAINTEXT, "store_pending_shared_plaintext_data_internal()");
+        return E2EES_RESULT_FAIL;
+    }
+    return E2EES_RESULT_SUCC;
+}
+
+int store_pending_common_plaintext_data_internal(
+    E2ees__E2eeAddress *from,
+    E2ees__E2eeAddress *to,
+    uint8_t *common_plaintext_data,
+    size_t common_plaintext_data_len,
+    E2ees__NotifLevel notif_level
+) {
+    if (is_pending_plaintext_outbox_full(from, to, "store_pending_common_plaintext_data_internal()")) {
+        return E2EES_RESULT_FAIL;
+    }
+
+    return store_pending_plaintext_data_internal(
+        from, to, common_plaintext_data, common_plaintext_data_len, notif_level
+    );
+}
+
+static void send_pending_plaintext_data_list(E2ees__Session *outbound_session) {
+    // load pending plaintext data(may be the group pre-key or the common plaintext)
+    uint32_t pending_plaintext_data_list_num;
+    char **pending_plaintext_id_list;
+    uint8_t **pending_plaintext_data_list;
+    size_t *pending_plaintext_data_len_list;
+    E2ees__NotifLevel *notif_level_list;
+    pending_plaintext_data_list_num =
+        get_e2ees_plugin()->db_handler.load_pending_plaintext_data(
+            outbound_session->our_address,
+            outbound_session->their_address,
+            &pending_plaintext_id_list,
+            &pending_plaintext_data_list,
+            &pending_plaintext_data_len_list,
+            &notif_level_list
+        );
+    if (pending_plaintext_data_list_num > 0) {
+        e2ees_notify_log(
+            outbound_session->our_address,
+            DEBUG_LOG,
+            "send_pending_plaintext_data_list(): list num = %d",
+            pending_plaintext_data_list_num
+        );
+        uint32_t i;
+        for (i = 0; i < pending_plaintext_data_list_num; i++) {
+            if (send_one2one_msg_async_internal(
+                    outbound_session,
+                    notif_level_list[i],
+                    pending_plaintext_data_list[i],
+                    pending_plaintext_data_len_list[i]
+                ) != E2EES_RESULT_SUCC) {
+                // the rest is kept for the next try
+                e2ees_notify_log(
+                    outbound_session->our_address,
+                    BAD_PENDING_PLAINTEXT,
+                    "send_pending_plaintext_data_list(): kept num = %d",
+                    pending_plaintext_data_list_num - i
+                );
+                break;
+            }
+            // a failed delivery is kept as a pending request
+            get_e2ees_plugin()->db_handler.unload_pending_plaintext_data(
+                outbound_session->our_address, outbound_session->their_address, pending_plaintext_id_list[i]
+            );
+        }
+
+        // release
+        for (i = 0; i < pending_plaintext_data_list_num; i++) {
+            free_mem((void **)&(pending_plaintext_data_list[i]), pending_plaintext_data_len_list[i]);
+            free(pending_plaintext_id_list[i]);
+        }
+        free_mem((void **)&pending_plaintext_id_list, sizeof(char *) * pending_plaintext_data_list_num);
+        free_mem((void **)&pending_plaintext_data_list, sizeof(uint8_t *) * pending_plaintext_data_list_num);
+        free_mem((void **)&pending_plaintext_data_len_list, sizeof(size_t) * pending_plaintext_data_list_num);
+        free_mem((void **)&notif_level_list, sizeof(E2ees__NotifLevel) * pending_plaintext_data_list_num);
+    }
+}
+
+static size_t send_pending_plaintext_page(
+    E2ees__Session *outbound_session,
+    const char *auth,
+    e2ees_pending_plaintext_t *pending_plaintext_list,
+    size_t pending_plaintext_num
+) {
+    size_t i;
+
+    if (auth == NULL || get_e2ees_plugin()->proto_handler.send_one2one_msg_async == NULL) {
+        for (i = 0; i < pending_plaintext_num; i++) {
+            if (send_one2one_msg_async_internal(
+                    outbound_session,
+                    pending_plaintext_list[i].notif_level,
+                    pending_plaintext_list[i].plaintext_data,
+                    pending_plaintext_list[i].plaintext_data_len
+                ) != E2EES_RESULT_SUCC) {
+                break;
+            }
+        }
+        return i;
+    }
+
+    // encrypt the whole page first, so the session state is stored once for the page
+    E2ees__SendOne2oneMsgRequest **request_list =
+        (E2ees__SendOne2oneMsgRequest **)malloc(sizeof(E2ees__SendOne2oneMsgRequest *) * pending_plaintext_num);
+    size_t request_num;
+    for (request_num = 0; request_num < pending_plaintext_num; request_num++) {
+        request_list[request_num] = NULL;
+        produce_send_one2one_msg_request(
+            &(request_list[request_num]),
+            outbound_session,
+            pending_plaintext_list[request_num].notif_level,
+            pending_plaintext_list[request_num].plaintext_data,
+            pending_plaintext_list[request_num].plaintext_data_len
+        );
+        if (request_list[request_num] == NULL) {
+            e2ees_notify_log(outbound_session->our_address, BAD_MESSAGE_ENCRYPTION, "send_pending_plaintext_page()");
+            break;
+        }
+    }
+
+    if (request_num > 0) {
+        // the ratchet has moved forward, so the session state is kept before the responses arrive
+        get_e2ees_plugin()->db_handler.store_session(outbound_session);
+        for (i = 0; i < request_num; i++) {
+            submit_one2one_msg_request_async(outbound_session, auth, request_list[i]);
+        }
+    }
+
+    // release
+    free_mem((void **)&request_list, sizeof(E2ees__SendOne2oneMsgRequest *) * pending_plaintext_num);
+
+    return request_num;
+}
+
+void send_pending_plaintext_data_internal(E2ees__Session *outbound_session) {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->load_pending_plaintext_data_page == NULL
+        || db_handler->unload_pending_plaintext_data_range == NULL) {
+        send_pending_plaintext_data_list(outbound_session);
+        return;
+    }
+
+    char *auth = NULL;
+    db_handler->load_auth(outbound_session->our_address, &auth);
+
+    // drain the outbox page by page in sequence order
+    uint64_t after_seq = 0;
+    size_t total_num = 0;
+    while (true) {
+        e2ees_pending_plaintext_t *pending_plaintext_list = NULL;
+        size_t pending_plaintext_num = db_handler->load_pending_plaintext_data_page(
+            outbound_session->our_address,
+            outbound_session->their_address,
+            after_seq,
+            E2EES_PENDING_PLAINTEXT_PAGE_SIZE,
+            &pending_plaintext_list
+        );
+        if (pending_plaintext_num == 0 || pending_plaintext_list == NULL) {
+            break;
+        }
+
+        // a failed delivery is kept as a pending request, so the order is still preserved
+        size_t sent_num = send_pending_plaintext_page(outbound_session, auth, pending_plaintext_list, pending_plaintext_num);
+
+        // unload what has been sent at once
+        if (sent_num > 0) {
+            uint64_t first_seq = pending_plaintext_list[0].seq;
+            after_seq = pending_plaintext_list[sent_num - 1].seq;
+            db_handler->unload_pending_plaintext_data_range(
+                outbound_session->our_address, outbound_session->their_address, first_seq, after_seq
+            );
+            total_num += sent_num;
+        }
+
+        // release
+        free_pending_plaintext_list(&pending_plaintext_list, pending_plaintext_num);
+
+        if (sent_num < pending_plaintext_num) {
+            // the rest stays in the outbox for the next try
+            e2ees_notify_log(
+                outbound_session->our_address,
+                BAD_PENDING_PLAINTEXT,
+                "send_pending_plaintext_data_internal(): sent num = %zu, the rest is kept",
+                total_num
+            );
+            break;
+        }
+        if (pending_plaintext_num < E2EES_PENDING_PLAINTEXT_PAGE_SIZE) {
+            break;
+        }
+    }
+
+    if (total_num > 0) {
+        e2ees_notify_log(
+            outbound_session->our_address,
+            DEBUG_LOG,
+            "send_pending_plaintext_data_internal(): sent num = %zu",
+            total_num
+        );
+    }
+
+    // release
+    free_string(auth);
 }
 
 void store_pending_request_internal(
@@ -558,396 +1122,1489 @@ void store_pending_request_internal(
     free(pending_request_id);
 }
 
-static void resend_pending_request(E2ees__Account *account) {
-    E2ees__E2eeAddress *user_address = account->address;
-    char *auth = account->auth;
+size_t load_outbound_session_headers_internal(
+    e2ees_session_header_t **session_headers_out,
+    E2ees__E2eeAddress *our_address,
+    const char *their_user_id,
+    const char *their_domain
+) {
+    *session_headers_out = NULL;
 
-    // load all pending request data
-    char **pending_request_id_list = NULL;
-    uint8_t *request_type_list = NULL;
-    uint8_t **request_data_list = NULL;
-    size_t *request_data_len_list = NULL;
-    size_t pending_request_data_num =
-        get_e2ees_plugin()->db_handler.load_pending_request_data(
-            user_address, &pending_request_id_list, &request_type_list, &request_data_list, &request_data_len_list
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->load_outbound_session_headers != NULL) {
+        return db_handler->load_outbound_session_headers(our_address, their_user_id, their_domain, session_headers_out);
+    }
+
+    // the db handler can only provide the full sessions, keep them in the headers
+    E2ees__Session **outbound_sessions = NULL;
+    size_t outbound_sessions_num = db_handler->load_outbound_sessions(our_address, their_user_id, their_domain, &outbound_sessions);
+    if (outbound_sessions_num == 0 || outbound_sessions == NULL) {
+        return 0;
+    }
+
+    e2ees_session_header_t *session_headers = (e2ees_session_header_t *)malloc(sizeof(e2ees_session_header_t) * outbound_sessions_num);
+    size_t i;
+    for (i = 0; i < outbound_sessions_num; i++) {
+        E2ees__Session *outbound_session = outbound_sessions[i];
+        session_headers[i].session_id = strdup(outbound_session->session_id);
+        copy_address_from_address(&(session_headers[i].our_address), outbound_session->our_address);
+        copy_address_from_address(&(session_headers[i].their_address), outbound_session->their_address);
+        session_headers[i].invite_t = outbound_session->invite_t;
+        session_headers[i].responded = outbound_session->responded;
+        session_headers[i].session = outbound_session;
+    }
+
+    // release
+    free_mem((void **)&outbound_sessions, sizeof(E2ees__Session *) * outbound_sessions_num);
+
+    *session_headers_out = session_headers;
+    return outbound_sessions_num;
+}
+
+E2ees__Session *load_outbound_session_by_header_internal(
+    e2ees_session_header_t *session_header
+) {
+    E2ees__Session *outbound_session = NULL;
+
+    if (session_header == NULL) {
+        return NULL;
+    }
+
+    if (session_header->session != NULL) {
+        // already unpacked
+        outbound_session = session_header->session;
+        session_header->session = NULL;
+        return outbound_session;
+    }
+
+    get_e2ees_plugin()->db_handler.load_outbound_session(
+        session_header->our_address, session_header->their_address, &outbound_session
+    );
+    if (outbound_session == NULL) {
+        e2ees_notify_log(
+            session_header->our_address,
+            BAD_SESSION,
+            "load_outbound_session_by_header_internal() session[%s] not found",
+            session_header->session_id
         );
-    // send the pending request data
-    int ret = E2EES_RESULT_SUCC;
-    bool succ = false;
-    E2ees__GroupSession *group_session = NULL;
-    size_t i, j;
-    for (i = 0; i < pending_request_data_num; i++) {
-        E2ees__PendingRequest *pending_request = e2ees__pending_request__unpack(NULL, request_data_len_list[i], request_data_list[i]);
+        return NULL;
+    }
+    if (!safe_strcmp(outbound_session->session_id, session_header->session_id)) {
+        // the header refers to a session that has been replaced
         e2ees_notify_log(
-            user_address,
+            session_header->our_address,
             DEBUG_LOG,
-            "resend_pending_request() request_type: %d",
-            request_type_list[i]
+            "load_outbound_session_by_header_internal() session[%s] replaced by session[%s]",
+            session_header->session_id,
+            outbound_session->session_id
         );
-        switch (request_type_list[i]) {
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_GET_PRE_KEY_BUNDLE: {
-                size_t their_device_num;
-                E2ees__GetPreKeyBundleRequest *get_pre_key_bundle_request = e2ees__get_pre_key_bundle_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__GetPreKeyBundleResponse *get_pre_key_bundle_response = get_e2ees_plugin()->proto_handler.get_pre_key_bundle(user_address, auth, get_pre_key_bundle_request);
-                // check if pre_key_bundles is empty
-                if (!is_valid_get_pre_key_bundle_response(get_pre_key_bundle_response)) {
-                    ret = E2EES_RESULT_FAIL;
+        e2ees__session__free_unpacked(outbound_session, NULL);
+        return NULL;
+    }
+
+    return outbound_session;
+}
+
+int verify_signature_internal(
+    const ds_suite_t *ds_suite,
+    const uint8_t *signature, size_t signature_len,
+    const uint8_t *msg, size_t msg_len,
+    const uint8_t *public_key
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    if (ds_suite == NULL || signature == NULL || msg == NULL || public_key == NULL) {
+        return E2EES_RESULT_FAIL;
+    }
+
+    // the digest covers everything the verification depends on, each part is
+    // prefixed with its length so that different splits never collide
+    size_t public_key_len = ds_suite->get_crypto_param().sign_pub_key_len;
+    const uint8_t *parts[3] = {public_key, msg, signature};
+    size_t parts_len[3] = {public_key_len, msg_len, signature_len};
+    size_t digest_input_len = 3 * sizeof(uint64_t) + public_key_len + msg_len + signature_len;
+    uint8_t *digest_input = (uint8_t *)malloc(sizeof(uint8_t) * digest_input_len);
+    uint8_t *pos = digest_input;
+    size_t i, j;
+    for (i = 0; i < 3; i++) {
+        for (j = 0; j < sizeof(uint64_t); j++) {
+            *pos++ = (uint8_t)((uint64_t)parts_len[i] >> (8 * (sizeof(uint64_t) - 1 - j)));
+        }
+        memcpy(pos, parts[i], parts_len[i]);
+        pos += parts_len[i];
+    }
+    uint8_t digest[SHA256_OUTPUT_LENGTH];
+    crypto_sha256(digest_input, digest_input_len, digest);
+    free_mem((void **)&digest_input, digest_input_len);
+
+    if (!load_verified_signature_from_cache(ds_suite, digest)) {
+        ret = ds_suite->verify(signature, signature_len, msg, msg_len, public_key);
+        if (ret == E2EES_RESULT_SUCC) {
+            store_verified_signature_into_cache(ds_suite, digest);
+        } else {
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    return ret;
+}
+
+int load_identity_key_internal(
+    E2ees__IdentityKey **identity_key_out,
+    E2ees__E2eeAddress *user_address
+) {
+    E2ees__IdentityKey *identity_key = NULL;
+
+    if (!is_valid_address(user_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "load_identity_key_internal()");
+        *identity_key_out = NULL;
+        return E2EES_RESULT_FAIL;
+    }
+
+    load_identity_key_from_cache(&identity_key, user_address);
+
+    if (identity_key == NULL) {
+        if (get_e2ees_plugin()->db_handler.load_identity_key != NULL) {
+            get_e2ees_plugin()->db_handler.load_identity_key(user_address, &identity_key);
+        } else {
+            E2ees__Account *account = NULL;
+            load_account_without_opks_internal(&account, user_address);
+            if (account != NULL) {
+                // take the identity key and drop the rest
+                identity_key = account->identity_key;
+                account->identity_key = NULL;
+                free_proto(account);
+            }
+        }
+    }
+
+    if (!is_valid_identity_key(identity_key)) {
+        e2ees_notify_log(user_address, BAD_ACCOUNT, "load_identity_key_internal()");
+        if (identity_key != NULL) {
+            e2ees__identity_key__free_unpacked(identity_key, NULL);
+        }
+        *identity_key_out = NULL;
+        return E2EES_RESULT_FAIL;
+    }
+
+    *identity_key_out = identity_key;
+    return E2EES_RESULT_SUCC;
+}
+
+int load_account_without_opks_internal(
+    E2ees__Account **account_out,
+    E2ees__E2eeAddress *user_address
+) {
+    E2ees__Account *account = NULL;
+
+    if (!is_valid_address(user_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "load_account_without_opks_internal()");
+        *account_out = NULL;
+        return E2EES_RESULT_FAIL;
+    }
+
+    // the one-time pre-keys can only be left in the db if they can be loaded one by one
+    if (get_e2ees_plugin()->db_handler.load_account_without_opks != NULL
+        && get_e2ees_plugin()->db_handler.load_one_time_pre_key != NULL
+    ) {
+        get_e2ees_plugin()->db_handler.load_account_without_opks(user_address, &account);
+    } else {
+        get_e2ees_plugin()->db_handler.load_account_by_address(user_address, &account);
+    }
+
+    *account_out = account;
+    if (account == NULL) {
+        return E2EES_RESULT_FAIL;
+    }
+    return E2EES_RESULT_SUCC;
+}
+
+static bool has_group_info_handlers() {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    return db_handler->store_group_info != NULL
+        && db_handler->store_group_info_delta != NULL
+        && db_handler->load_group_info != NULL
+        && db_handler->store_group_session_info_version != NULL
+        && db_handler->load_group_session_info_version != NULL;
+}
+
+static uint64_t load_session_group_info_version(E2ees__E2eeAddress *owner_address, const char *session_id) {
+    if (session_id == NULL) {
+        return 0;
+    }
+    return get_e2ees_plugin()->db_handler.load_group_session_info_version(owner_address, session_id);
+}
+
+static void store_session_group_info_version(E2ees__E2eeAddress *owner_address, const char *session_id, uint64_t version) {
+    if (session_id == NULL) {
+        return;
+    }
+    get_e2ees_plugin()->db_handler.store_group_session_info_version(owner_address, session_id, version);
+}
+
+int load_group_info_internal(
+    E2ees__GroupInfo **group_info_out,
+    uint64_t *version_out,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address
+) {
+    *group_info_out = NULL;
+    *version_out = 0;
+    if (!has_group_info_handlers()) {
+        return E2EES_RESULT_FAIL;
+    }
+    if (load_group_info_cacheer(group_info_out, version_out, owner_address, group_address) == E2EES_RESULT_SUCC) {
+        return E2EES_RESULT_SUCC;
+    }
+
+    E2ees__GroupInfo *group_info = NULL;
+    E2ees__GroupInfo **added_list = NULL;
+    E2ees__GroupInfo **removed_list = NULL;
+    uint64_t version = 0;
+    size_t deltas_num = get_e2ees_plugin()->db_handler.load_group_info(
+        owner_address, group_address, &group_info, &version, &added_list, &removed_list
+    );
+
+    // apply the deltas after the full record
+    size_t i;
+    for (i = 0; i < deltas_num; i++) {
+        if (group_info != NULL) {
+            E2ees__GroupInfo *removed_group_info = NULL;
+            E2ees__GroupInfo *added_group_info = NULL;
+            remove_group_members_from_group_info(
+                &removed_group_info, group_info,
+                removed_list[i]->group_member_list, removed_list[i]->n_group_member_list
+            );
+            add_group_members_to_group_info(
+                &added_group_info, removed_group_info,
+                added_list[i]->group_member_list, added_list[i]->n_group_member_list
+            );
+            e2ees__group_info__free_unpacked(group_info, NULL);
+            e2ees__group_info__free_unpacked(removed_group_info, NULL);
+            group_info = added_group_info;
+            version++;
+        }
+        e2ees__group_info__free_unpacked(added_list[i], NULL);
+        e2ees__group_info__free_unpacked(removed_list[i], NULL);
+    }
+    if (deltas_num > 0) {
+        free_mem((void **)&added_list, sizeof(E2ees__GroupInfo *) * deltas_num);
+        free_mem((void **)&removed_list, sizeof(E2ees__GroupInfo *) * deltas_num);
+    }
+
+    if (group_info == NULL) {
+        return E2EES_RESULT_FAIL;
+    }
+
+    update_group_info_cacheer(owner_address, group_info, version);
+    *group_info_out = group_info;
+    *version_out = version;
+    return E2EES_RESULT_SUCC;
+}
+
+static E2ees__GroupInfo *new_group_info_delta(
+    E2ees__GroupInfo *group_info, E2ees__GroupMember **members, size_t members_num
+) {
+    E2ees__GroupInfo *delta = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(delta);
+    if (group_info->group_name != NULL)
+        delta->group_name = strdup(group_info->group_name);
+    copy_address_from_address(&(delta->group_address), group_info->group_address);
+    if (members_num > 0) {
+        copy_group_members(&(delta->group_member_list), members, members_num);
+        delta->n_group_member_list = members_num;
+    }
+    return delta;
+}
+
+static void store_group_info_change(
+    E2ees__E2eeAddress *owner_address, const char *session_id, E2ees__GroupInfo *group_info
+) {
+    E2ees__GroupInfo *record = NULL;
+    uint64_t version = 0;
+    if (load_group_info_internal(&record, &version, owner_address, group_info->group_address) != E2EES_RESULT_SUCC) {
+        // the first record of the group
+        get_e2ees_plugin()->db_handler.store_group_info(owner_address, group_info, 1);
+        update_group_info_cacheer(owner_address, group_info, 1);
+        store_session_group_info_version(owner_address, session_id, 1);
+        return;
+    }
+
+    // the member list of the session was taken from an older record, so it is not a change
+    uint64_t session_version = load_session_group_info_version(owner_address, session_id);
+    if (session_version != 0 && session_version < version) {
+        e2ees__group_info__free_unpacked(record, NULL);
+        return;
+    }
+
+    // find the changed members, a member whose role is changed is removed and added again
+    group_member_index_t record_index;
+    group_member_index_t new_index;
+    init_group_member_index(&record_index, record->group_member_list, record->n_group_member_list);
+    init_group_member_index(&new_index, group_info->group_member_list, group_info->n_group_member_list);
+    E2ees__GroupMember **added_members = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * new_index.members_num);
+    E2ees__GroupMember **removed_members = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * (record_index.members_num + 1));
+    size_t added_members_num = 0, removed_members_num = 0;
+    size_t i, position;
+    for (i = 0; i < new_index.members_num; i++) {
+        E2ees__GroupMember *member = new_index.members[i];
+        if (!find_group_member_in_index(&record_index, member->user_id, member->domain, &position)) {
+            added_members[added_members_num++] = member;
+        } else if (record_index.members[position]->role != member->role) {
+            removed_members[removed_members_num++] = record_index.members[position];
+            added_members[added_members_num++] = member;
+        }
+    }
+    for (i = 0; i < record_index.members_num; i++) {
+        E2ees__GroupMember *member = record_index.members[i];
+        if (!find_group_member_in_index(&new_index, member->user_id, member->domain, NULL)) {
+            removed_members[removed_members_num++] = member;
+        }
+    }
+
+    if (added_members_num > 0 || removed_members_num > 0) {
+        version++;
+        if (version % E2EES_GROUP_INFO_MAX_DELTAS == 0) {
+            // start over from a full record so that the deltas do not pile up
+            get_e2ees_plugin()->db_handler.store_group_info(owner_address, group_info, version);
+        } else {
+            E2ees__GroupInfo *added = new_group_info_delta(group_info, added_members, added_members_num);
+            E2ees__GroupInfo *removed = new_group_info_delta(group_info, removed_members, removed_members_num);
+            get_e2ees_plugin()->db_handler.store_group_info_delta(owner_address, version, added, removed);
+            e2ees__group_info__free_unpacked(added, NULL);
+            e2ees__group_info__free_unpacked(removed, NULL);
+        }
+        update_group_info_cacheer(owner_address, group_info, version);
+    }
+    if (session_version != version) {
+        store_session_group_info_version(owner_address, session_id, version);
+    }
+
+    // release
+    free_mem((void **)&added_members, sizeof(E2ees__GroupMember *) * new_index.members_num);
+    free_mem((void **)&removed_members, sizeof(E2ees__GroupMember *) * (record_index.members_num + 1));
+    free_group_member_index(&record_index);
+    free_group_member_index(&new_index);
+    e2ees__group_info__free_unpacked(record, NULL);
+}
+
+static bool has_shared_group_session_handlers() {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    return db_handler->store_shared_group_session != NULL
+        && db_handler->load_shared_group_session != NULL;
+}
+
+static bool is_shared_group_session(E2ees__GroupSession *group_session) {
+    // a complete inbound group session is the same for all of its owners but the chain state
+    return has_shared_group_session_handlers()
+        && group_session->session_id != NULL && group_session->session_id[0] != '\0'
+        && group_session->sender != NULL && group_session->session_owner != NULL
+        && !compare_address(group_session->sender, group_session->session_owner)
+        && group_session->chain_key.len > 0 && group_session->associated_data.len > 0;
+}
+
+static bool share_group_session(E2ees__GroupSession *group_session) {
+    e2ees_pack_t *e2ees_pack = get_e2ees_pack(group_session->e2ees_pack_id);
+    if (e2ees_pack == NULL) {
+        return false;
+    }
+    ProtobufCBinaryData chain_id = {0, NULL};
+    get_group_chain_id(e2ees_pack->cipher_suite, group_session, &chain_id);
+
+    E2ees__GroupSession shared_group_session = E2EES__GROUP_SESSION__INIT;
+    shared_group_session.e2ees_pack_id = group_session->e2ees_pack_id;
+    shared_group_session.session_id = group_session->session_id;
+    shared_group_session.sender = group_session->sender;
+    shared_group_session.associated_data = group_session->associated_data;
+    shared_group_session.group_seed = group_session->group_seed;
+    get_e2ees_plugin()->db_handler.store_shared_group_session(
+        group_session->session_owner, &chain_id, &shared_group_session
+    );
+
+    // release
+    free_protobuf(&chain_id);
+
+    return true;
+}
+
+void store_group_session_internal(E2ees__GroupSession *group_session) {
+    E2ees__GroupInfo *group_info = group_session->group_info;
+    // a group session without a member list has been stripped already
+    bool strip_members = has_group_info_handlers() && group_info != NULL && group_info->n_group_member_list > 0;
+    bool strip_shared = is_shared_group_session(group_session) && share_group_session(group_session);
+    if (!strip_members && !strip_shared) {
+        get_e2ees_plugin()->db_handler.store_group_session(group_session);
+        return;
+    }
+
+    size_t group_members_num = 0;
+    E2ees__GroupMember **group_member_list = NULL;
+    if (strip_members) {
+        store_group_info_change(group_session->session_owner, group_session->session_id, group_info);
+
+        // the member list is kept in the group info record
+        group_members_num = group_info->n_group_member_list;
+        group_member_list = group_info->group_member_list;
+        group_info->n_group_member_list = 0;
+        group_info->group_member_list = NULL;
+    }
+    ProtobufCBinaryData associated_data = group_session->associated_data;
+    ProtobufCBinaryData group_seed = group_session->group_seed;
+    if (strip_shared) {
+        // the associated data and the group seed are kept in the shared group session
+        group_session->associated_data.len = 0;
+        group_session->associated_data.data = NULL;
+        group_session->group_seed.len = 0;
+        group_session->group_seed.data = NULL;
+    }
+    get_e2ees_plugin()->db_handler.store_group_session(group_session);
+    if (strip_members) {
+        group_info->n_group_member_list = group_members_num;
+        group_info->group_member_list = group_member_list;
+    }
+    group_session->associated_data = associated_data;
+    group_session->group_seed = group_seed;
+}
+
+bool fill_shared_group_session_internal(E2ees__GroupSession *group_session, ProtobufCBinaryData *chain_id_out) {
+    if (group_session == NULL || group_session->associated_data.len > 0 || !has_shared_group_session_handlers()) {
+        return false;
+    }
+
+    E2ees__GroupSession *shared_group_session = NULL;
+    ProtobufCBinaryData chain_id = {0, NULL};
+    get_e2ees_plugin()->db_handler.load_shared_group_session(
+        group_session->sender, group_session->session_owner, group_session->session_id,
+        &chain_id, &shared_group_session
+    );
+    if (shared_group_session == NULL) {
+        free_protobuf(&chain_id);
+        return false;
+    }
+
+    // hand over the associated data and the group seed
+    group_session->associated_data = shared_group_session->associated_data;
+    shared_group_session->associated_data.len = 0;
+    shared_group_session->associated_data.data = NULL;
+    if (shared_group_session->group_seed.len > 0) {
+        free_protobuf(&(group_session->group_seed));
+        group_session->group_seed = shared_group_session->group_seed;
+        shared_group_session->group_seed.len = 0;
+        shared_group_session->group_seed.data = NULL;
+    }
+    if (chain_id_out != NULL) {
+        *chain_id_out = chain_id;
+    } else {
+        free_protobuf(&chain_id);
+    }
+
+    // release
+    e2ees__group_session__free_unpacked(shared_group_session, NULL);
+
+    return true;
+}
+
+static void fill_group_session_members(E2ees__GroupSession *group_session) {
+    if (group_session == NULL || group_session->group_info == NULL
+        || group_session->group_info->n_group_member_list > 0 || !has_group_info_handlers()) {
+        return;
+    }
+
+    E2ees__GroupInfo *record = NULL;
+    uint64_t version = 0;
+    if (load_group_info_internal(
+            &record, &version, group_session->session_owner, group_session->group_info->group_address
+        ) == E2EES_RESULT_SUCC) {
+        // the member list of the session is at the version of the record from now on
+        if (load_session_group_info_version(group_session->session_owner, group_session->session_id) != version) {
+            store_session_group_info_version(group_session->session_owner, group_session->session_id, version);
+        }
+        // hand over the member list of the record
+        group_session->group_info->n_group_member_list = record->n_group_member_list;
+        group_session->group_info->group_member_list = record->group_member_list;
+        record->n_group_member_list = 0;
+        record->group_member_list = NULL;
+        e2ees__group_info__free_unpacked(record, NULL);
+    }
+}
+
+void load_group_session_by_address_internal(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address,
+    E2ees__GroupSession **group_session_out
+) {
+    get_e2ees_plugin()->db_handler.load_group_session_by_address(
+        sender_address, owner_address, group_address, group_session_out
+    );
+    fill_group_session_members(*group_session_out);
+    fill_shared_group_session_internal(*group_session_out, NULL);
+}
+
+void load_group_session_by_id_internal(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    char *session_id,
+    E2ees__GroupSession **group_session_out
+) {
+    get_e2ees_plugin()->db_handler.load_group_session_by_id(
+        sender_address, owner_address, session_id, group_session_out
+    );
+    fill_group_session_members(*group_session_out);
+    fill_shared_group_session_internal(*group_session_out, NULL);
+}
+
+size_t load_group_sessions_internal(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address,
+    E2ees__GroupSession ***group_sessions_out
+) {
+    size_t group_sessions_num = get_e2ees_plugin()->db_handler.load_group_sessions(
+        owner_address, group_address, group_sessions_out
+    );
+    size_t i;
+    for (i = 0; i < group_sessions_num; i++) {
+        fill_group_session_members((*group_sessions_out)[i]);
+        fill_shared_group_session_internal((*group_sessions_out)[i], NULL);
+    }
+    return group_sessions_num;
+}
+
+static bool replay_pending_request(
+    E2ees__Account *account, uint8_t request_type, E2ees__PendingRequest *pending_request
+) {
+    E2ees__E2eeAddress *user_address = account->address;
+    char *auth = account->auth;
+
+    int ret = E2EES_RESULT_SUCC;
+    bool succ = false;
+    bool done = false;
+    E2ees__GroupSession *group_session = NULL;
+    size_t j;
+
+    switch (request_type) {
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_GET_PRE_KEY_BUNDLE: {
+            size_t their_device_num;
+            E2ees__GetPreKeyBundleRequest *get_pre_key_bundle_request = e2ees__get_pre_key_bundle_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__GetPreKeyBundleResponse *get_pre_key_bundle_response = get_e2ees_plugin()->proto_handler.get_pre_key_bundle(user_address, auth, get_pre_key_bundle_request);
+            // check if pre_key_bundles is empty
+            if (!is_valid_get_pre_key_bundle_response(get_pre_key_bundle_response)) {
+                ret = E2EES_RESULT_FAIL;
+            }
+            if (ret == E2EES_RESULT_SUCC) {
+                their_device_num = get_pre_key_bundle_response->n_pre_key_bundles;
+                E2ees__InviteResponse **invite_response_list = NULL;
+                size_t invite_response_num = 0;
+                size_t arg_num = pending_request->n_request_arg_list;
+                size_t group_pre_key_plaintext_data_len = 0;
+                uint8_t *group_pre_key_plaintext_data = NULL;
+                if (arg_num == 2) {
+                    group_pre_key_plaintext_data = pending_request->request_arg_list[1].data;
+                    group_pre_key_plaintext_data_len = pending_request->request_arg_list[1].len;
                 }
-                if (ret == E2EES_RESULT_SUCC) {
-                    their_device_num = get_pre_key_bundle_response->n_pre_key_bundles;
-                    E2ees__InviteResponse **invite_response_list = NULL;
-                    size_t invite_response_num = 0;
-                    size_t arg_num = pending_request->n_request_arg_list;
-                    size_t group_pre_key_plaintext_data_len = 0;
-                    uint8_t *group_pre_key_plaintext_data = NULL;
-                    if (arg_num == 2) {
-                        group_pre_key_plaintext_data = pending_request->request_arg_list[1].data;
-                        group_pre_key_plaintext_data_len = pending_request->request_arg_list[1].len;
-                    }
-                    ret = consume_get_pre_key_bundle_response(
-                        &invite_response_list,
-                        &invite_response_num,
-                        user_address,
-                        group_pre_key_plaintext_data,
-                        group_pre_key_plaintext_data_len,
-                        get_pre_key_bundle_response
-                    );
+                ret = consume_get_pre_key_bundle_response(
+                    &invite_response_list,
+                    &invite_response_num,
+                    user_address,
+                    group_pre_key_plaintext_data,
+                    group_pre_key_plaintext_data_len,
+                    get_pre_key_bundle_response
+                );
 
-                    // release
-                    if (invite_response_list != NULL) {
-                        for (j = 0; j < their_device_num; j++) {
-                            if (invite_response_list[j] != NULL) {
-                                e2ees__invite_response__free_unpacked(invite_response_list[j], NULL);
-                            }
+                // release
+                if (invite_response_list != NULL) {
+                    for (j = 0; j < their_device_num; j++) {
+                        if (invite_response_list[j] != NULL) {
+                            e2ees__invite_response__free_unpacked(invite_response_list[j], NULL);
                         }
-                        free_mem((void **)&invite_response_list, sizeof(E2ees__InviteResponse *) * their_device_num);
                     }
+                    free_mem((void **)&invite_response_list, sizeof(E2ees__InviteResponse *) * their_device_num);
+                }
 
-                    if (ret == E2EES_RESULT_SUCC) {
-                        if (pending_request->request_arg_list[0].data[0] == 'T') {
-                            their_device_num = get_pre_key_bundle_response->n_pre_key_bundles;
-                            char **their_device_id = (char **)malloc(sizeof(char *) * their_device_num);
-                            E2ees__PreKeyBundle *cur_pre_key_bundle = NULL;
-                            for (j = 0; j < their_device_num; j++) {
-                                cur_pre_key_bundle = get_pre_key_bundle_response->pre_key_bundles[j];
-                                their_device_id[j] = strdup(cur_pre_key_bundle->user_address->user->device_id);
-                            }
-                            // send to other devices in order to create sessions
-                            send_sync_invite_msg(
-                                user_address,
-                                get_pre_key_bundle_request->user_id,
-                                get_pre_key_bundle_request->domain,
-                                their_device_id,
-                                their_device_num
-                            );
-
-                            // release
-                            for (j = 0; j < their_device_num; j++) {
-                                free(their_device_id[j]);
-                            }
-                            free_mem((void **)&their_device_id, sizeof(char *) * their_device_num);
+                if (ret == E2EES_RESULT_SUCC) {
+                    if (pending_request->request_arg_list[0].data[0] == 'T') {
+                        their_device_num = get_pre_key_bundle_response->n_pre_key_bundles;
+                        char **their_device_id = (char **)malloc(sizeof(char *) * their_device_num);
+                        E2ees__PreKeyBundle *cur_pre_key_bundle = NULL;
+                        for (j = 0; j < their_device_num; j++) {
+                            cur_pre_key_bundle = get_pre_key_bundle_response->pre_key_bundles[j];
+                            their_device_id[j] = strdup(cur_pre_key_bundle->user_address->user->device_id);
                         }
-                    }
-                } else {
-                    // if the get_pre_key_bundle_response code is no content, we will unload the pending request data
-                    if (get_pre_key_bundle_response != NULL) {
-                        if (get_pre_key_bundle_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NO_CONTENT) {
-                            e2ees_notify_log(
-                                user_address,
-                                DEBUG_LOG,
-                                "consume_get_pre_key_bundle_response() got empty pre_key_bundles, remove pending request"
-                            );
-                            succ = true;
+                        // send to other devices in order to create sessions
+                        send_sync_invite_msg(
+                            user_address,
+                            get_pre_key_bundle_request->user_id,
+                            get_pre_key_bundle_request->domain,
+                            their_device_id,
+                            their_device_num
+                        );
+
+                        // release
+                        for (j = 0; j < their_device_num; j++) {
+                            free(their_device_id[j]);
                         }
+                        free_mem((void **)&their_device_id, sizeof(char *) * their_device_num);
                     }
                 }
-                
-                if (ret == E2EES_RESULT_SUCC || succ) {
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending get_pre_key_bundle_request failed");
+            } else {
+                // if the get_pre_key_bundle_response code is no content, we will unload the pending request data
+                if (get_pre_key_bundle_response != NULL) {
+                    if (get_pre_key_bundle_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NO_CONTENT) {
+                        e2ees_notify_log(
+                            user_address,
+                            DEBUG_LOG,
+                            "consume_get_pre_key_bundle_response() got empty pre_key_bundles, remove pending request"
+                        );
+                        succ = true;
+                    }
                 }
-
-                // release
-                free_proto(get_pre_key_bundle_request);
-                free_proto(get_pre_key_bundle_response);
-                break;
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_INVITE: {
-                E2ees__InviteRequest *invite_request = e2ees__invite_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__InviteResponse *invite_response = get_e2ees_plugin()->proto_handler.invite(user_address, auth, invite_request);
-                succ = is_valid_invite_response(invite_response);
-                if (succ) {
-                    ret = consume_invite_response(user_address, invite_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending invite_request failed");
-                }
+            
+            if (ret == E2EES_RESULT_SUCC || succ) {
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending get_pre_key_bundle_request failed");
+            }
 
-                // release
-                free_proto(invite_request);
-                free_proto(invite_response);
-                break;
+            // release
+            free_proto(get_pre_key_bundle_request);
+            free_proto(get_pre_key_bundle_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_INVITE: {
+            E2ees__InviteRequest *invite_request = e2ees__invite_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__InviteResponse *invite_response = get_e2ees_plugin()->proto_handler.invite(user_address, auth, invite_request);
+            succ = is_valid_invite_response(invite_response);
+            if (succ) {
+                ret = consume_invite_response(user_address, invite_response);
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending invite_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ACCEPT: {
-                E2ees__AcceptRequest *accept_request = e2ees__accept_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__AcceptResponse *accept_response = get_e2ees_plugin()->proto_handler.accept(user_address, auth, accept_request);
-                succ = is_valid_accept_response(accept_response);
-                if (succ) {
-                    ret = consume_accept_response(accept_request->msg->from, accept_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending accept_request failed");
-                }
 
-                // release
-                free_proto(accept_request);
-                free_proto(accept_response);
-                break;
+            // release
+            free_proto(invite_request);
+            free_proto(invite_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ACCEPT: {
+            E2ees__AcceptRequest *accept_request = e2ees__accept_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__AcceptResponse *accept_response = get_e2ees_plugin()->proto_handler.accept(user_address, auth, accept_request);
+            succ = is_valid_accept_response(accept_response);
+            if (succ) {
+                ret = consume_accept_response(accept_request->msg->from, accept_response);
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending accept_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PUBLISH_SPK: {
-                E2ees__PublishSpkRequest *publish_spk_request = e2ees__publish_spk_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__PublishSpkResponse *publish_spk_response = get_e2ees_plugin()->proto_handler.publish_spk(user_address, auth, publish_spk_request);
-                succ = is_valid_publish_spk_response(publish_spk_response);
-                if (succ) {
-                    ret = consume_publish_spk_response(account, publish_spk_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending publish_spk_request failed");
-                }
 
-                // release
-                free_proto(publish_spk_request);
-                free_proto(publish_spk_response);
-                break;
+            // release
+            free_proto(accept_request);
+            free_proto(accept_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PUBLISH_SPK: {
+            E2ees__PublishSpkRequest *publish_spk_request = e2ees__publish_spk_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__PublishSpkResponse *publish_spk_response = get_e2ees_plugin()->proto_handler.publish_spk(user_address, auth, publish_spk_request);
+            succ = is_valid_publish_spk_response(publish_spk_response);
+            if (succ) {
+                ret = consume_publish_spk_response(account, publish_spk_response);
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending publish_spk_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SUPPLY_OPKS: {
-                E2ees__SupplyOpksRequest *supply_opks_request = e2ees__supply_opks_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__SupplyOpksResponse *supply_opks_response = get_e2ees_plugin()->proto_handler.supply_opks(user_address, auth,  supply_opks_request);
-                succ = is_valid_supply_opks_response(supply_opks_response);
-                if (succ) {
-                    ret = consume_supply_opks_response(account, (uint32_t)supply_opks_request->n_one_time_pre_key_public_list, supply_opks_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending supply_opks_request failed");
-                }
 
-                // release
-                free_proto(supply_opks_request);
-                free_proto(supply_opks_response);
-                break;
+            // release
+            free_proto(publish_spk_request);
+            free_proto(publish_spk_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SUPPLY_OPKS: {
+            E2ees__SupplyOpksRequest *supply_opks_request = e2ees__supply_opks_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__SupplyOpksResponse *supply_opks_response = get_e2ees_plugin()->proto_handler.supply_opks(user_address, auth,  supply_opks_request);
+            succ = is_valid_supply_opks_response(supply_opks_response);
+            if (succ) {
+                ret = consume_supply_opks_response(account, supply_opks_response);
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending supply_opks_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG: {
-                E2ees__SendOne2oneMsgRequest *send_one2one_msg_request = e2ees__send_one2one_msg_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__SendOne2oneMsgResponse *send_one2one_msg_response = get_e2ees_plugin()->proto_handler.send_one2one_msg(user_address, auth, send_one2one_msg_request);
-                if (send_one2one_msg_response != NULL && send_one2one_msg_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_OK) {
-                    succ = true;
-                }
-                if (succ) {
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending send_one2one_msg_request failed");
-                }
 
-                // release
-                free_proto(send_one2one_msg_request);
-                free_proto(send_one2one_msg_response);
-                break;
+            // release
+            free_proto(supply_opks_request);
+            free_proto(supply_opks_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG: {
+            E2ees__SendOne2oneMsgRequest *send_one2one_msg_request = e2ees__send_one2one_msg_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__SendOne2oneMsgResponse *send_one2one_msg_response = get_e2ees_plugin()->proto_handler.send_one2one_msg(user_address, auth, send_one2one_msg_request);
+            if (send_one2one_msg_response != NULL && send_one2one_msg_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_OK) {
+                succ = true;
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_CREATE_GROUP: {
-                E2ees__CreateGroupRequest *create_group_request = e2ees__create_group_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__CreateGroupResponse *create_group_response = get_e2ees_plugin()->proto_handler.create_group(user_address, auth, create_group_request);
-                succ = is_valid_create_group_response(create_group_response);
-                if (succ) {
-                    ret = consume_create_group_response(
-                        account->e2ees_pack_id,
-                        user_address,
-                        create_group_request->msg->group_info->group_name,
-                        create_group_request->msg->group_info->group_member_list,
-                        create_group_request->msg->group_info->n_group_member_list,
-                        create_group_response
-                    );
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                pending_request_id_list[i]);
-                } else {
-                    if (create_group_response != NULL && create_group_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
-                        // At least one member with group manager role,
-                        // or some error happened on creating group.
-                        get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                    pending_request_id_list[i]);
-                    }
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending create_group_request failed");
+            if (succ) {
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending send_one2one_msg_request failed");
+            }
+
+            // release
+            free_proto(send_one2one_msg_request);
+            free_proto(send_one2one_msg_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_CREATE_GROUP: {
+            E2ees__CreateGroupRequest *create_group_request = e2ees__create_group_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__CreateGroupResponse *create_group_response = get_e2ees_plugin()->proto_handler.create_group(user_address, auth, create_group_request);
+            succ = is_valid_create_group_response(create_group_response);
+            if (succ) {
+                ret = consume_create_group_response(
+                    account->e2ees_pack_id,
+                    user_address,
+                    create_group_request->msg->group_info->group_name,
+                    create_group_request->msg->group_info->group_member_list,
+                    create_group_request->msg->group_info->n_group_member_list,
+                    create_group_response
+                );
+                done = true;
+            } else {
+                if (create_group_response != NULL && create_group_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+                    // At least one member with group manager role,
+                    // or some error happened on creating group.
+                    done = true;
                 }
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending create_group_request failed");
+            }
 
-                // release
-                free_proto(create_group_request);
-                free_proto(create_group_response);
-                break;
+            // release
+            free_proto(create_group_request);
+            free_proto(create_group_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBERS: {
+            E2ees__AddGroupMembersRequest *add_group_members_request = e2ees__add_group_members_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__AddGroupMembersResponse *add_group_members_response = get_e2ees_plugin()->proto_handler.add_group_members(user_address, auth, add_group_members_request);
+            succ = is_valid_add_group_members_response(add_group_members_response);
+            if (succ) {
+                E2ees__AddGroupMembersMsg *add_group_members_msg = add_group_members_request->msg;
+                load_group_session_by_address_internal(
+                    user_address, user_address, add_group_members_msg->group_info->group_address, &group_session
+                );
+                ret = consume_add_group_members_response(
+                    group_session, add_group_members_response,
+                    add_group_members_msg->adding_member_list, add_group_members_msg->n_adding_member_list
+                );
+                done = true;
+            } else {
+                if (add_group_members_response != NULL && add_group_members_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+                    // Only the group member with GROUP_ROLE_MANAGER role can add group members,
+                    // or member inexists.
+                    done = true;
+                }
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending add_group_members_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBERS: {
-                E2ees__AddGroupMembersRequest *add_group_members_request = e2ees__add_group_members_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__AddGroupMembersResponse *add_group_members_response = get_e2ees_plugin()->proto_handler.add_group_members(user_address, auth, add_group_members_request);
-                succ = is_valid_add_group_members_response(add_group_members_response);
-                if (succ) {
-                    E2ees__AddGroupMembersMsg *add_group_members_msg = add_group_members_request->msg;
-                    get_e2ees_plugin()->db_handler.load_group_session_by_address(
-                        user_address, user_address, add_group_members_msg->group_info->group_address, &group_session
-                    );
-                    ret = consume_add_group_members_response(
-                        group_session, add_group_members_response,
-                        add_group_members_msg->adding_member_list, add_group_members_msg->n_adding_member_list
-                    );
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                pending_request_id_list[i]);
-                } else {
-                    if (add_group_members_response != NULL && add_group_members_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
-                        // Only the group member with GROUP_ROLE_MANAGER role can add group members,
-                        // or member inexists.
-                        get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                    pending_request_id_list[i]);
-                    }
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending add_group_members_request failed");
+
+            // release
+            free_proto(add_group_members_request);
+            free_proto(add_group_members_response);
+            free_proto(group_session);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBER_DEVICE: {
+            E2ees__AddGroupMemberDeviceRequest *add_group_member_device_request = e2ees__add_group_member_device_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__AddGroupMemberDeviceResponse *add_group_member_device_response = get_e2ees_plugin()->proto_handler.add_group_member_device(user_address, auth, add_group_member_device_request);
+            succ = is_valid_add_group_member_device_response(add_group_member_device_response);
+            if (succ) {
+                load_group_session_by_address_internal(
+                    user_address, user_address, add_group_member_device_request->msg->group_info->group_address, &group_session
+                );
+                ret = consume_add_group_member_device_response(
+                    group_session, add_group_member_device_response
+                );
+                done = true;
+            } else {
+                if (add_group_member_device_response != NULL && add_group_member_device_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+                    // Can not collect group member info, or member device already added.
+                    done = true;
                 }
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending add_group_member_device_request failed");
+            }
 
-                // release
-                free_proto(add_group_members_request);
-                free_proto(add_group_members_response);
-                free_proto(group_session);
-                break;
+            // release
+            free_proto(add_group_member_device_request);
+            free_proto(add_group_member_device_response);
+            free_proto(group_session);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_REMOVE_GROUP_MEMBERS: {
+            E2ees__RemoveGroupMembersRequest *remove_group_members_request = e2ees__remove_group_members_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__RemoveGroupMembersResponse *remove_group_members_response = get_e2ees_plugin()->proto_handler.remove_group_members(user_address, auth, remove_group_members_request);
+            succ = is_valid_remove_group_members_response(remove_group_members_response);
+            if (succ) {
+                E2ees__RemoveGroupMembersMsg *remove_group_members_msg = remove_group_members_request->msg;
+                load_group_session_by_address_internal(
+                    user_address, user_address,
+                    remove_group_members_msg->group_info->group_address, &group_session
+                );
+                ret = consume_remove_group_members_response(
+                    group_session, remove_group_members_response,
+                    remove_group_members_msg->removing_member_list, remove_group_members_msg->n_removing_member_list
+                );
+                done = true;
+            } else {
+                if (remove_group_members_response != NULL && remove_group_members_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+                    // Only the group member with GROUP_ROLE_MANAGER role can remove group members,
+                    // user can not remove himself, or member is not in removing member list.
+                    done = true;
+                }
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending remove_group_members_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBER_DEVICE: {
-                E2ees__AddGroupMemberDeviceRequest *add_group_member_device_request = e2ees__add_group_member_device_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__AddGroupMemberDeviceResponse *add_group_member_device_response = get_e2ees_plugin()->proto_handler.add_group_member_device(user_address, auth, add_group_member_device_request);
-                succ = is_valid_add_group_member_device_response(add_group_member_device_response);
-                if (succ) {
-                    get_e2ees_plugin()->db_handler.load_group_session_by_address(
-                        user_address, user_address, add_group_member_device_request->msg->group_info->group_address, &group_session
-                    );
-                    ret = consume_add_group_member_device_response(
-                        group_session, add_group_member_device_response
-                    );
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                pending_request_id_list[i]);
-                } else {
-                    if (add_group_member_device_response != NULL && add_group_member_device_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
-                        // Can not collect group member info, or member device already added.
-                        get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                    pending_request_id_list[i]);
-                    }
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending add_group_member_device_request failed");
+
+            // release
+            free_proto(remove_group_members_request);
+            free_proto(remove_group_members_response);
+            free_proto(group_session);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_LEAVE_GROUP: {
+            E2ees__LeaveGroupRequest *leave_group_request = e2ees__leave_group_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__LeaveGroupResponse *leave_group_response = get_e2ees_plugin()->proto_handler.leave_group(user_address, auth, leave_group_request);
+            succ = is_valid_leave_group_response(leave_group_response);
+            if (succ) {
+                ret = consume_leave_group_response(user_address, leave_group_response);
+                done = true;
+            } else {
+                if (leave_group_response != NULL && leave_group_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
+                    // Only the group member can leave the group.
+                    done = true;
                 }
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending leave_group_request failed");
+            }
 
-                // release
-                free_proto(add_group_member_device_request);
-                free_proto(add_group_member_device_response);
-                free_proto(group_session);
-                break;
+            // release
+            free_proto(leave_group_request);
+            free_proto(leave_group_response);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG: {
+            E2ees__SendGroupMsgRequest *send_group_msg_request = e2ees__send_group_msg_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__SendGroupMsgResponse *send_group_msg_response = get_e2ees_plugin()->proto_handler.send_group_msg(user_address, auth, send_group_msg_request);
+            succ = is_valid_send_group_msg_response(send_group_msg_response);
+            if (succ) {
+                load_group_session_by_address_internal(user_address, user_address, send_group_msg_request->msg->to, &group_session);
+                ret = consume_send_group_msg_response(group_session, send_group_msg_request, send_group_msg_response);
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending send_group_msg_request failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_REMOVE_GROUP_MEMBERS: {
-                E2ees__RemoveGroupMembersRequest *remove_group_members_request = e2ees__remove_group_members_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__RemoveGroupMembersResponse *remove_group_members_response = get_e2ees_plugin()->proto_handler.remove_group_members(user_address, auth, remove_group_members_request);
-                succ = is_valid_remove_group_members_response(remove_group_members_response);
-                if (succ) {
-                    E2ees__RemoveGroupMembersMsg *remove_group_members_msg = remove_group_members_request->msg;
-                    get_e2ees_plugin()->db_handler.load_group_session_by_address(
-                        user_address, user_address,
-                        remove_group_members_msg->group_info->group_address, &group_session
-                    );
-                    ret = consume_remove_group_members_response(
-                        group_session, remove_group_members_response,
-                        remove_group_members_msg->removing_member_list, remove_group_members_msg->n_removing_member_list
-                    );
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                pending_request_id_list[i]);
-                } else {
-                    if (remove_group_members_response != NULL && remove_group_members_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
-                        // Only the group member with GROUP_ROLE_MANAGER role can remove group members,
-                        // user can not remove himself, or member is not in removing member list.
-                        get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                    pending_request_id_list[i]);
-                    }
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending remove_group_members_request failed");
-                }
 
-                // release
-                free_proto(remove_group_members_request);
-                free_proto(remove_group_members_response);
-                free_proto(group_session);
-                break;
+            // release
+            free_proto(send_group_msg_request);
+            free_proto(send_group_msg_response);
+            free_proto(group_session);
+            break;
+        } 
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG: {
+            E2ees__ProtoMsg *proto_msg = e2ees__proto_msg__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
+            E2ees__ConsumeProtoMsgResponse *consume_proto_msg_response = consume_proto_msg(proto_msg->to, proto_msg->tag->proto_msg_id);
+            if (consume_proto_msg_response != NULL
+                && (consume_proto_msg_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_OK
+                    || consume_proto_msg_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND)) {
+                done = true;
+            } else {
+                e2ees_notify_log(user_address, DEBUG_LOG, "handle pending proto_msg failed");
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_LEAVE_GROUP: {
-                E2ees__LeaveGroupRequest *leave_group_request = e2ees__leave_group_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__LeaveGroupResponse *leave_group_response = get_e2ees_plugin()->proto_handler.leave_group(user_address, auth, leave_group_request);
-                succ = is_valid_leave_group_response(leave_group_response);
-                if (succ) {
-                    ret = consume_leave_group_response(user_address, leave_group_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                pending_request_id_list[i]);
-                } else {
-                    if (leave_group_response != NULL && leave_group_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND) {
-                        // Only the group member can leave the group.
-                        get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address,
-                                                                                    pending_request_id_list[i]);
-                    }
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending leave_group_request failed");
-                }
+            // release
+            free_proto(proto_msg);
+            free_proto(consume_proto_msg_response);
+            break;
+        }
+        default:
+            e2ees_notify_log(
+                user_address,
+                DEBUG_LOG,
+                "replay_pending_request() unknown pending request type: %d",
+                request_type
+            );
+            break;
+    };
 
-                // release
-                free_proto(leave_group_request);
-                free_proto(leave_group_response);
-                break;
+    return done;
+}
+
+static void resend_pending_request(E2ees__Account *account);
+
+typedef struct pending_request_item {
+    char *request_id;
+    uint8_t request_type;
+    E2ees__PendingRequest *pending_request;
+    // the requests with the same key are coalesced into one replay
+    char *proto_msg_id;
+    const uint8_t *key;
+    size_t key_len;
+    uint64_t key_digest;
+    // index of the first request with the same key, or -1 if none
+    long representative;
+    // the requests of the same peer are replayed in order, the peers are independent
+    char *lane_key;
+    bool consume_ack;
+    bool done;
+} pending_request_item;
+
+static char *make_pending_request_lane_key(char kind, const char *domain, const char *id) {
+    if (domain == NULL || id == NULL)
+        return NULL;
+
+    // "<kind>:<domain>:<id>"
+    size_t domain_len = strlen(domain);
+    size_t id_len = strlen(id);
+    char *lane_key = (char *)malloc(sizeof(char) * (domain_len + id_len + 4));
+    lane_key[0] = kind;
+    lane_key[1] = ':';
+    memcpy(lane_key + 2, domain, domain_len);
+    lane_key[2 + domain_len] = ':';
+    memcpy(lane_key + 3 + domain_len, id, id_len);
+    lane_key[3 + domain_len + id_len] = '\0';
+    return lane_key;
+}
+
+static char *get_address_lane_key(E2ees__E2eeAddress *address) {
+    if (address == NULL)
+        return NULL;
+    if (address->peer_case == E2EES__E2EE_ADDRESS__PEER_USER && address->user != NULL) {
+        // all devices of a peer user share one lane
+        return make_pending_request_lane_key('u', address->domain, address->user->user_id);
+    }
+    if (address->peer_case == E2EES__E2EE_ADDRESS__PEER_GROUP && address->group != NULL) {
+        return make_pending_request_lane_key('g', address->domain, address->group->group_id);
+    }
+    return NULL;
+}
+
+/**
+ * Find the peer user or the group that a pending request is sent for.
+ * The requests without a peer, such as publishing the signed pre-key, share the lane of the account.
+ */
+static char *get_pending_request_lane_key(uint8_t request_type, E2ees__PendingRequest *pending_request) {
+    size_t len = pending_request->request_data.len;
+    uint8_t *data = pending_request->request_data.data;
+    char *lane_key = NULL;
+
+    switch (request_type) {
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_GET_PRE_KEY_BUNDLE: {
+            E2ees__GetPreKeyBundleRequest *get_pre_key_bundle_request = e2ees__get_pre_key_bundle_request__unpack(NULL, len, data);
+            if (get_pre_key_bundle_request != NULL) {
+                lane_key = make_pending_request_lane_key(
+                    'u', get_pre_key_bundle_request->domain, get_pre_key_bundle_request->user_id
+                );
             }
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG: {
-                E2ees__SendGroupMsgRequest *send_group_msg_request = e2ees__send_group_msg_request__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__SendGroupMsgResponse *send_group_msg_response = get_e2ees_plugin()->proto_handler.send_group_msg(user_address, auth, send_group_msg_request);
-                succ = is_valid_send_group_msg_response(send_group_msg_response);
-                if (succ) {
-                    get_e2ees_plugin()->db_handler.load_group_session_by_address(user_address, user_address, send_group_msg_request->msg->to, &group_session);
-                    ret = consume_send_group_msg_response(group_session, send_group_msg_response);
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                } else {
-                    e2ees_notify_log(user_address, DEBUG_LOG, "handle pending send_group_msg_request failed");
-                }
+            free_proto(get_pre_key_bundle_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_INVITE: {
+            E2ees__InviteRequest *invite_request = e2ees__invite_request__unpack(NULL, len, data);
+            if (invite_request != NULL && invite_request->msg != NULL) {
+                lane_key = get_address_lane_key(invite_request->msg->to);
+            }
+            free_proto(invite_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ACCEPT: {
+            E2ees__AcceptRequest *accept_request = e2ees__accept_request__unpack(NULL, len, data);
+            if (accept_request != NULL && accept_request->msg != NULL) {
+                lane_key = get_address_lane_key(accept_request->msg->to);
+            }
+            free_proto(accept_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG: {
+            E2ees__SendOne2oneMsgRequest *send_one2one_msg_request = e2ees__send_one2one_msg_request__unpack(NULL, len, data);
+            if (send_one2one_msg_request != NULL && send_one2one_msg_request->msg != NULL) {
+                lane_key = get_address_lane_key(send_one2one_msg_request->msg->to);
+            }
+            free_proto(send_one2one_msg_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBERS: {
+            E2ees__AddGroupMembersRequest *add_group_members_request = e2ees__add_group_members_request__unpack(NULL, len, data);
+            if (add_group_members_request != NULL && add_group_members_request->msg != NULL
+                && add_group_members_request->msg->group_info != NULL) {
+                lane_key = get_address_lane_key(add_group_members_request->msg->group_info->group_address);
+            }
+            free_proto(add_group_members_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_ADD_GROUP_MEMBER_DEVICE: {
+            E2ees__AddGroupMemberDeviceRequest *add_group_member_device_request = e2ees__add_group_member_device_request__unpack(NULL, len, data);
+            if (add_group_member_device_request != NULL && add_group_member_device_request->msg != NULL
+                && add_group_member_device_request->msg->group_info != NULL) {
+                lane_key = get_address_lane_key(add_group_member_device_request->msg->group_info->group_address);
+            }
+            free_proto(add_group_member_device_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_REMOVE_GROUP_MEMBERS: {
+            E2ees__RemoveGroupMembersRequest *remove_group_members_request = e2ees__remove_group_members_request__unpack(NULL, len, data);
+            if (remove_group_members_request != NULL && remove_group_members_request->msg != NULL
+                && remove_group_members_request->msg->group_info != NULL) {
+                lane_key = get_address_lane_key(remove_group_members_request->msg->group_info->group_address);
+            }
+            free_proto(remove_group_members_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_LEAVE_GROUP: {
+            E2ees__LeaveGroupRequest *leave_group_request = e2ees__leave_group_request__unpack(NULL, len, data);
+            if (leave_group_request != NULL && leave_group_request->msg != NULL) {
+                lane_key = get_address_lane_key(leave_group_request->msg->group_address);
+            }
+            free_proto(leave_group_request);
+            break;
+        }
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG: {
+            E2ees__SendGroupMsgRequest *send_group_msg_request = e2ees__send_group_msg_request__unpack(NULL, len, data);
+            if (send_group_msg_request != NULL && send_group_msg_request->msg != NULL) {
+                lane_key = get_address_lane_key(send_group_msg_request->msg->to);
+            }
+            free_proto(send_group_msg_request);
+            break;
+        }
+        default:
+            break;
+    };
 
-                // release
-                free_proto(send_group_msg_request);
-                free_proto(send_group_msg_response);
-                free_proto(group_session);
-                break;
-            } 
-            case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG: {
-                E2ees__ProtoMsg *proto_msg = e2ees__proto_msg__unpack(NULL, pending_request->request_data.len, pending_request->request_data.data);
-                E2ees__ConsumeProtoMsgResponse *consume_proto_msg_response = consume_proto_msg(proto_msg->to, proto_msg->tag->proto_msg_id);
-                if (consume_proto_msg_response != NULL || consume_proto_msg_response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_OK) {
-                    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, pending_request_id_list[i]);
-                }
-                // release
-                free_proto(proto_msg);
-                free_proto(consume_proto_msg_response);
-                break;
+    return lane_key;
+}
+
+static uint64_t digest_pending_request_key(uint8_t request_type, const uint8_t *key, size_t key_len) {
+    // FNV-1a
+    uint64_t digest = 0xcbf29ce484222325ULL;
+    digest = (digest ^ request_type) * 0x100000001b3ULL;
+    size_t i;
+    for (i = 0; i < key_len; i++) {
+        digest = (digest ^ key[i]) * 0x100000001b3ULL;
+    }
+    return digest;
+}
+
+static void init_pending_request_item(
+    pending_request_item *item, char *request_id, uint8_t request_type, uint8_t *request_data, size_t request_data_len
+) {
+    item->request_id = request_id;
+    item->request_type = request_type;
+    item->pending_request = e2ees__pending_request__unpack(NULL, request_data_len, request_data);
+    item->proto_msg_id = NULL;
+    item->key = NULL;
+    item->key_len = 0;
+    item->key_digest = 0;
+    item->representative = -1;
+    item->lane_key = NULL;
+    item->consume_ack = (request_type == E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG);
+    item->done = false;
+
+    if (item->pending_request == NULL) {
+        return;
+    }
+    if (item->consume_ack) {
+        // consume-acks are identified by the proto_msg_id only, and they are consumed in one batch
+        E2ees__ProtoMsg *proto_msg = e2ees__proto_msg__unpack(
+            NULL, item->pending_request->request_data.len, item->pending_request->request_data.data
+        );
+        if (proto_msg != NULL && proto_msg->tag != NULL && proto_msg->tag->proto_msg_id != NULL) {
+            item->proto_msg_id = strdup(proto_msg->tag->proto_msg_id);
+        }
+        free_proto(proto_msg);
+    }
+    if (item->proto_msg_id != NULL) {
+        item->key = (const uint8_t *)item->proto_msg_id;
+        item->key_len = strlen(item->proto_msg_id);
+    } else {
+        item->key = item->pending_request->request_data.data;
+        item->key_len = item->pending_request->request_data.len;
+    }
+    item->key_digest = digest_pending_request_key(request_type, item->key, item->key_len);
+    if (!item->consume_ack) {
+        item->lane_key = get_pending_request_lane_key(request_type, item->pending_request);
+    }
+}
+
+static bool is_bad_pending_request_item(pending_request_item *item) {
+    return item->pending_request == NULL || (item->consume_ack && item->proto_msg_id == NULL);
+}
+
+static bool is_same_pending_request(pending_request_item *item_1, pending_request_item *item_2) {
+    return item_1->pending_request != NULL && item_2->pending_request != NULL
+        && item_1->request_type == item_2->request_type
+        && item_1->key_digest == item_2->key_digest
+        && item_1->key_len == item_2->key_len
+        && (item_1->key_len == 0 || memcmp(item_1->key, item_2->key, item_1->key_len) == 0);
+}
+
+static int compare_pending_request_item(const void *a, const void *b) {
+    const pending_request_item *item_1 = *(const pending_request_item **)a;
+    const pending_request_item *item_2 = *(const pending_request_item **)b;
+
+    if (item_1->request_type != item_2->request_type)
+        return item_1->request_type < item_2->request_type ? -1 : 1;
+    if (item_1->key_digest != item_2->key_digest)
+        return item_1->key_digest < item_2->key_digest ? -1 : 1;
+    if (item_1->key_len != item_2->key_len)
+        return item_1->key_len < item_2->key_len ? -1 : 1;
+    if (item_1->key_len > 0) {
+        int cmp = memcmp(item_1->key, item_2->key, item_1->key_len);
+        if (cmp != 0)
+            return cmp;
+    }
+    // the items are in one array, so the loaded order is kept among the same requests
+    return item_1 < item_2 ? -1 : (item_1 > item_2 ? 1 : 0);
+}
+
+static void find_duplicated_pending_requests(pending_request_item *items, size_t item_num) {
+    // sort the requests so that the same ones are next to each other
+    pending_request_item **sorted = (pending_request_item **)malloc(sizeof(pending_request_item *) * item_num);
+    size_t sorted_num = 0;
+    size_t i;
+    for (i = 0; i < item_num; i++) {
+        if (items[i].pending_request != NULL) {
+            sorted[sorted_num++] = &(items[i]);
+        }
+    }
+    qsort(sorted, sorted_num, sizeof(pending_request_item *), compare_pending_request_item);
+
+    // the first loaded one of the same requests is replayed for all of them
+    size_t first = 0;
+    for (i = 1; i < sorted_num; i++) {
+        if (is_same_pending_request(sorted[i], sorted[first])) {
+            sorted[i]->representative = (long)(sorted[first] - items);
+        } else {
+            first = i;
+        }
+    }
+
+    // release
+    free_mem((void **)&sorted, sizeof(pending_request_item *) * item_num);
+}
+
+static void run_scheduled_pending_request_retry(void *arg) {
+    E2ees__E2eeAddress *user_address = (E2ees__E2eeAddress *)arg;
+
+    clear_pending_request_retry_scheduled(user_address);
+    // the plugin may have been detached before the task is run
+    if (get_e2ees_plugin() != NULL) {
+        E2ees__Account *account = NULL;
+        load_account_without_opks_internal(&account, user_address);
+        if (account != NULL) {
+            resend_pending_request(account);
+            e2ees__account__free_unpacked(account, NULL);
+        }
+    }
+
+    // release
+    e2ees__e2ee_address__free_unpacked(user_address, NULL);
+}
+
+static void schedule_pending_request_retry(E2ees__E2eeAddress *user_address, int64_t now) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    if (plugin->common_handler.schedule_task == NULL)
+        return;
+
+    int64_t next_retry_ts = get_pending_request_next_retry_ts(user_address);
+    if (next_retry_ts == INT64_MAX)
+        return;
+
+    if (mark_pending_request_retry_scheduled(user_address)) {
+        E2ees__E2eeAddress *task_address = NULL;
+        copy_address_from_address(&task_address, user_address);
+        plugin->common_handler.schedule_task(
+            run_scheduled_pending_request_retry, task_address, next_retry_ts > now ? next_retry_ts - now : 0
+        );
+    }
+}
+
+static void unload_pending_request_item(E2ees__E2eeAddress *user_address, pending_request_item *item) {
+    get_e2ees_plugin()->db_handler.unload_pending_request_data(user_address, item->request_id);
+    remove_pending_request_attempts(item->request_id);
+    item->done = true;
+}
+
+static uint32_t add_pending_request_attempt_internal(E2ees__E2eeAddress *user_address, pending_request_item *item) {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    if (db_handler->add_pending_request_attempt != NULL) {
+        // the count survives a restart
+        return db_handler->add_pending_request_attempt(user_address, item->request_id);
+    }
+    return increase_pending_request_attempts(item->request_id);
+}
+
+typedef struct pending_request_lane {
+    E2ees__Account *account;
+    pending_request_item *all_items;
+    // the requests of this lane in the loaded order
+    pending_request_item **items;
+    size_t item_num;
+    bool consume_ack;
+    int64_t now;
+    size_t replayed_num;
+    size_t coalesced_num;
+    size_t deferred_num;
+} pending_request_lane;
+
+static int compare_pending_request_lane(const void *a, const void *b) {
+    const pending_request_item *item_1 = *(const pending_request_item **)a;
+    const pending_request_item *item_2 = *(const pending_request_item **)b;
+
+    if (item_1->consume_ack != item_2->consume_ack)
+        return item_1->consume_ack ? -1 : 1;
+    int cmp = strcmp(item_1->lane_key != NULL ? item_1->lane_key : "", item_2->lane_key != NULL ? item_2->lane_key : "");
+    if (cmp != 0)
+        return cmp;
+    // the items are in one array, so the loaded order is kept in a lane
+    return item_1 < item_2 ? -1 : (item_1 > item_2 ? 1 : 0);
+}
+
+static bool is_same_pending_request_lane(pending_request_item *item_1, pending_request_item *item_2) {
+    return item_1->consume_ack == item_2->consume_ack
+        && strcmp(item_1->lane_key != NULL ? item_1->lane_key : "", item_2->lane_key != NULL ? item_2->lane_key : "") == 0;
+}
+
+static void replay_pending_request_lane(pending_request_lane *lane) {
+    E2ees__Account *account = lane->account;
+    E2ees__E2eeAddress *user_address = account->address;
+    size_t i;
+
+    // replay in the loaded order, a failed type is deferred by backoff so that the order is kept
+    for (i = 0; i < lane->item_num; i++) {
+        pending_request_item *item = lane->items[i];
+        if (item->representative >= 0) {
+            // the first one of the same requests comes earlier in this lane
+            if (lane->all_items[item->representative].done) {
+                unload_pending_request_item(user_address, item);
+                lane->coalesced_num++;
+            } else {
+                lane->deferred_num++;
             }
-            default:
-                e2ees_notify_log(
-                    user_address,
-                    DEBUG_LOG,
-                    "resend_pending_request() unknown pending request type: %d, %s",
-                    request_type_list[i]
-                );
-                break;
-        };
-        // release
-        e2ees__pending_request__free_unpacked(pending_request, NULL);
-        free(pending_request_id_list[i]);
-        free_mem((void **)&(request_data_list[i]), request_data_len_list[i]);
+            continue;
+        }
+        if (!is_pending_request_type_ready(user_address, item->request_type, lane->now)) {
+            lane->deferred_num++;
+            continue;
+        }
+
+        uint32_t attempts = add_pending_request_attempt_internal(user_address, item);
+        e2ees_notify_log(
+            user_address,
+            DEBUG_LOG,
+            "resend_pending_request() request_type: %d, attempts: %u",
+            item->request_type,
+            attempts
+        );
+        lane->replayed_num++;
+        if (replay_pending_request(account, item->request_type, item->pending_request)) {
+            unload_pending_request_item(user_address, item);
+            mark_pending_request_type_succeeded(user_address, item->request_type);
+        } else {
+            mark_pending_request_type_failed(user_address, item->request_type, lane->now);
+        }
+    }
+}
+
+static void replay_consume_acks(pending_request_lane *lane) {
+    E2ees__Account *account = lane->account;
+    E2ees__E2eeAddress *user_address = account->address;
+    uint8_t request_type = E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG;
+    size_t i;
+
+    if (!is_pending_request_type_ready(user_address, request_type, lane->now)) {
+        lane->deferred_num += lane->item_num;
+        return;
+    }
+
+    // one request for each distinct proto_msg_id
+    E2ees__ConsumeProtoMsgRequest **requests = (E2ees__ConsumeProtoMsgRequest **)malloc(
+        sizeof(E2ees__ConsumeProtoMsgRequest *) * lane->item_num
+    );
+    pending_request_item **request_items = (pending_request_item **)malloc(sizeof(pending_request_item *) * lane->item_num);
+    size_t request_num = 0;
+    uint32_t max_attempts = 0;
+    for (i = 0; i < lane->item_num; i++) {
+        pending_request_item *item = lane->items[i];
+        if (item->representative >= 0)
+            continue;
+        uint32_t attempts = add_pending_request_attempt_internal(user_address, item);
+        if (attempts > max_attempts)
+            max_attempts = attempts;
+        requests[request_num] = (E2ees__ConsumeProtoMsgRequest *)malloc(sizeof(E2ees__ConsumeProtoMsgRequest));
+        e2ees__consume_proto_msg_request__init(requests[request_num]);
+        requests[request_num]->proto_msg_id = strdup(item->proto_msg_id);
+        request_items[request_num] = item;
+        request_num++;
+    }
+    e2ees_notify_log(
+        user_address,
+        DEBUG_LOG,
+        "resend_pending_request() consume-acks: %zu, max attempts: %u",
+        request_num,
+        max_attempts
+    );
+
+    E2ees__ConsumeProtoMsgResponse **responses = NULL;
+    if (request_num > 0) {
+        responses = get_e2ees_plugin()->proto_handler.consume_proto_msgs(user_address, account->auth, requests, request_num);
+    }
+    bool failed = false;
+    for (i = 0; i < request_num; i++) {
+        E2ees__ConsumeProtoMsgResponse *response = (responses == NULL ? NULL : responses[i]);
+        if (response != NULL
+            && (response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_OK
+                || response->code == E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND)) {
+            unload_pending_request_item(user_address, request_items[i]);
+        } else {
+            failed = true;
+        }
+        if (response != NULL) {
+            e2ees__consume_proto_msg_response__free_unpacked(response, NULL);
+        }
+        e2ees__consume_proto_msg_request__free_unpacked(requests[i], NULL);
+    }
+    lane->replayed_num += request_num;
+    if (failed) {
+        e2ees_notify_log(user_address, DEBUG_LOG, "handle pending proto_msg batch failed");
+        mark_pending_request_type_failed(user_address, request_type, lane->now);
+    } else {
+        mark_pending_request_type_succeeded(user_address, request_type);
+    }
+
+    // the duplicates follow the first ones
+    for (i = 0; i < lane->item_num; i++) {
+        pending_request_item *item = lane->items[i];
+        if (item->representative < 0)
+            continue;
+        if (lane->all_items[item->representative].done) {
+            unload_pending_request_item(user_address, item);
+            lane->coalesced_num++;
+        } else {
+            lane->deferred_num++;
+        }
     }
 
     // release
-    if (pending_request_data_num > 0) {
-        free_mem((void **)&pending_request_id_list, sizeof(char *) * pending_request_data_num);
-        free_mem((void **)&request_type_list, sizeof(uint8_t) * pending_request_data_num);
-        free_mem((void **)&request_data_list, sizeof(uint8_t *) * pending_request_data_num);
-        free_mem((void **)&request_data_len_list, sizeof(size_t) * pending_request_data_num);
+    if (responses != NULL) {
+        free(responses);
+    }
+    free_mem((void **)&requests, sizeof(E2ees__ConsumeProtoMsgRequest *) * lane->item_num);
+    free_mem((void **)&request_items, sizeof(pending_request_item *) * lane->item_num);
+}
+
+static void run_pending_request_lane(void *arg) {
+    pending_request_lane *lane = (pending_request_lane *)arg;
+
+    if (lane->consume_ack && get_e2ees_plugin()->proto_handler.consume_proto_msgs != NULL) {
+        replay_consume_acks(lane);
+    } else {
+        replay_pending_request_lane(lane);
+    }
+}
+
+static void resend_pending_request(E2ees__Account *account) {
+    E2ees__E2eeAddress *user_address = account->address;
+
+    // load all pending request data
+    char **pending_request_id_list = NULL;
+    uint8_t *request_type_list = NULL;
+    uint8_t **request_data_list = NULL;
+    size_t *request_data_len_list = NULL;
+    size_t pending_request_data_num =
+        get_e2ees_plugin()->db_handler.load_pending_request_data(
+            user_address, &pending_request_id_list, &request_type_list, &request_data_list, &request_data_len_list
+        );
+    if (pending_request_data_num == 0) {
+        return;
+    }
+
+    // unpack each request once and find out the duplicated ones
+    pending_request_item *items = (pending_request_item *)malloc(sizeof(pending_request_item) * pending_request_data_num);
+    size_t i;
+    for (i = 0; i < pending_request_data_num; i++) {
+        init_pending_request_item(
+            &(items[i]), pending_request_id_list[i], request_type_list[i], request_data_list[i], request_data_len_list[i]
+        );
+    }
+    find_duplicated_pending_requests(items, pending_request_data_num);
+
+    // drop the bad requests and sort the rest into lanes, one for each peer and one for the consume-acks
+    pending_request_item **sorted = (pending_request_item **)malloc(sizeof(pending_request_item *) * pending_request_data_num);
+    size_t sorted_num = 0;
+    for (i = 0; i < pending_request_data_num; i++) {
+        if (is_bad_pending_request_item(&(items[i]))) {
+            e2ees_notify_log(user_address, BAD_ACCOUNT, "resend_pending_request() bad pending request: %s", items[i].request_id);
+            unload_pending_request_item(user_address, &(items[i]));
+            continue;
+        }
+        sorted[sorted_num++] = &(items[i]);
+    }
+    qsort(sorted, sorted_num, sizeof(pending_request_item *), compare_pending_request_lane);
+
+    int64_t now = get_e2ees_plugin()->common_handler.gen_ts();
+    pending_request_lane *lanes = (pending_request_lane *)malloc(sizeof(pending_request_lane) * pending_request_data_num);
+    void **lane_args = (void **)malloc(sizeof(void *) * pending_request_data_num);
+    size_t lane_num = 0;
+    for (i = 0; i < sorted_num; i++) {
+        if (i == 0 || !is_same_pending_request_lane(sorted[i], sorted[i - 1])) {
+            pending_request_lane *lane = &(lanes[lane_num]);
+            lane->account = account;
+            lane->all_items = items;
+            lane->items = &(sorted[i]);
+            lane->item_num = 0;
+            lane->consume_ack = sorted[i]->consume_ack;
+            lane->now = now;
+            lane->replayed_num = 0;
+            lane->coalesced_num = 0;
+            lane->deferred_num = 0;
+            lane_args[lane_num] = lane;
+            lane_num++;
+        }
+        lanes[lane_num - 1].item_num++;
+    }
+
+    // the peers are independent, so their lanes are replayed at the same time
+    run_tasks_internal(run_pending_request_lane, lane_args, lane_num, E2EES_PENDING_REQUEST_REPLAY_MAX_WORKERS);
+
+    size_t replayed_num = 0, coalesced_num = 0, deferred_num = 0;
+    for (i = 0; i < lane_num; i++) {
+        replayed_num += lanes[i].replayed_num;
+        coalesced_num += lanes[i].coalesced_num;
+        deferred_num += lanes[i].deferred_num;
+    }
+    e2ees_notify_log(
+        user_address,
+        DEBUG_LOG,
+        "resend_pending_request() total: %zu, lanes: %zu, replayed: %zu, coalesced: %zu, deferred: %zu",
+        pending_request_data_num,
+        lane_num,
+        replayed_num,
+        coalesced_num,
+        deferred_num
+    );
+
+    // the failed and deferred requests are retried when their backoff time has passed
+    schedule_pending_request_retry(user_address, now);
+
+    // release
+    for (i = 0; i < pending_request_data_num; i++) {
+        if (items[i].pending_request != NULL) {
+            e2ees__pending_request__free_unpacked(items[i].pending_request, NULL);
+        }
+        free_string(items[i].proto_msg_id);
+        free_string(items[i].lane_key);
+        free(pending_request_id_list[i]);
+        free_mem((void **)&(request_data_list[i]), request_data_len_list[i]);
     }
+    free_mem((void **)&lanes, sizeof(pending_request_lane) * pending_request_data_num);
+    free_mem((void **)&lane_args, sizeof(void *) * pending_request_data_num);
+    free_mem((void **)&sorted, sizeof(pending_request_item *) * pending_request_data_num);
+    free_mem((void **)&items, sizeof(pending_request_item) * pending_request_data_num);
+    free_mem((void **)&pending_request_id_list, sizeof(char *) * pending_request_data_num);
+    free_mem((void **)&request_type_list, sizeof(uint8_t) * pending_request_data_num);
+    free_mem((void **)&request_data_list, sizeof(uint8_t *) * pending_request_data_num);
+    free_mem((void **)&request_data_len_list, sizeof(size_t) * pending_request_data_num);
 }
 
 void resume_connection_internal(E2ees__Account *account) {
@@ -955,4 +2612,5 @@ void resume_connection_internal(E2ees__Account *account) {
         return;
 
     resend_pending_request(account);
+    resume_session_establishments(account);
 }
@@ -20,10 +20,11 @@
 
 #include <string.h>
 
-#include "e2ees/account_cache.h"
 #include "e2ees/cipher.h"
+#include "e2ees/crypto.h"
 #include "e2ees/e2ees_client.h"
 #include "e2ees/e2ees_client_internal.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/group_session_manager.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/validation.h"
@@ -35,6 +36,7 @@
 static const char ROOT_SEED[] = "ROOT";
 static const uint8_t CHAIN_KEY_SEED[1] = {0x02};
 static const char MESSAGE_KEY_SEED[] = "MessageKeys";
+static const char CHECKPOINT_SEED[] = "ChainCheckpoint";
 
 void advance_group_chain_key(const cipher_suite_t *cipher_suite, ProtobufCBinaryData *chain_key) {
     int group_shared_key_len = cipher_suite->hash_suite->get_crypto_param().hash_len;
@@ -48,6 +50,27 @@ void advance_group_chain_key(const cipher_suite_t *cipher_suite, ProtobufCBinary
     overwrite_protobuf_from_array(chain_key, shared_key);
 }
 
+void advance_group_chain_key_to_sequence(
+    const cipher_suite_t *cipher_suite,
+    ProtobufCBinaryData *chain_key,
+    uint32_t *sequence,
+    uint32_t target_sequence,
+    const ProtobufCBinaryData *checkpoint_chain_key,
+    uint32_t checkpoint_sequence
+) {
+    if (checkpoint_chain_key != NULL && checkpoint_chain_key->len > 0
+        && *sequence < checkpoint_sequence && checkpoint_sequence <= target_sequence
+    ) {
+        free_protobuf(chain_key);
+        copy_protobuf_from_protobuf(chain_key, checkpoint_chain_key);
+        *sequence = checkpoint_sequence;
+    }
+    while (*sequence < target_sequence) {
+        advance_group_chain_key(cipher_suite, chain_key);
+        *sequence += 1;
+    }
+}
+
 void advance_group_chain_key_by_welcome(
     const cipher_suite_t *cipher_suite, const ProtobufCBinaryData *src_chain_key, ProtobufCBinaryData **dest_chain_key
 ) {
@@ -92,6 +115,33 @@ void advance_group_chain_key_by_add(
     free_mem((void **)&new_chain_key, sizeof(ProtobufCBinaryData));
 }
 
+void get_group_chain_id(
+    const cipher_suite_t *cipher_suite,
+    const E2ees__GroupSession *inbound_group_session,
+    ProtobufCBinaryData *chain_id_out
+) {
+    const ProtobufCBinaryData *associated_data = &(inbound_group_session->associated_data);
+    const ProtobufCBinaryData *chain_key = &(inbound_group_session->chain_key);
+    size_t chain_state_len = associated_data->len + 4 + chain_key->len;
+    uint8_t *chain_state = (uint8_t *)malloc(sizeof(uint8_t) * chain_state_len);
+    uint32_t sequence = inbound_group_session->sequence;
+
+    memcpy(chain_state, associated_data->data, associated_data->len);
+    chain_state[associated_data->len] = (uint8_t)(sequence >> 24);
+    chain_state[associated_data->len + 1] = (uint8_t)(sequence >> 16);
+    chain_state[associated_data->len + 2] = (uint8_t)(sequence >> 8);
+    chain_state[associated_data->len + 3] = (uint8_t)sequence;
+    memcpy(chain_state + associated_data->len + 4, chain_key->data, chain_key->len);
+
+    int hash_len = cipher_suite->hash_suite->get_crypto_param().hash_len;
+    chain_id_out->len = hash_len;
+    chain_id_out->data = (uint8_t *)malloc(sizeof(uint8_t) * hash_len);
+    cipher_suite->hash_suite->hash(chain_state, chain_state_len, chain_id_out->data);
+
+    // release
+    free_mem((void **)&chain_state, chain_state_len);
+}
+
 void create_group_message_key(
     const cipher_suite_t *cipher_suite,
     const ProtobufCBinaryData *chain_key,
@@ -319,6 +369,374 @@ static void insert_inbound_group_session_data(
     copy_group_info(&(inbound_group_session->group_info), other_group_session->group_info);
 }
 
+typedef struct group_distribution_task_t {
+    E2ees__E2eeAddress *session_owner;
+    const char *auth;
+    uint8_t *plaintext_data;
+    size_t plaintext_data_len;
+    bool send_in_task;
+    // deliver to the device of an existing outbound session
+    E2ees__Session *outbound_session;
+    E2ees__SendOne2oneMsgRequest *request;
+    E2ees__SendOne2oneMsgResponse *response;
+    // or invite a member that we have no session with
+    E2ees__GroupMember *member;
+} group_distribution_task_t;
+
+static void run_group_distribution_task(void *arg) {
+    group_distribution_task_t *task = (group_distribution_task_t *)arg;
+
+    if (task->outbound_session != NULL) {
+        produce_send_one2one_msg_request(
+            &(task->request), task->outbound_session,
+            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION,
+            task->plaintext_data, task->plaintext_data_len
+        );
+        if (task->request != NULL && task->send_in_task) {
+            task->response = get_e2ees_plugin()->proto_handler.send_one2one_msg(
+                task->session_owner, task->auth, task->request
+            );
+        }
+    } else {
+        /** Since we haven't created any session, we need to create a session before sending the group pre-key. */
+        E2ees__InviteResponse **invite_response_list = NULL;
+        size_t invite_response_num = 0;
+        get_pre_key_bundle_internal(
+            &invite_response_list,
+            &invite_response_num,
+            task->session_owner,
+            task->auth,
+            task->member->user_id, task->member->domain,
+            NULL, true,
+            task->plaintext_data, task->plaintext_data_len
+        );
+        // release
+        free_invite_response_list(&invite_response_list, invite_response_num);
+    }
+}
+
+/**
+ * Send the plaintext data to every device of the given members. The outbound sessions
+ * are prefetched in one go, the messages are encrypted and the members without any session
+ * are invited on the worker pool, and the messages are submitted without waiting for the
+ * responses, or in one batch, if the proto handler supports it.
+ */
+static void distribute_group_plaintext_data(
+    E2ees__E2eeAddress *session_owner,
+    const char *auth,
+    E2ees__GroupMember **members,
+    size_t members_num,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len
+) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    group_member_index_t member_index;
+    E2ees__Session **outbound_sessions = NULL;
+    size_t outbound_sessions_num = 0;
+    bool *member_has_session = NULL;
+    size_t i, position;
+
+    init_group_member_index(&member_index, members, members_num);
+    if (member_index.members_num == 0) {
+        free_group_member_index(&member_index);
+        return;
+    }
+    member_has_session = (bool *)calloc(member_index.members_num, sizeof(bool));
+
+    // prefetch the outbound sessions of all members
+    if (plugin->db_handler.load_outbound_sessions_by_users != NULL) {
+        outbound_sessions_num = plugin->db_handler.load_outbound_sessions_by_users(
+            session_owner, member_index.members, member_index.members_num, &outbound_sessions
+        );
+        for (i = 0; i < outbound_sessions_num; i++) {
+            E2ees__E2eeAddress *their_address = outbound_sessions[i]->their_address;
+            if (find_group_member_in_index(&member_index, their_address->user->user_id, their_address->domain, &position))
+                member_has_session[position] = true;
+        }
+    } else {
+        for (i = 0; i < member_index.members_num; i++) {
+            E2ees__Session **member_sessions = NULL;
+            size_t member_sessions_num = plugin->db_handler.load_outbound_sessions(
+                session_owner, member_index.members[i]->user_id, member_index.members[i]->domain, &member_sessions
+            );
+            if (member_sessions_num > 0 && member_sessions != NULL) {
+                member_has_session[i] = true;
+                outbound_sessions = (E2ees__Session **)realloc(
+                    outbound_sessions, sizeof(E2ees__Session *) * (outbound_sessions_num + member_sessions_num)
+                );
+                memcpy(outbound_sessions + outbound_sessions_num, member_sessions, sizeof(E2ees__Session *) * member_sessions_num);
+                outbound_sessions_num += member_sessions_num;
+            }
+            if (member_sessions != NULL)
+                free(member_sessions);
+        }
+    }
+
+    // plan the tasks
+    group_distribution_task_t *tasks = (group_distribution_task_t *)calloc(
+        outbound_sessions_num + member_index.members_num, sizeof(group_distribution_task_t)
+    );
+    size_t task_num = 0;
+    bool async = plugin->proto_handler.send_one2one_msg_async != NULL;
+    bool batched = !async && plugin->proto_handler.send_one2one_msgs != NULL;
+    uint8_t plaintext_hash[SHA256_OUTPUT_LENGTH];
+    bool hashed = false;
+    for (i = 0; i < outbound_sessions_num; i++) {
+        E2ees__Session *outbound_session = outbound_sessions[i];
+        if (compare_address(outbound_session->their_address, session_owner))
+            continue;
+        if (outbound_session->responded) {
+            tasks[task_num].outbound_session = outbound_session;
+            tasks[task_num].send_in_task = !async && !batched;
+            task_num++;
+        } else {
+            /** Since the other has not responded, we store the group pre-key first so that
+             *  we can send it right after receiving the other's accept message.
+             */
+            if (!hashed) {
+                crypto_sha256(plaintext_data, plaintext_data_len, plaintext_hash);
+                hashed = true;
+            }
+            store_pending_shared_plaintext_data_internal(
+                outbound_session->our_address,
+                outbound_session->their_address,
+                plaintext_hash,
+                plaintext_data,
+                plaintext_data_len,
+                E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
+            );
+        }
+    }
+    for (i = 0; i < member_index.members_num; i++) {
+        if (!member_has_session[i]) {
+            tasks[task_num].member = member_index.members[i];
+            task_num++;
+        }
+    }
+
+    // run
+    void **task_args = (void **)malloc(sizeof(void *) * (task_num > 0 ? task_num : 1));
+    for (i = 0; i < task_num; i++) {
+        tasks[i].session_owner = session_owner;
+        tasks[i].auth = auth;
+        tasks[i].plaintext_data = plaintext_data;
+        tasks[i].plaintext_data_len = plaintext_data_len;
+        task_args[i] = &(tasks[i]);
+    }
+    run_tasks_internal(run_group_distribution_task, task_args, task_num, E2EES_GROUP_DISTRIBUTION_MAX_WORKERS);
+
+    // submit the encrypted messages in one batch
+    if (batched) {
+        E2ees__SendOne2oneMsgRequest **requests = (E2ees__SendOne2oneMsgRequest **)malloc(
+            sizeof(E2ees__SendOne2oneMsgRequest *) * (task_num > 0 ? task_num : 1)
+        );
+        group_distribution_task_t **request_tasks = (group_distribution_task_t **)malloc(
+            sizeof(group_distribution_task_t *) * (task_num > 0 ? task_num : 1)
+        );
+        size_t request_num = 0;
+        for (i = 0; i < task_num; i++) {
+            if (tasks[i].request != NULL) {
+                requests[request_num] = tasks[i].request;
+                request_tasks[request_num] = &(tasks[i]);
+                request_num++;
+            }
+        }
+        if (request_num > 0) {
+            E2ees__SendOne2oneMsgResponse **responses = plugin->proto_handler.send_one2one_msgs(
+                session_owner, auth, requests, request_num
+            );
+            if (responses != NULL) {
+                for (i = 0; i < request_num; i++) {
+                    request_tasks[i]->response = responses[i];
+                }
+                free(responses);
+            }
+        }
+        free(requests);
+        free(request_tasks);
+    }
+
+    // consume the responses, the undelivered messages are kept as pending requests
+    for (i = 0; i < task_num; i++) {
+        if (tasks[i].outbound_session == NULL)
+            continue;
+        if (tasks[i].request == NULL) {
+            e2ees_notify_log(session_owner, BAD_MESSAGE_ENCRYPTION, "distribute_group_plaintext_data()");
+            continue;
+        }
+        if (async) {
+            // all the messages are outstanding at once, the responses are consumed on completion
+            send_one2one_msg_request_async_internal(tasks[i].outbound_session, auth, tasks[i].request);
+            continue;
+        }
+        E2ees__SendOne2oneMsgResponse *response = complete_send_one2one_msg_internal(
+            tasks[i].outbound_session, tasks[i].request, tasks[i].response
+        );
+        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
+        e2ees__send_one2one_msg_request__free_unpacked(tasks[i].request, NULL);
+    }
+
+    // release
+    free(task_args);
+    free(tasks);
+    for (i = 0; i < outbound_sessions_num; i++) {
+        e2ees__session__free_unpacked(outbound_sessions[i], NULL);
+    }
+    if (outbound_sessions != NULL)
+        free(outbound_sessions);
+    free(member_has_session);
+    free_group_member_index(&member_index);
+}
+
+static size_t new_group_chain_checkpoint_signed_data(
+    uint8_t **signed_data_out,
+    const E2ees__GroupUpdateKeyBundle *checkpoint,
+    size_t chain_key_len
+) {
+    // every part but the trailing session ID has a fixed length
+    size_t seed_len = sizeof(CHECKPOINT_SEED) - 1;
+    size_t session_id_len = strlen(checkpoint->session_id);
+    size_t signed_data_len = seed_len + 4 + chain_key_len + session_id_len;
+    uint8_t *signed_data = (uint8_t *)malloc(sizeof(uint8_t) * signed_data_len);
+    uint8_t *pos = signed_data;
+    memcpy(pos, CHECKPOINT_SEED, seed_len);
+    pos += seed_len;
+    *pos++ = (uint8_t)(checkpoint->sequence >> 24);
+    *pos++ = (uint8_t)(checkpoint->sequence >> 16);
+    *pos++ = (uint8_t)(checkpoint->sequence >> 8);
+    *pos++ = (uint8_t)(checkpoint->sequence);
+    memcpy(pos, checkpoint->chain_key.data, chain_key_len);
+    pos += chain_key_len;
+    memcpy(pos, checkpoint->session_id, session_id_len);
+
+    *signed_data_out = signed_data;
+    return signed_data_len;
+}
+
+int sign_group_chain_checkpoint(
+    E2ees__GroupUpdateKeyBundle *checkpoint,
+    const ProtobufCBinaryData *sign_private_key
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    const cipher_suite_t *cipher_suite = NULL;
+    size_t chain_key_len = 0;
+    uint8_t *signed_data = NULL;
+    size_t signed_data_len = 0;
+
+    if (!is_valid_group_update_key_bundle(checkpoint) || !is_group_chain_checkpoint(checkpoint)) {
+        e2ees_notify_log(NULL, BAD_GROUP_UPDATE_KEY_BUNDLE, "sign_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    } else if (!is_valid_protobuf(sign_private_key)) {
+        e2ees_notify_log(NULL, BAD_PRIVATE_KEY, "sign_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    } else {
+        cipher_suite = get_e2ees_pack(checkpoint->e2ees_pack_id)->cipher_suite;
+        chain_key_len = cipher_suite->hash_suite->get_crypto_param().hash_len;
+        if (checkpoint->chain_key.len != chain_key_len) {
+            e2ees_notify_log(NULL, BAD_GROUP_CHAIN_KEY, "sign_group_chain_checkpoint()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        signed_data_len = new_group_chain_checkpoint_signed_data(&signed_data, checkpoint, chain_key_len);
+
+        // the signature follows the chain key
+        uint32_t sig_len = cipher_suite->ds_suite->get_crypto_param().sig_len;
+        checkpoint->chain_key.data = (uint8_t *)realloc(checkpoint->chain_key.data, sizeof(uint8_t) * (chain_key_len + sig_len));
+        checkpoint->chain_key.len = chain_key_len + sig_len;
+        size_t signature_out_len;
+        ret = cipher_suite->ds_suite->sign(
+            checkpoint->chain_key.data + chain_key_len, &signature_out_len,
+            signed_data, signed_data_len,
+            sign_private_key->data
+        );
+        if (ret != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(NULL, BAD_SIGNATURE, "sign_group_chain_checkpoint()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    // release
+    free_mem((void **)&signed_data, sizeof(uint8_t) * signed_data_len);
+
+    return ret;
+}
+
+int publish_group_chain_checkpoint(E2ees__GroupSession *outbound_group_session) {
+    int ret = E2EES_RESULT_SUCC;
+
+    char *auth = NULL;
+    E2ees__IdentityKey *identity_key = NULL;
+    uint8_t *checkpoint_plaintext_data = NULL;
+    size_t checkpoint_plaintext_data_len = 0;
+
+    if (!is_valid_group_session(outbound_group_session)) {
+        e2ees_notify_log(NULL, BAD_GROUP_SESSION, "publish_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    } else {
+        if (load_identity_key_internal(&identity_key, outbound_group_session->session_owner) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "publish_group_chain_checkpoint()");
+            ret = E2EES_RESULT_FAIL;
+        } else {
+            get_e2ees_plugin()->db_handler.load_auth(outbound_group_session->session_owner, &auth);
+            if (auth == NULL) {
+                e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "publish_group_chain_checkpoint()");
+                ret = E2EES_RESULT_FAIL;
+            }
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        E2ees__GroupUpdateKeyBundle *group_update_key_bundle = (E2ees__GroupUpdateKeyBundle *)malloc(sizeof(E2ees__GroupUpdateKeyBundle));
+        e2ees__group_update_key_bundle__init(group_update_key_bundle);
+
+        group_update_key_bundle->version = strdup(outbound_group_session->version);
+        group_update_key_bundle->e2ees_pack_id = outbound_group_session->e2ees_pack_id;
+        copy_address_from_address(&(group_update_key_bundle->sender), outbound_group_session->sender);
+        group_update_key_bundle->adding = false;
+        group_update_key_bundle->session_id = strdup(outbound_group_session->session_id);
+
+        // the receivers already have the member list, so only the group address is carried
+        group_update_key_bundle->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+        e2ees__group_info__init(group_update_key_bundle->group_info);
+        group_update_key_bundle->group_info->group_name = strdup(outbound_group_session->group_info->group_name);
+        copy_address_from_address(
+            &(group_update_key_bundle->group_info->group_address), outbound_group_session->group_info->group_address
+        );
+
+        group_update_key_bundle->sequence = outbound_group_session->sequence;
+        copy_protobuf_from_protobuf(&(group_update_key_bundle->chain_key), &(outbound_group_session->chain_key));
+        copy_protobuf_from_protobuf(&(group_update_key_bundle->sign_public_key), &(identity_key->sign_key_pair->public_key));
+
+        ret = sign_group_chain_checkpoint(group_update_key_bundle, &(identity_key->sign_key_pair->private_key));
+        if (ret == E2EES_RESULT_SUCC) {
+            // group_update_key_bundle is released in pack_group_ratchet_state()
+            pack_group_ratchet_state(
+                group_update_key_bundle,
+                &checkpoint_plaintext_data, &checkpoint_plaintext_data_len
+            );
+
+            distribute_group_plaintext_data(
+                outbound_group_session->session_owner, auth,
+                outbound_group_session->group_info->group_member_list,
+                outbound_group_session->group_info->n_group_member_list,
+                checkpoint_plaintext_data, checkpoint_plaintext_data_len
+            );
+        } else {
+            e2ees__group_update_key_bundle__free_unpacked(group_update_key_bundle, NULL);
+        }
+    }
+
+    // release
+    free_proto(identity_key);
+    free_string(auth);
+    free_mem((void **)&checkpoint_plaintext_data, sizeof(uint8_t) * checkpoint_plaintext_data_len);
+
+    return ret;
+}
+
 int new_outbound_group_session_by_sender(
     size_t n_member_info_list,
     E2ees__GroupMemberInfo **member_info_list,
@@ -332,43 +750,22 @@ int new_outbound_group_session_by_sender(
 ) {
     int ret = E2EES_RESULT_SUCC;
 
-    E2ees__Account *account = NULL;
     char *auth = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     uint8_t *identity_public_key = NULL;
     E2ees__GroupSession *outbound_group_session = NULL;
     E2ees__GroupInfo *group_info = NULL;
     uint8_t *group_pre_key_plaintext_data = NULL;
-    size_t group_pre_key_plaintext_data_len;
-    char *cur_user_id = NULL, *cur_user_domain = NULL;
-    E2ees__Session **outbound_sessions = NULL;
-    size_t outbound_sessions_num;
-    E2ees__Session *outbound_session = NULL;
-    E2ees__SendOne2oneMsgResponse *response = NULL;
-    E2ees__InviteResponse **invite_response_list = NULL;
-    size_t invite_response_num = 0;
-    size_t i, j;
+    size_t group_pre_key_plaintext_data_len = 0;
+    size_t i;
 
     if (!is_valid_address(user_address)) {
         e2ees_notify_log(NULL, BAD_ADDRESS, "new_outbound_group_session_by_sender()");
         ret = E2EES_RESULT_FAIL;
     } else {
-        load_identity_key_from_cache(&identity_key, user_address);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(user_address, &account);
-            if (account == NULL) {
-                e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_sender()");
-                ret = E2EES_RESULT_FAIL;
-            } else {
-                identity_public_key = get_identity_public_key_ds_uint8_from_account(account);
-                if (identity_public_key == NULL) {
-                    e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_sender()");
-                    ret = E2EES_RESULT_FAIL;
-                } else {
-                    auth = strdup(account->auth);
-                }
-            }
+        if (load_identity_key_internal(&identity_key, user_address) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_sender()");
+            ret = E2EES_RESULT_FAIL;
         } else {
             get_e2ees_plugin()->db_handler.load_auth(user_address, &auth);
             if (auth == NULL) {
@@ -423,58 +820,11 @@ int new_outbound_group_session_by_sender(
 
         group_info = outbound_group_session->group_info;
         // send the group pre-key message to the members in the group
-        for (i = 0; i < group_info->n_group_member_list; i++) {
-            // the ith group member
-            cur_user_id = group_info->group_member_list[i]->user_id;
-            cur_user_domain = group_info->group_member_list[i]->domain;
-            outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(
-                outbound_group_session->session_owner, cur_user_id, cur_user_domain, &outbound_sessions
-            );
-
-            if (outbound_sessions_num > 0 && outbound_sessions != NULL) {
-                for (j = 0; j < outbound_sessions_num; j++) {
-                    outbound_session = outbound_sessions[j];
-                    if (compare_address(outbound_session->their_address, outbound_group_session->session_owner))
-                        continue;
-                    if (outbound_session->responded) {
-                        response = send_one2one_msg_internal(
-                            outbound_session,
-                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION,
-                            group_pre_key_plaintext_data, group_pre_key_plaintext_data_len
-                        );
-                        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
-                    } else {
-                        /** Since the other has not responded, we store the group pre-key first so that
-                         *  we can send it right after receiving the other's accept message.
-                         */
-                        store_pending_common_plaintext_data_internal(
-                            outbound_session->our_address,
-                            outbound_session->their_address,
-                            group_pre_key_plaintext_data,
-                            group_pre_key_plaintext_data_len,
-                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
-                        );
-                    }
-                    // release outbound_session
-                    e2ees__session__free_unpacked(outbound_session, NULL);
-                }
-                // release outbound_sessions
-                free_mem((void **)&outbound_sessions, sizeof(E2ees__Session *) * outbound_sessions_num);
-            } else {
-                /** Since we haven't created any session, we need to create a session before sending the group pre-key. */
-                int invite_response_ret = get_pre_key_bundle_internal(
-                    &invite_response_list,
-                    &invite_response_num,
-                    outbound_group_session->session_owner,
-                    auth,
-                    cur_user_id, cur_user_domain,
-                    NULL, true,
-                    group_pre_key_plaintext_data, group_pre_key_plaintext_data_len
-                );
-                // release
-                free_invite_response_list(&invite_response_list, invite_response_num);
-            }
-        }
+        distribute_group_plaintext_data(
+            outbound_group_session->session_owner, auth,
+            group_info->group_member_list, group_info->n_group_member_list,
+            group_pre_key_plaintext_data, group_pre_key_plaintext_data_len
+        );
 
         // create the inbound group sessions
         for (i = 0; i < n_member_info_list; i++) {
@@ -486,11 +836,11 @@ int new_outbound_group_session_by_sender(
         free_protobuf(&(outbound_group_session->group_seed));
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+        store_group_session_internal(outbound_group_session);
     }
 
     // release
-    free_proto(account);
+    free_proto(identity_key);
     free_string(auth);
     e2ees__group_session__free_unpacked(outbound_group_session, NULL);
     free_mem((void **)&group_pre_key_plaintext_data, sizeof(uint8_t) * group_pre_key_plaintext_data_len);
@@ -510,27 +860,15 @@ int new_outbound_group_session_by_receiver(
 ) {
     int ret = E2EES_RESULT_SUCC;
 
-    E2ees__Account *account = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     uint8_t *identity_public_key = NULL;
     if (!is_valid_address(user_address)) {
         e2ees_notify_log(NULL, BAD_ACCOUNT, "new_outbound_group_session_by_receiver()");
         ret = E2EES_RESULT_FAIL;
     } else {
-        load_identity_key_from_cache(&identity_key, user_address);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(user_address, &account);
-            if (account == NULL) {
-                e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_receiver()");
-                ret = E2EES_RESULT_FAIL;
-            } else {
-                identity_public_key = get_identity_public_key_ds_uint8_from_account(account);
-                if (identity_public_key == NULL) {
-                    e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_receiver()");
-                    ret = E2EES_RESULT_FAIL;
-                }
-            }
+        if (load_identity_key_internal(&identity_key, user_address) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_by_receiver()");
+            ret = E2EES_RESULT_FAIL;
         } else {
             identity_public_key = identity_key->sign_key_pair->public_key.data;
         }
@@ -576,10 +914,10 @@ int new_outbound_group_session_by_receiver(
         free_protobuf(&(outbound_group_session->group_seed));
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+        store_group_session_internal(outbound_group_session);
 
         // release
-        free_proto(account);
+        free_proto(identity_key);
         e2ees__group_session__free_unpacked(outbound_group_session, NULL);
     }
 
@@ -592,27 +930,15 @@ int new_outbound_group_session_invited(
 ) {
     int ret = E2EES_RESULT_SUCC;
 
-    E2ees__Account *account = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     uint8_t *identity_public_key = NULL;
     if (!is_valid_address(user_address)) {
         e2ees_notify_log(NULL, BAD_ACCOUNT, "new_outbound_group_session_invited()");
         ret = E2EES_RESULT_FAIL;
     } else {
-        load_identity_key_from_cache(&identity_key, user_address);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(user_address, &account);
-            if (account == NULL) {
-                e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_invited()");
-                ret = E2EES_RESULT_FAIL;
-            } else {
-                identity_public_key = get_identity_public_key_ds_uint8_from_account(account);
-                if (identity_public_key == NULL) {
-                    e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_invited()");
-                    ret = E2EES_RESULT_FAIL;
-                }
-            }
+        if (load_identity_key_internal(&identity_key, user_address) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(user_address, BAD_ACCOUNT, "new_outbound_group_session_invited()");
+            ret = E2EES_RESULT_FAIL;
         } else {
             identity_public_key = identity_key->sign_key_pair->public_key.data;
         }
@@ -668,7 +994,7 @@ int new_outbound_group_session_invited(
         }
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+        store_group_session_internal(outbound_group_session);
 
         // notify: how to convert group member info to group members?
         // E2ees__GroupMember **added_member_list = NULL;
@@ -694,7 +1020,7 @@ int new_outbound_group_session_invited(
         // }
 
         // release
-        free_proto(account);
+        free_proto(identity_key);
         e2ees__group_session__free_unpacked(outbound_group_session, NULL);
         for (i = 0; i < n_adding_member_info_list; i++) {
             free_protobuf(adding_members_chain_key[i]);
@@ -746,7 +1072,7 @@ int new_inbound_group_session_by_pre_key_bundle(
         inbound_group_session->group_seed.data = (uint8_t *)malloc(sizeof(uint8_t) * inbound_group_session->group_seed.len);
         memcpy(inbound_group_session->group_seed.data, group_seed->data, group_seed->len);
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         e2ees__group_session__free_unpacked(inbound_group_session, NULL);
@@ -795,7 +1121,7 @@ int new_inbound_group_session_by_member_id(
         memcpy(inbound_group_session->associated_data.data, group_member_id->sign_public_key.data, sign_key_len);
         memcpy((inbound_group_session->associated_data.data) + sign_key_len, group_member_id->sign_public_key.data, sign_key_len);
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         e2ees__group_session__free_unpacked(inbound_group_session, NULL);
@@ -848,7 +1174,7 @@ int complete_inbound_group_session_by_pre_key_bundle(
             inbound_group_session->chain_key.data, inbound_group_session->chain_key.len
         );
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         free_mem((void **)&secret, secret_len);
@@ -905,7 +1231,7 @@ int complete_inbound_group_session_by_member_id(
             inbound_group_session->chain_key.data, inbound_group_session->chain_key.len
         );
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         free_mem((void **)&secret, secret_len);
@@ -969,7 +1295,7 @@ int new_and_complete_inbound_group_session(
         memcpy(inbound_group_session->associated_data.data, identity_public_key, sign_key_len);
         memcpy((inbound_group_session->associated_data.data) + sign_key_len, identity_public_key, sign_key_len);
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         e2ees__group_session__free_unpacked(inbound_group_session, NULL);
@@ -1020,7 +1346,7 @@ int new_and_complete_inbound_group_session_with_chain_key(
         memcpy(inbound_group_session->associated_data.data, identity_public_key, sign_key_len);
         memcpy((inbound_group_session->associated_data.data) + sign_key_len, identity_public_key, sign_key_len);
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         e2ees__group_session__free_unpacked(inbound_group_session, NULL);
@@ -1079,7 +1405,7 @@ int new_and_complete_inbound_group_session_with_ratchet_state(
         memcpy(inbound_group_session->associated_data.data, identity_public_key, sign_key_len);
         memcpy((inbound_group_session->associated_data.data) + sign_key_len, identity_public_key, sign_key_len);
 
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
 
         // release
         e2ees__group_session__free_unpacked(inbound_group_session, NULL);
@@ -1088,6 +1414,79 @@ int new_and_complete_inbound_group_session_with_ratchet_state(
     return ret;
 }
 
+bool is_group_chain_checkpoint(const E2ees__GroupUpdateKeyBundle *group_update_key_bundle) {
+    return group_update_key_bundle != NULL
+        && group_update_key_bundle->adding == false
+        && group_update_key_bundle->n_adding_member_info_list == 0;
+}
+
+int consume_group_chain_checkpoint(
+    E2ees__GroupUpdateKeyBundle *group_update_key_bundle,
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *user_address
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    const cipher_suite_t *cipher_suite = NULL;
+    size_t chain_key_len = 0;
+    uint32_t sig_len = 0;
+    uint8_t *signed_data = NULL;
+    size_t signed_data_len = 0;
+
+    if (!is_valid_address(user_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "consume_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (!is_valid_group_update_key_bundle(group_update_key_bundle)) {
+        e2ees_notify_log(NULL, BAD_GROUP_UPDATE_KEY_BUNDLE, "consume_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    } else if (!compare_address(from_address, group_update_key_bundle->sender)) {
+        // only the sender of the group session can publish its checkpoints
+        e2ees_notify_log(user_address, BAD_ADDRESS, "consume_group_chain_checkpoint()");
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        cipher_suite = get_e2ees_pack(group_update_key_bundle->e2ees_pack_id)->cipher_suite;
+        chain_key_len = cipher_suite->hash_suite->get_crypto_param().hash_len;
+        sig_len = cipher_suite->ds_suite->get_crypto_param().sig_len;
+        if (group_update_key_bundle->chain_key.len != chain_key_len + sig_len
+            || group_update_key_bundle->sign_public_key.len != cipher_suite->ds_suite->get_crypto_param().sign_pub_key_len
+        ) {
+            e2ees_notify_log(user_address, BAD_GROUP_UPDATE_KEY_BUNDLE, "consume_group_chain_checkpoint()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // the signing key is matched against the inbound group session in store_group_chain_checkpoint()
+        signed_data_len = new_group_chain_checkpoint_signed_data(&signed_data, group_update_key_bundle, chain_key_len);
+        ret = verify_signature_internal(
+            cipher_suite->ds_suite,
+            group_update_key_bundle->chain_key.data + chain_key_len, sig_len,
+            signed_data, signed_data_len,
+            group_update_key_bundle->sign_public_key.data
+        );
+        if (ret != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(user_address, BAD_SIGNATURE, "consume_group_chain_checkpoint()");
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        ProtobufCBinaryData checkpoint_chain_key = {chain_key_len, group_update_key_bundle->chain_key.data};
+        ret = store_group_chain_checkpoint(
+            group_update_key_bundle->sender, user_address, group_update_key_bundle->session_id,
+            &(group_update_key_bundle->sign_public_key),
+            &checkpoint_chain_key, group_update_key_bundle->sequence
+        );
+    }
+
+    // release
+    free_mem((void **)&signed_data, sizeof(uint8_t) * signed_data_len);
+
+    return ret;
+}
+
 int renew_outbound_group_session_by_welcome_and_add(
     E2ees__GroupSession *outbound_group_session,
     ProtobufCBinaryData *sender_chain_key,
@@ -1099,7 +1498,6 @@ int renew_outbound_group_session_by_welcome_and_add(
 ) {
     int ret = E2EES_RESULT_SUCC;
 
-    E2ees__Account *account = NULL;
     char *auth = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     ProtobufCBinaryData *identity_public_key = NULL;
@@ -1107,22 +1505,9 @@ int renew_outbound_group_session_by_welcome_and_add(
         e2ees_notify_log(NULL, BAD_GROUP_SESSION, "renew_outbound_group_session_by_welcome_and_add()");
         ret = E2EES_RESULT_FAIL;
     } else {
-        load_identity_key_from_cache(&identity_key, outbound_group_session->session_owner);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->session_owner, &account);
-            if (account == NULL) {
-                e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_outbound_group_session_by_welcome_and_add()");
-                ret = E2EES_RESULT_FAIL;
-            } else {
-                identity_public_key = get_identity_public_key_ds_bytes_from_account(account);
-                if (identity_public_key == NULL) {
-                    e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_outbound_group_session_by_welcome_and_add()");
-                    ret = E2EES_RESULT_FAIL;
-                } else {
-                    auth = strdup(account->auth);
-                }
-            }
+        if (load_identity_key_internal(&identity_key, outbound_group_session->session_owner) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_outbound_group_session_by_welcome_and_add()");
+            ret = E2EES_RESULT_FAIL;
         } else {
             get_e2ees_plugin()->db_handler.load_auth(outbound_group_session->session_owner, &auth);
             if (auth == NULL) {
@@ -1150,10 +1535,7 @@ int renew_outbound_group_session_by_welcome_and_add(
         const cipher_suite_t *cipher_suite = get_e2ees_pack(outbound_group_session->e2ees_pack_id)->cipher_suite;
 
         // renew the group members
-        E2ees__GroupInfo *old_group_info = NULL;
-        copy_group_info(&old_group_info, outbound_group_session->group_info);
-        e2ees__group_info__free_unpacked(outbound_group_session->group_info, NULL);
-
+        E2ees__GroupInfo *old_group_info = outbound_group_session->group_info;
         add_group_members_to_group_info(
             &(outbound_group_session->group_info), old_group_info, adding_group_members, adding_group_members_num
         );
@@ -1161,72 +1543,18 @@ int renew_outbound_group_session_by_welcome_and_add(
         e2ees__group_info__free_unpacked(old_group_info, NULL);
 
         // send the current ratchet state to the new group members
-        size_t i, j;
-        char *cur_user_id, *cur_user_domain;
+        size_t i;
         uint8_t *group_ratchet_state_plaintext_data = NULL;
-        size_t group_ratchet_state_plaintext_data_len;
-        for (i = 0; i < adding_group_members_num; i++) {
-            // pack
-            group_ratchet_state_plaintext_data_len = pack_group_ratchet_state_plaintext(
-                outbound_group_session, &group_ratchet_state_plaintext_data,
-                sender_chain_key == NULL, identity_public_key,
-                n_adding_member_info_list, adding_member_info_list
-            );
-
-            cur_user_id = adding_group_members[i]->user_id;
-            cur_user_domain = adding_group_members[i]->domain;
-            E2ees__Session **outbound_sessions = NULL;
-            size_t outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(
-                outbound_group_session->session_owner, cur_user_id, cur_user_domain, &outbound_sessions
-            );
-
-            if (outbound_sessions_num > 0 && outbound_sessions != NULL) {
-                for (j = 0; j < outbound_sessions_num; j++) {
-                    E2ees__Session *outbound_session = outbound_sessions[j];
-                    if (compare_address(outbound_session->their_address, outbound_group_session->session_owner))
-                        continue;
-                    if (outbound_session->responded) {
-                        E2ees__SendOne2oneMsgResponse *response;
-                        response = send_one2one_msg_internal(
-                            outbound_session,
-                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION,
-                            group_ratchet_state_plaintext_data, group_ratchet_state_plaintext_data_len
-                        );
-                        e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
-                    } else {
-                        /** Since the other has not responded, we store the group pre-key first so that
-                         *  we can send it right after receiving the other's accept message.
-                         */
-                        store_pending_common_plaintext_data_internal(
-                            outbound_session->our_address,
-                            outbound_session->their_address,
-                            group_ratchet_state_plaintext_data,
-                            group_ratchet_state_plaintext_data_len,
-                            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
-                        );
-                    }
-                    // release outbound_session
-                    e2ees__session__free_unpacked(outbound_session, NULL);
-                }
-                // release outbound_sessions
-                free_mem((void **)&outbound_sessions, sizeof(E2ees__Session *) * outbound_sessions_num);
-            } else {
-                /** Since we haven't created any session, we need to create a session before sending the group pre-key. */
-                E2ees__InviteResponse **invite_response_list = NULL;
-                size_t invite_response_num = 0;
-                int invite_response_ret = get_pre_key_bundle_internal(
-                    &invite_response_list,
-                    &invite_response_num,
-                    outbound_group_session->session_owner,
-                    auth,
-                    cur_user_id, cur_user_domain,
-                    NULL, true,
-                    group_ratchet_state_plaintext_data, group_ratchet_state_plaintext_data_len
-                );
-                // release
-                free_invite_response_list(&invite_response_list, invite_response_num);
-            }
-        }
+        size_t group_ratchet_state_plaintext_data_len = pack_group_ratchet_state_plaintext(
+            outbound_group_session, &group_ratchet_state_plaintext_data,
+            sender_chain_key == NULL, identity_public_key,
+            n_adding_member_info_list, adding_member_info_list
+        );
+        distribute_group_plaintext_data(
+            outbound_group_session->session_owner, auth,
+            adding_group_members, adding_group_members_num,
+            group_ratchet_state_plaintext_data, group_ratchet_state_plaintext_data_len
+        );
 
         ProtobufCBinaryData **their_chain_keys = (ProtobufCBinaryData **)malloc(sizeof(ProtobufCBinaryData *) * n_adding_member_info_list);
         // advance the chain key
@@ -1249,11 +1577,12 @@ int renew_outbound_group_session_by_welcome_and_add(
         outbound_group_session->sequence = 0;
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+        store_group_session_internal(outbound_group_session);
 
         // renew existed inbound group sessions
         E2ees__GroupSession **inbound_group_sessions = NULL;
-        size_t inbound_group_sessions_num = get_e2ees_plugin()->db_handler.load_group_sessions(
+        flush_group_session_cache(outbound_group_session->session_owner);
+        size_t inbound_group_sessions_num = load_group_sessions_internal(
             outbound_group_session->session_owner, outbound_group_session->group_info->group_address, &inbound_group_sessions
         );
 
@@ -1304,7 +1633,7 @@ int renew_outbound_group_session_by_welcome_and_add(
         }
 
         // release
-        free_proto(account);
+        free_proto(identity_key);
         free_string(auth);
         free_mem((void **)&group_ratchet_state_plaintext_data, sizeof(uint8_t) * group_ratchet_state_plaintext_data_len);
         for (i = 0; i < n_adding_member_info_list; i++) {
@@ -1357,7 +1686,7 @@ int renew_inbound_group_session_by_welcome_and_add(
         inbound_group_session->sequence = 0;
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        store_group_session_internal(inbound_group_session);
     }
 
     return ret;
@@ -1372,7 +1701,6 @@ int renew_group_sessions_with_new_device(
 ) {
     int ret = E2EES_RESULT_SUCC;
 
-    E2ees__Account *account = NULL;
     char *auth = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     ProtobufCBinaryData *identity_public_key = NULL;
@@ -1380,22 +1708,9 @@ int renew_group_sessions_with_new_device(
         e2ees_notify_log(NULL, BAD_GROUP_SESSION, "renew_group_sessions_with_new_device()");
         ret = E2EES_RESULT_FAIL;
     } else {
-        load_identity_key_from_cache(&identity_key, outbound_group_session->session_owner);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->session_owner, &account);
-            if (account == NULL) {
-                e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_group_sessions_with_new_device()");
-                ret = E2EES_RESULT_FAIL;
-            } else {
-                identity_public_key = get_identity_public_key_ds_bytes_from_account(account);
-                if (identity_public_key == NULL) {
-                    e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_group_sessions_with_new_device()");
-                    ret = E2EES_RESULT_FAIL;
-                } else {
-                    auth = strdup(account->auth);
-                }
-            }
+        if (load_identity_key_internal(&identity_key, outbound_group_session->session_owner) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "renew_group_sessions_with_new_device()");
+            ret = E2EES_RESULT_FAIL;
         } else {
             get_e2ees_plugin()->db_handler.load_auth(outbound_group_session->session_owner, &auth);
             if (auth == NULL) {
@@ -1458,13 +1773,11 @@ int renew_group_sessions_with_new_device(
                     DEBUG_LOG,
                     "renew_group_sessions_with_new_device() outbound_session found and is responded"
                 );
-                E2ees__SendOne2oneMsgResponse *response;
-                response = send_one2one_msg_internal(
+                send_one2one_msg_async_internal(
                     outbound_session,
                     E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION,
                     group_ratchet_state_plaintext_data, group_ratchet_state_plaintext_data_len
                 );
-                e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
             } else {
                 e2ees_notify_log(
                     outbound_group_session->session_owner,
@@ -1474,7 +1787,7 @@ int renew_group_sessions_with_new_device(
                 /** Since the other has not responded, we store the group pre-key first so that
                  *  we can send it right after receiving the other's accept message.
                  */
-                store_pending_common_plaintext_data_internal(
+                store_pending_plaintext_data_internal(
                     outbound_session->our_address,
                     outbound_session->their_address,
                     group_ratchet_state_plaintext_data,
@@ -1533,11 +1846,12 @@ int renew_group_sessions_with_new_device(
         outbound_group_session->sequence = 0;
 
         // store
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+        store_group_session_internal(outbound_group_session);
 
         // renew the inbound group sessions
         E2ees__GroupSession **inbound_group_sessions = NULL;
-        size_t inbound_group_sessions_num = get_e2ees_plugin()->db_handler.load_group_sessions(
+        flush_group_session_cache(outbound_group_session->session_owner);
+        size_t inbound_group_sessions_num = load_group_sessions_internal(
             outbound_group_session->session_owner, outbound_group_session->group_info->group_address, &inbound_group_sessions
         );
         if (inbound_group_sessions_num > 0 && inbound_group_sessions != NULL) {
@@ -1587,7 +1901,7 @@ int renew_group_sessions_with_new_device(
         }
 
         // release
-        free_proto(account);
+        free_proto(identity_key);
         free_string(auth);
         free_mem((void **)&their_chain_keys, sizeof(ProtobufCBinaryData));
     }
@@ -0,0 +1,721 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "e2ees/group_session_cache.h"
+
+#include <string.h>
+
+#include "e2ees/e2ees_client_internal.h"
+#include "e2ees/group_session.h"
+#include "e2ees/mem_util.h"
+#include "spin_lock.h"
+
+#define GROUP_SESSION_CACHE_BUCKETS 256
+
+/**
+ * The chain keys of an inbound group session shared by the co-hosted owners.
+ * The chain key of a sequence is kept in the slot sequence % E2EES_GROUP_SHARED_CHAIN_KEYS.
+ */
+typedef struct shared_group_chain {
+    char *session_id;
+    E2ees__E2eeAddress *sender_address;
+    ProtobufCBinaryData chain_id;
+    uint32_t sequences[E2EES_GROUP_SHARED_CHAIN_KEYS];
+    ProtobufCBinaryData chain_keys[E2EES_GROUP_SHARED_CHAIN_KEYS];
+    struct shared_group_chain *next;
+} shared_group_chain;
+
+typedef struct group_info_cacheer {
+    E2ees__E2eeAddress *owner_address;
+    E2ees__GroupInfo *group_info;
+    uint64_t version;
+    struct group_info_cacheer *next;
+} group_info_cacheer;
+
+static group_session_cacheer *group_session_cacheer_buckets[GROUP_SESSION_CACHE_BUCKETS] = {NULL};
+static group_info_cacheer *group_info_cacheers = NULL;
+static shared_group_chain *shared_group_chain_buckets[GROUP_SESSION_CACHE_BUCKETS] = {NULL};
+static bool group_chain_sharing = false;
+static e2ees_spin_lock_t group_session_cache_lock = E2EES_SPIN_LOCK_INIT;
+
+static size_t hash_group_session_id(const char *session_id) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    const char *cur;
+    for (cur = session_id; *cur != '\0'; cur++) {
+        hash ^= (uint8_t)(*cur);
+        hash *= 16777619u;
+    }
+    return hash % GROUP_SESSION_CACHE_BUCKETS;
+}
+
+static group_session_cacheer *find_group_session_cacheer(
+    E2ees__E2eeAddress *sender_address, E2ees__E2eeAddress *owner_address, const char *session_id
+) {
+    group_session_cacheer *cur = group_session_cacheer_buckets[hash_group_session_id(session_id)];
+    while (cur != NULL) {
+        if (safe_strcmp(cur->session_id, session_id)
+            && compare_address(cur->sender_address, sender_address)
+            && compare_address(cur->owner_address, owner_address)) {
+            return cur;
+        }
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+static group_session_cacheer *new_group_session_cacheer(E2ees__GroupSession *group_session) {
+    group_session_cacheer *cacheer = (group_session_cacheer *)malloc(sizeof(group_session_cacheer));
+    cacheer->session_id = strdup(group_session->session_id);
+    copy_address_from_address(&(cacheer->sender_address), group_session->sender);
+    copy_address_from_address(&(cacheer->owner_address), group_session->session_owner);
+    copy_address_from_address(&(cacheer->group_address), group_session->group_info->group_address);
+    cacheer->e2ees_pack_id = group_session->e2ees_pack_id;
+    copy_protobuf_from_protobuf(&(cacheer->chain_key), &(group_session->chain_key));
+    cacheer->sequence = group_session->sequence;
+    copy_protobuf_from_protobuf(&(cacheer->associated_data), &(group_session->associated_data));
+    cacheer->chain_id.len = 0;
+    cacheer->chain_id.data = NULL;
+    cacheer->stored_sequence = group_session->sequence;
+    cacheer->checkpoint_chain_key.len = 0;
+    cacheer->checkpoint_chain_key.data = NULL;
+    cacheer->checkpoint_sequence = 0;
+    cacheer->skipped_keys = NULL;
+    cacheer->skipped_keys_num = 0;
+    cacheer->next = NULL;
+    return cacheer;
+}
+
+static group_session_cacheer *copy_group_session_cacheer(group_session_cacheer *src) {
+    group_session_cacheer *cacheer = (group_session_cacheer *)malloc(sizeof(group_session_cacheer));
+    cacheer->session_id = strdup(src->session_id);
+    copy_address_from_address(&(cacheer->sender_address), src->sender_address);
+    copy_address_from_address(&(cacheer->owner_address), src->owner_address);
+    copy_address_from_address(&(cacheer->group_address), src->group_address);
+    cacheer->e2ees_pack_id = src->e2ees_pack_id;
+    copy_protobuf_from_protobuf(&(cacheer->chain_key), &(src->chain_key));
+    cacheer->sequence = src->sequence;
+    copy_protobuf_from_protobuf(&(cacheer->associated_data), &(src->associated_data));
+    cacheer->chain_id.len = 0;
+    cacheer->chain_id.data = NULL;
+    copy_protobuf_from_protobuf(&(cacheer->chain_id), &(src->chain_id));
+    cacheer->stored_sequence = src->stored_sequence;
+    cacheer->checkpoint_chain_key.len = 0;
+    cacheer->checkpoint_chain_key.data = NULL;
+    if (src->checkpoint_chain_key.len > 0) {
+        copy_protobuf_from_protobuf(&(cacheer->checkpoint_chain_key), &(src->checkpoint_chain_key));
+    }
+    cacheer->checkpoint_sequence = src->checkpoint_sequence;
+    // the skipped keys stay in the cache
+    cacheer->skipped_keys = NULL;
+    cacheer->skipped_keys_num = 0;
+    cacheer->next = NULL;
+    return cacheer;
+}
+
+void free_group_session_cacheer(group_session_cacheer **cacheer) {
+    group_session_cacheer *cur = *cacheer;
+    if (cur == NULL) {
+        return;
+    }
+    free_string(cur->session_id);
+    if (cur->sender_address != NULL) {
+        e2ees__e2ee_address__free_unpacked(cur->sender_address, NULL);
+        cur->sender_address = NULL;
+    }
+    if (cur->owner_address != NULL) {
+        e2ees__e2ee_address__free_unpacked(cur->owner_address, NULL);
+        cur->owner_address = NULL;
+    }
+    if (cur->group_address != NULL) {
+        e2ees__e2ee_address__free_unpacked(cur->group_address, NULL);
+        cur->group_address = NULL;
+    }
+    free_protobuf(&(cur->chain_key));
+    free_protobuf(&(cur->associated_data));
+    free_protobuf(&(cur->chain_id));
+    free_protobuf(&(cur->checkpoint_chain_key));
+    group_msg_skipped_key *skipped_key;
+    while (cur->skipped_keys != NULL) {
+        skipped_key = cur->skipped_keys;
+        cur->skipped_keys = skipped_key->next;
+        free_protobuf(&(skipped_key->msg_key));
+        free_mem((void **)&skipped_key, sizeof(group_msg_skipped_key));
+    }
+    free_mem((void **)cacheer, sizeof(group_session_cacheer));
+}
+
+static bool has_group_session_sequence_handlers() {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    return db_handler->store_group_session_sequence != NULL
+        && db_handler->load_group_session_sequence != NULL;
+}
+
+static void write_back_group_session_cacheer(group_session_cacheer *cacheer) {
+    E2ees__GroupSession *group_session = NULL;
+    get_e2ees_plugin()->db_handler.load_group_session_by_id(
+        cacheer->sender_address, cacheer->owner_address, cacheer->session_id, &group_session
+    );
+    if (group_session == NULL) {
+        // the session has been unloaded
+        return;
+    }
+    // never move the stored chain backwards
+    if (group_session->sequence < cacheer->sequence) {
+        free_protobuf(&(group_session->chain_key));
+        copy_protobuf_from_protobuf(&(group_session->chain_key), &(cacheer->chain_key));
+        group_session->sequence = cacheer->sequence;
+        get_e2ees_plugin()->db_handler.store_group_session(group_session);
+    }
+    e2ees__group_session__free_unpacked(group_session, NULL);
+}
+
+int load_group_session_cacheer(
+    group_session_cacheer **cacheer_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id
+) {
+    *cacheer_out = NULL;
+    if (sender_address == NULL || owner_address == NULL || session_id == NULL) {
+        return E2EES_RESULT_FAIL;
+    }
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *cacheer = find_group_session_cacheer(sender_address, owner_address, session_id);
+    if (cacheer != NULL) {
+        *cacheer_out = copy_group_session_cacheer(cacheer);
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+    if (*cacheer_out != NULL) {
+        return E2EES_RESULT_SUCC;
+    }
+
+    // not cached yet, load the whole session once
+    E2ees__GroupSession *group_session = NULL;
+    get_e2ees_plugin()->db_handler.load_group_session_by_id(sender_address, owner_address, (char *)session_id, &group_session);
+    if (group_session == NULL) {
+        return E2EES_RESULT_FAIL;
+    }
+    if (group_session->group_info == NULL || group_session->group_info->group_address == NULL) {
+        e2ees__group_session__free_unpacked(group_session, NULL);
+        return E2EES_RESULT_FAIL;
+    }
+    // the chain id comes with the shared group session, or is taken over the chain state loaded
+    ProtobufCBinaryData chain_id = {0, NULL};
+    e2ees_pack_t *e2ees_pack = get_e2ees_pack(group_session->e2ees_pack_id);
+    if (!fill_shared_group_session_internal(group_session, &chain_id)
+        && e2ees_pack != NULL && group_session->associated_data.len > 0 && group_session->chain_key.len > 0) {
+        get_group_chain_id(e2ees_pack->cipher_suite, group_session, &chain_id);
+    }
+    // the messages up to the stored sequence have been handed over before the chain state was written back
+    if (has_group_session_sequence_handlers()) {
+        uint32_t decrypted_sequence = get_e2ees_plugin()->db_handler.load_group_session_sequence(owner_address, session_id);
+        if (decrypted_sequence > group_session->sequence && e2ees_pack != NULL) {
+            advance_group_chain_key_to_sequence(
+                e2ees_pack->cipher_suite, &(group_session->chain_key), &(group_session->sequence),
+                decrypted_sequence, NULL, 0
+            );
+        }
+    }
+    group_session_cacheer *new_cacheer = new_group_session_cacheer(group_session);
+    new_cacheer->chain_id = chain_id;
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    cacheer = find_group_session_cacheer(sender_address, owner_address, session_id);
+    if (cacheer == NULL) {
+        size_t bucket = hash_group_session_id(session_id);
+        new_cacheer->next = group_session_cacheer_buckets[bucket];
+        group_session_cacheer_buckets[bucket] = new_cacheer;
+        cacheer = new_cacheer;
+        new_cacheer = NULL;
+    }
+    *cacheer_out = copy_group_session_cacheer(cacheer);
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    // another thread has cached the same session
+    free_group_session_cacheer(&new_cacheer);
+
+    return E2EES_RESULT_SUCC;
+}
+
+void update_group_session_cacheer(group_session_cacheer *cacheer) {
+    group_session_cacheer *write_back = NULL;
+    uint32_t decrypted_sequence = 0;
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *cached = find_group_session_cacheer(
+        cacheer->sender_address, cacheer->owner_address, cacheer->session_id
+    );
+    if (cached == NULL) {
+        // flushed in the meantime, write the state back directly
+        write_back = copy_group_session_cacheer(cacheer);
+    } else if (cached->sequence < cacheer->sequence) {
+        free_protobuf(&(cached->chain_key));
+        copy_protobuf_from_protobuf(&(cached->chain_key), &(cacheer->chain_key));
+        cached->sequence = cacheer->sequence;
+        if (cached->checkpoint_chain_key.len > 0 && cached->sequence >= cached->checkpoint_sequence) {
+            // the checkpoint has been reached
+            free_protobuf(&(cached->checkpoint_chain_key));
+            cached->checkpoint_sequence = 0;
+        }
+        if (!has_group_session_sequence_handlers()
+            || cached->sequence - cached->stored_sequence >= E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL) {
+            cached->stored_sequence = cached->sequence;
+            write_back = copy_group_session_cacheer(cached);
+        } else {
+            decrypted_sequence = cached->sequence;
+        }
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    if (write_back != NULL) {
+        write_back_group_session_cacheer(write_back);
+        free_group_session_cacheer(&write_back);
+    } else if (decrypted_sequence > 0) {
+        get_e2ees_plugin()->db_handler.store_group_session_sequence(
+            cacheer->owner_address, cacheer->session_id, decrypted_sequence
+        );
+    }
+}
+
+int store_group_chain_checkpoint(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    const ProtobufCBinaryData *sign_public_key,
+    const ProtobufCBinaryData *checkpoint_chain_key,
+    uint32_t checkpoint_sequence
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    // make sure that the session is cached
+    group_session_cacheer *cacheer = NULL;
+    ret = load_group_session_cacheer(&cacheer, sender_address, owner_address, session_id);
+    if (ret != E2EES_RESULT_SUCC) {
+        return ret;
+    }
+    free_group_session_cacheer(&cacheer);
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *cached = find_group_session_cacheer(sender_address, owner_address, session_id);
+    if (cached == NULL) {
+        ret = E2EES_RESULT_FAIL;
+    } else if (sign_public_key->len > cached->associated_data.len
+        || memcmp(sign_public_key->data, cached->associated_data.data, sign_public_key->len) != 0
+    ) {
+        // the sender's signing key is the prefix of the associated data
+        ret = E2EES_RESULT_FAIL;
+    } else if (checkpoint_sequence <= cached->sequence
+        || (cached->checkpoint_chain_key.len > 0 && checkpoint_sequence <= cached->checkpoint_sequence)
+    ) {
+        // nothing to skip
+        ret = E2EES_RESULT_FAIL;
+    } else {
+        free_protobuf(&(cached->checkpoint_chain_key));
+        copy_protobuf_from_protobuf(&(cached->checkpoint_chain_key), checkpoint_chain_key);
+        cached->checkpoint_sequence = checkpoint_sequence;
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    return ret;
+}
+
+static bool has_group_msg_skipped_key_handlers() {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    return db_handler->store_skipped_group_msg_key != NULL
+        && db_handler->take_skipped_group_msg_key != NULL;
+}
+
+void store_group_msg_skipped_key(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *msg_key
+) {
+    if (has_group_msg_skipped_key_handlers()) {
+        get_e2ees_plugin()->db_handler.store_skipped_group_msg_key(
+            owner_address, sender_address, session_id, sequence, msg_key
+        );
+        return;
+    }
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *cached = find_group_session_cacheer(sender_address, owner_address, session_id);
+    if (cached != NULL) {
+        group_msg_skipped_key *skipped_key = cached->skipped_keys;
+        while (skipped_key != NULL && skipped_key->sequence != sequence) {
+            skipped_key = skipped_key->next;
+        }
+        if (skipped_key == NULL) {
+            skipped_key = (group_msg_skipped_key *)malloc(sizeof(group_msg_skipped_key));
+            skipped_key->sequence = sequence;
+            copy_protobuf_from_protobuf(&(skipped_key->msg_key), msg_key);
+            skipped_key->next = cached->skipped_keys;
+            cached->skipped_keys = skipped_key;
+            cached->skipped_keys_num++;
+        }
+
+        // drop the oldest keys, which are at the tail
+        if (cached->skipped_keys_num > E2EES_GROUP_MSG_MAX_SKIPPED_KEYS) {
+            group_msg_skipped_key **cur = &(cached->skipped_keys);
+            size_t i;
+            for (i = 0; i < E2EES_GROUP_MSG_MAX_SKIPPED_KEYS; i++) {
+                cur = &((*cur)->next);
+            }
+            while (*cur != NULL) {
+                group_msg_skipped_key *temp = *cur;
+                *cur = temp->next;
+                free_protobuf(&(temp->msg_key));
+                free_mem((void **)&temp, sizeof(group_msg_skipped_key));
+                cached->skipped_keys_num--;
+            }
+        }
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+}
+
+int take_group_msg_skipped_key(
+    ProtobufCBinaryData *msg_key_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    uint32_t sequence
+) {
+    int ret = E2EES_RESULT_FAIL;
+
+    if (has_group_msg_skipped_key_handlers()) {
+        if (get_e2ees_plugin()->db_handler.take_skipped_group_msg_key(
+                owner_address, sender_address, session_id, sequence, msg_key_out
+            )) {
+            ret = E2EES_RESULT_SUCC;
+        }
+        return ret;
+    }
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *cached = find_group_session_cacheer(sender_address, owner_address, session_id);
+    if (cached != NULL) {
+        group_msg_skipped_key **cur = &(cached->skipped_keys);
+        while (*cur != NULL) {
+            if ((*cur)->sequence == sequence) {
+                group_msg_skipped_key *temp = *cur;
+                *cur = temp->next;
+                // hand over the key
+                *msg_key_out = temp->msg_key;
+                free_mem((void **)&temp, sizeof(group_msg_skipped_key));
+                cached->skipped_keys_num--;
+                ret = E2EES_RESULT_SUCC;
+                break;
+            }
+            cur = &((*cur)->next);
+        }
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    return ret;
+}
+
+static shared_group_chain *find_shared_group_chain(
+    E2ees__E2eeAddress *sender_address, const char *session_id, const ProtobufCBinaryData *chain_id
+) {
+    shared_group_chain *cur = shared_group_chain_buckets[hash_group_session_id(session_id)];
+    while (cur != NULL) {
+        if (safe_strcmp(cur->session_id, session_id) && compare_address(cur->sender_address, sender_address)
+            && compare_protobuf(&(cur->chain_id), (ProtobufCBinaryData *)chain_id)) {
+            return cur;
+        }
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+static void free_shared_group_chain(shared_group_chain **chain) {
+    shared_group_chain *cur = *chain;
+    size_t i;
+    for (i = 0; i < E2EES_GROUP_SHARED_CHAIN_KEYS; i++) {
+        free_protobuf(&(cur->chain_keys[i]));
+    }
+    free_protobuf(&(cur->chain_id));
+    free_string(cur->session_id);
+    e2ees__e2ee_address__free_unpacked(cur->sender_address, NULL);
+    free_mem((void **)chain, sizeof(shared_group_chain));
+}
+
+void set_group_chain_sharing(bool enabled) {
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_chain_sharing = enabled;
+    e2ees_spin_unlock(&group_session_cache_lock);
+}
+
+bool load_shared_group_chain_key(
+    ProtobufCBinaryData *chain_key_out,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    const ProtobufCBinaryData *chain_id,
+    uint32_t sequence
+) {
+    bool found = false;
+    // a chain that can not be told apart from the others is not shared
+    if (chain_id == NULL || chain_id->len == 0) {
+        return false;
+    }
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    if (group_chain_sharing) {
+        shared_group_chain *chain = find_shared_group_chain(sender_address, session_id, chain_id);
+        size_t slot = sequence % E2EES_GROUP_SHARED_CHAIN_KEYS;
+        if (chain != NULL && chain->chain_keys[slot].len > 0 && chain->sequences[slot] == sequence) {
+            free_protobuf(chain_key_out);
+            copy_protobuf_from_protobuf(chain_key_out, &(chain->chain_keys[slot]));
+            found = true;
+        }
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    return found;
+}
+
+void store_shared_group_chain_key(
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    const ProtobufCBinaryData *chain_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *chain_key
+) {
+    if (chain_id == NULL || chain_id->len == 0) {
+        return;
+    }
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    if (group_chain_sharing) {
+        shared_group_chain *chain = find_shared_group_chain(sender_address, session_id, chain_id);
+        if (chain == NULL) {
+            chain = (shared_group_chain *)malloc(sizeof(shared_group_chain));
+            memset(chain, 0, sizeof(shared_group_chain));
+            chain->session_id = strdup(session_id);
+            copy_address_from_address(&(chain->sender_address), sender_address);
+            copy_protobuf_from_protobuf(&(chain->chain_id), chain_id);
+            size_t bucket = hash_group_session_id(session_id);
+            chain->next = shared_group_chain_buckets[bucket];
+            shared_group_chain_buckets[bucket] = chain;
+        }
+        size_t slot = sequence % E2EES_GROUP_SHARED_CHAIN_KEYS;
+        free_protobuf(&(chain->chain_keys[slot]));
+        copy_protobuf_from_protobuf(&(chain->chain_keys[slot]), chain_key);
+        chain->sequences[slot] = sequence;
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+}
+
+static bool has_group_session_cursor_locked(shared_group_chain *chain) {
+    group_session_cacheer *cur = group_session_cacheer_buckets[hash_group_session_id(chain->session_id)];
+    while (cur != NULL) {
+        if (safe_strcmp(cur->session_id, chain->session_id) && compare_address(cur->sender_address, chain->sender_address)
+            && compare_protobuf(&(cur->chain_id), &(chain->chain_id))) {
+            return true;
+        }
+        cur = cur->next;
+    }
+    return false;
+}
+
+static shared_group_chain *unlink_shared_group_chains_locked(bool all) {
+    shared_group_chain *unlinked = NULL;
+    size_t i;
+    for (i = 0; i < GROUP_SESSION_CACHE_BUCKETS; i++) {
+        shared_group_chain **cur = &(shared_group_chain_buckets[i]);
+        while (*cur != NULL) {
+            // a shared chain lives as long as one of the owners has a cursor on it
+            if (all || !has_group_session_cursor_locked(*cur)) {
+                shared_group_chain *temp = *cur;
+                *cur = temp->next;
+                temp->next = unlinked;
+                unlinked = temp;
+            } else {
+                cur = &((*cur)->next);
+            }
+        }
+    }
+    return unlinked;
+}
+
+static void release_shared_group_chains(shared_group_chain *cur) {
+    shared_group_chain *temp;
+    while (cur != NULL) {
+        temp = cur;
+        cur = cur->next;
+        free_shared_group_chain(&temp);
+    }
+}
+
+static group_info_cacheer **find_group_info_cacheer(E2ees__E2eeAddress *owner_address, E2ees__E2eeAddress *group_address) {
+    group_info_cacheer **cur = &group_info_cacheers;
+    while (*cur != NULL) {
+        if (compare_address((*cur)->owner_address, owner_address)
+            && compare_address((*cur)->group_info->group_address, group_address)) {
+            return cur;
+        }
+        cur = &((*cur)->next);
+    }
+    return cur;
+}
+
+static void free_group_info_cacheer(group_info_cacheer **cacheer) {
+    group_info_cacheer *cur = *cacheer;
+    e2ees__e2ee_address__free_unpacked(cur->owner_address, NULL);
+    e2ees__group_info__free_unpacked(cur->group_info, NULL);
+    free_mem((void **)cacheer, sizeof(group_info_cacheer));
+}
+
+int load_group_info_cacheer(
+    E2ees__GroupInfo **group_info_out,
+    uint64_t *version_out,
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address
+) {
+    int ret = E2EES_RESULT_FAIL;
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_info_cacheer *cached = *find_group_info_cacheer(owner_address, group_address);
+    if (cached != NULL) {
+        copy_group_info(group_info_out, cached->group_info);
+        *version_out = cached->version;
+        ret = E2EES_RESULT_SUCC;
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    return ret;
+}
+
+void update_group_info_cacheer(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__GroupInfo *group_info,
+    uint64_t version
+) {
+    // copy outside of the lock
+    E2ees__GroupInfo *group_info_copy = NULL;
+    copy_group_info(&group_info_copy, group_info);
+
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_info_cacheer **cur = find_group_info_cacheer(owner_address, group_info->group_address);
+    if (*cur == NULL) {
+        *cur = (group_info_cacheer *)malloc(sizeof(group_info_cacheer));
+        copy_address_from_address(&((*cur)->owner_address), owner_address);
+        (*cur)->group_info = group_info_copy;
+        (*cur)->version = version;
+        (*cur)->next = NULL;
+        group_info_copy = NULL;
+    } else if ((*cur)->version <= version) {
+        // never go back to an older version, the replaced copy is released below
+        E2ees__GroupInfo *temp = (*cur)->group_info;
+        (*cur)->group_info = group_info_copy;
+        (*cur)->version = version;
+        group_info_copy = temp;
+    }
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    if (group_info_copy != NULL) {
+        e2ees__group_info__free_unpacked(group_info_copy, NULL);
+    }
+}
+
+static group_info_cacheer *unlink_group_info_cacheers_locked(E2ees__E2eeAddress *owner_address) {
+    group_info_cacheer *unlinked = NULL;
+    group_info_cacheer **cur = &group_info_cacheers;
+    while (*cur != NULL) {
+        if (owner_address == NULL || compare_address((*cur)->owner_address, owner_address)) {
+            group_info_cacheer *temp = *cur;
+            *cur = temp->next;
+            temp->next = unlinked;
+            unlinked = temp;
+        } else {
+            cur = &((*cur)->next);
+        }
+    }
+    return unlinked;
+}
+
+static void release_group_info_cacheers(group_info_cacheer *cur) {
+    group_info_cacheer *temp;
+    while (cur != NULL) {
+        temp = cur;
+        cur = cur->next;
+        free_group_info_cacheer(&temp);
+    }
+}
+
+static group_session_cacheer *unlink_group_session_cacheers_locked(E2ees__E2eeAddress *owner_address) {
+    group_session_cacheer *unlinked = NULL;
+    size_t i;
+    for (i = 0; i < GROUP_SESSION_CACHE_BUCKETS; i++) {
+        group_session_cacheer **cur = &(group_session_cacheer_buckets[i]);
+        while (*cur != NULL) {
+            if (owner_address == NULL || compare_address((*cur)->owner_address, owner_address)) {
+                group_session_cacheer *temp = *cur;
+                *cur = temp->next;
+                temp->next = unlinked;
+                unlinked = temp;
+            } else {
+                cur = &((*cur)->next);
+            }
+        }
+    }
+    return unlinked;
+}
+
+static void release_group_session_cacheers(group_session_cacheer *cur, bool write_back) {
+    group_session_cacheer *temp;
+    while (cur != NULL) {
+        temp = cur;
+        cur = cur->next;
+        if (write_back && temp->sequence > temp->stored_sequence) {
+            write_back_group_session_cacheer(temp);
+        }
+        free_group_session_cacheer(&temp);
+    }
+}
+
+void flush_group_session_cache(E2ees__E2eeAddress *owner_address) {
+    if (owner_address == NULL) {
+        return;
+    }
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *unlinked = unlink_group_session_cacheers_locked(owner_address);
+    shared_group_chain *unlinked_chains = unlink_shared_group_chains_locked(false);
+    group_info_cacheer *unlinked_group_infos = unlink_group_info_cacheers_locked(owner_address);
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    release_group_session_cacheers(unlinked, true);
+    release_shared_group_chains(unlinked_chains);
+    release_group_info_cacheers(unlinked_group_infos);
+}
+
+void free_group_session_cache() {
+    e2ees_spin_lock(&group_session_cache_lock);
+    group_session_cacheer *unlinked = unlink_group_session_cacheers_locked(NULL);
+    shared_group_chain *unlinked_chains = unlink_shared_group_chains_locked(true);
+    group_info_cacheer *unlinked_group_infos = unlink_group_info_cacheers_locked(NULL);
+    e2ees_spin_unlock(&group_session_cache_lock);
+
+    release_group_session_cacheers(unlinked, get_e2ees_plugin() != NULL);
+    release_shared_group_chains(unlinked_chains);
+    release_group_info_cacheers(unlinked_group_infos);
+}
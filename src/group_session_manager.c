@@ -23,10 +23,15 @@
 #include "e2ees/account_cache.h"
 #include "e2ees/cipher.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
+#include "e2ees/crypto.h"
 #include "e2ees/group_session.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/validation.h"
 #include "e2ees/session.h"
+#include "mutex.h"
+#include "spin_lock.h"
 
 int produce_create_group_request(
     E2ees__CreateGroupRequest **request_out,
@@ -63,7 +68,7 @@ int produce_create_group_request(
         load_e2ees_pack_id_from_cache(&e2ees_pack_id, sender_address);
 
         if (e2ees_pack_id == E2EES_PACK_ID_UNSPECIFIED) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(sender_address, &account);
+            load_account_without_opks_internal(&account, sender_address);
             if (account == NULL) {
                 e2ees_notify_log(sender_address, BAD_ACCOUNT, "produce_create_group_request()");
                 ret = E2EES_RESULT_FAIL;
@@ -170,7 +175,8 @@ bool consume_create_group_msg(E2ees__E2eeAddress *receiver_address, E2ees__Creat
     // try to load inbound group session
     size_t i;
     E2ees__GroupSession *inbound_group_session = NULL;
-    get_e2ees_plugin()->db_handler.load_group_session_by_address(sender_address, receiver_address, group_address, &inbound_group_session);
+    flush_group_session_cache(receiver_address);
+    load_group_session_by_address_internal(sender_address, receiver_address, group_address, &inbound_group_session);
     if (inbound_group_session == NULL) {
         for (i = 0; i < msg->n_member_info_list; i++) {
             E2ees__GroupMemberInfo *cur_group_member_info = (msg->member_info_list)[i];
@@ -296,7 +302,7 @@ int produce_add_group_members_request(
         load_e2ees_pack_id_from_cache(&e2ees_pack_id, outbound_group_session->session_owner);
 
         if (e2ees_pack_id == E2EES_PACK_ID_UNSPECIFIED) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->session_owner, &account);
+            load_account_without_opks_internal(&account, outbound_group_session->session_owner);
             if (account == NULL) {
                 e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "produce_add_group_members_request()");
                 ret = E2EES_RESULT_FAIL;
@@ -413,27 +419,34 @@ bool consume_add_group_members_msg(E2ees__E2eeAddress *receiver_address, E2ees__
      *  On the other hand, the new group members need to create the outbound group session.
      */
     E2ees__GroupSession *outbound_group_session = NULL;
-    get_e2ees_plugin()->db_handler.load_group_session_by_address(
+    load_group_session_by_address_internal(
         receiver_address, receiver_address, group_address, &outbound_group_session
     );
     // renew the outbound group session if it exists
     if (outbound_group_session != NULL) {
+        // take the checkpoint of the sender's chain before the cached chain states are written back
+        group_session_cacheer *sender_chain = NULL;
+        load_group_session_cacheer(&sender_chain, msg->sender_address, receiver_address, outbound_group_session->session_id);
+        flush_group_session_cache(receiver_address);
+
         // load the inbound group session to get the chain key
         E2ees__GroupSession *inbound_group_session = NULL;
-        get_e2ees_plugin()->db_handler.load_group_session_by_id(
+        load_group_session_by_id_internal(
             msg->sender_address, receiver_address, outbound_group_session->session_id, &inbound_group_session
         );
         if (inbound_group_session == NULL) {
             e2ees_notify_log(receiver_address, BAD_GROUP_SESSION, "consume_add_group_members_msg()");
             e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+            free_group_session_cacheer(&sender_chain);
             return false;
         }
         const cipher_suite_t *cipher_suite = get_e2ees_pack(inbound_group_session->e2ees_pack_id)->cipher_suite;
-        uint32_t their_sequence = msg->sequence;
-        while (inbound_group_session->sequence < their_sequence) {
-            advance_group_chain_key(cipher_suite, &(inbound_group_session->chain_key));
-            inbound_group_session->sequence += 1;
-        }
+        advance_group_chain_key_to_sequence(
+            cipher_suite, &(inbound_group_session->chain_key), &(inbound_group_session->sequence), msg->sequence,
+            (sender_chain == NULL) ? NULL : &(sender_chain->checkpoint_chain_key),
+            (sender_chain == NULL) ? 0 : sender_chain->checkpoint_sequence
+        );
+        free_group_session_cacheer(&sender_chain);
 
         // renew the outbound group session
         renew_outbound_group_session_by_welcome_and_add(
@@ -488,7 +501,7 @@ int produce_add_group_member_device_request(
         load_e2ees_pack_id_from_cache(&e2ees_pack_id, outbound_group_session->session_owner);
 
         if (e2ees_pack_id == E2EES_PACK_ID_UNSPECIFIED) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->session_owner, &account);
+            load_account_without_opks_internal(&account, outbound_group_session->session_owner);
             if (account == NULL) {
                 e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "produce_add_group_member_device_request()");
                 ret = E2EES_RESULT_FAIL;
@@ -604,28 +617,35 @@ bool consume_add_group_member_device_msg(
      *  On the other hand, the new group members need to create the outbound group session.
      */
     E2ees__GroupSession *outbound_group_session = NULL;
-    get_e2ees_plugin()->db_handler.load_group_session_by_address(
+    load_group_session_by_address_internal(
         receiver_address, receiver_address, group_address, &outbound_group_session
     );
     // renew the outbound group session if it exists
     if (outbound_group_session != NULL) {
+        // take the checkpoint of the sender's chain before the cached chain states are written back
+        group_session_cacheer *sender_chain = NULL;
+        load_group_session_cacheer(&sender_chain, msg->sender_address, receiver_address, outbound_group_session->session_id);
+        flush_group_session_cache(receiver_address);
+
         // load the inbound group session to get the chain key
         E2ees__GroupSession *inbound_group_session = NULL;
-        get_e2ees_plugin()->db_handler.load_group_session_by_id(
+        load_group_session_by_id_internal(
             msg->sender_address, receiver_address, outbound_group_session->session_id, &inbound_group_session
         );
         if (inbound_group_session == NULL) {
             e2ees_notify_log(receiver_address, BAD_GROUP_SESSION, "consume_add_group_member_device_msg()");
             // release
             e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+            free_group_session_cacheer(&sender_chain);
             return false;
         }
         const cipher_suite_t *cipher_suite = get_e2ees_pack(inbound_group_session->e2ees_pack_id)->cipher_suite;
-        uint32_t their_sequence = msg->sequence;
-        while (inbound_group_session->sequence < their_sequence) {
-            advance_group_chain_key(cipher_suite, &(inbound_group_session->chain_key));
-            inbound_group_session->sequence += 1;
-        }
+        advance_group_chain_key_to_sequence(
+            cipher_suite, &(inbound_group_session->chain_key), &(inbound_group_session->sequence), msg->sequence,
+            (sender_chain == NULL) ? NULL : &(sender_chain->checkpoint_chain_key),
+            (sender_chain == NULL) ? 0 : sender_chain->checkpoint_sequence
+        );
+        free_group_session_cacheer(&sender_chain);
 
         // renew the outbound group session
         renew_group_sessions_with_new_device(
@@ -678,7 +698,7 @@ int produce_remove_group_members_request(
         load_e2ees_pack_id_from_cache(&e2ees_pack_id, outbound_group_session->session_owner);
 
         if (e2ees_pack_id == E2EES_PACK_ID_UNSPECIFIED) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->session_owner, &account);
+            load_account_without_opks_internal(&account, outbound_group_session->session_owner);
             if (account == NULL) {
                 e2ees_notify_log(outbound_group_session->session_owner, BAD_ACCOUNT, "produce_remove_group_members_request()");
                 ret = E2EES_RESULT_FAIL;
@@ -764,6 +784,7 @@ int consume_remove_group_members_response(
 
     if (ret == E2EES_RESULT_SUCC) {
         // delete the old outbound group session
+        flush_group_session_cache(sender_address);
         get_e2ees_plugin()->db_handler.unload_group_session_by_id(sender_address, old_session_id);
 
         if (group_members_num > 0 && user_in_group(sender_address, group_member_list, group_members_num)) {
@@ -817,6 +838,7 @@ bool consume_remove_group_members_msg(E2ees__E2eeAddress *receiver_address, E2ee
     for (i = 0; i < msg->n_removing_member_list; i++) {
         if (safe_strcmp(receiver_address->user->user_id, msg->removing_member_list[i]->user_id) && safe_strcmp(receiver_address->domain, msg->removing_member_list[i]->domain)) {
             // unload all outbound and inbound group sessions
+            flush_group_session_cache(receiver_address);
             get_e2ees_plugin()->db_handler.unload_group_session_by_address(receiver_address, group_address);
 
             // notify
@@ -840,7 +862,8 @@ bool consume_remove_group_members_msg(E2ees__E2eeAddress *receiver_address, E2ee
     // unload the old group sessions if necessary
     bool new_group_session = true;
     E2ees__GroupSession *inbound_group_session = NULL;
-    get_e2ees_plugin()->db_handler.load_group_session_by_address(sender_address, receiver_address, group_address, &inbound_group_session);
+    flush_group_session_cache(receiver_address);
+    load_group_session_by_address_internal(sender_address, receiver_address, group_address, &inbound_group_session);
 
     if (inbound_group_session != NULL) {
         if (!compare_group_member(
@@ -961,6 +984,7 @@ int consume_leave_group_response(
     if (ret == E2EES_RESULT_SUCC) {
         e2ees_notify_log(user_address, DEBUG_LOG, "consume_leave_group_response() success, unload group session");
         // unload
+        flush_group_session_cache(user_address);
         get_e2ees_plugin()->db_handler.unload_group_session_by_address(user_address, response->group_address);
     } else {
         e2ees_notify_log(user_address, DEBUG_LOG, "consume_leave_group_response() failed, redo later");
@@ -1012,6 +1036,141 @@ bool consume_leave_group_msg(E2ees__E2eeAddress *receiver_address, E2ees__LeaveG
     return succ;
 }
 
+/**
+ * The lock of the outbound group session of an owner in a group, which is held
+ * while the chain state is loaded, advanced and stored, so that the senders
+ * of the same group never share a sequence. It lives as long as it is in use.
+ */
+typedef struct group_msg_sequence_mutex {
+    E2ees__E2eeAddress *owner_address;
+    E2ees__E2eeAddress *group_address;
+    e2ees_mutex_t mutex;
+    size_t ref_num;
+    struct group_msg_sequence_mutex *next;
+} group_msg_sequence_mutex;
+
+static group_msg_sequence_mutex *group_msg_sequence_mutexes = NULL;
+// guards the list of the locks only, never held across the db handler
+static e2ees_spin_lock_t group_msg_sequence_lock = E2EES_SPIN_LOCK_INIT;
+
+static group_msg_sequence_mutex *lock_group_msg_sequences(
+    E2ees__E2eeAddress *owner_address, E2ees__E2eeAddress *group_address
+) {
+    e2ees_spin_lock(&group_msg_sequence_lock);
+    group_msg_sequence_mutex *cur = group_msg_sequence_mutexes;
+    while (cur != NULL
+        && !(compare_address(cur->owner_address, owner_address) && compare_address(cur->group_address, group_address))) {
+        cur = cur->next;
+    }
+    if (cur == NULL) {
+        cur = (group_msg_sequence_mutex *)malloc(sizeof(group_msg_sequence_mutex));
+        copy_address_from_address(&(cur->owner_address), owner_address);
+        copy_address_from_address(&(cur->group_address), group_address);
+        e2ees_mutex_init(&(cur->mutex));
+        cur->ref_num = 0;
+        cur->next = group_msg_sequence_mutexes;
+        group_msg_sequence_mutexes = cur;
+    }
+    cur->ref_num++;
+    e2ees_spin_unlock(&group_msg_sequence_lock);
+
+    e2ees_mutex_lock(&(cur->mutex));
+    return cur;
+}
+
+static void unlock_group_msg_sequences(group_msg_sequence_mutex *sequence_mutex) {
+    e2ees_mutex_unlock(&(sequence_mutex->mutex));
+
+    bool unused = false;
+    e2ees_spin_lock(&group_msg_sequence_lock);
+    sequence_mutex->ref_num--;
+    if (sequence_mutex->ref_num == 0) {
+        group_msg_sequence_mutex **cur = &group_msg_sequence_mutexes;
+        while (*cur != sequence_mutex) {
+            cur = &((*cur)->next);
+        }
+        *cur = sequence_mutex->next;
+        unused = true;
+    }
+    e2ees_spin_unlock(&group_msg_sequence_lock);
+
+    if (unused) {
+        e2ees_mutex_destroy(&(sequence_mutex->mutex));
+        e2ees__e2ee_address__free_unpacked(sequence_mutex->owner_address, NULL);
+        e2ees__e2ee_address__free_unpacked(sequence_mutex->group_address, NULL);
+        free_mem((void **)&sequence_mutex, sizeof(group_msg_sequence_mutex));
+    }
+}
+
+int reserve_group_msg_sequences(
+    E2ees__GroupSession **outbound_group_session_out,
+    ProtobufCBinaryData **chain_keys_out,
+    uint32_t *first_sequence_out,
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *group_address,
+    size_t msg_num
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    E2ees__GroupSession *outbound_group_session = NULL;
+    ProtobufCBinaryData *chain_keys = NULL;
+    uint32_t first_sequence = 0;
+    size_t i;
+
+    *outbound_group_session_out = NULL;
+    *chain_keys_out = NULL;
+
+    if (!is_valid_address(sender_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "reserve_group_msg_sequences()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (!is_valid_address(group_address)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "reserve_group_msg_sequences()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (msg_num == 0) {
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // load, advance and store the chain key in one step so that concurrent senders never share a sequence
+        group_msg_sequence_mutex *sequence_mutex = lock_group_msg_sequences(sender_address, group_address);
+        load_group_session_by_address_internal(
+            sender_address, sender_address, group_address, &outbound_group_session
+        );
+        if (is_valid_group_session(outbound_group_session)) {
+            const cipher_suite_t *cipher_suite = get_e2ees_pack(outbound_group_session->e2ees_pack_id)->cipher_suite;
+            first_sequence = outbound_group_session->sequence;
+            chain_keys = (ProtobufCBinaryData *)malloc(sizeof(ProtobufCBinaryData) * msg_num);
+            for (i = 0; i < msg_num; i++) {
+                copy_protobuf_from_protobuf(&(chain_keys[i]), &(outbound_group_session->chain_key));
+                advance_group_chain_key(cipher_suite, &(outbound_group_session->chain_key));
+                outbound_group_session->sequence += 1;
+            }
+            store_group_session_internal(outbound_group_session);
+        } else {
+            ret = E2EES_RESULT_FAIL;
+        }
+        unlock_group_msg_sequences(sequence_mutex);
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // publish a checkpoint so that the members who fall behind can skip ahead
+        if (first_sequence / E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL
+            != outbound_group_session->sequence / E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL) {
+            publish_group_chain_checkpoint(outbound_group_session);
+        }
+
+        *outbound_group_session_out = outbound_group_session;
+        *chain_keys_out = chain_keys;
+        *first_sequence_out = first_sequence;
+    } else if (outbound_group_session != NULL) {
+        e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+    }
+
+    return ret;
+}
+
 int produce_send_group_msg_request(
     E2ees__SendGroupMsgRequest **request_out,
     E2ees__GroupSession *outbound_group_session,
@@ -1021,6 +1180,30 @@ int produce_send_group_msg_request(
     size_t allow_list_len,
     E2ees__E2eeAddress **deny_list,
     size_t deny_list_len
+) {
+    if (!is_valid_group_session(outbound_group_session)) {
+        e2ees_notify_log(NULL, BAD_GROUP_SESSION, "produce_send_group_msg_request()");
+        return E2EES_RESULT_FAIL;
+    }
+    return produce_send_group_msg_request_by_sequence(
+        request_out, outbound_group_session,
+        &(outbound_group_session->chain_key), outbound_group_session->sequence,
+        notif_level, plaintext_data, plaintext_data_len,
+        allow_list, allow_list_len, deny_list, deny_list_len
+    );
+}
+
+int produce_send_group_msg_request_by_sequence(
+    E2ees__SendGroupMsgRequest **request_out,
+    E2ees__GroupSession *outbound_group_session,
+    const ProtobufCBinaryData *chain_key,
+    uint32_t sequence,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    E2ees__E2eeAddress **allow_list,
+    size_t allow_list_len,
+    E2ees__E2eeAddress **deny_list,
+    size_t deny_list_len
 ) {
     int ret = E2EES_RESULT_SUCC;
 
@@ -1028,7 +1211,6 @@ int produce_send_group_msg_request(
     E2ees__MsgKey *msg_key = NULL;
     E2ees__E2eeMsg *e2ee_msg = NULL;
     E2ees__GroupMsgPayload *group_msg_payload = NULL;
-    E2ees__Account *account = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     cipher_suite_t *cipher_suite = NULL;
     uint8_t *ciphertext_data = NULL;
@@ -1040,6 +1222,10 @@ int produce_send_group_msg_request(
         e2ees_notify_log(NULL, BAD_GROUP_SESSION, "produce_send_group_msg_request()");
         ret = E2EES_RESULT_FAIL;
     }
+    if (!is_valid_protobuf(chain_key)) {
+        e2ees_notify_log(NULL, BAD_GROUP_CHAIN_KEY, "produce_send_group_msg_request()");
+        ret = E2EES_RESULT_FAIL;
+    }
     if (plaintext_data == NULL) {
         e2ees_notify_log(NULL, BAD_PLAINTEXT, "produce_send_group_msg_request()");
         ret = E2EES_RESULT_FAIL;
@@ -1058,15 +1244,9 @@ int produce_send_group_msg_request(
     }
 
     if (ret == E2EES_RESULT_SUCC) {
-        load_identity_key_from_cache(&identity_key, outbound_group_session->sender);
-
-        if (identity_key == NULL) {
-            get_e2ees_plugin()->db_handler.load_account_by_address(outbound_group_session->sender, &account);
-            if (account == NULL) {
-                e2ees_notify_log(outbound_group_session->sender, BAD_ACCOUNT, "produce_send_group_msg_request()");
-                ret = E2EES_RESULT_FAIL;
-            }
-            copy_ik_from_ik(&identity_key, account->identity_key);
+        if (load_identity_key_internal(&identity_key, outbound_group_session->sender) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(outbound_group_session->sender, BAD_ACCOUNT, "produce_send_group_msg_request()");
+            ret = E2EES_RESULT_FAIL;
         }
     }
 
@@ -1074,7 +1254,7 @@ int produce_send_group_msg_request(
         // create the message key
         msg_key = (E2ees__MsgKey *)malloc(sizeof(E2ees__MsgKey));
         e2ees__msg_key__init(msg_key);
-        create_group_message_key(cipher_suite, &(outbound_group_session->chain_key), msg_key);
+        create_group_message_key(cipher_suite, chain_key, msg_key);
     
         // encryption
         ret = cipher_suite->se_suite->encrypt(
@@ -1091,7 +1271,7 @@ int produce_send_group_msg_request(
         // prepare a group_msg_payload
         group_msg_payload = (E2ees__GroupMsgPayload *)malloc(sizeof(E2ees__GroupMsgPayload));
         e2ees__group_msg_payload__init(group_msg_payload);
-        group_msg_payload->sequence = outbound_group_session->sequence;
+        group_msg_payload->sequence = sequence;
 
         group_msg_payload->ciphertext.data = (uint8_t *)malloc(sizeof(uint8_t) * ciphertext_data_len);
         memcpy(group_msg_payload->ciphertext.data, ciphertext_data, ciphertext_data_len);
@@ -1153,7 +1333,6 @@ int produce_send_group_msg_request(
     }
     
     // release
-    free_proto(account);
     if (identity_key != NULL) {
         e2ees__identity_key__free_unpacked(identity_key, NULL);
         identity_key = NULL;
@@ -1169,7 +1348,179 @@ int produce_send_group_msg_request(
     return ret;
 }
 
-int consume_send_group_msg_response(E2ees__GroupSession *outbound_group_session, E2ees__SendGroupMsgResponse *response) {
+static int compare_string(const char *str_1, const char *str_2) {
+    if (str_1 == NULL || str_2 == NULL) {
+        return (str_1 == NULL) - (str_2 == NULL);
+    }
+    return strcmp(str_1, str_2);
+}
+
+static int compare_group_msg_filter_address(const void *a, const void *b) {
+    const E2ees__E2eeAddress *address_1 = *(const E2ees__E2eeAddress **)a;
+    const E2ees__E2eeAddress *address_2 = *(const E2ees__E2eeAddress **)b;
+
+    int cmp = compare_string(address_1->domain, address_2->domain);
+    if (cmp != 0)
+        return cmp;
+    if (address_1->peer_case != address_2->peer_case)
+        return address_1->peer_case < address_2->peer_case ? -1 : 1;
+    if (address_1->peer_case == E2EES__E2EE_ADDRESS__PEER_USER) {
+        cmp = compare_string(address_1->user->user_id, address_2->user->user_id);
+        if (cmp != 0)
+            return cmp;
+        return compare_string(address_1->user->device_id, address_2->user->device_id);
+    }
+    if (address_1->peer_case == E2EES__E2EE_ADDRESS__PEER_GROUP) {
+        return compare_string(address_1->group->group_id, address_2->group->group_id);
+    }
+    return 0;
+}
+
+static size_t copy_group_msg_filter_list(
+    E2ees__E2eeAddress ***dest, E2ees__E2eeAddress **address_list, size_t address_list_len
+) {
+    if (address_list_len == 0) {
+        *dest = NULL;
+        return 0;
+    }
+
+    E2ees__E2eeAddress **sorted = (E2ees__E2eeAddress **)malloc(sizeof(E2ees__E2eeAddress *) * address_list_len);
+    memcpy(sorted, address_list, sizeof(E2ees__E2eeAddress *) * address_list_len);
+    qsort(sorted, address_list_len, sizeof(E2ees__E2eeAddress *), compare_group_msg_filter_address);
+
+    size_t copied_num = 0;
+    size_t i;
+    for (i = 0; i < address_list_len; i++) {
+        if (i > 0 && compare_group_msg_filter_address(&(sorted[i - 1]), &(sorted[i])) == 0) {
+            continue;
+        }
+        copied_num++;
+    }
+    *dest = (E2ees__E2eeAddress **)malloc(sizeof(E2ees__E2eeAddress *) * copied_num);
+    copied_num = 0;
+    for (i = 0; i < address_list_len; i++) {
+        if (i > 0 && compare_group_msg_filter_address(&(sorted[i - 1]), &(sorted[i])) == 0) {
+            continue;
+        }
+        copy_address_from_address(&((*dest)[copied_num]), sorted[i]);
+        copied_num++;
+    }
+
+    // release
+    free_mem((void **)&sorted, sizeof(E2ees__E2eeAddress *) * address_list_len);
+
+    return copied_num;
+}
+
+int new_group_msg_filter(
+    e2ees_group_msg_filter_t **filter_out,
+    E2ees__E2eeAddress **allow_list,
+    size_t allow_list_len,
+    E2ees__E2eeAddress **deny_list,
+    size_t deny_list_len
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    e2ees_group_msg_filter_t *filter = NULL;
+
+    if (!is_valid_address_list(allow_list, allow_list_len)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "new_group_msg_filter()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (!is_valid_address_list(deny_list, deny_list_len)) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "new_group_msg_filter()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (allow_list_len == 0 && deny_list_len == 0) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "new_group_msg_filter() empty filter");
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        filter = (e2ees_group_msg_filter_t *)malloc(sizeof(e2ees_group_msg_filter_t));
+        filter->allow_list_len = copy_group_msg_filter_list(&(filter->allow_list), allow_list, allow_list_len);
+        filter->deny_list_len = copy_group_msg_filter_list(&(filter->deny_list), deny_list, deny_list_len);
+
+        *filter_out = filter;
+    }
+
+    return ret;
+}
+
+void free_group_msg_filter(e2ees_group_msg_filter_t **filter) {
+    e2ees_group_msg_filter_t *cur = *filter;
+    if (cur == NULL) {
+        return;
+    }
+
+    size_t i;
+    for (i = 0; i < cur->allow_list_len; i++) {
+        e2ees__e2ee_address__free_unpacked(cur->allow_list[i], NULL);
+    }
+    if (cur->allow_list != NULL) {
+        free_mem((void **)&(cur->allow_list), sizeof(E2ees__E2eeAddress *) * cur->allow_list_len);
+    }
+    for (i = 0; i < cur->deny_list_len; i++) {
+        e2ees__e2ee_address__free_unpacked(cur->deny_list[i], NULL);
+    }
+    if (cur->deny_list != NULL) {
+        free_mem((void **)&(cur->deny_list), sizeof(E2ees__E2eeAddress *) * cur->deny_list_len);
+    }
+    free_mem((void **)filter, sizeof(e2ees_group_msg_filter_t));
+}
+
+int produce_send_group_msg_request_with_filter(
+    E2ees__SendGroupMsgRequest **request_out,
+    E2ees__GroupSession *outbound_group_session,
+    const ProtobufCBinaryData *chain_key,
+    uint32_t sequence,
+    uint32_t notif_level,
+    const uint8_t *plaintext_data, size_t plaintext_data_len,
+    const e2ees_group_msg_filter_t *filter
+) {
+    if (filter == NULL) {
+        e2ees_notify_log(NULL, BAD_ADDRESS, "produce_send_group_msg_request_with_filter()");
+        return E2EES_RESULT_FAIL;
+    }
+
+    E2ees__SendGroupMsgRequest *request = NULL;
+    int ret = produce_send_group_msg_request_by_sequence(
+        &request, outbound_group_session, chain_key, sequence, notif_level,
+        plaintext_data, plaintext_data_len, NULL, 0, NULL, 0
+    );
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // the filter has been validated, lend its addresses to the request
+        request->n_allow_list = filter->allow_list_len;
+        request->allow_list = filter->allow_list;
+        request->n_deny_list = filter->deny_list_len;
+        request->deny_list = filter->deny_list;
+
+        *request_out = request;
+    }
+
+    return ret;
+}
+
+void free_send_group_msg_request_with_filter(E2ees__SendGroupMsgRequest **request) {
+    E2ees__SendGroupMsgRequest *cur = *request;
+    if (cur == NULL) {
+        return;
+    }
+
+    cur->n_allow_list = 0;
+    cur->allow_list = NULL;
+    cur->n_deny_list = 0;
+    cur->deny_list = NULL;
+    e2ees__send_group_msg_request__free_unpacked(cur, NULL);
+    *request = NULL;
+}
+
+int consume_send_group_msg_response(
+    E2ees__GroupSession *outbound_group_session,
+    E2ees__SendGroupMsgRequest *request,
+    E2ees__SendGroupMsgResponse *response
+) {
     int ret = E2EES_RESULT_SUCC;
 
     cipher_suite_t *cipher_suite = NULL;
@@ -1179,27 +1530,109 @@ int consume_send_group_msg_response(E2ees__GroupSession *outbound_group_session,
     } else {
         ret = E2EES_RESULT_FAIL;
     }
+    if (request == NULL || request->msg == NULL || request->msg->group_msg == NULL) {
+        ret = E2EES_RESULT_FAIL;
+    }
     if (!is_valid_send_group_msg_response(response)) {
         ret = E2EES_RESULT_FAIL;
     }
 
-    if (ret == E2EES_RESULT_SUCC) {
-        // prepare a new chain key for next encryption
-        advance_group_chain_key(cipher_suite, &(outbound_group_session->chain_key));
-        outbound_group_session->sequence += 1;
-        // store sesson state
-        get_e2ees_plugin()->db_handler.store_group_session(outbound_group_session);
+    if (ret == E2EES_RESULT_SUCC
+        && safe_strcmp(outbound_group_session->session_id, request->msg->session_id)
+        && outbound_group_session->sequence <= request->msg->group_msg->sequence
+    ) {
+        // the request was produced without a reservation, move past its sequence
+        uint32_t next_sequence = request->msg->group_msg->sequence + 1;
+        E2ees__GroupSession *group_session = NULL;
+        group_msg_sequence_mutex *sequence_mutex = lock_group_msg_sequences(
+            outbound_group_session->session_owner, outbound_group_session->group_info->group_address
+        );
+        load_group_session_by_address_internal(
+            outbound_group_session->session_owner, outbound_group_session->session_owner,
+            outbound_group_session->group_info->group_address, &group_session
+        );
+        if (group_session != NULL
+            && safe_strcmp(group_session->session_id, request->msg->session_id)
+            && group_session->sequence < next_sequence
+        ) {
+            advance_group_chain_key_to_sequence(
+                cipher_suite, &(group_session->chain_key), &(group_session->sequence), next_sequence, NULL, 0
+            );
+            store_group_session_internal(group_session);
+        }
+        unlock_group_msg_sequences(sequence_mutex);
+        free_proto(group_session);
     }
 
     return ret;
 }
 
+// the chain keys derived while catching up are shared with the other owners only
+// after the message has been decrypted, so that a chain that went wrong is not spread
+typedef struct derived_group_chain_keys {
+    uint32_t *sequences;
+    ProtobufCBinaryData *chain_keys;
+    size_t chain_keys_num;
+} derived_group_chain_keys;
+
+static void keep_derived_group_chain_key(
+    derived_group_chain_keys *derived, uint32_t sequence, const ProtobufCBinaryData *chain_key
+) {
+    derived->sequences = (uint32_t *)realloc(derived->sequences, sizeof(uint32_t) * (derived->chain_keys_num + 1));
+    derived->chain_keys = (ProtobufCBinaryData *)realloc(
+        derived->chain_keys, sizeof(ProtobufCBinaryData) * (derived->chain_keys_num + 1)
+    );
+    derived->sequences[derived->chain_keys_num] = sequence;
+    copy_protobuf_from_protobuf(&(derived->chain_keys[derived->chain_keys_num]), chain_key);
+    derived->chain_keys_num++;
+}
+
+static void release_derived_group_chain_keys(
+    derived_group_chain_keys *derived, group_session_cacheer *inbound_group_session, bool share
+) {
+    size_t i;
+    for (i = 0; i < derived->chain_keys_num; i++) {
+        if (share) {
+            store_shared_group_chain_key(
+                inbound_group_session->sender_address, inbound_group_session->session_id,
+                &(inbound_group_session->chain_id), derived->sequences[i], &(derived->chain_keys[i])
+            );
+        }
+        free_protobuf(&(derived->chain_keys[i]));
+    }
+    free_mem((void **)&(derived->sequences), sizeof(uint32_t) * derived->chain_keys_num);
+    free_mem((void **)&(derived->chain_keys), sizeof(ProtobufCBinaryData) * derived->chain_keys_num);
+    derived->chain_keys_num = 0;
+}
+
+static void step_inbound_group_chain(
+    const cipher_suite_t *cipher_suite, group_session_cacheer *inbound_group_session, derived_group_chain_keys *derived
+) {
+    uint32_t next_sequence = inbound_group_session->sequence + 1;
+    // take the next chain key from another owner of the same chain if it has been derived already
+    if (!load_shared_group_chain_key(
+            &(inbound_group_session->chain_key), inbound_group_session->sender_address,
+            inbound_group_session->session_id, &(inbound_group_session->chain_id), next_sequence
+        )) {
+        advance_group_chain_key(cipher_suite, &(inbound_group_session->chain_key));
+        if (derived != NULL) {
+            keep_derived_group_chain_key(derived, next_sequence, &(inbound_group_session->chain_key));
+        } else {
+            store_shared_group_chain_key(
+                inbound_group_session->sender_address, inbound_group_session->session_id,
+                &(inbound_group_session->chain_id), next_sequence, &(inbound_group_session->chain_key)
+            );
+        }
+    }
+    inbound_group_session->sequence = next_sequence;
+}
+
 bool consume_group_msg(E2ees__E2eeAddress *receiver_address, E2ees__E2eeMsg *e2ee_msg) {
     int ret = E2EES_RESULT_SUCC;
 
-    // load the inbound group session
-    E2ees__GroupSession *inbound_group_session = NULL;
-    get_e2ees_plugin()->db_handler.load_group_session_by_id(e2ee_msg->from, receiver_address, e2ee_msg->session_id, &inbound_group_session);
+    // load the chain state of the inbound group session from the cache
+    group_session_cacheer *inbound_group_session = NULL;
+    load_group_session_cacheer(&inbound_group_session, e2ee_msg->from, receiver_address, e2ee_msg->session_id);
 
     if (inbound_group_session == NULL){
         e2ees_notify_log(receiver_address, BAD_GROUP_SESSION, "consume_group_msg() inbound group session not found, just consume it");
@@ -1211,66 +1644,117 @@ bool consume_group_msg(E2ees__E2eeAddress *receiver_address, E2ees__E2eeMsg *e2e
 
     if (inbound_group_session->associated_data.data == NULL || inbound_group_session->associated_data.len < sign_key_len){
         e2ees_notify_log(receiver_address, BAD_GROUP_SESSION, "consume_group_msg() inbound group session associated_data is null, just consume it");
+        free_group_session_cacheer(&inbound_group_session);
         return true;
     }
 
     // unpack the e2ee message
     E2ees__GroupMsgPayload *group_msg_payload = e2ee_msg->group_msg;
 
-    uint8_t *identity_public_key = (uint8_t *)malloc(sizeof(uint8_t) * sign_key_len);
-    memcpy(identity_public_key, inbound_group_session->associated_data.data, sign_key_len);
-
-    // verify the signature
+    // verify the signature, the sender's identity public key is the prefix of the associated data
     int succ = cipher_suite->ds_suite->verify(
         group_msg_payload->signature.data, group_msg_payload->signature.len,
         group_msg_payload->ciphertext.data, group_msg_payload->ciphertext.len,
-        identity_public_key
+        inbound_group_session->associated_data.data
     );
     if (succ < 0){
-        e2ees_notify_log(inbound_group_session->session_owner, BAD_SIGNATURE, "consume_group_msg()");
+        e2ees_notify_log(inbound_group_session->owner_address, BAD_SIGNATURE, "consume_group_msg()");
         // release
-        e2ees__group_session__free_unpacked(inbound_group_session, NULL);
-        free_mem((void **)&identity_public_key, sign_key_len);
+        free_group_session_cacheer(&inbound_group_session);
         return false;
     }
 
-    // advance the chain key
-    while (inbound_group_session->sequence < group_msg_payload->sequence){
-        advance_group_chain_key(cipher_suite, &(inbound_group_session->chain_key));
-        inbound_group_session->sequence += 1;
-    }
-
-    // create the message key
     E2ees__MsgKey *msg_key = (E2ees__MsgKey *)malloc(sizeof(E2ees__MsgKey));
     e2ees__msg_key__init(msg_key);
-    create_group_message_key(cipher_suite, &(inbound_group_session->chain_key), msg_key);
+    derived_group_chain_keys derived = {NULL, NULL, 0};
+
+    bool overtaken = group_msg_payload->sequence < inbound_group_session->sequence;
+    if (overtaken) {
+        // a message from a pipelined sender can arrive after a later one, use the kept message key
+        if (take_group_msg_skipped_key(
+                &(msg_key->derived_key), e2ee_msg->from, receiver_address, e2ee_msg->session_id, group_msg_payload->sequence
+            ) != E2EES_RESULT_SUCC) {
+            // the key was never kept, because the chain jumped over the sequence, or it has been taken already
+            e2ees_notify_log(
+                inbound_group_session->owner_address, BAD_GROUP_MSG_OVERTAKEN,
+                "consume_group_msg() no message key of sequence %u kept, the chain is at sequence %u, just consume it",
+                group_msg_payload->sequence, inbound_group_session->sequence
+            );
+        }
+    } else {
+        // jump to the sender's checkpoint if there is one on the way
+        uint32_t window_start = inbound_group_session->sequence;
+        if (group_msg_payload->sequence - window_start > E2EES_GROUP_MSG_MAX_SKIPPED_KEYS)
+            window_start = group_msg_payload->sequence - E2EES_GROUP_MSG_MAX_SKIPPED_KEYS;
+        uint32_t checkpoint_sequence = inbound_group_session->checkpoint_sequence;
+        if (inbound_group_session->checkpoint_chain_key.len > 0
+            && checkpoint_sequence > window_start && checkpoint_sequence <= group_msg_payload->sequence)
+            window_start = checkpoint_sequence;
+        if (window_start > inbound_group_session->sequence) {
+            if (load_shared_group_chain_key(
+                    &(inbound_group_session->chain_key), e2ee_msg->from, e2ee_msg->session_id,
+                    &(inbound_group_session->chain_id), window_start
+                )) {
+                inbound_group_session->sequence = window_start;
+            } else {
+                advance_group_chain_key_to_sequence(
+                    cipher_suite, &(inbound_group_session->chain_key), &(inbound_group_session->sequence), window_start,
+                    &(inbound_group_session->checkpoint_chain_key), checkpoint_sequence
+                );
+                keep_derived_group_chain_key(&derived, window_start, &(inbound_group_session->chain_key));
+            }
+        }
+
+        // keep the message keys of the skipped sequences close to the message
+        while (inbound_group_session->sequence < group_msg_payload->sequence) {
+            create_group_message_key(cipher_suite, &(inbound_group_session->chain_key), msg_key);
+            store_group_msg_skipped_key(
+                e2ee_msg->from, receiver_address, e2ee_msg->session_id,
+                inbound_group_session->sequence, &(msg_key->derived_key)
+            );
+            free_protobuf(&(msg_key->derived_key));
+            step_inbound_group_chain(cipher_suite, inbound_group_session, &derived);
+        }
+
+        // create the message key
+        create_group_message_key(cipher_suite, &(inbound_group_session->chain_key), msg_key);
+    }
 
     // decryption
-    uint8_t *plaintext_data;
-    size_t plaintext_data_len;
-    ret = cipher_suite->se_suite->decrypt(
-        &plaintext_data,
-        &plaintext_data_len,
-        &(inbound_group_session->associated_data),
-        msg_key->derived_key.data,
-        group_msg_payload->ciphertext.data, group_msg_payload->ciphertext.len
-    );
+    uint8_t *plaintext_data = NULL;
+    size_t plaintext_data_len = 0;
+    if (msg_key->derived_key.len > 0) {
+        ret = cipher_suite->se_suite->decrypt(
+            &plaintext_data,
+            &plaintext_data_len,
+            &(inbound_group_session->associated_data),
+            msg_key->derived_key.data,
+            group_msg_payload->ciphertext.data, group_msg_payload->ciphertext.len
+        );
+    }
 
     if (plaintext_data_len <= 0){
-        e2ees_notify_log(inbound_group_session->session_owner, BAD_MESSAGE_DECRYPTION, "consume_group_msg()");
-    } else {
-        e2ees_notify_group_msg(inbound_group_session->session_owner, e2ee_msg->from, inbound_group_session->group_info->group_address, plaintext_data, plaintext_data_len);
+        // an overtaken message without a key has been reported already
+        if (msg_key->derived_key.len > 0) {
+            e2ees_notify_log(inbound_group_session->owner_address, BAD_MESSAGE_DECRYPTION, "consume_group_msg()");
+        }
+    } else if (overtaken) {
+        // the chain has already moved past this message
+        e2ees_notify_group_msg(inbound_group_session->owner_address, e2ee_msg->from, inbound_group_session->group_address, plaintext_data, plaintext_data_len);
         free_mem((void **)&plaintext_data, plaintext_data_len);
+    } else {
+        // advance the chain key, the message has been decrypted so the next key can be shared at once
+        step_inbound_group_chain(cipher_suite, inbound_group_session, NULL);
+        // the sequence is stored before the message is handed over, the chain state is written back in batches
+        update_group_session_cacheer(inbound_group_session);
 
-        // advance the chain key
-        advance_group_chain_key(cipher_suite, &(inbound_group_session->chain_key));
-        inbound_group_session->sequence += 1;
-        get_e2ees_plugin()->db_handler.store_group_session(inbound_group_session);
+        e2ees_notify_group_msg(inbound_group_session->owner_address, e2ee_msg->from, inbound_group_session->group_address, plaintext_data, plaintext_data_len);
+        free_mem((void **)&plaintext_data, plaintext_data_len);
     }
 
-    // release
-    e2ees__group_session__free_unpacked(inbound_group_session, NULL);
-    free_mem((void **)&identity_public_key, sign_key_len);
+    // release, the derived chain keys are shared only if the message has been decrypted
+    release_derived_group_chain_keys(&derived, inbound_group_session, plaintext_data_len > 0 && !overtaken);
+    free_group_session_cacheer(&inbound_group_session);
     e2ees__msg_key__free_unpacked(msg_key, NULL);
 
     return succ>=0;
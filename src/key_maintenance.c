@@ -0,0 +1,297 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "e2ees/key_maintenance.h"
+
+#include <stdatomic.h>
+#include <string.h>
+
+#include "e2ees/account.h"
+#include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
+#include "e2ees/mem_util.h"
+#include "e2ees/validation.h"
+#include "spin_lock.h"
+
+typedef struct key_maintenance_task_t {
+    E2ees__E2eeAddress *address;
+    E2ees__Account *account;
+    int64_t now;
+    atomic_size_t *rotated_num;
+    _Atomic int64_t *next_due_ts;
+} key_maintenance_task_t;
+
+/**
+ * @brief The one-time pre-keys to be supplied for an account. There is at most one
+ * task running for each account, the other requests are added to its opks_num.
+ */
+typedef struct supply_opks_task_t {
+    E2ees__E2eeAddress *address;
+    uint32_t opks_num;
+    struct supply_opks_task_t *next;
+} supply_opks_task_t;
+
+static atomic_bool key_maintenance_scheduled = false;
+
+static supply_opks_task_t *supply_opks_task_list = NULL;
+static e2ees_spin_lock_t supply_opks_task_lock = E2EES_SPIN_LOCK_INIT;
+
+int rotate_signed_pre_key(E2ees__Account *account) {
+    int ret = E2EES_RESULT_SUCC;
+
+    E2ees__SignedPreKey *signed_pre_key = NULL;
+    E2ees__PublishSpkResponse *response = NULL;
+
+    if (!is_valid_registered_account(account)) {
+        e2ees_notify_log(NULL, BAD_ACCOUNT, "rotate_signed_pre_key()");
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // generate a new pair of signed pre-key
+        ret = generate_signed_pre_key(
+            &signed_pre_key, account->e2ees_pack_id, account->signed_pre_key->spk_id,
+            account->identity_key->sign_key_pair->private_key.data
+        );
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // release the old signed pre-key
+        e2ees__signed_pre_key__free_unpacked(account->signed_pre_key, NULL);
+        account->signed_pre_key = signed_pre_key;
+
+        ret = publish_spk_internal(&response, account);
+        if (ret == E2EES_RESULT_SUCC && response == NULL) {
+            // the server did not take it, the new signed pre-key is not saved
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        // check and remove signed pre-keys (keep last two)
+        get_e2ees_plugin()->db_handler.remove_expired_signed_pre_key(account->address);
+    }
+
+    // release
+    if (response != NULL) {
+        e2ees__publish_spk_response__free_unpacked(response, NULL);
+        response = NULL;
+    }
+
+    return ret;
+}
+
+static void update_next_due_ts(_Atomic int64_t *next_due_ts, int64_t due_ts) {
+    int64_t cur = atomic_load(next_due_ts);
+    while (due_ts < cur && !atomic_compare_exchange_weak(next_due_ts, &cur, due_ts)) {
+    }
+}
+
+static void run_key_maintenance_task(void *arg) {
+    key_maintenance_task_t *task = (key_maintenance_task_t *)arg;
+    E2ees__Account *account = task->account;
+
+    if (account == NULL) {
+        // the one-time pre-keys are not needed for the rotation
+        load_account_without_opks_internal(&account, task->address);
+    }
+    if (account == NULL || !is_valid_registered_account(account)) {
+        e2ees_notify_log(task->address, BAD_ACCOUNT, "run_key_maintenance_task()");
+    } else {
+        if (account->signed_pre_key->ttl - E2EES_SIGNED_PRE_KEY_ROTATION_LEAD_MS <= task->now) {
+            if (rotate_signed_pre_key(account) == E2EES_RESULT_SUCC) {
+                atomic_fetch_add(task->rotated_num, 1);
+            } else {
+                // try again later
+                update_next_due_ts(task->next_due_ts, task->now + E2EES_KEY_MAINTENANCE_RETRY_MS);
+            }
+        }
+        update_next_due_ts(task->next_due_ts, account->signed_pre_key->ttl - E2EES_SIGNED_PRE_KEY_ROTATION_LEAD_MS);
+    }
+
+    // release
+    if (account != NULL && account != task->account) {
+        e2ees__account__free_unpacked(account, NULL);
+    }
+}
+
+size_t run_key_maintenance() {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    e2ees_account_header_t *account_headers = NULL;
+    E2ees__Account **accounts = NULL;
+    size_t account_num;
+    if (plugin->db_handler.load_account_headers != NULL) {
+        account_num = plugin->db_handler.load_account_headers(&account_headers);
+    } else {
+        account_num = plugin->db_handler.load_accounts(&accounts);
+    }
+    if (account_num == 0) {
+        return 0;
+    }
+
+    int64_t now = plugin->common_handler.gen_ts();
+    atomic_size_t rotated_num;
+    atomic_init(&rotated_num, 0);
+    _Atomic int64_t next_due_ts;
+    atomic_init(&next_due_ts, INT64_MAX);
+
+    // the key generation and the publishing of each account are independent
+    key_maintenance_task_t *tasks = (key_maintenance_task_t *)malloc(sizeof(key_maintenance_task_t) * account_num);
+    void **task_args = (void **)malloc(sizeof(void *) * account_num);
+    size_t i;
+    for (i = 0; i < account_num; i++) {
+        tasks[i].account = accounts == NULL ? NULL : accounts[i];
+        tasks[i].address = accounts == NULL ? account_headers[i].address : accounts[i]->address;
+        tasks[i].now = now;
+        tasks[i].rotated_num = &rotated_num;
+        tasks[i].next_due_ts = &next_due_ts;
+        task_args[i] = &(tasks[i]);
+    }
+    run_tasks_internal(run_key_maintenance_task, task_args, account_num, E2EES_KEY_MAINTENANCE_MAX_WORKERS);
+
+    size_t rotated = atomic_load(&rotated_num);
+    e2ees_notify_log(NULL, DEBUG_LOG, "run_key_maintenance(): rotated num = %zu", rotated);
+
+    int64_t next_due = atomic_load(&next_due_ts);
+    if (next_due != INT64_MAX) {
+        schedule_key_maintenance(next_due > now ? next_due - now : E2EES_KEY_MAINTENANCE_RETRY_MS);
+    }
+
+    // release
+    free_mem((void **)&task_args, sizeof(void *) * account_num);
+    free_mem((void **)&tasks, sizeof(key_maintenance_task_t) * account_num);
+    if (account_headers != NULL) {
+        free_account_headers(&account_headers, account_num);
+    }
+    if (accounts != NULL) {
+        for (i = 0; i < account_num; i++) {
+            if (accounts[i] != NULL)
+                e2ees__account__free_unpacked(accounts[i], NULL);
+        }
+        free_mem((void **)&accounts, sizeof(E2ees__Account *) * account_num);
+    }
+
+    return rotated;
+}
+
+static void run_scheduled_key_maintenance(void *arg) {
+    atomic_store(&key_maintenance_scheduled, false);
+    // the plugin may have been detached before the task is run
+    if (get_e2ees_plugin() == NULL)
+        return;
+    run_key_maintenance();
+}
+
+bool schedule_key_maintenance(int64_t delay_ms) {
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    if (plugin->common_handler.schedule_task == NULL)
+        return false;
+
+    bool expected = false;
+    if (atomic_compare_exchange_strong(&key_maintenance_scheduled, &expected, true)) {
+        plugin->common_handler.schedule_task(run_scheduled_key_maintenance, NULL, delay_ms);
+    }
+    return true;
+}
+
+static uint32_t take_supply_opks_num(supply_opks_task_t *task) {
+    uint32_t opks_num;
+
+    e2ees_spin_lock(&supply_opks_task_lock);
+    opks_num = task->opks_num;
+    task->opks_num = 0;
+    if (opks_num == 0) {
+        // nothing is left, so the next request starts a new task
+        supply_opks_task_t **cur = &supply_opks_task_list;
+        while (*cur != task) {
+            cur = &((*cur)->next);
+        }
+        *cur = task->next;
+    }
+    e2ees_spin_unlock(&supply_opks_task_lock);
+
+    return opks_num;
+}
+
+static void run_supply_opks_task(void *arg) {
+    supply_opks_task_t *task = (supply_opks_task_t *)arg;
+    uint32_t opks_num;
+
+    while ((opks_num = take_supply_opks_num(task)) != 0) {
+        // the plugin may have been detached before the task is run
+        if (get_e2ees_plugin() == NULL)
+            continue;
+
+        // the account is loaded here so that it has the next one-time pre-key id of the previous supply,
+        // which is derived from the one-time pre-keys in the account if the db cannot keep it
+        E2ees__Account *account = NULL;
+        if (get_e2ees_plugin()->db_handler.update_next_one_time_pre_key_id != NULL) {
+            load_account_without_opks_internal(&account, task->address);
+        } else {
+            get_e2ees_plugin()->db_handler.load_account_by_address(task->address, &account);
+        }
+        if (!is_valid_registered_account(account)) {
+            e2ees_notify_log(task->address, BAD_ACCOUNT, "run_supply_opks_task()");
+        } else {
+            E2ees__SupplyOpksResponse *response = NULL;
+            supply_opks_internal(&response, account, opks_num);
+            if (response != NULL) {
+                e2ees__supply_opks_response__free_unpacked(response, NULL);
+                response = NULL;
+            }
+        }
+
+        // release
+        if (account != NULL) {
+            e2ees__account__free_unpacked(account, NULL);
+        }
+    }
+
+    // release
+    e2ees__e2ee_address__free_unpacked(task->address, NULL);
+    free(task);
+}
+
+void schedule_supply_opks(E2ees__E2eeAddress *address, uint32_t opks_num) {
+    supply_opks_task_t *task = NULL;
+
+    e2ees_spin_lock(&supply_opks_task_lock);
+    supply_opks_task_t *cur = supply_opks_task_list;
+    while (cur != NULL) {
+        if (compare_address(cur->address, address)) {
+            // the running task of the account takes it
+            cur->opks_num += opks_num;
+            e2ees_spin_unlock(&supply_opks_task_lock);
+            return;
+        }
+        cur = cur->next;
+    }
+    task = (supply_opks_task_t *)malloc(sizeof(supply_opks_task_t));
+    copy_address_from_address(&(task->address), address);
+    task->opks_num = opks_num;
+    task->next = supply_opks_task_list;
+    supply_opks_task_list = task;
+    e2ees_spin_unlock(&supply_opks_task_lock);
+
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    if (plugin->common_handler.schedule_task != NULL) {
+        plugin->common_handler.schedule_task(run_supply_opks_task, task, 0);
+    } else {
+        run_supply_opks_task(task);
+    }
+}
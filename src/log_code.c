@@ -68,6 +68,7 @@ static const char * LOG_CODE_STRINGS[] = {
     "BAD_GROUP_INFO",
     "BAD_GROUP_SEED",
     "BAD_GROUP_CHAIN_KEY",
+    "BAD_GROUP_MSG_OVERTAKEN",
     "BAD_GROUP_PRE_KEY_BUNDLE",
     "BAD_GROUP_UPDATE_KEY_BUNDLE",
 
@@ -123,6 +124,7 @@ static const char * LOG_CODE_STRINGS[] = {
 
     // plaintext
     "BAD_PLAINTEXT",
+    "BAD_PENDING_PLAINTEXT",
 
     // server signature
     "BAD_SERVER_SIGNATURE"
@@ -569,31 +569,180 @@ void copy_leave_group_msg(E2ees__LeaveGroupMsg **dest, E2ees__LeaveGroupMsg *src
     }
 }
 
+///-----------------group member index-----------------///
+
+static uint32_t hash_group_member_key(const char *user_id, const char *domain) {
+    // FNV-1a over "user_id\0domain"
+    uint32_t hash = 2166136261u;
+    const char *cur;
+    if (user_id != NULL) {
+        for (cur = user_id; *cur != '\0'; cur++) {
+            hash ^= (uint8_t)(*cur);
+            hash *= 16777619u;
+        }
+    }
+    // the separator byte
+    hash *= 16777619u;
+    if (domain != NULL) {
+        for (cur = domain; *cur != '\0'; cur++) {
+            hash ^= (uint8_t)(*cur);
+            hash *= 16777619u;
+        }
+    }
+    return hash;
+}
+
+static bool lookup_group_member_slot(
+    const group_member_index_t *index, const char *user_id, const char *domain, uint32_t hash, size_t *slot_out
+) {
+    size_t mask = index->slots_num - 1;
+    size_t slot = hash & mask;
+    while (index->slots[slot] != 0) {
+        if (index->slot_hashes[slot] == hash) {
+            E2ees__GroupMember *member = index->members[index->slots[slot] - 1];
+            if (safe_strcmp(member->user_id, user_id) && safe_strcmp(member->domain, domain)) {
+                *slot_out = slot;
+                return true;
+            }
+        }
+        slot = (slot + 1) & mask;
+    }
+    *slot_out = slot;
+    return false;
+}
+
+static void rehash_group_member_index(group_member_index_t *index, size_t slots_num) {
+    size_t i, slot;
+    free_mem((void **)&(index->slots), sizeof(size_t) * index->slots_num);
+    free_mem((void **)&(index->slot_hashes), sizeof(uint32_t) * index->slots_num);
+    index->slots_num = slots_num;
+    index->slots = (size_t *)calloc(slots_num, sizeof(size_t));
+    index->slot_hashes = (uint32_t *)calloc(slots_num, sizeof(uint32_t));
+    for (i = 0; i < index->members_num; i++) {
+        uint32_t hash = hash_group_member_key(index->members[i]->user_id, index->members[i]->domain);
+        lookup_group_member_slot(index, index->members[i]->user_id, index->members[i]->domain, hash, &slot);
+        index->slots[slot] = i + 1;
+        index->slot_hashes[slot] = hash;
+    }
+}
+
+void init_group_member_index(group_member_index_t *index, E2ees__GroupMember **members, size_t members_num) {
+    size_t slots_num = 16;
+    while (slots_num < 2 * members_num)
+        slots_num <<= 1;
+
+    index->members = NULL;
+    index->members_num = 0;
+    index->members_capacity = 0;
+    index->slots = NULL;
+    index->slot_hashes = NULL;
+    index->slots_num = 0;
+    rehash_group_member_index(index, slots_num);
+
+    if (members_num > 0) {
+        index->members_capacity = members_num;
+        index->members = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * members_num);
+    }
+    size_t i;
+    for (i = 0; i < members_num; i++) {
+        insert_group_member_into_index(index, members[i]);
+    }
+}
+
+bool find_group_member_in_index(
+    const group_member_index_t *index, const char *user_id, const char *domain, size_t *position_out
+) {
+    size_t slot;
+    if (index->slots_num == 0)
+        return false;
+    if (!lookup_group_member_slot(index, user_id, domain, hash_group_member_key(user_id, domain), &slot))
+        return false;
+    if (position_out != NULL)
+        *position_out = index->slots[slot] - 1;
+    return true;
+}
+
+bool insert_group_member_into_index(group_member_index_t *index, E2ees__GroupMember *member) {
+    size_t slot;
+    uint32_t hash = hash_group_member_key(member->user_id, member->domain);
+    if (lookup_group_member_slot(index, member->user_id, member->domain, hash, &slot))
+        return false;
+
+    if (index->members_num == index->members_capacity) {
+        index->members_capacity = index->members_capacity == 0 ? 8 : 2 * index->members_capacity;
+        index->members = (E2ees__GroupMember **)realloc(
+            index->members, sizeof(E2ees__GroupMember *) * index->members_capacity
+        );
+    }
+    index->members[index->members_num] = member;
+    index->members_num++;
+    index->slots[slot] = index->members_num;
+    index->slot_hashes[slot] = hash;
+
+    // keep the load factor under one half
+    if (2 * index->members_num > index->slots_num)
+        rehash_group_member_index(index, 2 * index->slots_num);
+
+    return true;
+}
+
+void free_group_member_index(group_member_index_t *index) {
+    if (index->members != NULL) {
+        free(index->members);
+        index->members = NULL;
+    }
+    free_mem((void **)&(index->slots), sizeof(size_t) * index->slots_num);
+    free_mem((void **)&(index->slot_hashes), sizeof(uint32_t) * index->slots_num);
+    index->members_num = 0;
+    index->members_capacity = 0;
+    index->slots_num = 0;
+}
+
 ///-----------------add or remove group members-----------------///
 
-void add_group_members_to_group_info(
+static void new_group_info_with_members(
     E2ees__GroupInfo **dest,
     E2ees__GroupInfo *old_group_info,
-    E2ees__GroupMember **adding_member_list,
-    size_t adding_members_num
+    E2ees__GroupMember **members,
+    size_t members_num
 ) {
-    size_t old_group_members_num = old_group_info->n_group_member_list;
-    size_t new_group_members_num = old_group_members_num + adding_members_num;
     *dest = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
     e2ees__group_info__init(*dest);
     if (old_group_info->group_name != NULL)
         (*dest)->group_name = strdup(old_group_info->group_name);
     if (old_group_info->group_address != NULL)
         copy_address_from_address(&((*dest)->group_address), old_group_info->group_address);
-    (*dest)->n_group_member_list = new_group_members_num;
-    (*dest)->group_member_list = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * new_group_members_num);
-    size_t i;
-    for (i = 0; i < old_group_members_num; i++) {
-        copy_group_member(&(((*dest)->group_member_list)[i]), (old_group_info->group_member_list)[i]);
+    (*dest)->n_group_member_list = members_num;
+    if (members_num > 0) {
+        (*dest)->group_member_list = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * members_num);
+        size_t i;
+        for (i = 0; i < members_num; i++) {
+            copy_group_member(&(((*dest)->group_member_list)[i]), members[i]);
+        }
     }
-    for (i = old_group_members_num; i < new_group_members_num; i++) {
-        copy_group_member(&(((*dest)->group_member_list)[i]), adding_member_list[i - old_group_members_num]);
+}
+
+void add_group_members_to_group_info(
+    E2ees__GroupInfo **dest,
+    E2ees__GroupInfo *old_group_info,
+    E2ees__GroupMember **adding_member_list,
+    size_t adding_members_num
+) {
+    group_member_index_t index;
+    init_group_member_index(&index, old_group_info->group_member_list, old_group_info->n_group_member_list);
+    size_t i;
+    for (i = 0; i < adding_members_num; i++) {
+        if (!insert_group_member_into_index(&index, adding_member_list[i])) {
+            e2ees_notify_log(
+                NULL, DEBUG_LOG, "add_group_members_to_group_info() skip existing group member: %s@%s",
+                adding_member_list[i]->user_id, adding_member_list[i]->domain
+            );
+        }
     }
+
+    new_group_info_with_members(dest, old_group_info, index.members, index.members_num);
+
+    free_group_member_index(&index);
 }
 
 void remove_group_members_from_group_info(
@@ -603,25 +752,26 @@ void remove_group_members_from_group_info(
     size_t removing_members_num
 ) {
     size_t old_group_members_num = old_group_info->n_group_member_list;
-    size_t new_group_members_num = old_group_members_num - removing_members_num;
-    *dest = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
-    e2ees__group_info__init(*dest);
-    if (old_group_info->group_name != NULL)
-        (*dest)->group_name = strdup(old_group_info->group_name);
-    if (old_group_info->group_address != NULL)
-        copy_address_from_address(&((*dest)->group_address), old_group_info->group_address);
-    (*dest)->n_group_member_list = new_group_members_num;
-    (*dest)->group_member_list = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * new_group_members_num);
-    size_t i, cur_pos = 0;
+    E2ees__GroupMember **remaining_members = NULL;
+    size_t remaining_members_num = 0;
+    if (old_group_members_num > 0)
+        remaining_members = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * old_group_members_num);
+
+    group_member_index_t removing_index;
+    init_group_member_index(&removing_index, removing_member_list, removing_members_num);
+    size_t i;
     for (i = 0; i < old_group_members_num; i++) {
-        if ((cur_pos == removing_members_num) || ((old_group_info->group_member_list)[i]->role != removing_member_list[cur_pos]->role) ||
-            !safe_strcmp((old_group_info->group_member_list)[i]->user_id, removing_member_list[cur_pos]->user_id) ||
-            !safe_strcmp((old_group_info->group_member_list)[i]->domain, removing_member_list[cur_pos]->domain)) {
-            copy_group_member(&(((*dest)->group_member_list)[i - cur_pos]), (old_group_info->group_member_list)[i]);
-        } else {
-            cur_pos++;
+        E2ees__GroupMember *member = (old_group_info->group_member_list)[i];
+        if (!find_group_member_in_index(&removing_index, member->user_id, member->domain, NULL)) {
+            remaining_members[remaining_members_num++] = member;
         }
     }
+
+    new_group_info_with_members(dest, old_group_info, remaining_members, remaining_members_num);
+
+    free_group_member_index(&removing_index);
+    if (remaining_members != NULL)
+        free(remaining_members);
 }
 
 E2ees__GroupMember *member_info_to_group_member(E2ees__GroupMemberInfo *member_info) {
@@ -648,62 +798,36 @@ size_t member_info_to_group_members(
     E2ees__GroupMemberInfo **member_info_list, size_t member_info_list_num,
     E2ees__GroupMember **member_list, size_t member_list_num
 ) {
-    size_t dest_num = 0;
-    size_t i, j, k, l;
-    if (member_info_list_num > 0) {
-        dest_num = 1;
-        for (i = 1; i < member_info_list_num; i++) {
-            E2ees__GroupMemberInfo *member_info = member_info_list[i];
-            bool exist = false;
-            for (j = 0; j < member_info_list_num && j != i; j++) {
-                E2ees__GroupMemberInfo *scan_member_info = member_info_list[j];
-                if (compare_user_id(
-                        member_info->member_address,
-                        scan_member_info->member_address->user->user_id,
-                        scan_member_info->member_address->domain
-                    )
-                ) {
-                    exist = true;
-                    break;
-                }
-            }
-            if (!exist) {
-                dest_num++;
-            }
-        }
-    }
+    group_member_index_t member_index, dest_index;
+    init_group_member_index(&member_index, member_list, member_list_num);
+    init_group_member_index(&dest_index, NULL, 0);
 
-    *dest = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * dest_num);
-    k = 0;
+    size_t i, position;
     for (i = 0; i < member_info_list_num; i++) {
-        E2ees__GroupMemberInfo *member_info = member_info_list[i];
-        bool exist = false;
-        for (j = 0; j < k; j++) {
-            E2ees__GroupMember *scan_member = (*dest)[j];
-            if (compare_user_id(member_info->member_address, scan_member->user_id, scan_member->domain)) {
-                exist = true;
-                break;
-            }
+        E2ees__GroupMember *group_member = member_info_to_group_member(member_info_list[i]);
+        if (group_member == NULL)
+            continue;
+        if (!insert_group_member_into_index(&dest_index, group_member)) {
+            e2ees__group_member__free_unpacked(group_member, NULL);
+            continue;
         }
-        if (!exist) {
-            E2ees__GroupMember *group_member = member_info_to_group_member(member_info);
-            bool role_set = false;
-            for(l = 0; l < member_list_num; l++) {
-                E2ees__GroupMember *scan_member = member_list[l];
-                if (compare_user_id(member_info->member_address, scan_member->user_id, scan_member->domain)) {
-                    group_member->role = scan_member->role;
-                    role_set = true;
-                    break;
-                }
-            }
-            if (!role_set) {
-                e2ees_notify_log(NULL, DEBUG_LOG, "member_info_to_group_members() group member has no member info: %s@%s", group_member->user_id, group_member->domain);
-            }
-            (*dest)[k] = group_member;
-            k++;
+        if (find_group_member_in_index(&member_index, group_member->user_id, group_member->domain, &position)) {
+            group_member->role = member_index.members[position]->role;
+        } else {
+            e2ees_notify_log(NULL, DEBUG_LOG, "member_info_to_group_members() group member has no member info: %s@%s", group_member->user_id, group_member->domain);
         }
     }
 
+    // the collected members are handed over to dest
+    size_t dest_num = dest_index.members_num;
+    *dest = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * dest_num);
+    for (i = 0; i < dest_num; i++) {
+        (*dest)[i] = dest_index.members[i];
+    }
+
+    free_group_member_index(&member_index);
+    free_group_member_index(&dest_index);
+
     // done
     return dest_num;
 }
@@ -720,10 +844,16 @@ void free_e2ee_addresses(E2ees__E2eeAddress ***dest, size_t e2ee_addresses_num)
 }
 
 void free_invite_response_list(E2ees__InviteResponse ***dest, size_t invite_response_num) {
+    if (*dest == NULL) {
+        return;
+    }
     size_t i;
     for (i = 0; i < invite_response_num; i++) {
-        e2ees__invite_response__free_unpacked((*dest)[i], NULL);
-        (*dest)[i] = NULL;
+        // the entry of a skipped or failed invite is left NULL
+        if ((*dest)[i] != NULL) {
+            e2ees__invite_response__free_unpacked((*dest)[i], NULL);
+            (*dest)[i] = NULL;
+        }
     }
     free_mem((void **)&(*dest), sizeof(E2ees__InviteResponse *) * invite_response_num);
 }
@@ -737,6 +867,59 @@ void free_group_members(E2ees__GroupMember ***dest, size_t group_members_num) {
     free_mem((void **)&(*dest), sizeof(E2ees__GroupMember *) * group_members_num);
 }
 
+void free_session_headers(e2ees_session_header_t **dest, size_t session_headers_num) {
+    size_t i;
+    for (i = 0; i < session_headers_num; i++) {
+        e2ees_session_header_t *session_header = &((*dest)[i]);
+        free_string(session_header->session_id);
+        if (session_header->our_address != NULL) {
+            e2ees__e2ee_address__free_unpacked(session_header->our_address, NULL);
+            session_header->our_address = NULL;
+        }
+        if (session_header->their_address != NULL) {
+            e2ees__e2ee_address__free_unpacked(session_header->their_address, NULL);
+            session_header->their_address = NULL;
+        }
+        if (session_header->session != NULL) {
+            e2ees__session__free_unpacked(session_header->session, NULL);
+            session_header->session = NULL;
+        }
+    }
+    free_mem((void **)&(*dest), sizeof(e2ees_session_header_t) * session_headers_num);
+}
+
+void free_pending_plaintext_list(e2ees_pending_plaintext_t **dest, size_t pending_plaintext_num) {
+    size_t i;
+    for (i = 0; i < pending_plaintext_num; i++) {
+        free_mem((void **)&((*dest)[i].plaintext_data), (*dest)[i].plaintext_data_len);
+        (*dest)[i].plaintext_data_len = 0;
+    }
+    free_mem((void **)&(*dest), sizeof(e2ees_pending_plaintext_t) * pending_plaintext_num);
+}
+
+void free_session_establishments(e2ees_session_establishment_t **dest, size_t session_establishments_num) {
+    size_t i;
+    for (i = 0; i < session_establishments_num; i++) {
+        if ((*dest)[i].their_address != NULL) {
+            e2ees__e2ee_address__free_unpacked((*dest)[i].their_address, NULL);
+            (*dest)[i].their_address = NULL;
+        }
+    }
+    free_mem((void **)&(*dest), sizeof(e2ees_session_establishment_t) * session_establishments_num);
+}
+
+void free_account_headers(e2ees_account_header_t **dest, size_t account_headers_num) {
+    size_t i;
+    for (i = 0; i < account_headers_num; i++) {
+        e2ees_account_header_t *account_header = &((*dest)[i]);
+        if (account_header->address != NULL) {
+            e2ees__e2ee_address__free_unpacked(account_header->address, NULL);
+            account_header->address = NULL;
+        }
+    }
+    free_mem((void **)&(*dest), sizeof(e2ees_account_header_t) * account_headers_num);
+}
+
 void free_protobuf(ProtobufCBinaryData *output) {
     if (output != NULL) {
         if (output->data) {
@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MUTEX_H_
+#define MUTEX_H_
+
+/* This header is private to the library like spin_lock.h. */
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <pthread.h>
+#endif
+
+/**
+ * @brief A blocking lock for the state that is kept in the database,
+ * which may be held across the calls to the db handler. The in-memory
+ * caches keep using the spin lock.
+ */
+#if defined(_WIN32)
+typedef SRWLOCK e2ees_mutex_t;
+#else
+typedef pthread_mutex_t e2ees_mutex_t;
+#endif
+
+static inline void e2ees_mutex_init(e2ees_mutex_t *mutex) {
+#if defined(_WIN32)
+    InitializeSRWLock(mutex);
+#else
+    pthread_mutex_init(mutex, NULL);
+#endif
+}
+
+static inline void e2ees_mutex_lock(e2ees_mutex_t *mutex) {
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+static inline void e2ees_mutex_unlock(e2ees_mutex_t *mutex) {
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+static inline void e2ees_mutex_destroy(e2ees_mutex_t *mutex) {
+#if defined(_WIN32)
+    (void)mutex;
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+#endif /* MUTEX_H_ */
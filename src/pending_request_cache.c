@@ -0,0 +1,242 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "e2ees/pending_request_cache.h"
+
+#include <string.h>
+
+#include "e2ees/mem_util.h"
+#include "spin_lock.h"
+
+static pending_request_backoff *pending_request_backoff_list = NULL;
+static pending_request_attempt *pending_request_attempt_list = NULL;
+static pending_request_retry *pending_request_retry_list = NULL;
+static e2ees_spin_lock_t pending_request_cache_lock = E2EES_SPIN_LOCK_INIT;
+
+int64_t get_pending_request_retry_base_ms(uint8_t request_type) {
+    switch (request_type) {
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG:
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_GROUP_MSG:
+        case E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG:
+            // messages and consume-acks are cheap to retry
+            return E2EES_PENDING_REQUEST_RETRY_BASE_MS;
+        default:
+            // key and group management requests are expensive on the server side
+            return E2EES_PENDING_REQUEST_RETRY_BASE_MS * 4;
+    }
+}
+
+static pending_request_backoff *find_pending_request_backoff(E2ees__E2eeAddress *address, uint8_t request_type) {
+    pending_request_backoff *cur = pending_request_backoff_list;
+    while (cur != NULL) {
+        if (cur->request_type == request_type && compare_address(cur->address, address)) {
+            return cur;
+        }
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+bool is_pending_request_type_ready(E2ees__E2eeAddress *address, uint8_t request_type, int64_t now) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_backoff *backoff = find_pending_request_backoff(address, request_type);
+    bool ready = (backoff == NULL || now >= backoff->next_retry_ts);
+    e2ees_spin_unlock(&pending_request_cache_lock);
+    return ready;
+}
+
+void mark_pending_request_type_failed(E2ees__E2eeAddress *address, uint8_t request_type, int64_t now) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_backoff *backoff = find_pending_request_backoff(address, request_type);
+    if (backoff == NULL) {
+        backoff = (pending_request_backoff *)malloc(sizeof(pending_request_backoff));
+        copy_address_from_address(&(backoff->address), address);
+        backoff->request_type = request_type;
+        backoff->failures = 0;
+        backoff->next = pending_request_backoff_list;
+        pending_request_backoff_list = backoff;
+    }
+
+    // exponential backoff: base * 2^(failures - 1), bounded by the max interval
+    int64_t interval = get_pending_request_retry_base_ms(request_type);
+    uint32_t i;
+    for (i = 0; i < backoff->failures && interval < E2EES_PENDING_REQUEST_RETRY_MAX_MS; i++) {
+        interval *= 2;
+    }
+    if (interval > E2EES_PENDING_REQUEST_RETRY_MAX_MS) {
+        interval = E2EES_PENDING_REQUEST_RETRY_MAX_MS;
+    }
+    backoff->failures++;
+    backoff->next_retry_ts = now + interval;
+    e2ees_spin_unlock(&pending_request_cache_lock);
+}
+
+void mark_pending_request_type_succeeded(E2ees__E2eeAddress *address, uint8_t request_type) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_backoff *backoff = find_pending_request_backoff(address, request_type);
+    if (backoff != NULL) {
+        backoff->failures = 0;
+        backoff->next_retry_ts = 0;
+    }
+    e2ees_spin_unlock(&pending_request_cache_lock);
+}
+
+int64_t get_pending_request_next_retry_ts(E2ees__E2eeAddress *address) {
+    int64_t next_retry_ts = INT64_MAX;
+
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_backoff *cur = pending_request_backoff_list;
+    while (cur != NULL) {
+        if (cur->failures > 0 && cur->next_retry_ts < next_retry_ts && compare_address(cur->address, address)) {
+            next_retry_ts = cur->next_retry_ts;
+        }
+        cur = cur->next;
+    }
+    e2ees_spin_unlock(&pending_request_cache_lock);
+
+    return next_retry_ts;
+}
+
+bool mark_pending_request_retry_scheduled(E2ees__E2eeAddress *address) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_retry *cur = pending_request_retry_list;
+    while (cur != NULL) {
+        if (compare_address(cur->address, address)) {
+            e2ees_spin_unlock(&pending_request_cache_lock);
+            return false;
+        }
+        cur = cur->next;
+    }
+    cur = (pending_request_retry *)malloc(sizeof(pending_request_retry));
+    copy_address_from_address(&(cur->address), address);
+    cur->next = pending_request_retry_list;
+    pending_request_retry_list = cur;
+    e2ees_spin_unlock(&pending_request_cache_lock);
+
+    return true;
+}
+
+void clear_pending_request_retry_scheduled(E2ees__E2eeAddress *address) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_retry *prev = NULL;
+    pending_request_retry *cur = pending_request_retry_list;
+    while (cur != NULL) {
+        if (compare_address(cur->address, address)) {
+            if (prev == NULL) {
+                pending_request_retry_list = cur->next;
+            } else {
+                prev->next = cur->next;
+            }
+            e2ees__e2ee_address__free_unpacked(cur->address, NULL);
+            free(cur);
+            break;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+    e2ees_spin_unlock(&pending_request_cache_lock);
+}
+
+static pending_request_attempt *find_pending_request_attempt(const char *request_id) {
+    pending_request_attempt *cur = pending_request_attempt_list;
+    while (cur != NULL) {
+        if (safe_strcmp(cur->request_id, request_id)) {
+            return cur;
+        }
+        cur = cur->next;
+    }
+    return NULL;
+}
+
+uint32_t increase_pending_request_attempts(const char *request_id) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_attempt *attempt = find_pending_request_attempt(request_id);
+    if (attempt == NULL) {
+        attempt = (pending_request_attempt *)malloc(sizeof(pending_request_attempt));
+        attempt->request_id = strdup(request_id);
+        attempt->attempts = 0;
+        attempt->next = pending_request_attempt_list;
+        pending_request_attempt_list = attempt;
+    }
+    uint32_t attempts = ++(attempt->attempts);
+    e2ees_spin_unlock(&pending_request_cache_lock);
+    return attempts;
+}
+
+uint32_t get_pending_request_attempts(const char *request_id) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_attempt *attempt = find_pending_request_attempt(request_id);
+    uint32_t attempts = (attempt == NULL ? 0 : attempt->attempts);
+    e2ees_spin_unlock(&pending_request_cache_lock);
+    return attempts;
+}
+
+void remove_pending_request_attempts(const char *request_id) {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_attempt *prev = NULL;
+    pending_request_attempt *cur = pending_request_attempt_list;
+    while (cur != NULL) {
+        if (safe_strcmp(cur->request_id, request_id)) {
+            if (prev == NULL) {
+                pending_request_attempt_list = cur->next;
+            } else {
+                prev->next = cur->next;
+            }
+            free(cur->request_id);
+            free(cur);
+            break;
+        }
+        prev = cur;
+        cur = cur->next;
+    }
+    e2ees_spin_unlock(&pending_request_cache_lock);
+}
+
+void free_pending_request_cache() {
+    e2ees_spin_lock(&pending_request_cache_lock);
+    pending_request_backoff *cur_backoff = pending_request_backoff_list;
+    pending_request_backoff *temp_backoff;
+    while (cur_backoff != NULL) {
+        temp_backoff = cur_backoff;
+        cur_backoff = cur_backoff->next;
+        e2ees__e2ee_address__free_unpacked(temp_backoff->address, NULL);
+        free(temp_backoff);
+    }
+    pending_request_backoff_list = NULL;
+
+    pending_request_attempt *cur_attempt = pending_request_attempt_list;
+    pending_request_attempt *temp_attempt;
+    while (cur_attempt != NULL) {
+        temp_attempt = cur_attempt;
+        cur_attempt = cur_attempt->next;
+        free(temp_attempt->request_id);
+        free(temp_attempt);
+    }
+    pending_request_attempt_list = NULL;
+
+    pending_request_retry *cur_retry = pending_request_retry_list;
+    pending_request_retry *temp_retry;
+    while (cur_retry != NULL) {
+        temp_retry = cur_retry;
+        cur_retry = cur_retry->next;
+        e2ees__e2ee_address__free_unpacked(temp_retry->address, NULL);
+        free(temp_retry);
+    }
+    pending_request_retry_list = NULL;
+    e2ees_spin_unlock(&pending_request_cache_lock);
+}
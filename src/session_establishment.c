@@ -0,0 +1,190 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "e2ees/session_establishment.h"
+
+#include <string.h>
+
+#include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
+#include "e2ees/mem_util.h"
+#include "e2ees/validation.h"
+
+typedef struct session_establishment_task_t {
+    E2ees__Account *account;
+    e2ees_session_establishment_t *session_establishment;
+} session_establishment_task_t;
+
+static bool is_session_establishment_supported() {
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    return db_handler->store_session_establishment != NULL
+        && db_handler->load_session_establishments != NULL
+        && db_handler->unload_session_establishment != NULL;
+}
+
+void store_session_establishment_step(
+    E2ees__E2eeAddress *our_address,
+    E2ees__E2eeAddress *their_address,
+    e2ees_session_establishment_step_t step
+) {
+    if (!is_session_establishment_supported())
+        return;
+
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    plugin->db_handler.store_session_establishment(
+        our_address, their_address, (uint32_t)step, plugin->common_handler.gen_ts()
+    );
+}
+
+void finish_session_establishment(
+    E2ees__E2eeAddress *our_address,
+    E2ees__E2eeAddress *their_address
+) {
+    if (!is_session_establishment_supported())
+        return;
+
+    get_e2ees_plugin()->db_handler.unload_session_establishment(our_address, their_address);
+}
+
+int advance_session_establishment(
+    E2ees__Account *account,
+    e2ees_session_establishment_t *session_establishment
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    E2ees__E2eeAddress *our_address = NULL;
+    E2ees__E2eeAddress *their_address = NULL;
+    E2ees__Session *outbound_session = NULL;
+
+    if (is_valid_registered_account(account)) {
+        our_address = account->address;
+    } else {
+        e2ees_notify_log(NULL, BAD_ACCOUNT, "advance_session_establishment()");
+        ret = E2EES_RESULT_FAIL;
+    }
+    if (session_establishment != NULL && session_establishment->their_address != NULL
+        && session_establishment->their_address->user != NULL
+    ) {
+        their_address = session_establishment->their_address;
+    } else {
+        e2ees_notify_log(our_address, BAD_ADDRESS, "advance_session_establishment()");
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        e2ees_notify_log(
+            our_address,
+            DEBUG_LOG,
+            "advance_session_establishment(): to [%s:%s], step: %d",
+            their_address->user->user_id,
+            their_address->user->device_id != NULL ? their_address->user->device_id : "",
+            session_establishment->step
+        );
+        if (session_establishment->step == E2EES_SESSION_ESTABLISHMENT_STEP_GET_PRE_KEY_BUNDLE) {
+            // fetch the pre-key bundles again, a failed request is kept as a pending request
+            E2ees__InviteResponse **invite_response_list = NULL;
+            size_t invite_response_num = 0;
+            ret = get_pre_key_bundle_internal(
+                &invite_response_list,
+                &invite_response_num,
+                our_address,
+                account->auth,
+                their_address->user->user_id,
+                their_address->domain,
+                NULL,
+                true,
+                NULL, 0
+            );
+            free_invite_response_list(&invite_response_list, invite_response_num);
+            finish_session_establishment(our_address, their_address);
+        } else {
+            get_e2ees_plugin()->db_handler.load_outbound_session(our_address, their_address, &outbound_session);
+            if (outbound_session == NULL) {
+                // the session has been removed
+                finish_session_establishment(our_address, their_address);
+            } else if (outbound_session->responded) {
+                // the accept message has been consumed, only the pending plaintext is left
+                send_pending_plaintext_data_internal(outbound_session);
+                finish_session_establishment(our_address, their_address);
+            } else if (session_establishment->step == E2EES_SESSION_ESTABLISHMENT_STEP_INVITE) {
+                E2ees__InviteResponse *invite_response = NULL;
+                ret = invite_internal(&invite_response, outbound_session);
+                if (invite_response != NULL)
+                    e2ees__invite_response__free_unpacked(invite_response, NULL);
+            } else {
+                // invite again if we have waited too long for the accept message
+                E2ees__InviteResponse *invite_response = reinvite(outbound_session);
+                if (invite_response != NULL)
+                    e2ees__invite_response__free_unpacked(invite_response, NULL);
+            }
+        }
+    }
+
+    // release
+    if (outbound_session != NULL) {
+        e2ees__session__free_unpacked(outbound_session, NULL);
+    }
+
+    return ret;
+}
+
+static void run_session_establishment_task(void *arg) {
+    session_establishment_task_t *task = (session_establishment_task_t *)arg;
+    advance_session_establishment(task->account, task->session_establishment);
+}
+
+size_t resume_session_establishments(E2ees__Account *account) {
+    if (!is_session_establishment_supported() || account == NULL)
+        return 0;
+
+    e2ees_session_establishment_t *session_establishments = NULL;
+    size_t session_establishments_num = get_e2ees_plugin()->db_handler.load_session_establishments(
+        account->address, &session_establishments
+    );
+    if (session_establishments_num == 0 || session_establishments == NULL)
+        return 0;
+
+    // every session establishment waits on its own peer, so they are advanced independently
+    session_establishment_task_t *tasks = (session_establishment_task_t *)malloc(
+        sizeof(session_establishment_task_t) * session_establishments_num
+    );
+    void **task_args = (void **)malloc(sizeof(void *) * session_establishments_num);
+    size_t i;
+    for (i = 0; i < session_establishments_num; i++) {
+        tasks[i].account = account;
+        tasks[i].session_establishment = &(session_establishments[i]);
+        task_args[i] = &(tasks[i]);
+    }
+    run_tasks_internal(
+        run_session_establishment_task, task_args, session_establishments_num, E2EES_SESSION_ESTABLISHMENT_MAX_WORKERS
+    );
+
+    e2ees_notify_log(
+        account->address,
+        DEBUG_LOG,
+        "resume_session_establishments(): resumed num = %zu",
+        session_establishments_num
+    );
+
+    // release
+    free(task_args);
+    free(tasks);
+    free_session_establishments(&session_establishments, session_establishments_num);
+
+    return session_establishments_num;
+}
@@ -18,6 +18,7 @@
  */
 #include "e2ees/session_manager.h"
 
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -26,69 +27,18 @@
 #include "e2ees/e2ees_client.h"
 #include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/ratchet.h"
 #include "e2ees/validation.h"
 #include "e2ees/session.h"
+#include "e2ees/session_establishment.h"
 
 typedef struct group_address_node {
     E2ees__E2eeAddress *group_address;
     struct group_address_node *next;
 } group_address_node;
 
-static void send_pending_plaintext_data(E2ees__Session *outbound_session) {
-    // load pending plaintext data(may be the group pre-key or the common plaintext)
-    uint32_t pending_plaintext_data_list_num;
-    char **pending_plaintext_id_list;
-    uint8_t **pending_plaintext_data_list;
-    size_t *pending_plaintext_data_len_list;
-    E2ees__NotifLevel *notif_level_list;
-    pending_plaintext_data_list_num =
-        get_e2ees_plugin()->db_handler.load_pending_plaintext_data(
-            outbound_session->our_address,
-            outbound_session->their_address,
-            &pending_plaintext_id_list,
-            &pending_plaintext_data_list,
-            &pending_plaintext_data_len_list,
-            &notif_level_list
-        );
-    if (pending_plaintext_data_list_num > 0) {
-        e2ees_notify_log(
-            outbound_session->our_address,
-            DEBUG_LOG,
-            "send_pending_plaintext_data(): list num = %d",
-            pending_plaintext_data_list_num
-        );
-        uint32_t i;
-        for (i = 0; i < pending_plaintext_data_list_num; i++) {
-            E2ees__SendOne2oneMsgResponse *response = send_one2one_msg_internal(
-                outbound_session,
-                notif_level_list[i],
-                pending_plaintext_data_list[i],
-                pending_plaintext_data_len_list[i]
-            );
-            // always unload
-            get_e2ees_plugin()->db_handler.unload_pending_plaintext_data(
-                outbound_session->our_address, outbound_session->their_address, pending_plaintext_id_list[i]
-            );
-            // release
-            if (response != NULL) {
-                e2ees__send_one2one_msg_response__free_unpacked(response, NULL);
-            }
-        }
-
-        // release
-        for (i = 0; i < pending_plaintext_data_list_num; i++) {
-            free_mem((void **)&(pending_plaintext_data_list[i]), pending_plaintext_data_len_list[i]);
-            free(pending_plaintext_id_list[i]);
-        }
-        free_mem((void **)&pending_plaintext_id_list, sizeof(char *) * pending_plaintext_data_list_num);
-        free_mem((void **)&pending_plaintext_data_list, sizeof(uint8_t *) * pending_plaintext_data_list_num);
-        free_mem((void **)&pending_plaintext_data_len_list, sizeof(size_t) * pending_plaintext_data_list_num);
-        free_mem((void **)&notif_level_list, sizeof(E2ees__NotifLevel) * pending_plaintext_data_list_num);
-    }
-}
-
 int produce_get_pre_key_bundle_request(
     E2ees__GetPreKeyBundleRequest **request_out,
     const char *to_user_id,
@@ -123,6 +73,107 @@ int produce_get_pre_key_bundle_request(
     return ret;
 }
 
+typedef struct pre_key_bundle_verification_task_t {
+    E2ees__PreKeyBundle *pre_key_bundle;
+    ProtobufCBinaryData *server_public_key;
+    atomic_bool *failed;
+} pre_key_bundle_verification_task_t;
+
+/**
+ * Verify the server signature and the signed pre-key signature of a pre-key bundle.
+ */
+static bool verify_pre_key_bundle(E2ees__PreKeyBundle *pre_key_bundle, ProtobufCBinaryData *server_public_key) {
+    if (!is_valid_server_signed_signature(pre_key_bundle->signature)) {
+        e2ees_notify_log(NULL, BAD_SERVER_SIGNATURE, "consume_get_pre_key_bundle_response()");
+        return false;
+    }
+    ds_suite_t *server_ds_suite = get_ds_suite(pre_key_bundle->signature->signing_alg);
+    if (server_ds_suite == NULL
+        || verify_signature_internal(
+            server_ds_suite,
+            pre_key_bundle->signature->signature.data,
+            pre_key_bundle->signature->signature.len,
+            pre_key_bundle->signature->msg_fingerprint.data,
+            pre_key_bundle->signature->msg_fingerprint.len,
+            server_public_key->data
+        ) != E2EES_RESULT_SUCC
+    ) {
+        e2ees_notify_log(NULL, BAD_SERVER_SIGNATURE, "consume_get_pre_key_bundle_response()");
+        return false;
+    }
+
+    if (!is_valid_pre_key_bundle(pre_key_bundle) || !is_valid_e2ees_pack_id(pre_key_bundle->e2ees_pack_id)) {
+        e2ees_notify_log(NULL, BAD_PRE_KEY_BUNDLE, "consume_get_pre_key_bundle_response()");
+        return false;
+    }
+    const cipher_suite_t *cipher_suite = get_e2ees_pack(pre_key_bundle->e2ees_pack_id)->cipher_suite;
+    E2ees__IdentityKeyPublic *their_ik = pre_key_bundle->identity_key_public;
+    E2ees__SignedPreKeyPublic *their_spk = pre_key_bundle->signed_pre_key_public;
+    if (their_ik->sign_public_key.len != cipher_suite->ds_suite->get_crypto_param().sign_pub_key_len
+        || their_spk->public_key.len != cipher_suite->kem_suite->get_crypto_param().asym_pub_key_len
+        || verify_signature_internal(
+            cipher_suite->ds_suite,
+            their_spk->signature.data, their_spk->signature.len,
+            their_spk->public_key.data, their_spk->public_key.len,
+            their_ik->sign_public_key.data
+        ) != E2EES_RESULT_SUCC
+    ) {
+        e2ees_notify_log(pre_key_bundle->user_address, BAD_SIGNATURE, "consume_get_pre_key_bundle_response()");
+        return false;
+    }
+
+    return true;
+}
+
+static void run_pre_key_bundle_verification_task(void *arg) {
+    pre_key_bundle_verification_task_t *task = (pre_key_bundle_verification_task_t *)arg;
+
+    // another bundle has failed, so the whole response will be dropped
+    if (atomic_load(task->failed))
+        return;
+    if (!verify_pre_key_bundle(task->pre_key_bundle, task->server_public_key)) {
+        atomic_store(task->failed, true);
+    }
+}
+
+/**
+ * Verify all of the pre-key bundles on the worker pool, skipping the bundle of the given device.
+ * The verified signatures are cached, so the session suite does not verify them again.
+ */
+static int verify_pre_key_bundles(
+    E2ees__PreKeyBundle **pre_key_bundles,
+    size_t pre_key_bundles_num,
+    E2ees__E2eeAddress *skipped_address,
+    ProtobufCBinaryData *server_public_key
+) {
+    pre_key_bundle_verification_task_t *tasks = (pre_key_bundle_verification_task_t *)malloc(
+        sizeof(pre_key_bundle_verification_task_t) * (pre_key_bundles_num > 0 ? pre_key_bundles_num : 1)
+    );
+    void **task_args = (void **)malloc(sizeof(void *) * (pre_key_bundles_num > 0 ? pre_key_bundles_num : 1));
+    atomic_bool failed;
+    atomic_init(&failed, false);
+    size_t task_num = 0;
+    size_t i;
+
+    for (i = 0; i < pre_key_bundles_num; i++) {
+        if (skipped_address != NULL && compare_address(skipped_address, pre_key_bundles[i]->user_address)) {
+            continue;
+        }
+        tasks[task_num].pre_key_bundle = pre_key_bundles[i];
+        tasks[task_num].server_public_key = server_public_key;
+        tasks[task_num].failed = &failed;
+        task_args[task_num] = &(tasks[task_num]);
+        task_num++;
+    }
+    run_tasks_internal(run_pre_key_bundle_verification_task, task_args, task_num, E2EES_PRE_KEY_BUNDLE_VERIFICATION_MAX_WORKERS);
+
+    // release
+    free(task_args);
+    free(tasks);
+
+    return atomic_load(&failed) ? E2EES_RESULT_FAIL : E2EES_RESULT_SUCC;
+}
+
 int consume_get_pre_key_bundle_response(
     E2ees__InviteResponse ***invite_response_list_out,
     size_t *invite_response_num,
@@ -140,7 +191,6 @@ int consume_get_pre_key_bundle_response(
     uint32_t e2ees_pack_id;
     E2ees__InviteResponse **invite_response_list = NULL;
     int invite_response_ret = E2EES_RESULT_SUCC;    // this parameter may be useful
-    int server_check = E2EES_RESULT_SUCC;
     ProtobufCBinaryData server_public_key = {0, NULL};
     bool is_self = false;
     char *from_user_id = NULL;
@@ -156,10 +206,10 @@ int consume_get_pre_key_bundle_response(
                 if (n_pre_key_bundles > 1) {
                     // pre-key bundles from this and other devices, but we need not invite this device
                     is_self = true;
-                    invite_response_list = (E2ees__InviteResponse **)malloc(sizeof(E2ees__InviteResponse *) * (n_pre_key_bundles - 1));
+                    invite_response_list = (E2ees__InviteResponse **)calloc(n_pre_key_bundles, sizeof(E2ees__InviteResponse *));
                 } else if (n_pre_key_bundles == 1) {
                     if (!compare_address(from, their_pre_key_bundles[0]->user_address)) {
-                        invite_response_list = (E2ees__InviteResponse **)malloc(sizeof(E2ees__InviteResponse *));
+                        invite_response_list = (E2ees__InviteResponse **)calloc(1, sizeof(E2ees__InviteResponse *));
                     } else {
                         ret = E2EES_RESULT_FAIL;
                     }
@@ -168,7 +218,7 @@ int consume_get_pre_key_bundle_response(
                     ret = E2EES_RESULT_FAIL;
                 }
             } else {
-                invite_response_list = (E2ees__InviteResponse **)malloc(sizeof(E2ees__InviteResponse *) * n_pre_key_bundles);
+                invite_response_list = (E2ees__InviteResponse **)calloc(n_pre_key_bundles, sizeof(E2ees__InviteResponse *));
             }
 
             load_server_public_key_from_cache(&server_public_key, from);
@@ -181,43 +231,31 @@ int consume_get_pre_key_bundle_response(
     }
 
     if (ret == E2EES_RESULT_SUCC) {
-        for (i = 0; i < n_pre_key_bundles; i++) {
-            cur_pre_key_bundle = their_pre_key_bundles[i];
-            e2ees_pack_id = cur_pre_key_bundle->e2ees_pack_id;
-            to_address = cur_pre_key_bundle->user_address;
-            // skip if the pre-key bundle is from this device
-            if (is_self) {
-                if (compare_address(from, to_address)) {
-                    continue;
-                }
-            }
-
-            if (is_valid_server_signed_signature(cur_pre_key_bundle->signature)) {
-                ds_suite_t *digital_signature_suite = get_ds_suite(cur_pre_key_bundle->signature->signing_alg);
-                server_check = digital_signature_suite->verify(
-                    cur_pre_key_bundle->signature->signature.data,
-                    cur_pre_key_bundle->signature->signature.len,
-                    cur_pre_key_bundle->signature->msg_fingerprint.data,
-                    cur_pre_key_bundle->signature->msg_fingerprint.len,
-                    server_public_key.data
-                );
+        ret = verify_pre_key_bundles(their_pre_key_bundles, n_pre_key_bundles, is_self ? from : NULL, &server_public_key);
+    }
 
-                if (server_check < E2EES_RESULT_SUCC) {
-                    e2ees_notify_log(NULL, BAD_SERVER_SIGNATURE, "consume_get_pre_key_bundle_response()");
-                    ret = E2EES_RESULT_FAIL;
-                }
-            } else {
-                e2ees_notify_log(NULL, BAD_SERVER_SIGNATURE, "consume_get_pre_key_bundle_response()");
+    if (ret == E2EES_RESULT_SUCC) {
+        // not every e2ees pack implements sessions
+        for (i = 0; i < n_pre_key_bundles; i++) {
+            if (!is_valid_session_suite(get_e2ees_pack(their_pre_key_bundles[i]->e2ees_pack_id)->session_suite)) {
+                e2ees_notify_log(from, BAD_E2EES_PACK, "consume_get_pre_key_bundle_response()");
                 ret = E2EES_RESULT_FAIL;
+                break;
             }
         }
     }
 
     if (ret == E2EES_RESULT_SUCC) {
-        int insert_pos = 0;
+        E2ees__PreKeyBundle **inviting_pre_key_bundles = (E2ees__PreKeyBundle **)malloc(sizeof(E2ees__PreKeyBundle *) * n_pre_key_bundles);
+        size_t inviting_num = 0;
+        bool same_e2ees_pack = true;
+        // the group pre-keys are the same for all devices, so they are stored once by hash
+        uint8_t group_pre_key_hash[SHA256_OUTPUT_LENGTH];
+        if (group_pre_key_plaintext_data != NULL) {
+            crypto_sha256(group_pre_key_plaintext_data, group_pre_key_plaintext_data_len, group_pre_key_hash);
+        }
         for (i = 0; i < n_pre_key_bundles; i++) {
             cur_pre_key_bundle = their_pre_key_bundles[i];
-            e2ees_pack_id = cur_pre_key_bundle->e2ees_pack_id;
             to_address = cur_pre_key_bundle->user_address;
             // skip if the pre-key bundle is from this device
             if (is_self) {
@@ -228,28 +266,48 @@ int consume_get_pre_key_bundle_response(
             // store the group pre-keys if necessary
             if (group_pre_key_plaintext_data != NULL) {
                 e2ees_notify_log(from, DEBUG_LOG, "consume_get_pre_key_bundle_response() store the group pre-keys");
-                char *pending_plaintext_id = generate_uuid_str();
-                get_e2ees_plugin()->db_handler.store_pending_plaintext_data(
+                store_pending_shared_plaintext_data_internal(
                     from,
                     to_address,
-                    pending_plaintext_id,
+                    group_pre_key_hash,
                     group_pre_key_plaintext_data,
                     group_pre_key_plaintext_data_len,
                     E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
                 );
-                // release
-                free(pending_plaintext_id);
-                pending_plaintext_id = NULL;
             }
-            // create an outbound session
-            const session_suite_t *session_suite = get_e2ees_pack(e2ees_pack_id)->session_suite;
-            invite_response_ret = session_suite->new_outbound_session(&(invite_response_list[insert_pos]), from, cur_pre_key_bundle);
-            insert_pos++;
+            if (inviting_num > 0 && cur_pre_key_bundle->e2ees_pack_id != inviting_pre_key_bundles[0]->e2ees_pack_id) {
+                same_e2ees_pack = false;
+            }
+            inviting_pre_key_bundles[inviting_num] = cur_pre_key_bundle;
+            inviting_num++;
+        }
+
+        // create the outbound sessions, all devices at once if the session suite supports it
+        const session_suite_t *session_suite = NULL;
+        if (inviting_num > 0) {
+            session_suite = get_e2ees_pack(inviting_pre_key_bundles[0]->e2ees_pack_id)->session_suite;
+        }
+        if (inviting_num > 1 && same_e2ees_pack && session_suite->new_outbound_sessions != NULL) {
+            session_suite->new_outbound_sessions(invite_response_list, from, inviting_pre_key_bundles, inviting_num);
+        } else {
+            for (i = 0; i < inviting_num; i++) {
+                e2ees_pack_id = inviting_pre_key_bundles[i]->e2ees_pack_id;
+                session_suite = get_e2ees_pack(e2ees_pack_id)->session_suite;
+                invite_response_ret = session_suite->new_outbound_session(&(invite_response_list[i]), from, inviting_pre_key_bundles[i]);
+            }
         }
         *invite_response_list_out = invite_response_list;
         *invite_response_num = n_pre_key_bundles;
+
+        // release
+        free(inviting_pre_key_bundles);
+    } else if (invite_response_list != NULL) {
+        free(invite_response_list);
     }
 
+    // release
+    free_protobuf(&server_public_key);
+
     // done
     return ret;
 }
@@ -449,6 +507,8 @@ bool consume_one2one_msg(E2ees__E2eeAddress *receiver_address, E2ees__E2eeMsg *e
                     e2ees_notify_other_device_msg(receiver_address, e2ee_msg->from, e2ee_msg->to, plaintext->common_sync_msg.data, plaintext->common_sync_msg.len);
                 } else if (plaintext->payload_case == E2EES__PLAINTEXT__PAYLOAD_GROUP_PRE_KEY_BUNDLE) {
                     E2ees__GroupPreKeyBundle *group_pre_key_bundle = plaintext->group_pre_key_bundle;
+                    // the cached inbound group sessions are reloaded after the renewal
+                    flush_group_session_cache(receiver_address);
 
                     // unload the old outbound and inbound group sessions
                     if ((group_pre_key_bundle->old_session_id)[0] != '\0') {
@@ -466,7 +526,7 @@ bool consume_one2one_msg(E2ees__E2eeAddress *receiver_address, E2ees__E2eeMsg *e
                     // try to load the new group sessions
                     E2ees__GroupInfo *cur_group_info = group_pre_key_bundle->group_info;
                     E2ees__GroupSession **inbound_group_sessions = NULL;
-                    size_t inbound_group_sessions_num = get_e2ees_plugin()->db_handler.load_group_sessions(
+                    size_t inbound_group_sessions_num = load_group_sessions_internal(
                         receiver_address, group_pre_key_bundle->group_info->group_address, &inbound_group_sessions
                     );
                     e2ees_notify_log(
@@ -531,27 +591,32 @@ bool consume_one2one_msg(E2ees__E2eeAddress *receiver_address, E2ees__E2eeMsg *e
                 } else if (plaintext->payload_case == E2EES__PLAINTEXT__PAYLOAD_GROUP_UPDATE_KEY_BUNDLE) {
                     E2ees__GroupUpdateKeyBundle *group_update_key_bundle = plaintext->group_update_key_bundle;
 
-                    if (group_update_key_bundle->adding == true) {
-                        // create the outbound group session
-                        new_outbound_group_session_invited(group_update_key_bundle, receiver_address);
+                    if (is_group_chain_checkpoint(group_update_key_bundle)) {
+                        // the sender's chain checkpoint, the inbound group session is kept
+                        consume_group_chain_checkpoint(group_update_key_bundle, e2ee_msg->from, receiver_address);
+                    } else {
+                        if (group_update_key_bundle->adding == true) {
+                            // create the outbound group session
+                            new_outbound_group_session_invited(group_update_key_bundle, receiver_address);
+                            e2ees_notify_log(
+                                receiver_address,
+                                DEBUG_LOG,
+                                "new_outbound_group_session_invited: %s, session_owner: [%s:%s]",
+                                group_update_key_bundle->session_id,
+                                receiver_address->user->user_id,
+                                receiver_address->user->device_id
+                            );
+                        }
+                        new_and_complete_inbound_group_session_with_ratchet_state(group_update_key_bundle, receiver_address);
                         e2ees_notify_log(
                             receiver_address,
                             DEBUG_LOG,
-                            "new_outbound_group_session_invited: %s, session_owner: [%s:%s]",
+                            "new_and_complete_inbound_group_session_with_ratchet_state: %s, session_owner: [%s:%s]",
                             group_update_key_bundle->session_id,
                             receiver_address->user->user_id,
                             receiver_address->user->device_id
                         );
                     }
-                    new_and_complete_inbound_group_session_with_ratchet_state(group_update_key_bundle, receiver_address);
-                    e2ees_notify_log(
-                        receiver_address,
-                        DEBUG_LOG,
-                        "new_and_complete_inbound_group_session_with_ratchet_state: %s, session_owner: [%s:%s]",
-                        group_update_key_bundle->session_id,
-                        receiver_address->user->user_id,
-                        receiver_address->user->device_id
-                    );
                 }
                 e2ees__plaintext__free_unpacked(plaintext, NULL);
                 // success
@@ -817,8 +882,9 @@ bool consume_invite_msg(E2ees__E2eeAddress *receiver_address, E2ees__InviteMsg *
     e2ees_notify_inbound_session_invited(receiver_address, from);
 
     // automatic create inbound session and send accept request
+    // only the one-time pre-key used by the invite is loaded
     E2ees__Account *account = NULL;
-    get_e2ees_plugin()->db_handler.load_account_by_address(to, &account);
+    load_account_without_opks_internal(&account, to);
     if (account == NULL) {
         e2ees_notify_log(receiver_address, BAD_ACCOUNT, "consume_invite_msg()");
         return false;
@@ -826,6 +892,12 @@ bool consume_invite_msg(E2ees__E2eeAddress *receiver_address, E2ees__InviteMsg *
 
     inbound_session = NULL;
     const session_suite_t *session_suite = get_e2ees_pack(e2ees_pack_id)->session_suite;
+    if (!is_valid_session_suite(session_suite)) {
+        e2ees_notify_log(receiver_address, BAD_E2EES_PACK, "consume_invite_msg()");
+        free_proto(account);
+        // just consume it
+        return true;
+    }
     // create a new inbound session
     int result = session_suite->new_inbound_session(&inbound_session, account, invite_msg);
 
@@ -948,14 +1020,22 @@ bool consume_accept_msg(E2ees__E2eeAddress *receiver_address, E2ees__AcceptMsg *
 
     E2ees__Session *outbound_session = NULL;
     const session_suite_t *session_suite = get_e2ees_pack(accept_msg->e2ees_pack_id)->session_suite;
+    if (!is_valid_session_suite(session_suite)) {
+        e2ees_notify_log(receiver_address, BAD_E2EES_PACK, "consume_accept_msg()");
+        // just consume it
+        return true;
+    }
     int result = session_suite->complete_outbound_session(&outbound_session, accept_msg);
 
     if (result == E2EES_RESULT_SUCC) {
+        store_session_establishment_step(receiver_address, accept_msg->from, E2EES_SESSION_ESTABLISHMENT_STEP_SEND_PENDING);
+
         // notify
         e2ees_notify_outbound_session_ready(receiver_address, outbound_session);
 
         // try to send group pre-keys if necessary
-        send_pending_plaintext_data(outbound_session);
+        send_pending_plaintext_data_internal(outbound_session);
+        finish_session_establishment(receiver_address, accept_msg->from);
     }
 
     return result == E2EES_RESULT_SUCC;
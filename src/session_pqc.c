@@ -22,7 +22,6 @@
 #include <string.h>
 
 #include "e2ees/account.h"
-#include "e2ees/account_cache.h"
 #include "e2ees/cipher.h"
 #include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session.h"
@@ -32,16 +31,20 @@
 
 static const char FINGERPRINT_SEED[] = "Fingerprint";
 
-int pqc_new_outbound_session_v2(
-    E2ees__InviteResponse **response_out,
+/**
+ * Verify their pre-key bundle and derive a new outbound session from it. The session is
+ * neither stored nor invited here, so this can run on the worker pool.
+ */
+static int build_pqc_outbound_session(
+    E2ees__Session **outbound_session_out,
+    const cipher_suite_t *cipher_suite,
+    E2ees__IdentityKey *my_identity_key,
     E2ees__E2eeAddress *from,
     E2ees__PreKeyBundle *their_pre_key_bundle
 ) {
     int ret = E2EES_RESULT_SUCC;
 
     uint32_t e2ees_pack_id;
-    cipher_suite_t *cipher_suite = NULL;
-    E2ees__Account *local_account = NULL;
     E2ees__KeyPair *my_identity_key_pair = NULL;
     E2ees__IdentityKeyPublic *their_ik = NULL;
     E2ees__SignedPreKeyPublic *their_spk = NULL;
@@ -49,35 +52,27 @@ int pqc_new_outbound_session_v2(
     uint32_t asym_pub_key_len, sign_pub_key_len, sig_len, kem_ciphertext_len;
     E2ees__E2eeAddress *to = NULL;
     E2ees__Session *outbound_session = NULL;
-    E2ees__InviteResponse *response = NULL;
 
-    if (is_valid_address(from)) {
-        // load the account
-        get_e2ees_plugin()->db_handler.load_account_by_address(from, &local_account);
-        if (is_valid_registered_account(local_account)) {
-            my_identity_key_pair = local_account->identity_key->asym_key_pair;
-            if (is_valid_pre_key_bundle(their_pre_key_bundle)) {
-                e2ees_pack_id = their_pre_key_bundle->e2ees_pack_id;
-                cipher_suite = get_e2ees_pack(e2ees_pack_id)->cipher_suite;
-                to = their_pre_key_bundle->user_address;
-                if (is_valid_cipher_suite(cipher_suite)) {
-                    asym_pub_key_len = cipher_suite->kem_suite->get_crypto_param().asym_pub_key_len;
-                    sign_pub_key_len = cipher_suite->ds_suite->get_crypto_param().sign_pub_key_len;
-                    sig_len = cipher_suite->ds_suite->get_crypto_param().sig_len;
-                    kem_ciphertext_len = cipher_suite->kem_suite->get_crypto_param().kem_ciphertext_len;
-
-                    their_ik = their_pre_key_bundle->identity_key_public;
-                    their_spk = their_pre_key_bundle->signed_pre_key_public;
-                    their_opk = their_pre_key_bundle->one_time_pre_key_public;
-                } else {
-                    ret = E2EES_RESULT_FAIL;
-                }
+    if (is_valid_address(from) && my_identity_key != NULL) {
+        my_identity_key_pair = my_identity_key->asym_key_pair;
+        if (is_valid_pre_key_bundle(their_pre_key_bundle)) {
+            // the cipher suite is resolved by the caller from the e2ees pack of the bundle
+            e2ees_pack_id = their_pre_key_bundle->e2ees_pack_id;
+            to = their_pre_key_bundle->user_address;
+            if (is_valid_cipher_suite(cipher_suite)) {
+                asym_pub_key_len = cipher_suite->kem_suite->get_crypto_param().asym_pub_key_len;
+                sign_pub_key_len = cipher_suite->ds_suite->get_crypto_param().sign_pub_key_len;
+                sig_len = cipher_suite->ds_suite->get_crypto_param().sig_len;
+                kem_ciphertext_len = cipher_suite->kem_suite->get_crypto_param().kem_ciphertext_len;
+
+                their_ik = their_pre_key_bundle->identity_key_public;
+                their_spk = their_pre_key_bundle->signed_pre_key_public;
+                their_opk = their_pre_key_bundle->one_time_pre_key_public;
             } else {
-                e2ees_notify_log(from, BAD_PRE_KEY_BUNDLE, "pqc_new_outbound_session()");
                 ret = E2EES_RESULT_FAIL;
             }
         } else {
-            e2ees_notify_log(from, BAD_ACCOUNT, "pqc_new_outbound_session()");
+            e2ees_notify_log(from, BAD_PRE_KEY_BUNDLE, "pqc_new_outbound_session()");
             ret = E2EES_RESULT_FAIL;
         }
     } else {
@@ -106,8 +101,9 @@ int pqc_new_outbound_session_v2(
     }
 
     if (ret == E2EES_RESULT_SUCC) {
-        // verify the signature
-        ret = cipher_suite->ds_suite->verify(
+        // verify the signature, usually already verified along with the pre-key bundle response
+        ret = verify_signature_internal(
+            cipher_suite->ds_suite,
             their_spk->signature.data, their_spk->signature.len,
             their_spk->public_key.data, asym_pub_key_len,
             their_ik->sign_public_key.data
@@ -217,28 +213,75 @@ int pqc_new_outbound_session_v2(
         e2ees__key_pair__init(outbound_session->alice_base_key);
         cipher_suite->kem_suite->asym_key_gen(&outbound_session->alice_base_key->public_key, &outbound_session->alice_base_key->private_key);
 
-        // store sesson state before send invite
-        e2ees_notify_log(
-            outbound_session->our_address,
-            DEBUG_LOG,
-            "pqc_new_outbound_session() store sesson state before send invite session_id=%s, from [%s:%s], to [%s:%s]",
-            outbound_session->session_id,
-            outbound_session->our_address->user->user_id,
-            outbound_session->our_address->user->device_id,
-            outbound_session->their_address->user->user_id,
-            outbound_session->their_address->user->device_id
-        );
-        outbound_session->invite_t = get_e2ees_plugin()->common_handler.gen_ts();
-        get_e2ees_plugin()->db_handler.store_session(outbound_session);
-
-        // send the invite request to the peer
-        ret = invite_internal(&response, outbound_session);
-
         // release
         unset(secret, sizeof(secret));
+        free_mem((void **)&hash_input, hash_input_len);
         free_protobuf(&ciphertext_2);
         free_protobuf(&ciphertext_3);
         free_protobuf(&ciphertext_4);
+
+        *outbound_session_out = outbound_session;
+    }
+
+    return ret;
+}
+
+static void store_pqc_outbound_session(E2ees__Session *outbound_session) {
+    // store sesson state before send invite
+    e2ees_notify_log(
+        outbound_session->our_address,
+        DEBUG_LOG,
+        "pqc_new_outbound_session() store sesson state before send invite session_id=%s, from [%s:%s], to [%s:%s]",
+        outbound_session->session_id,
+        outbound_session->our_address->user->user_id,
+        outbound_session->our_address->user->device_id,
+        outbound_session->their_address->user->user_id,
+        outbound_session->their_address->user->device_id
+    );
+    outbound_session->invite_t = get_e2ees_plugin()->common_handler.gen_ts();
+    get_e2ees_plugin()->db_handler.store_session(outbound_session);
+}
+
+int pqc_new_outbound_session_v2(
+    E2ees__InviteResponse **response_out,
+    E2ees__E2eeAddress *from,
+    E2ees__PreKeyBundle *their_pre_key_bundle
+) {
+    int ret = E2EES_RESULT_SUCC;
+
+    E2ees__IdentityKey *my_identity_key = NULL;
+    E2ees__Session *outbound_session = NULL;
+    E2ees__InviteResponse *response = NULL;
+
+    if (is_valid_address(from)) {
+        // only the identity key of the account is needed
+        if (load_identity_key_internal(&my_identity_key, from) != E2EES_RESULT_SUCC) {
+            e2ees_notify_log(from, BAD_ACCOUNT, "pqc_new_outbound_session()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    } else {
+        ret = E2EES_RESULT_FAIL;
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        if (is_valid_pre_key_bundle(their_pre_key_bundle)) {
+            ret = build_pqc_outbound_session(
+                &outbound_session, get_e2ees_pack(their_pre_key_bundle->e2ees_pack_id)->cipher_suite,
+                my_identity_key, from, their_pre_key_bundle
+            );
+        } else {
+            e2ees_notify_log(from, BAD_PRE_KEY_BUNDLE, "pqc_new_outbound_session()");
+            ret = E2EES_RESULT_FAIL;
+        }
+    }
+
+    if (ret == E2EES_RESULT_SUCC) {
+        store_pqc_outbound_session(outbound_session);
+
+        // send the invite request to the peer
+        ret = invite_internal(&response, outbound_session);
+
+        // release
         e2ees__session__free_unpacked(outbound_session, NULL);
         outbound_session = NULL;
     }
@@ -247,9 +290,115 @@ int pqc_new_outbound_session_v2(
         *response_out = response;
     }
 
+    // release
+    if (my_identity_key != NULL) {
+        e2ees__identity_key__free_unpacked(my_identity_key, NULL);
+    }
+
     return ret;
 }
 
+typedef struct pqc_outbound_session_task_t {
+    const cipher_suite_t *cipher_suite;
+    E2ees__IdentityKey *my_identity_key;
+    E2ees__E2eeAddress *from;
+    E2ees__PreKeyBundle *their_pre_key_bundle;
+    E2ees__Session *outbound_session;
+} pqc_outbound_session_task_t;
+
+static void run_pqc_outbound_session_task(void *arg) {
+    pqc_outbound_session_task_t *task = (pqc_outbound_session_task_t *)arg;
+    build_pqc_outbound_session(
+        &(task->outbound_session), task->cipher_suite, task->my_identity_key, task->from, task->their_pre_key_bundle
+    );
+}
+
+size_t pqc_new_outbound_sessions(
+    E2ees__InviteResponse **response_list,
+    E2ees__E2eeAddress *from,
+    E2ees__PreKeyBundle **their_pre_key_bundles,
+    size_t their_pre_key_bundles_num
+) {
+    E2ees__IdentityKey *my_identity_key = NULL;
+    const cipher_suite_t *cipher_suite = NULL;
+    pqc_outbound_session_task_t *tasks = NULL;
+    void **task_args = NULL;
+    E2ees__Session **outbound_sessions = NULL;
+    E2ees__InviteResponse **session_responses = NULL;
+    size_t outbound_sessions_num = 0;
+    size_t succ_num = 0;
+    size_t i, j;
+
+    for (i = 0; i < their_pre_key_bundles_num; i++) {
+        response_list[i] = NULL;
+    }
+    if (their_pre_key_bundles_num == 0 || !is_valid_address(from))
+        return 0;
+
+    // the bundles share one e2ees pack, which is resolved once before the workers start
+    for (i = 0; i < their_pre_key_bundles_num; i++) {
+        if (!is_valid_pre_key_bundle(their_pre_key_bundles[i])
+            || their_pre_key_bundles[i]->e2ees_pack_id != their_pre_key_bundles[0]->e2ees_pack_id) {
+            e2ees_notify_log(from, BAD_PRE_KEY_BUNDLE, "pqc_new_outbound_sessions()");
+            return 0;
+        }
+    }
+    cipher_suite = get_e2ees_pack(their_pre_key_bundles[0]->e2ees_pack_id)->cipher_suite;
+
+    // the identity key is loaded once for all of the bundles
+    if (load_identity_key_internal(&my_identity_key, from) != E2EES_RESULT_SUCC) {
+        e2ees_notify_log(from, BAD_ACCOUNT, "pqc_new_outbound_sessions()");
+        return 0;
+    }
+
+    // verify the bundles and run the encapsulations on the worker pool
+    tasks = (pqc_outbound_session_task_t *)malloc(sizeof(pqc_outbound_session_task_t) * their_pre_key_bundles_num);
+    task_args = (void **)malloc(sizeof(void *) * their_pre_key_bundles_num);
+    for (i = 0; i < their_pre_key_bundles_num; i++) {
+        tasks[i].cipher_suite = cipher_suite;
+        tasks[i].my_identity_key = my_identity_key;
+        tasks[i].from = from;
+        tasks[i].their_pre_key_bundle = their_pre_key_bundles[i];
+        tasks[i].outbound_session = NULL;
+        task_args[i] = &(tasks[i]);
+    }
+    run_tasks_internal(
+        run_pqc_outbound_session_task, task_args, their_pre_key_bundles_num, E2EES_SESSION_ESTABLISHMENT_MAX_WORKERS
+    );
+
+    // store the new sessions and invite them in one go
+    outbound_sessions = (E2ees__Session **)malloc(sizeof(E2ees__Session *) * their_pre_key_bundles_num);
+    for (i = 0; i < their_pre_key_bundles_num; i++) {
+        if (tasks[i].outbound_session != NULL) {
+            store_pqc_outbound_session(tasks[i].outbound_session);
+            outbound_sessions[outbound_sessions_num] = tasks[i].outbound_session;
+            outbound_sessions_num++;
+        }
+    }
+    if (outbound_sessions_num > 0) {
+        session_responses = (E2ees__InviteResponse **)malloc(sizeof(E2ees__InviteResponse *) * outbound_sessions_num);
+        succ_num = invite_sessions_internal(session_responses, outbound_sessions, outbound_sessions_num);
+        for (i = 0, j = 0; i < their_pre_key_bundles_num; i++) {
+            if (tasks[i].outbound_session != NULL) {
+                response_list[i] = session_responses[j];
+                j++;
+            }
+        }
+        free(session_responses);
+    }
+
+    // release
+    for (i = 0; i < outbound_sessions_num; i++) {
+        e2ees__session__free_unpacked(outbound_sessions[i], NULL);
+    }
+    free(outbound_sessions);
+    free(task_args);
+    free(tasks);
+    e2ees__identity_key__free_unpacked(my_identity_key, NULL);
+
+    return succ_num;
+}
+
 int pqc_new_inbound_session(
     E2ees__Session **inbound_session_out,
     E2ees__Account *local_account,
@@ -450,23 +599,15 @@ int pqc_complete_outbound_session(E2ees__Session **outbound_session_out, E2ees__
 
     E2ees__Session *session = NULL;
     cipher_suite_t *cipher_suite = NULL;
-    E2ees__Account *account = NULL;
     E2ees__IdentityKey *identity_key = NULL;
     ProtobufCBinaryData their_ratchet_key = {0, NULL};
 
     if (is_valid_accept_msg(msg)) {
         get_e2ees_plugin()->db_handler.load_outbound_session(msg->to, msg->from, &session);
         if (is_valid_uncompleted_session(session)) {
-            load_identity_key_from_cache(&identity_key, session->our_address);
-
-            if (identity_key == NULL) {
-                get_e2ees_plugin()->db_handler.load_account_by_address(session->our_address, &account);
-                if (is_valid_registered_account(account)) {
-                    copy_ik_from_ik(&identity_key, account->identity_key);
-                } else {
-                    e2ees_notify_log(NULL, BAD_ACCOUNT, "pqc_complete_outbound_session()");
-                    ret = E2EES_RESULT_FAIL;
-                }
+            if (load_identity_key_internal(&identity_key, session->our_address) != E2EES_RESULT_SUCC) {
+                e2ees_notify_log(NULL, BAD_ACCOUNT, "pqc_complete_outbound_session()");
+                ret = E2EES_RESULT_FAIL;
             }
         } else {
             e2ees_notify_log(NULL, BAD_SESSION, "pqc_complete_outbound_session()");
@@ -511,7 +652,6 @@ int pqc_complete_outbound_session(E2ees__Session **outbound_session_out, E2ees__
 
     // release
     free_protobuf(&their_ratchet_key);
-    free_proto(account);
     free_proto(identity_key);
 
     // done
@@ -521,5 +661,6 @@ int pqc_complete_outbound_session(E2ees__Session **outbound_session_out, E2ees__
 session_suite_t E2EES_SESSION_PQC = {
     pqc_new_outbound_session_v2,
     pqc_new_inbound_session,
-    pqc_complete_outbound_session
+    pqc_complete_outbound_session,
+    pqc_new_outbound_sessions
 };
@@ -0,0 +1,42 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPIN_LOCK_H_
+#define SPIN_LOCK_H_
+
+/* This header is private to the library, C++ consumers of the installed headers never see the atomics. */
+#include <stdatomic.h>
+
+/**
+ * @brief A minimal lock for the in-memory caches, which may be accessed
+ * by the tasks running on the worker pool of the host.
+ */
+typedef atomic_flag e2ees_spin_lock_t;
+
+#define E2EES_SPIN_LOCK_INIT ATOMIC_FLAG_INIT
+
+static inline void e2ees_spin_lock(e2ees_spin_lock_t *lock) {
+    while (atomic_flag_test_and_set_explicit(lock, memory_order_acquire)) {
+    }
+}
+
+static inline void e2ees_spin_unlock(e2ees_spin_lock_t *lock) {
+    atomic_flag_clear_explicit(lock, memory_order_release);
+}
+
+#endif /* SPIN_LOCK_H_ */
@@ -18,6 +18,8 @@
  */
 #include "e2ees/validation.h"
 
+#include "e2ees/session.h"
+
 ///-----------------accuracy-----------------///
 bool accurate_key_pair(E2ees__KeyPair *key_pair, uint32_t pub_key_len, uint32_t priv_key_len) {
     if (key_pair != NULL) {
@@ -94,6 +96,22 @@ bool is_valid_e2ees_pack_id(uint32_t e2ees_pack_id) {
     return is_valid_cipher_suite(cipher_suite);
 }
 
+bool is_valid_session_suite(const session_suite_t *session_suite) {
+    if (session_suite != NULL) {
+        // new_outbound_sessions is optional
+        if (session_suite->new_outbound_session == NULL)
+            return false;
+        if (session_suite->new_inbound_session == NULL)
+            return false;
+        if (session_suite->complete_outbound_session == NULL)
+            return false;
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
 bool is_valid_protobuf(const ProtobufCBinaryData *src) {
     if (src != NULL) {
         if (src->len == 0 || src->data == NULL) {
@@ -0,0 +1,260 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "e2ees/e2ees_client.h"
+#include "e2ees/mem_util.h"
+#include "mock_server_sending.h"
+#include "test_plugin.h"
+#include "test_util.h"
+
+/**
+ * Large-group benchmark on top of the mock server. For each group size the
+ * latency of create, add, remove, send and receive is measured until all the
+ * fanned out messages have been consumed by the receivers, together with the
+ * peak memory of the process.
+ *
+ * Usage: bench_group [devices ...], by default 100, 1000 and 10000 devices.
+ */
+
+static size_t group_msgs_received = 0;
+
+static void on_log(E2ees__E2eeAddress *user_address, LogCode log_code, const char *log_msg) {
+    if (log_code == 0 || log_code == DEBUG_LOG)
+        return;
+    print_log((char *)log_msg, log_code);
+}
+
+static void on_user_registered(E2ees__Account *account) {}
+
+static void on_inbound_session_invited(E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from) {}
+
+static void on_inbound_session_ready(E2ees__E2eeAddress *user_address, E2ees__Session *inbound_session) {}
+
+static void on_outbound_session_ready(E2ees__E2eeAddress *user_address, E2ees__Session *outbound_session) {}
+
+static void on_one2one_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {}
+
+static void on_other_device_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {}
+
+static void on_group_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *group_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {
+    // only called from the mock server sending thread
+    group_msgs_received++;
+}
+
+static void on_group_created(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num
+) {}
+
+static void on_group_members_added(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num,
+    E2ees__GroupMember **added_group_members, size_t added_group_members_num
+) {}
+
+static void on_group_members_removed(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num,
+    E2ees__GroupMember **removed_group_members, size_t removed_group_members_num
+) {}
+
+static e2ees_event_handler_t bench_event_handler = {
+    on_log,
+    on_user_registered,
+    on_inbound_session_invited,
+    on_inbound_session_ready,
+    on_outbound_session_ready,
+    on_one2one_msg_received,
+    on_other_device_msg_received,
+    on_group_msg_received,
+    on_group_created,
+    on_group_members_added,
+    on_group_members_removed,
+    NULL
+};
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static long max_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static E2ees__E2eeAddress *register_bench_device(uint32_t e2ees_pack_id, size_t i) {
+    char user_name[32], authenticator[64];
+    snprintf(user_name, sizeof(user_name), "bench_%zu", i);
+    snprintf(authenticator, sizeof(authenticator), "bench_%zu@domain.com.tw", i);
+    char *device_id = generate_uuid_str();
+
+    E2ees__RegisterUserResponse *response = NULL;
+    int ret = register_user(&response, e2ees_pack_id, user_name, user_name, device_id, authenticator, "123456");
+    assert(ret == E2EES_RESULT_SUCC);
+
+    E2ees__E2eeAddress *address = NULL;
+    copy_address_from_address(&address, response->address);
+
+    // release
+    free(device_id);
+    e2ees__register_user_response__free_unpacked(response, NULL);
+
+    return address;
+}
+
+static E2ees__GroupMember *new_bench_group_member(E2ees__E2eeAddress *address, E2ees__GroupRole role) {
+    E2ees__GroupMember *member = (E2ees__GroupMember *)malloc(sizeof(E2ees__GroupMember));
+    e2ees__group_member__init(member);
+    member->user_id = strdup(address->user->user_id);
+    member->domain = strdup(address->domain);
+    member->role = role;
+    return member;
+}
+
+static void bench_group(uint32_t e2ees_pack_id, size_t devices_num) {
+    tear_up();
+    get_e2ees_plugin()->event_handler = bench_event_handler;
+    start_mock_server_sending();
+    group_msgs_received = 0;
+
+    // one device per user, the last one joins after the group is created
+    E2ees__E2eeAddress **addresses = (E2ees__E2eeAddress **)malloc(sizeof(E2ees__E2eeAddress *) * devices_num);
+    size_t i;
+    for (i = 0; i < devices_num; i++) {
+        addresses[i] = register_bench_device(e2ees_pack_id, i);
+    }
+    wait_mock_server_sending();
+
+    size_t group_members_num = devices_num - 1;
+    E2ees__GroupMember **group_members = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * group_members_num);
+    group_members[0] = new_bench_group_member(addresses[0], E2EES__GROUP_ROLE__GROUP_ROLE_MANAGER);
+    for (i = 1; i < group_members_num; i++) {
+        group_members[i] = new_bench_group_member(addresses[i], E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER);
+    }
+    E2ees__GroupMember *joining_member = new_bench_group_member(addresses[devices_num - 1], E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER);
+
+    // create
+    double start = now_ms();
+    E2ees__CreateGroupResponse *create_group_response = NULL;
+    int ret = create_group(&create_group_response, addresses[0], "Bench group", group_members, group_members_num);
+    assert(ret == E2EES_RESULT_SUCC);
+    wait_mock_server_sending();
+    double create_ms = now_ms() - start;
+    E2ees__E2eeAddress *group_address = create_group_response->group_address;
+
+    // add
+    start = now_ms();
+    E2ees__AddGroupMembersResponse *add_group_members_response = NULL;
+    ret = add_group_members(&add_group_members_response, addresses[0], group_address, &joining_member, 1);
+    assert(ret == E2EES_RESULT_SUCC);
+    wait_mock_server_sending();
+    double add_ms = now_ms() - start;
+
+    // remove
+    start = now_ms();
+    E2ees__RemoveGroupMembersResponse *remove_group_members_response = NULL;
+    ret = remove_group_members(&remove_group_members_response, addresses[0], group_address, &joining_member, 1);
+    assert(ret == E2EES_RESULT_SUCC);
+    wait_mock_server_sending();
+    double remove_ms = now_ms() - start;
+
+    // send and receive
+    uint8_t plaintext[] = "Benchmark message.";
+    size_t plaintext_len = sizeof(plaintext) - 1;
+    start = now_ms();
+    E2ees__SendGroupMsgResponse *send_group_msg_response = NULL;
+    ret = send_group_msg(
+        &send_group_msg_response, addresses[0], group_address, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL, plaintext, plaintext_len
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+    double send_ms = now_ms() - start;
+    start = now_ms();
+    wait_mock_server_sending();
+    double receive_ms = now_ms() - start;
+    // every remaining member other than the sender decrypts the message
+    assert(group_msgs_received == group_members_num - 1);
+
+    printf(
+        "%8zu %12.1f %12.1f %12.1f %12.1f %12.1f %10zu %12ld\n",
+        devices_num, create_ms, add_ms, remove_ms, send_ms, receive_ms, group_msgs_received, max_rss_kb()
+    );
+
+    // release
+    if (create_group_response != NULL)
+        e2ees__create_group_response__free_unpacked(create_group_response, NULL);
+    if (add_group_members_response != NULL)
+        e2ees__add_group_members_response__free_unpacked(add_group_members_response, NULL);
+    if (remove_group_members_response != NULL)
+        e2ees__remove_group_members_response__free_unpacked(remove_group_members_response, NULL);
+    if (send_group_msg_response != NULL)
+        e2ees__send_group_msg_response__free_unpacked(send_group_msg_response, NULL);
+    e2ees__group_member__free_unpacked(joining_member, NULL);
+    free_group_members(&group_members, group_members_num);
+    free_e2ee_addresses(&addresses, devices_num);
+
+    tear_down();
+}
+
+int main(int argc, char *argv[]) {
+    size_t default_sizes[] = {100, 1000, 10000};
+    size_t sizes_num = argc > 1 ? (size_t)(argc - 1) : sizeof(default_sizes) / sizeof(size_t);
+    size_t *sizes = (size_t *)malloc(sizeof(size_t) * sizes_num);
+    size_t i;
+    for (i = 0; i < sizes_num; i++) {
+        sizes[i] = argc > 1 ? (size_t)strtoul(argv[i + 1], NULL, 10) : default_sizes[i];
+        if (sizes[i] < 3) {
+            printf("a group needs at least 3 devices\n");
+            free(sizes);
+            return 1;
+        }
+    }
+
+    printf(
+        "%8s %12s %12s %12s %12s %12s %10s %12s\n",
+        "devices", "create_ms", "add_ms", "remove_ms", "send_ms", "receive_ms", "received", "max_rss_kb"
+    );
+    for (i = 0; i < sizes_num; i++) {
+        bench_group(gen_e2ees_pack_id_pqc(), sizes[i]);
+    }
+
+    free(sizes);
+    return 0;
+}
@@ -0,0 +1,411 @@
+/*
+ * Copyright © 2021 Academia Sinica. All Rights Reserved.
+ *
+ * This file is part of E2EE Security.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * E2EE Security is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "e2ees/account.h"
+#include "e2ees/e2ees_client.h"
+#include "e2ees/mem_util.h"
+#include "e2ees/validation.h"
+#include "mock_server.h"
+#include "mock_server_sending.h"
+#include "test_plugin.h"
+#include "test_util.h"
+
+/**
+ * Handshake benchmark on top of the mock server. For each (ds, kem) pair an
+ * account is generated, then Alice invites Bob and sends him a first message.
+ * The latency of every step, the bytes of the handshake requests and responses
+ * and the peak memory of the process are printed as a JSON array.
+ *
+ * Usage: bench_handshake [ds kem ...], by default every supported pair.
+ * The ids are the E2EES_PACK_ALG_DS_* and E2EES_PACK_ALG_KEM_* values.
+ * Pairs whose KEM has no session suite, such as curve25519, are skipped.
+ */
+
+typedef struct bench_alg_t {
+    unsigned id;
+    const char *name;
+} bench_alg_t;
+
+static const bench_alg_t bench_ds_algs[] = {
+    {E2EES_PACK_ALG_DS_CURVE25519, "curve25519"},
+    {E2EES_PACK_ALG_DS_MLDSA44, "mldsa44"},
+    {E2EES_PACK_ALG_DS_MLDSA65, "mldsa65"},
+    {E2EES_PACK_ALG_DS_MLDSA87, "mldsa87"},
+    {E2EES_PACK_ALG_DS_FALCON512, "falcon512"},
+    {E2EES_PACK_ALG_DS_FALCON1024, "falcon1024"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_128F, "sphincs_sha2_128f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_128S, "sphincs_sha2_128s"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_192F, "sphincs_sha2_192f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_192S, "sphincs_sha2_192s"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_256F, "sphincs_sha2_256f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHA2_256S, "sphincs_sha2_256s"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_128F, "sphincs_shake_128f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_128S, "sphincs_shake_128s"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_192F, "sphincs_shake_192f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_192S, "sphincs_shake_192s"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_256F, "sphincs_shake_256f"},
+    {E2EES_PACK_ALG_DS_SPHINCS_SHAKE_256S, "sphincs_shake_256s"}
+};
+
+static const bench_alg_t bench_kem_algs[] = {
+    {E2EES_PACK_ALG_KEM_CURVE25519, "curve25519"},
+    {E2EES_PACK_ALG_KEM_HQC128, "hqc128"},
+    {E2EES_PACK_ALG_KEM_HQC192, "hqc192"},
+    {E2EES_PACK_ALG_KEM_HQC256, "hqc256"},
+    {E2EES_PACK_ALG_KEM_MLKEM512, "mlkem512"},
+    {E2EES_PACK_ALG_KEM_MLKEM768, "mlkem768"},
+    {E2EES_PACK_ALG_KEM_MLKEM1024, "mlkem1024"},
+    {E2EES_PACK_ALG_KEM_MCELIECE348864, "mceliece348864"},
+    {E2EES_PACK_ALG_KEM_MCELIECE348864F, "mceliece348864f"},
+    {E2EES_PACK_ALG_KEM_MCELIECE460896, "mceliece460896"},
+    {E2EES_PACK_ALG_KEM_MCELIECE460896F, "mceliece460896f"},
+    {E2EES_PACK_ALG_KEM_MCELIECE6688128, "mceliece6688128"},
+    {E2EES_PACK_ALG_KEM_MCELIECE6688128F, "mceliece6688128f"},
+    {E2EES_PACK_ALG_KEM_MCELIECE6960119, "mceliece6960119"},
+    {E2EES_PACK_ALG_KEM_MCELIECE6960119F, "mceliece6960119f"},
+    {E2EES_PACK_ALG_KEM_MCELIECE8192128, "mceliece8192128"},
+    {E2EES_PACK_ALG_KEM_MCELIECE8192128F, "mceliece8192128f"}
+};
+
+#define BENCH_DS_ALGS_NUM (sizeof(bench_ds_algs) / sizeof(bench_alg_t))
+#define BENCH_KEM_ALGS_NUM (sizeof(bench_kem_algs) / sizeof(bench_alg_t))
+
+// timestamps of one handshake, the handlers may be called from the mock server sending thread
+static double bundle_received_ms = 0;
+static double bundle_verify_ms = 0;
+static double invite_sent_ms = 0;
+static double invite_done_ms = 0;
+static double inbound_ready_ms = 0;
+static double accept_done_ms = 0;
+static double outbound_ready_ms = 0;
+static double msg_sent_ms = 0;
+static double msg_done_ms = 0;
+static double msg_received_ms = 0;
+static size_t handshake_bytes = 0;
+static size_t msg_bytes = 0;
+
+static double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1000000.0;
+}
+
+static long max_rss_kb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static void on_log(E2ees__E2eeAddress *user_address, LogCode log_code, const char *log_msg) {
+    // stdout is kept for the JSON output
+    if (log_code == 0 || log_code == DEBUG_LOG)
+        return;
+    fprintf(stderr, "[ErrorCode=%d]: %s\n", log_code, log_msg);
+}
+
+static void on_user_registered(E2ees__Account *account) {}
+
+static void on_inbound_session_invited(E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from) {}
+
+static void on_inbound_session_ready(E2ees__E2eeAddress *user_address, E2ees__Session *inbound_session) {
+    inbound_ready_ms = now_ms();
+}
+
+static void on_outbound_session_ready(E2ees__E2eeAddress *user_address, E2ees__Session *outbound_session) {
+    outbound_ready_ms = now_ms();
+}
+
+static void on_one2one_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {
+    msg_received_ms = now_ms();
+}
+
+static void on_other_device_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {}
+
+static void on_group_msg_received(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *group_address,
+    uint8_t *plaintext, size_t plaintext_len
+) {}
+
+static void on_group_created(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num
+) {}
+
+static void on_group_members_added(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num,
+    E2ees__GroupMember **added_group_members, size_t added_group_members_num
+) {}
+
+static void on_group_members_removed(
+    E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *group_address, const char *group_name,
+    E2ees__GroupMember **group_members, size_t group_members_num,
+    E2ees__GroupMember **removed_group_members, size_t removed_group_members_num
+) {}
+
+static e2ees_event_handler_t bench_event_handler = {
+    on_log,
+    on_user_registered,
+    on_inbound_session_invited,
+    on_inbound_session_ready,
+    on_outbound_session_ready,
+    on_one2one_msg_received,
+    on_other_device_msg_received,
+    on_group_msg_received,
+    on_group_created,
+    on_group_members_added,
+    on_group_members_removed,
+    NULL
+};
+
+static E2ees__GetPreKeyBundleResponse *bench_get_pre_key_bundle(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__GetPreKeyBundleRequest *request
+) {
+    E2ees__GetPreKeyBundleResponse *response = mock_get_pre_key_bundle(from, auth, request);
+    bundle_received_ms = now_ms();
+    handshake_bytes += e2ees__get_pre_key_bundle_request__get_packed_size(request);
+    if (response == NULL)
+        return NULL;
+    handshake_bytes += e2ees__get_pre_key_bundle_response__get_packed_size(response);
+
+    // the signed pre-key signature is what the client checks for every bundle
+    if (response->n_pre_key_bundles > 0) {
+        E2ees__PreKeyBundle *pre_key_bundle = response->pre_key_bundles[0];
+        E2ees__SignedPreKeyPublic *spk = pre_key_bundle->signed_pre_key_public;
+        const ds_suite_t *ds_suite = get_e2ees_pack(pre_key_bundle->e2ees_pack_id)->cipher_suite->ds_suite;
+        double start = now_ms();
+        ds_suite->verify(
+            spk->signature.data, spk->signature.len, spk->public_key.data, spk->public_key.len,
+            pre_key_bundle->identity_key_public->sign_public_key.data
+        );
+        bundle_verify_ms = now_ms() - start;
+    }
+    return response;
+}
+
+static E2ees__InviteResponse *bench_invite(E2ees__E2eeAddress *from, const char *auth, E2ees__InviteRequest *request) {
+    invite_sent_ms = now_ms();
+    E2ees__InviteResponse *response = mock_invite(from, auth, request);
+    invite_done_ms = now_ms();
+    handshake_bytes += e2ees__invite_request__get_packed_size(request);
+    if (response != NULL)
+        handshake_bytes += e2ees__invite_response__get_packed_size(response);
+    return response;
+}
+
+static E2ees__AcceptResponse *bench_accept(E2ees__E2eeAddress *from, const char *auth, E2ees__AcceptRequest *request) {
+    E2ees__AcceptResponse *response = mock_accept(from, auth, request);
+    accept_done_ms = now_ms();
+    handshake_bytes += e2ees__accept_request__get_packed_size(request);
+    if (response != NULL)
+        handshake_bytes += e2ees__accept_response__get_packed_size(response);
+    return response;
+}
+
+static E2ees__SendOne2oneMsgResponse *bench_send_one2one_msg(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest *request
+) {
+    msg_sent_ms = now_ms();
+    E2ees__SendOne2oneMsgResponse *response = mock_send_one2one_msg(from, auth, request);
+    msg_done_ms = now_ms();
+    msg_bytes += e2ees__send_one2one_msg_request__get_packed_size(request);
+    return response;
+}
+
+static E2ees__E2eeAddress *register_bench_user(uint32_t e2ees_pack_id, const char *user_name) {
+    char authenticator[64];
+    snprintf(authenticator, sizeof(authenticator), "%s@domain.com.tw", user_name);
+    char *device_id = generate_uuid_str();
+
+    E2ees__RegisterUserResponse *response = NULL;
+    int ret = register_user(&response, e2ees_pack_id, user_name, user_name, device_id, authenticator, "123456");
+
+    E2ees__E2eeAddress *address = NULL;
+    if (ret == E2EES_RESULT_SUCC && response != NULL)
+        copy_address_from_address(&address, response->address);
+
+    // release
+    free(device_id);
+    if (response != NULL)
+        e2ees__register_user_response__free_unpacked(response, NULL);
+
+    return address;
+}
+
+static uint32_t bench_e2ees_pack_id(const bench_alg_t *ds, const bench_alg_t *kem) {
+    return gen_e2ees_pack_id_raw(
+        0, ds->id, kem->id, E2EES_PACK_ALG_SE_AES256GCM, E2EES_PACK_ALG_HASH_SHA2_256
+    );
+}
+
+static bool is_bench_pair_supported(const bench_alg_t *ds, const bench_alg_t *kem) {
+    return is_valid_session_suite(get_e2ees_pack(bench_e2ees_pack_id(ds, kem))->session_suite);
+}
+
+static void bench_handshake(const bench_alg_t *ds, const bench_alg_t *kem, bool first) {
+    uint32_t e2ees_pack_id = bench_e2ees_pack_id(ds, kem);
+
+    tear_up();
+    get_e2ees_plugin()->event_handler = bench_event_handler;
+    e2ees_proto_handler_t proto_handler = get_e2ees_plugin()->proto_handler;
+    get_e2ees_plugin()->proto_handler.get_pre_key_bundle = bench_get_pre_key_bundle;
+    get_e2ees_plugin()->proto_handler.invite = bench_invite;
+    get_e2ees_plugin()->proto_handler.accept = bench_accept;
+    get_e2ees_plugin()->proto_handler.send_one2one_msg = bench_send_one2one_msg;
+    start_mock_server_sending();
+
+    bundle_received_ms = bundle_verify_ms = invite_sent_ms = invite_done_ms = 0;
+    inbound_ready_ms = accept_done_ms = outbound_ready_ms = 0;
+    msg_sent_ms = msg_done_ms = msg_received_ms = 0;
+    handshake_bytes = msg_bytes = 0;
+
+    // keygen of a whole account, the identity key, the signed pre-key and the one-time pre-keys
+    double start = now_ms();
+    E2ees__Account *account = NULL;
+    bool ok = create_account(&account, e2ees_pack_id) == E2EES_RESULT_SUCC;
+    double keygen_ms = now_ms() - start;
+    if (account != NULL)
+        e2ees__account__free_unpacked(account, NULL);
+
+    E2ees__E2eeAddress *alice_address = NULL, *bob_address = NULL;
+    if (ok) {
+        alice_address = register_bench_user(e2ees_pack_id, "alice");
+        bob_address = register_bench_user(e2ees_pack_id, "bob");
+        wait_mock_server_sending();
+        ok = alice_address != NULL && bob_address != NULL;
+    }
+
+    // handshake
+    double invite_start_ms = 0;
+    if (ok) {
+        invite_start_ms = now_ms();
+        E2ees__InviteResponse *invite_response = invite(alice_address, bob_address->user->user_id, bob_address->domain);
+        if (invite_response != NULL)
+            e2ees__invite_response__free_unpacked(invite_response, NULL);
+        wait_mock_server_sending();
+        ok = inbound_ready_ms > 0 && outbound_ready_ms > 0;
+    }
+
+    // first message
+    double encrypt_start_ms = 0;
+    if (ok) {
+        uint8_t plaintext[] = "Benchmark message.";
+        encrypt_start_ms = now_ms();
+        E2ees__SendOne2oneMsgResponse *send_response = send_one2one_msg(
+            alice_address, bob_address->user->user_id, bob_address->domain,
+            E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL, plaintext, sizeof(plaintext) - 1
+        );
+        if (send_response != NULL)
+            e2ees__send_one2one_msg_response__free_unpacked(send_response, NULL);
+        wait_mock_server_sending();
+        ok = msg_received_ms > 0;
+    }
+
+    printf(
+        "%s  {\"ds\": \"%s\", \"kem\": \"%s\", \"e2ees_pack_id\": %u, \"ok\": %s, "
+        "\"keygen_ms\": %.3f, \"fetch_bundle_ms\": %.3f, \"verify_bundle_ms\": %.3f, \"outbound_ms\": %.3f, "
+        "\"inbound_ms\": %.3f, \"complete_ms\": %.3f, \"handshake_ms\": %.3f, \"handshake_bytes\": %zu, "
+        "\"encrypt_ms\": %.3f, \"decrypt_ms\": %.3f, \"msg_bytes\": %zu, \"max_rss_kb\": %ld}",
+        first ? "" : ",\n", ds->name, kem->name, e2ees_pack_id, ok ? "true" : "false",
+        keygen_ms,
+        ok ? bundle_received_ms - invite_start_ms : 0,
+        ok ? bundle_verify_ms : 0,
+        ok ? invite_sent_ms - bundle_received_ms : 0,
+        ok ? inbound_ready_ms - invite_done_ms : 0,
+        ok ? outbound_ready_ms - accept_done_ms : 0,
+        ok ? outbound_ready_ms - invite_start_ms : 0,
+        handshake_bytes,
+        ok ? msg_sent_ms - encrypt_start_ms : 0,
+        ok ? msg_received_ms - msg_done_ms : 0,
+        msg_bytes, max_rss_kb()
+    );
+    fflush(stdout);
+
+    // release
+    if (alice_address != NULL)
+        e2ees__e2ee_address__free_unpacked(alice_address, NULL);
+    if (bob_address != NULL)
+        e2ees__e2ee_address__free_unpacked(bob_address, NULL);
+    get_e2ees_plugin()->proto_handler = proto_handler;
+
+    tear_down();
+}
+
+static const bench_alg_t *find_bench_alg(const bench_alg_t *algs, size_t algs_num, unsigned id) {
+    size_t i;
+    for (i = 0; i < algs_num; i++) {
+        if (algs[i].id == id)
+            return &(algs[i]);
+    }
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (argc - 1) % 2 != 0) {
+        fprintf(stderr, "usage: bench_handshake [ds kem ...]\n");
+        return 1;
+    }
+
+    bool first = true;
+    size_t i, j;
+    printf("[\n");
+    if (argc > 1) {
+        for (i = 1; i < (size_t)argc; i += 2) {
+            const bench_alg_t *ds = find_bench_alg(bench_ds_algs, BENCH_DS_ALGS_NUM, (unsigned)strtoul(argv[i], NULL, 10));
+            const bench_alg_t *kem = find_bench_alg(bench_kem_algs, BENCH_KEM_ALGS_NUM, (unsigned)strtoul(argv[i + 1], NULL, 10));
+            if (ds == NULL || kem == NULL) {
+                fprintf(stderr, "unknown pair: %s %s\n", argv[i], argv[i + 1]);
+                continue;
+            }
+            if (!is_bench_pair_supported(ds, kem)) {
+                fprintf(stderr, "no session suite for pair: %s %s\n", ds->name, kem->name);
+                continue;
+            }
+            bench_handshake(ds, kem, first);
+            first = false;
+        }
+    } else {
+        for (i = 0; i < BENCH_DS_ALGS_NUM; i++) {
+            for (j = 0; j < BENCH_KEM_ALGS_NUM; j++) {
+                if (!is_bench_pair_supported(&(bench_ds_algs[i]), &(bench_kem_algs[j])))
+                    continue;
+                bench_handshake(&(bench_ds_algs[i]), &(bench_kem_algs[j]), first);
+                first = false;
+            }
+        }
+    }
+    printf("\n]\n");
+
+    return 0;
+}
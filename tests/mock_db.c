@@ -99,6 +99,7 @@ static const char *SESSION_CREATE_TABLE = "CREATE TABLE SESSION( "
                                           "OUR_ADDRESS INTEGER NOT NULL, "
                                           "THEIR_ADDRESS INTEGER NOT NULL, "
                                           "INVITE_T INTEGER NOT NULL, "
+                                          "RESPONDED INTEGER NOT NULL, "
                                           "DATA BLOB NOT NULL, "
                                           "FOREIGN KEY(OUR_ADDRESS) REFERENCES ADDRESS(ID), "
                                           "FOREIGN KEY(THEIR_ADDRESS) REFERENCES ADDRESS(ID), "
@@ -115,8 +116,8 @@ static const char *SESSION_LOAD_DATA_BY_ADDRESSES = "SELECT DATA FROM SESSION "
                                                     "LIMIT 1;";
 
 static const char *SESSION_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO SESSION "
-                                               "(ID, OUR_ADDRESS, THEIR_ADDRESS, INVITE_T, DATA) "
-                                               "VALUES (?, ?, ?, ?, ?);";
+                                               "(ID, OUR_ADDRESS, THEIR_ADDRESS, INVITE_T, RESPONDED, DATA) "
+                                               "VALUES (?, ?, ?, ?, ?, ?);";
 
 static const char *SESSION_LOAD_DATA_BY_ADDRESS_AND_ID = "SELECT DATA FROM SESSION "
                                                          "INNER JOIN ADDRESS "
@@ -148,6 +149,41 @@ static const char *SESSION_LOAD_OUTBOUND_SESSIONS = "SELECT DATA "
                                                     "AND a1.DEVICE_ID is (?) "
                                                     "AND a2.USER_ID is (?);";
 
+static const char *SESSION_LOAD_OUTBOUND_SESSIONS_OF_OWNER = "SELECT DATA, a2.USER_ID, a2.DOMAIN "
+                                                             "FROM SESSION "
+                                                             "INNER JOIN ADDRESS AS a1 "
+                                                             "ON SESSION.OUR_ADDRESS = a1.ID "
+                                                             "INNER JOIN ADDRESS AS a2 "
+                                                             "ON SESSION.THEIR_ADDRESS = a2.ID "
+                                                             "WHERE a1.DOMAIN is (?) "
+                                                             "AND a1.USER_ID is (?) "
+                                                             "AND a1.DEVICE_ID is (?);";
+
+static const char *SESSION_LOAD_N_OUTBOUND_SESSION_HEADERS = "SELECT COUNT(DISTINCT SESSION.THEIR_ADDRESS) "
+                                                             "FROM SESSION "
+                                                             "INNER JOIN ADDRESS AS a1 "
+                                                             "ON SESSION.OUR_ADDRESS = a1.ID "
+                                                             "INNER JOIN ADDRESS AS a2 "
+                                                             "ON SESSION.THEIR_ADDRESS = a2.ID "
+                                                             "WHERE a1.DOMAIN is (?) "
+                                                             "AND a1.USER_ID is (?) "
+                                                             "AND a1.DEVICE_ID is (?) "
+                                                             "AND a2.USER_ID is (?);";
+
+// the bare columns are taken from the row of MAX(INVITE_T)
+static const char *SESSION_LOAD_OUTBOUND_SESSION_HEADERS = "SELECT SESSION.ID, a2.DOMAIN, a2.USER_ID, a2.DEVICE_ID, "
+                                                           "MAX(SESSION.INVITE_T), SESSION.RESPONDED "
+                                                           "FROM SESSION "
+                                                           "INNER JOIN ADDRESS AS a1 "
+                                                           "ON SESSION.OUR_ADDRESS = a1.ID "
+                                                           "INNER JOIN ADDRESS AS a2 "
+                                                           "ON SESSION.THEIR_ADDRESS = a2.ID "
+                                                           "WHERE a1.DOMAIN is (?) "
+                                                           "AND a1.USER_ID is (?) "
+                                                           "AND a1.DEVICE_ID is (?) "
+                                                           "AND a2.USER_ID is (?) "
+                                                           "GROUP BY SESSION.THEIR_ADDRESS;";
+
 static const char *SESSION_DELETE_DATA_BY_ADDRESSES = "DELETE FROM SESSION "
                                                       "WHERE OUR_ADDRESS IN "
                                                       "(SELECT ID FROM ADDRESS WHERE USER_ID is (?) AND DEVICE_ID is (?)) "
@@ -247,21 +283,257 @@ static const char *GROUP_SESSION_DELETE_DATA_WITH_NO_ID = "DELETE FROM GROUP_SES
                                                           "(SELECT ID FROM ADDRESS WHERE GROUP_ID is (?)) "
                                                           "AND ID is (?);";
 
+static const char *GROUP_INFO_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_INFO;";
+static const char *GROUP_INFO_CREATE_TABLE = "CREATE TABLE GROUP_INFO( "
+                                             "OWNER INTEGER NOT NULL, "
+                                             "ADDRESS INTEGER NOT NULL, "
+                                             "VERSION INTEGER NOT NULL, "
+                                             "GROUP_DATA BLOB NOT NULL, "
+                                             "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                             "FOREIGN KEY(ADDRESS) REFERENCES ADDRESS(ID), "
+                                             "PRIMARY KEY (OWNER, ADDRESS));";
+
+static const char *GROUP_INFO_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO GROUP_INFO "
+                                                  "(OWNER, ADDRESS, VERSION, GROUP_DATA) "
+                                                  "VALUES (?, ?, ?, ?);";
+
+static const char *GROUP_INFO_LOAD = "SELECT VERSION, GROUP_DATA FROM GROUP_INFO "
+                                     "WHERE OWNER is (?) AND ADDRESS is (?);";
+
+static const char *GROUP_INFO_DELTA_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_INFO_DELTA;";
+static const char *GROUP_INFO_DELTA_CREATE_TABLE = "CREATE TABLE GROUP_INFO_DELTA( "
+                                                   "OWNER INTEGER NOT NULL, "
+                                                   "ADDRESS INTEGER NOT NULL, "
+                                                   "VERSION INTEGER NOT NULL, "
+                                                   "ADDED_DATA BLOB NOT NULL, "
+                                                   "REMOVED_DATA BLOB NOT NULL, "
+                                                   "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                   "FOREIGN KEY(ADDRESS) REFERENCES ADDRESS(ID), "
+                                                   "PRIMARY KEY (OWNER, ADDRESS, VERSION));";
+
+static const char *GROUP_INFO_DELTA_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO GROUP_INFO_DELTA "
+                                                        "(OWNER, ADDRESS, VERSION, ADDED_DATA, REMOVED_DATA) "
+                                                        "VALUES (?, ?, ?, ?, ?);";
+
+static const char *N_GROUP_INFO_DELTA_LOAD = "SELECT COUNT(*) FROM GROUP_INFO_DELTA "
+                                             "WHERE OWNER is (?) AND ADDRESS is (?) AND VERSION > (?);";
+
+static const char *GROUP_INFO_DELTA_LOAD = "SELECT ADDED_DATA, REMOVED_DATA FROM GROUP_INFO_DELTA "
+                                           "WHERE OWNER is (?) AND ADDRESS is (?) AND VERSION > (?) "
+                                           "ORDER BY VERSION;";
+
+static const char *GROUP_INFO_DELTA_DELETE_OLD = "DELETE FROM GROUP_INFO_DELTA "
+                                                 "WHERE OWNER is (?) AND ADDRESS is (?) AND VERSION <= (?);";
+
+static const char *GROUP_INFO_DELETE = "DELETE FROM GROUP_INFO "
+                                       "WHERE OWNER is (?) AND ADDRESS is (?);";
+
+static const char *GROUP_INFO_DELTA_DELETE = "DELETE FROM GROUP_INFO_DELTA "
+                                             "WHERE OWNER is (?) AND ADDRESS is (?);";
+
+static const char *GROUP_INFO_DELETE_ORPHAN = "DELETE FROM GROUP_INFO "
+                                              "WHERE OWNER is (?) AND ADDRESS NOT IN "
+                                              "(SELECT ADDRESS FROM GROUP_SESSION WHERE OWNER is (?));";
+
+static const char *GROUP_INFO_DELTA_DELETE_ORPHAN = "DELETE FROM GROUP_INFO_DELTA "
+                                                    "WHERE OWNER is (?) AND ADDRESS NOT IN "
+                                                    "(SELECT ADDRESS FROM GROUP_SESSION WHERE OWNER is (?));";
+
+static const char *GROUP_SESSION_INFO_VERSION_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_SESSION_INFO_VERSION;";
+static const char *GROUP_SESSION_INFO_VERSION_CREATE_TABLE = "CREATE TABLE GROUP_SESSION_INFO_VERSION( "
+                                                             "OWNER INTEGER NOT NULL, "
+                                                             "SESSION_ID TEXT NOT NULL, "
+                                                             "VERSION INTEGER NOT NULL, "
+                                                             "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                             "PRIMARY KEY (OWNER, SESSION_ID));";
+
+static const char *GROUP_SESSION_INFO_VERSION_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO GROUP_SESSION_INFO_VERSION "
+                                                                  "(OWNER, SESSION_ID, VERSION) "
+                                                                  "VALUES (?, ?, ?);";
+
+static const char *GROUP_SESSION_INFO_VERSION_LOAD = "SELECT VERSION FROM GROUP_SESSION_INFO_VERSION "
+                                                     "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_SESSION_INFO_VERSION_DELETE = "DELETE FROM GROUP_SESSION_INFO_VERSION "
+                                                       "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_SESSION_INFO_VERSION_DELETE_BY_ADDRESS = "DELETE FROM GROUP_SESSION_INFO_VERSION "
+                                                                  "WHERE OWNER is (?) AND SESSION_ID IN "
+                                                                  "(SELECT ID FROM GROUP_SESSION WHERE OWNER is (?) AND ADDRESS is (?));";
+
+static const char *GROUP_SESSION_SEQUENCE_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_SESSION_SEQUENCE;";
+static const char *GROUP_SESSION_SEQUENCE_CREATE_TABLE = "CREATE TABLE GROUP_SESSION_SEQUENCE( "
+                                                         "OWNER INTEGER NOT NULL, "
+                                                         "SESSION_ID TEXT NOT NULL, "
+                                                         "SEQUENCE INTEGER NOT NULL, "
+                                                         "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                         "PRIMARY KEY (OWNER, SESSION_ID));";
+
+static const char *GROUP_SESSION_SEQUENCE_RAISE = "INSERT OR REPLACE INTO GROUP_SESSION_SEQUENCE "
+                                                  "(OWNER, SESSION_ID, SEQUENCE) "
+                                                  "VALUES (?1, ?2, MAX(?3, IFNULL("
+                                                  "(SELECT SEQUENCE FROM GROUP_SESSION_SEQUENCE WHERE OWNER is (?1) AND SESSION_ID is (?2)), 0)));";
+
+static const char *GROUP_SESSION_SEQUENCE_LOAD = "SELECT SEQUENCE FROM GROUP_SESSION_SEQUENCE "
+                                                 "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_SESSION_SEQUENCE_DELETE = "DELETE FROM GROUP_SESSION_SEQUENCE "
+                                                   "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_SESSION_SEQUENCE_DELETE_BY_ADDRESS = "DELETE FROM GROUP_SESSION_SEQUENCE "
+                                                              "WHERE OWNER is (?) AND SESSION_ID IN "
+                                                              "(SELECT ID FROM GROUP_SESSION WHERE OWNER is (?) AND ADDRESS is (?));";
+
+static const char *SHARED_GROUP_SESSION_DROP_TABLE = "DROP TABLE IF EXISTS SHARED_GROUP_SESSION;";
+static const char *SHARED_GROUP_SESSION_CREATE_TABLE = "CREATE TABLE SHARED_GROUP_SESSION( "
+                                                       "SESSION_ID TEXT NOT NULL, "
+                                                       "SENDER INTEGER NOT NULL, "
+                                                       "CHAIN_ID BLOB NOT NULL, "
+                                                       "GROUP_DATA BLOB NOT NULL, "
+                                                       "FOREIGN KEY(SENDER) REFERENCES ADDRESS(ID), "
+                                                       "PRIMARY KEY (SESSION_ID, SENDER, CHAIN_ID));";
+
+static const char *GROUP_SESSION_SHARED_REF_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_SESSION_SHARED_REF;";
+static const char *GROUP_SESSION_SHARED_REF_CREATE_TABLE = "CREATE TABLE GROUP_SESSION_SHARED_REF( "
+                                                           "OWNER INTEGER NOT NULL, "
+                                                           "SESSION_ID TEXT NOT NULL, "
+                                                           "SENDER INTEGER NOT NULL, "
+                                                           "CHAIN_ID BLOB NOT NULL, "
+                                                           "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                           "FOREIGN KEY(SENDER) REFERENCES ADDRESS(ID), "
+                                                           "PRIMARY KEY (OWNER, SESSION_ID, SENDER));";
+
+static const char *GROUP_SESSION_SHARED_REF_INSERT_OR_IGNORE = "INSERT OR IGNORE INTO GROUP_SESSION_SHARED_REF "
+                                                               "(OWNER, SESSION_ID, SENDER, CHAIN_ID) "
+                                                               "VALUES (?, ?, ?, ?);";
+
+static const char *SHARED_GROUP_SESSION_INSERT_OR_IGNORE = "INSERT OR IGNORE INTO SHARED_GROUP_SESSION "
+                                                           "(SESSION_ID, SENDER, CHAIN_ID, GROUP_DATA) "
+                                                           "SELECT ?1, ?2, ?3, ?4 WHERE EXISTS "
+                                                           "(SELECT 1 FROM GROUP_SESSION_SHARED_REF "
+                                                           "WHERE OWNER is (?5) AND SESSION_ID is (?1) AND SENDER is (?2) AND CHAIN_ID is (?3));";
+
+static const char *SHARED_GROUP_SESSION_LOAD = "SELECT r.CHAIN_ID, s.GROUP_DATA FROM GROUP_SESSION_SHARED_REF AS r "
+                                               "INNER JOIN SHARED_GROUP_SESSION AS s "
+                                               "ON s.SESSION_ID = r.SESSION_ID AND s.SENDER = r.SENDER AND s.CHAIN_ID = r.CHAIN_ID "
+                                               "WHERE r.OWNER is (?) AND r.SESSION_ID is (?) AND r.SENDER is (?);";
+
+static const char *GROUP_SESSION_SHARED_REF_DELETE = "DELETE FROM GROUP_SESSION_SHARED_REF "
+                                                     "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_SESSION_SHARED_REF_DELETE_BY_ADDRESS = "DELETE FROM GROUP_SESSION_SHARED_REF "
+                                                                "WHERE OWNER is (?) AND SESSION_ID IN "
+                                                                "(SELECT ID FROM GROUP_SESSION WHERE OWNER is (?) AND ADDRESS is (?));";
+
+static const char *SHARED_GROUP_SESSION_DELETE_ORPHAN = "DELETE FROM SHARED_GROUP_SESSION "
+                                                        "WHERE NOT EXISTS (SELECT 1 FROM GROUP_SESSION_SHARED_REF AS r "
+                                                        "WHERE r.SESSION_ID = SHARED_GROUP_SESSION.SESSION_ID "
+                                                        "AND r.SENDER = SHARED_GROUP_SESSION.SENDER "
+                                                        "AND r.CHAIN_ID = SHARED_GROUP_SESSION.CHAIN_ID);";
+
+static const char *GROUP_MSG_SKIPPED_KEY_DROP_TABLE = "DROP TABLE IF EXISTS GROUP_MSG_SKIPPED_KEY;";
+static const char *GROUP_MSG_SKIPPED_KEY_CREATE_TABLE = "CREATE TABLE GROUP_MSG_SKIPPED_KEY( "
+                                                        "OWNER INTEGER NOT NULL, "
+                                                        "SENDER INTEGER NOT NULL, "
+                                                        "SESSION_ID TEXT NOT NULL, "
+                                                        "SEQUENCE INTEGER NOT NULL, "
+                                                        "MSG_KEY BLOB NOT NULL, "
+                                                        "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                        "FOREIGN KEY(SENDER) REFERENCES ADDRESS(ID), "
+                                                        "PRIMARY KEY (OWNER, SENDER, SESSION_ID, SEQUENCE));";
+
+static const char *GROUP_MSG_SKIPPED_KEY_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO GROUP_MSG_SKIPPED_KEY "
+                                                            "(OWNER, SENDER, SESSION_ID, SEQUENCE, MSG_KEY) "
+                                                            "VALUES (?, ?, ?, ?, ?);";
+
+static const char *GROUP_MSG_SKIPPED_KEY_DELETE_OLDEST = "DELETE FROM GROUP_MSG_SKIPPED_KEY "
+                                                         "WHERE OWNER is (?1) AND SENDER is (?2) AND SESSION_ID is (?3) "
+                                                         "AND SEQUENCE NOT IN (SELECT SEQUENCE FROM GROUP_MSG_SKIPPED_KEY "
+                                                         "WHERE OWNER is (?1) AND SENDER is (?2) AND SESSION_ID is (?3) "
+                                                         "ORDER BY SEQUENCE DESC LIMIT (?4));";
+
+static const char *GROUP_MSG_SKIPPED_KEY_LOAD = "SELECT MSG_KEY FROM GROUP_MSG_SKIPPED_KEY "
+                                                "WHERE OWNER is (?) AND SENDER is (?) AND SESSION_ID is (?) AND SEQUENCE is (?);";
+
+static const char *GROUP_MSG_SKIPPED_KEY_DELETE = "DELETE FROM GROUP_MSG_SKIPPED_KEY "
+                                                  "WHERE OWNER is (?) AND SENDER is (?) AND SESSION_ID is (?) AND SEQUENCE is (?);";
+
+static const char *GROUP_MSG_SKIPPED_KEY_DELETE_BY_ID = "DELETE FROM GROUP_MSG_SKIPPED_KEY "
+                                                        "WHERE OWNER is (?) AND SESSION_ID is (?);";
+
+static const char *GROUP_MSG_SKIPPED_KEY_DELETE_BY_ADDRESS = "DELETE FROM GROUP_MSG_SKIPPED_KEY "
+                                                             "WHERE OWNER is (?) AND SESSION_ID IN "
+                                                             "(SELECT ID FROM GROUP_SESSION WHERE OWNER is (?) AND ADDRESS is (?));";
+
 // pending data related
 static const char *PENDING_PLAINTEXT_DATA_DROP_TABLE = "DROP TABLE IF EXISTS PENDING_PLAINTEXT_DATA;";
 static const char *PENDING_PLAINTEXT_DATA_CREATE_TABLE = "CREATE TABLE PENDING_PLAINTEXT_DATA( "
                                                          "PENDING_PLAINTEXT_ID TEXT NOT NULL, "
                                                          "FROM_ADDRESS INTEGER NOT NULL, "
                                                          "TO_ADDRESS INTEGER NOT NULL, "
-                                                         "PLAINTEXT_DATA BLOB NOT NULL, "
+                                                         "SEQ INTEGER NOT NULL, "
+                                                         "PLAINTEXT_DATA BLOB, "
+                                                         "PAYLOAD_HASH BLOB, "
                                                          "NOTIF_LEVEL INTEGER NOT NULL, "
                                                          "FOREIGN KEY(FROM_ADDRESS) REFERENCES ADDRESS(ID), "
                                                          "FOREIGN KEY(TO_ADDRESS) REFERENCES ADDRESS(ID), "
                                                          "PRIMARY KEY (PENDING_PLAINTEXT_ID, FROM_ADDRESS, TO_ADDRESS));";
 
+static const char *PENDING_PAYLOAD_DROP_TABLE = "DROP TABLE IF EXISTS PENDING_PAYLOAD;";
+static const char *PENDING_PAYLOAD_CREATE_TABLE = "CREATE TABLE PENDING_PAYLOAD( "
+                                                  "FROM_ADDRESS INTEGER NOT NULL, "
+                                                  "PAYLOAD_HASH BLOB NOT NULL, "
+                                                  "PAYLOAD BLOB NOT NULL, "
+                                                  "REFCOUNT INTEGER NOT NULL, "
+                                                  "FOREIGN KEY(FROM_ADDRESS) REFERENCES ADDRESS(ID), "
+                                                  "PRIMARY KEY (FROM_ADDRESS, PAYLOAD_HASH));";
+
+static const char *PENDING_PAYLOAD_REF = "INSERT INTO PENDING_PAYLOAD "
+                                         "(FROM_ADDRESS, PAYLOAD_HASH, PAYLOAD, REFCOUNT) "
+                                         "VALUES (?, ?, ?, 1) "
+                                         "ON CONFLICT(FROM_ADDRESS, PAYLOAD_HASH) DO UPDATE SET REFCOUNT = REFCOUNT + 1;";
+
+// release the shared payload together with its last reference
+static const char *PENDING_PAYLOAD_UNREF_TRIGGER = "CREATE TRIGGER PENDING_PAYLOAD_UNREF "
+                                                   "AFTER DELETE ON PENDING_PLAINTEXT_DATA "
+                                                   "WHEN OLD.PAYLOAD_HASH IS NOT NULL "
+                                                   "BEGIN "
+                                                   "UPDATE PENDING_PAYLOAD SET REFCOUNT = REFCOUNT - 1 "
+                                                   "WHERE FROM_ADDRESS = OLD.FROM_ADDRESS AND PAYLOAD_HASH = OLD.PAYLOAD_HASH; "
+                                                   "DELETE FROM PENDING_PAYLOAD "
+                                                   "WHERE FROM_ADDRESS = OLD.FROM_ADDRESS AND PAYLOAD_HASH = OLD.PAYLOAD_HASH "
+                                                   "AND REFCOUNT <= 0; "
+                                                   "END;";
+
+static const char *N_PENDING_PAYLOAD_LOAD = "SELECT COUNT(*) FROM PENDING_PAYLOAD "
+                                            "INNER JOIN ADDRESS "
+                                            "ON PENDING_PAYLOAD.FROM_ADDRESS = ADDRESS.ID "
+                                            "WHERE ADDRESS.DOMAIN is (?) AND ADDRESS.USER_ID is (?) AND ADDRESS.DEVICE_ID is (?);";
+
 static const char *PENDING_PLAINTEXT_DATA_INSERT = "INSERT INTO PENDING_PLAINTEXT_DATA "
-                                                   "(PENDING_PLAINTEXT_ID, FROM_ADDRESS, TO_ADDRESS, PLAINTEXT_DATA, NOTIF_LEVEL) "
-                                                   "VALUES (?, ? ,?, ?, ?);";
+                                                   "(PENDING_PLAINTEXT_ID, FROM_ADDRESS, TO_ADDRESS, PLAINTEXT_DATA, NOTIF_LEVEL, SEQ) "
+                                                   "VALUES (?, ? ,?, ?, ?, ?);";
+
+static const char *PENDING_PLAINTEXT_REF_INSERT = "INSERT INTO PENDING_PLAINTEXT_DATA "
+                                                  "(PENDING_PLAINTEXT_ID, FROM_ADDRESS, TO_ADDRESS, PAYLOAD_HASH, NOTIF_LEVEL, SEQ) "
+                                                  "VALUES (?, ? ,?, ?, ?, ?);";
+
+static const char *PENDING_PLAINTEXT_SEQ_DROP_TABLE = "DROP TABLE IF EXISTS PENDING_PLAINTEXT_SEQ;";
+static const char *PENDING_PLAINTEXT_SEQ_CREATE_TABLE = "CREATE TABLE PENDING_PLAINTEXT_SEQ( "
+                                                        "FROM_ADDRESS INTEGER NOT NULL, "
+                                                        "TO_ADDRESS INTEGER NOT NULL, "
+                                                        "SEQ INTEGER NOT NULL, "
+                                                        "FOREIGN KEY(FROM_ADDRESS) REFERENCES ADDRESS(ID), "
+                                                        "FOREIGN KEY(TO_ADDRESS) REFERENCES ADDRESS(ID), "
+                                                        "PRIMARY KEY (FROM_ADDRESS, TO_ADDRESS));";
+
+static const char *PENDING_PLAINTEXT_SEQ_INCREASE = "INSERT INTO PENDING_PLAINTEXT_SEQ "
+                                                    "(FROM_ADDRESS, TO_ADDRESS, SEQ) "
+                                                    "VALUES (?, ?, 1) "
+                                                    "ON CONFLICT(FROM_ADDRESS, TO_ADDRESS) DO UPDATE SET SEQ = SEQ + 1;";
+
+static const char *PENDING_PLAINTEXT_SEQ_LOAD = "SELECT SEQ FROM PENDING_PLAINTEXT_SEQ "
+                                                "WHERE FROM_ADDRESS is (?) AND TO_ADDRESS is (?);";
 
 static const char *N_PENDING_PLAINTEXT_DATA_LOAD = "SELECT COUNT(*) "
                                                    "FROM PENDING_PLAINTEXT_DATA "
@@ -273,15 +545,43 @@ static const char *N_PENDING_PLAINTEXT_DATA_LOAD = "SELECT COUNT(*) "
                                                    "AND a2.DOMAIN is (?) AND a2.USER_ID is (?) AND a2.DEVICE_ID is (?);";
 
 static const char *PENDING_PLAINTEXT_DATA_LOAD = "SELECT PENDING_PLAINTEXT_ID, "
-                                                 "PLAINTEXT_DATA, "
+                                                 "COALESCE(PLAINTEXT_DATA, PAYLOAD), "
                                                  "NOTIF_LEVEL "
                                                  "FROM PENDING_PLAINTEXT_DATA "
                                                  "INNER JOIN ADDRESS AS a1 "
                                                  "ON PENDING_PLAINTEXT_DATA.FROM_ADDRESS = a1.ID "
                                                  "INNER JOIN ADDRESS AS a2 "
                                                  "ON PENDING_PLAINTEXT_DATA.TO_ADDRESS = a2.ID "
+                                                 "LEFT JOIN PENDING_PAYLOAD "
+                                                 "ON PENDING_PLAINTEXT_DATA.FROM_ADDRESS = PENDING_PAYLOAD.FROM_ADDRESS "
+                                                 "AND PENDING_PLAINTEXT_DATA.PAYLOAD_HASH = PENDING_PAYLOAD.PAYLOAD_HASH "
                                                  "WHERE a1.DOMAIN is (?) AND a1.USER_ID is (?) AND a1.DEVICE_ID is (?) "
-                                                 "AND a2.DOMAIN is (?) AND a2.USER_ID is (?) AND a2.DEVICE_ID is (?);";
+                                                 "AND a2.DOMAIN is (?) AND a2.USER_ID is (?) AND a2.DEVICE_ID is (?) "
+                                                 "ORDER BY PENDING_PLAINTEXT_DATA.SEQ;";
+
+static const char *PENDING_PLAINTEXT_DATA_PAGE_LOAD = "SELECT PENDING_PLAINTEXT_DATA.SEQ, "
+                                                      "COALESCE(PLAINTEXT_DATA, PAYLOAD), "
+                                                      "NOTIF_LEVEL "
+                                                      "FROM PENDING_PLAINTEXT_DATA "
+                                                      "INNER JOIN ADDRESS AS a1 "
+                                                      "ON PENDING_PLAINTEXT_DATA.FROM_ADDRESS = a1.ID "
+                                                      "INNER JOIN ADDRESS AS a2 "
+                                                      "ON PENDING_PLAINTEXT_DATA.TO_ADDRESS = a2.ID "
+                                                      "LEFT JOIN PENDING_PAYLOAD "
+                                                      "ON PENDING_PLAINTEXT_DATA.FROM_ADDRESS = PENDING_PAYLOAD.FROM_ADDRESS "
+                                                      "AND PENDING_PLAINTEXT_DATA.PAYLOAD_HASH = PENDING_PAYLOAD.PAYLOAD_HASH "
+                                                      "WHERE a1.DOMAIN is (?) AND a1.USER_ID is (?) AND a1.DEVICE_ID is (?) "
+                                                      "AND a2.DOMAIN is (?) AND a2.USER_ID is (?) AND a2.DEVICE_ID is (?) "
+                                                      "AND PENDING_PLAINTEXT_DATA.SEQ > (?) "
+                                                      "ORDER BY PENDING_PLAINTEXT_DATA.SEQ "
+                                                      "LIMIT (?);";
+
+static const char *PENDING_PLAINTEXT_DATA_RANGE_DELETE = "DELETE FROM PENDING_PLAINTEXT_DATA "
+                                                         "WHERE FROM_ADDRESS IN "
+                                                         "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
+                                                         "AND TO_ADDRESS IN "
+                                                         "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
+                                                         "AND SEQ >= (?) AND SEQ <= (?);";
 
 static const char *PENDING_PLAINTEXT_DATA_DELETE = "DELETE FROM PENDING_PLAINTEXT_DATA "
                                                    "WHERE FROM_ADDRESS IN "
@@ -290,12 +590,41 @@ static const char *PENDING_PLAINTEXT_DATA_DELETE = "DELETE FROM PENDING_PLAINTEX
                                                    "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
                                                    "AND PENDING_PLAINTEXT_ID is (?);";
 
+// session establishment related
+static const char *SESSION_ESTABLISHMENT_DROP_TABLE = "DROP TABLE IF EXISTS SESSION_ESTABLISHMENT;";
+static const char *SESSION_ESTABLISHMENT_CREATE_TABLE = "CREATE TABLE SESSION_ESTABLISHMENT( "
+                                                        "OWNER INTEGER NOT NULL, "
+                                                        "ADDRESS INTEGER NOT NULL, "
+                                                        "STEP INTEGER NOT NULL, "
+                                                        "UPDATED_TS INTEGER NOT NULL, "
+                                                        "FOREIGN KEY(OWNER) REFERENCES ADDRESS(ID), "
+                                                        "FOREIGN KEY(ADDRESS) REFERENCES ADDRESS(ID), "
+                                                        "PRIMARY KEY (OWNER, ADDRESS));";
+
+static const char *SESSION_ESTABLISHMENT_INSERT_OR_REPLACE = "INSERT OR REPLACE INTO SESSION_ESTABLISHMENT "
+                                                            "(OWNER, ADDRESS, STEP, UPDATED_TS) "
+                                                            "VALUES (?, ?, ?, ?);";
+
+static const char *N_SESSION_ESTABLISHMENT_LOAD = "SELECT COUNT(*) FROM SESSION_ESTABLISHMENT "
+                                                  "WHERE OWNER is (?);";
+
+static const char *SESSION_ESTABLISHMENT_LOAD = "SELECT ADDRESS.DOMAIN, ADDRESS.USER_ID, ADDRESS.DEVICE_ID, STEP, UPDATED_TS "
+                                                "FROM SESSION_ESTABLISHMENT "
+                                                "INNER JOIN ADDRESS "
+                                                "ON SESSION_ESTABLISHMENT.ADDRESS = ADDRESS.ID "
+                                                "WHERE OWNER is (?) "
+                                                "ORDER BY UPDATED_TS;";
+
+static const char *SESSION_ESTABLISHMENT_DELETE = "DELETE FROM SESSION_ESTABLISHMENT "
+                                                  "WHERE OWNER is (?) AND ADDRESS is (?);";
+
 static const char *PENDING_REQUEST_DATA_DROP_TABLE = "DROP TABLE IF EXISTS PENDING_REQUEST_DATA;";
 static const char *PENDING_REQUEST_DATA_CREATE_TABLE = "CREATE TABLE PENDING_REQUEST_DATA( "
                                                        "PENDING_REQUEST_ID TEXT NOT NULL, "
                                                        "UESR_ADDRESS INTEGER NOT NULL, "
                                                        "REQUEST_TYPE INTEGER NOT NULL, "
                                                        "REQUEST_DATA BLOB NOT NULL, "
+                                                       "ATTEMPTS INTEGER NOT NULL DEFAULT 0, "
                                                        "FOREIGN KEY(UESR_ADDRESS) REFERENCES ADDRESS(ID), "
                                                        "PRIMARY KEY (PENDING_REQUEST_ID, UESR_ADDRESS, REQUEST_TYPE));";
 
@@ -326,6 +655,18 @@ static const char *PENDING_REQUEST_DATA_DELETE = "DELETE FROM PENDING_REQUEST_DA
                                                  "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
                                                  "AND PENDING_REQUEST_ID is (?);";
 
+static const char *PENDING_REQUEST_DATA_ADD_ATTEMPT = "UPDATE PENDING_REQUEST_DATA "
+                                                      "SET ATTEMPTS = ATTEMPTS + 1 "
+                                                      "WHERE UESR_ADDRESS IN "
+                                                      "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
+                                                      "AND PENDING_REQUEST_ID is (?);";
+
+static const char *PENDING_REQUEST_DATA_LOAD_ATTEMPTS = "SELECT ATTEMPTS "
+                                                        "FROM PENDING_REQUEST_DATA "
+                                                        "WHERE UESR_ADDRESS IN "
+                                                        "(SELECT ID FROM ADDRESS WHERE DOMAIN is (?) AND USER_ID is (?) AND DEVICE_ID is (?)) "
+                                                        "AND PENDING_REQUEST_ID is (?);";
+
 // account related
 // NOTE: ADDRESS_ID
 static const char *ADDRESS_DROP_TABLE = "DROP TABLE IF EXISTS ADDRESS;";
@@ -413,6 +754,18 @@ static const char *ACCOUNTS_NUM = "SELECT COUNT(*) FROM ACCOUNT;";
 // NOTE: ADDRESS_ID == ADDRESS (INT)
 static const char *ACCOUNT_LOAD_ALL_ADDRESS_ID = "SELECT ADDRESS FROM ACCOUNT;";
 
+static const char *ACCOUNT_LOAD_HEADERS = "SELECT ADDRESS.DOMAIN, "
+                                          "ADDRESS.USER_ID, "
+                                          "ADDRESS.DEVICE_ID, "
+                                          "ACCOUNT.e2ees_pack_id, "
+                                          "(SELECT COUNT(*) FROM PENDING_REQUEST_DATA "
+                                          "WHERE PENDING_REQUEST_DATA.UESR_ADDRESS = ACCOUNT.ADDRESS), "
+                                          "(SELECT COUNT(*) FROM SESSION_ESTABLISHMENT "
+                                          "WHERE SESSION_ESTABLISHMENT.OWNER = ACCOUNT.ADDRESS) "
+                                          "FROM ACCOUNT "
+                                          "INNER JOIN ADDRESS "
+                                          "ON ACCOUNT.ADDRESS = ADDRESS.ID;";
+
 // new
 static const char *LOAD_VERSION_BY_ADDRESS_ID = "SELECT VERSION "
                                                 "FROM ACCOUNT "
@@ -511,6 +864,19 @@ static const char *LOAD_ONETIME_PRE_KEYS_BY_ADDRESS_ID = "SELECT ONETIME_PRE_KEY
                                                          "ON ONETIME_PRE_KEY.KEYPAIR = KEYPAIR.ID "
                                                          "WHERE ACCOUNT.ADDRESS is (?);";
 
+static const char *LOAD_ONETIME_PRE_KEY_PAIR_BY_ADDRESS_ID = "SELECT ONETIME_PRE_KEY.OPK_ID, "
+                                                             "ONETIME_PRE_KEY.USED, "
+                                                             "KEYPAIR.PUBLIC_KEY, "
+                                                             "KEYPAIR.PRIVATE_KEY "
+                                                             "FROM ACCOUNT_ONETIME_PRE_KEY "
+                                                             "INNER JOIN ONETIME_PRE_KEY "
+                                                             "ON ACCOUNT_ONETIME_PRE_KEY.ONETIME_PRE_KEY = "
+                                                             "ONETIME_PRE_KEY.ID "
+                                                             "INNER JOIN KEYPAIR "
+                                                             "ON ONETIME_PRE_KEY.KEYPAIR = KEYPAIR.ID "
+                                                             "WHERE ACCOUNT_ONETIME_PRE_KEY.ADDRESS_ID is (?) AND "
+                                                             "ONETIME_PRE_KEY.OPK_ID is (?);";
+
 // static const char *ACCOUNT_LOAD_ONETIME_PRE_KEY = "SELECT ONETIME_PRE_KEY.ID "
 static const char *LOAD_ONETIME_PRE_KEY_BY_ADDRESS_ID = "SELECT ONETIME_PRE_KEY.ID "
                                                         "FROM ACCOUNT_ONETIME_PRE_KEY "
@@ -525,6 +891,10 @@ static const char *LOAD_NEXT_ONETIME_PRE_KEY_ID_BY_ADDRESS_ID = "SELECT NEXT_ONE
                                                                 "FROM ACCOUNT "
                                                                 "WHERE ADDRESS is (?);";
 
+static const char *RAISE_NEXT_ONETIME_PRE_KEY_ID_BY_ADDRESS_ID = "UPDATE ACCOUNT "
+                                                                 "SET NEXT_ONETIME_PRE_KEY_ID = MAX(NEXT_ONETIME_PRE_KEY_ID, (?2)) "
+                                                                 "WHERE ADDRESS is (?1);";
+
 static const char *LOAD_ADDRESS_ID = "SELECT ADDRESS "
                                      "FROM ACCOUNT "
                                      "INNER JOIN ADDRESS "
@@ -646,9 +1016,34 @@ void mock_db_begin() {
     sqlite_execute(GROUP_SESSION_DROP_TABLE);
     sqlite_execute(GROUP_SESSION_CREATE_TABLE);
 
+    // group_info
+    sqlite_execute(GROUP_INFO_DROP_TABLE);
+    sqlite_execute(GROUP_INFO_CREATE_TABLE);
+    sqlite_execute(GROUP_INFO_DELTA_DROP_TABLE);
+    sqlite_execute(GROUP_INFO_DELTA_CREATE_TABLE);
+    sqlite_execute(GROUP_SESSION_INFO_VERSION_DROP_TABLE);
+    sqlite_execute(GROUP_SESSION_INFO_VERSION_CREATE_TABLE);
+    sqlite_execute(GROUP_SESSION_SEQUENCE_DROP_TABLE);
+    sqlite_execute(GROUP_SESSION_SEQUENCE_CREATE_TABLE);
+    sqlite_execute(SHARED_GROUP_SESSION_DROP_TABLE);
+    sqlite_execute(SHARED_GROUP_SESSION_CREATE_TABLE);
+    sqlite_execute(GROUP_SESSION_SHARED_REF_DROP_TABLE);
+    sqlite_execute(GROUP_SESSION_SHARED_REF_CREATE_TABLE);
+    sqlite_execute(GROUP_MSG_SKIPPED_KEY_DROP_TABLE);
+    sqlite_execute(GROUP_MSG_SKIPPED_KEY_CREATE_TABLE);
+
     // pending_plaintext_data
     sqlite_execute(PENDING_PLAINTEXT_DATA_DROP_TABLE);
     sqlite_execute(PENDING_PLAINTEXT_DATA_CREATE_TABLE);
+    sqlite_execute(PENDING_PLAINTEXT_SEQ_DROP_TABLE);
+    sqlite_execute(PENDING_PLAINTEXT_SEQ_CREATE_TABLE);
+    sqlite_execute(PENDING_PAYLOAD_DROP_TABLE);
+    sqlite_execute(PENDING_PAYLOAD_CREATE_TABLE);
+    sqlite_execute(PENDING_PAYLOAD_UNREF_TRIGGER);
+
+    // session_establishment
+    sqlite_execute(SESSION_ESTABLISHMENT_DROP_TABLE);
+    sqlite_execute(SESSION_ESTABLISHMENT_CREATE_TABLE);
 
     // pending_request_data
     sqlite_execute(PENDING_REQUEST_DATA_DROP_TABLE);
@@ -1006,6 +1401,36 @@ size_t load_one_time_pre_keys(uint64_t address_id, E2ees__OneTimePreKey ***one_t
     return n_one_time_pre_key_list;
 }
 
+void load_one_time_pre_key_pair(uint64_t address_id, uint32_t one_time_pre_key_id, E2ees__OneTimePreKey **one_time_pre_key) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(LOAD_ONETIME_PRE_KEY_PAIR_BY_ADDRESS_ID, &stmt);
+    sqlite3_bind_int64(stmt, 1, address_id);
+    sqlite3_bind_int(stmt, 2, one_time_pre_key_id);
+
+    // step
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        // allocate
+        *one_time_pre_key = (E2ees__OneTimePreKey *)malloc(sizeof(E2ees__OneTimePreKey));
+        e2ees__one_time_pre_key__init(*one_time_pre_key);
+
+        E2ees__KeyPair *key_pair = (E2ees__KeyPair *)malloc(sizeof(E2ees__KeyPair));
+        e2ees__key_pair__init(key_pair);
+        (*one_time_pre_key)->key_pair = key_pair;
+
+        // load
+        (*one_time_pre_key)->opk_id = (uint32_t)sqlite3_column_int(stmt, 0);
+        (*one_time_pre_key)->used = sqlite3_column_int(stmt, 1);
+        copy_protobuf_from_array(&(key_pair->public_key), (uint8_t *)sqlite3_column_blob(stmt, 2), sqlite3_column_bytes(stmt, 2));
+        copy_protobuf_from_array(&(key_pair->private_key), (uint8_t *)sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
+    } else {
+        *one_time_pre_key = NULL;
+    }
+
+    // release
+    sqlite_finalize(stmt);
+}
+
 uint32_t load_next_one_time_pre_key_id(uint64_t address_id) {
     // prepare
     sqlite3_stmt *stmt;
@@ -1414,6 +1839,26 @@ bool add_one_time_pre_key(E2ees__E2eeAddress *address, E2ees__OneTimePreKey *one
     return true;
 }
 
+void update_next_one_time_pre_key_id(E2ees__E2eeAddress *address, uint32_t next_one_time_pre_key_id) {
+    sqlite_int64 address_id;
+    if (!load_address_id(address, &address_id))
+        return;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(RAISE_NEXT_ONETIME_PRE_KEY_ID_BY_ADDRESS_ID, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, address_id);
+    sqlite3_bind_int64(stmt, 2, next_one_time_pre_key_id);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
 static void delete_one_time_pre_key(sqlite_int64 one_time_pre_key_id) {
     // prepare
     sqlite3_stmt *stmt;
@@ -1587,7 +2032,27 @@ void load_auth(E2ees__E2eeAddress *address, char **auth) {
     sqlite_finalize(stmt);
 }
 
-void load_account_by_address(E2ees__E2eeAddress *address, E2ees__Account **account) {
+void load_identity_key(E2ees__E2eeAddress *address, E2ees__IdentityKey **identity_key) {
+    sqlite_int64 address_id;
+    if (load_address_id(address, &address_id) == false) {
+        *identity_key = NULL;
+        return;
+    }
+
+    load_identity_key_pair(address_id, identity_key);
+}
+
+void load_one_time_pre_key(E2ees__E2eeAddress *address, uint32_t one_time_pre_key_id, E2ees__OneTimePreKey **one_time_pre_key) {
+    sqlite_int64 address_id;
+    if (load_address_id(address, &address_id) == false) {
+        *one_time_pre_key = NULL;
+        return;
+    }
+
+    load_one_time_pre_key_pair(address_id, one_time_pre_key_id, one_time_pre_key);
+}
+
+void load_account_without_opks(E2ees__E2eeAddress *address, E2ees__Account **account) {
     sqlite_int64 address_id;
     bool succ = load_address_id(address, &address_id);
     if (succ) {
@@ -1603,12 +2068,20 @@ void load_account_by_address(E2ees__E2eeAddress *address, E2ees__Account **accou
 
         load_signed_pre_key_pair(address_id, &((*account)->signed_pre_key));
         load_identity_key_pair(address_id, &((*account)->identity_key));
-        (*account)->n_one_time_pre_key_list = load_one_time_pre_keys(address_id, &((*account)->one_time_pre_key_list));
         (*account)->next_one_time_pre_key_id = load_next_one_time_pre_key_id(address_id);
     } else {
         *account = NULL;
     }
 }
+
+void load_account_by_address(E2ees__E2eeAddress *address, E2ees__Account **account) {
+    load_account_without_opks(address, account);
+    if (*account != NULL) {
+        sqlite_int64 address_id;
+        load_address_id(address, &address_id);
+        (*account)->n_one_time_pre_key_list = load_one_time_pre_keys(address_id, &((*account)->one_time_pre_key_list));
+    }
+}
 // NOTE:NEW
 size_t load_accounts(E2ees__Account ***accounts) {
     // load all address_ids
@@ -1632,6 +2105,52 @@ size_t load_accounts(E2ees__Account ***accounts) {
     return num;
 }
 
+size_t load_account_headers(e2ees_account_header_t **account_headers) {
+    // count accounts
+    sqlite3_stmt *stmt;
+    sqlite_prepare(ACCOUNTS_NUM, &stmt);
+    sqlite_step(stmt, SQLITE_ROW);
+    size_t num = (size_t)sqlite3_column_int64(stmt, 0);
+    sqlite_finalize(stmt);
+
+    if (num == 0) {
+        *account_headers = NULL;
+        return num;
+    }
+
+    // allocate memory
+    *account_headers = (e2ees_account_header_t *)malloc(sizeof(e2ees_account_header_t) * num);
+
+    // prepare
+    sqlite_prepare(ACCOUNT_LOAD_HEADERS, &stmt);
+
+    // step
+    size_t i = 0;
+    while (i < num && sqlite3_step(stmt) == SQLITE_ROW) {
+        e2ees_account_header_t *account_header = &((*account_headers)[i]);
+        E2ees__E2eeAddress *address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+        e2ees__e2ee_address__init(address);
+        address->user = (E2ees__PeerUser *)malloc(sizeof(E2ees__PeerUser));
+        e2ees__peer_user__init(address->user);
+        address->peer_case = E2EES__E2EE_ADDRESS__PEER_USER;
+        address->domain = strdup((char *)sqlite3_column_text(stmt, 0));
+        address->user->user_id = strdup((char *)sqlite3_column_text(stmt, 1));
+        address->user->device_id = strdup((char *)sqlite3_column_text(stmt, 2));
+
+        account_header->address = address;
+        account_header->e2ees_pack_id = (uint32_t)sqlite3_column_int64(stmt, 3);
+        account_header->pending_request_num = (size_t)sqlite3_column_int64(stmt, 4);
+        account_header->session_establishment_num = (size_t)sqlite3_column_int64(stmt, 5);
+        i++;
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    // done
+    return i;
+}
+
 // session related handlers
 void load_inbound_session(
     char *session_id, E2ees__E2eeAddress *our_address, E2ees__Session **session
@@ -1778,6 +2297,125 @@ size_t load_outbound_sessions(
     return n_outbound_sessions;
 }
 
+size_t load_outbound_sessions_by_users(
+    E2ees__E2eeAddress *our_address,
+    E2ees__GroupMember **their_users, size_t their_users_num,
+    E2ees__Session ***outbound_sessions
+) {
+    size_t n_outbound_sessions = 0, capacity = 0;
+    *outbound_sessions = NULL;
+
+    group_member_index_t user_index;
+    init_group_member_index(&user_index, their_users, their_users_num);
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SESSION_LOAD_OUTBOUND_SESSIONS_OF_OWNER, &stmt);
+    sqlite3_bind_text(stmt, 1, our_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, our_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, our_address->user->device_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *their_user_id = (const char *)sqlite3_column_text(stmt, 1);
+        const char *their_domain = (const char *)sqlite3_column_text(stmt, 2);
+        if (!find_group_member_in_index(&user_index, their_user_id, their_domain, NULL))
+            continue;
+
+        // load
+        size_t session_data_len = sqlite3_column_bytes(stmt, 0);
+        uint8_t *session_data = (uint8_t *)sqlite3_column_blob(stmt, 0);
+
+        // unpack
+        if (n_outbound_sessions == capacity) {
+            capacity = capacity == 0 ? 16 : 2 * capacity;
+            *outbound_sessions = (E2ees__Session **)realloc(*outbound_sessions, capacity * sizeof(E2ees__Session *));
+        }
+        (*outbound_sessions)[n_outbound_sessions++] = e2ees__session__unpack(NULL, session_data_len, session_data);
+    }
+
+    // release
+    sqlite_finalize(stmt);
+    free_group_member_index(&user_index);
+
+    return n_outbound_sessions;
+}
+
+int load_n_outbound_session_headers(
+    E2ees__E2eeAddress *our_address, const char *their_user_id
+) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SESSION_LOAD_N_OUTBOUND_SESSION_HEADERS, &stmt);
+    sqlite3_bind_text(stmt, 1, our_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, our_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, our_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, their_user_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    sqlite_step(stmt, SQLITE_ROW);
+
+    // load
+    int n_outbound_session_headers = (int)sqlite3_column_int(stmt, 0);
+
+    // release
+    sqlite_finalize(stmt);
+
+    return n_outbound_session_headers;
+}
+
+size_t load_outbound_session_headers(
+    E2ees__E2eeAddress *our_address,
+    const char *their_user_id, const char *their_domain,
+    e2ees_session_header_t **session_headers
+) {
+    // allocate memory
+    size_t n_session_headers = load_n_outbound_session_headers(our_address, their_user_id);
+    if (n_session_headers == 0) {
+        *session_headers = NULL;
+        return 0;
+    }
+    (*session_headers) = (e2ees_session_header_t *)malloc(n_session_headers * sizeof(e2ees_session_header_t));
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SESSION_LOAD_OUTBOUND_SESSION_HEADERS, &stmt);
+    sqlite3_bind_text(stmt, 1, our_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, our_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, our_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, their_user_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    for (int i = 0; i < n_session_headers; i++) {
+        sqlite3_step(stmt);
+
+        // load
+        e2ees_session_header_t *session_header = &((*session_headers)[i]);
+        session_header->session_id = strdup((char *)sqlite3_column_text(stmt, 0));
+        copy_address_from_address(&(session_header->our_address), our_address);
+
+        E2ees__E2eeAddress *their_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+        e2ees__e2ee_address__init(their_address);
+        E2ees__PeerUser *peer_user = (E2ees__PeerUser *)malloc(sizeof(E2ees__PeerUser));
+        e2ees__peer_user__init(peer_user);
+        their_address->domain = strdup((char *)sqlite3_column_text(stmt, 1));
+        peer_user->user_id = strdup((char *)sqlite3_column_text(stmt, 2));
+        peer_user->device_id = strdup((char *)sqlite3_column_text(stmt, 3));
+        their_address->peer_case = E2EES__E2EE_ADDRESS__PEER_USER;
+        their_address->user = peer_user;
+        session_header->their_address = their_address;
+
+        session_header->invite_t = (int64_t)sqlite3_column_int64(stmt, 4);
+        session_header->responded = (protobuf_c_boolean)sqlite3_column_int(stmt, 5);
+        session_header->session = NULL;
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    return n_session_headers;
+}
+
 void store_session(E2ees__Session *session) {
     // pack
     char *session_id = session->session_id;
@@ -1798,7 +2436,8 @@ void store_session(E2ees__Session *session) {
     sqlite3_bind_int64(stmt, 2, our_id);
     sqlite3_bind_int64(stmt, 3, their_id);
     sqlite3_bind_int64(stmt, 4, invite_t);
-    sqlite3_bind_blob(stmt, 5, session_data, (int)session_data_len, SQLITE_STATIC);
+    sqlite3_bind_int(stmt, 5, session->responded ? 1 : 0);
+    sqlite3_bind_blob(stmt, 6, session_data, (int)session_data_len, SQLITE_STATIC);
 
     // step
     sqlite_step(stmt, SQLITE_DONE);
@@ -2102,10 +2741,95 @@ void store_group_session(E2ees__GroupSession *group_session) {
     free_mem((void **)&group_session_data, group_session_data_len);
 }
 
+static void unload_group_info_by_address(sqlite_int64 owner_id, sqlite_int64 address_id) {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_INFO_VERSION_DELETE_BY_ADDRESS, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite3_bind_int64(stmt, 3, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    sqlite_prepare(GROUP_INFO_DELETE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    sqlite_prepare(GROUP_INFO_DELTA_DELETE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
+static void unload_group_session_sequences_by_address(sqlite_int64 owner_id, sqlite_int64 address_id) {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_SEQUENCE_DELETE_BY_ADDRESS, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite3_bind_int64(stmt, 3, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
+static void unload_shared_group_session_refs_by_address(sqlite_int64 owner_id, sqlite_int64 address_id) {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_SHARED_REF_DELETE_BY_ADDRESS, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite3_bind_int64(stmt, 3, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
+static void unload_group_msg_skipped_keys_by_address(sqlite_int64 owner_id, sqlite_int64 address_id) {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_MSG_SKIPPED_KEY_DELETE_BY_ADDRESS, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite3_bind_int64(stmt, 3, address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
+static void unload_orphan_shared_group_sessions() {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SHARED_GROUP_SESSION_DELETE_ORPHAN, &stmt);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
+static void unload_orphan_group_info(sqlite_int64 owner_id) {
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_INFO_DELETE_ORPHAN, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    sqlite_prepare(GROUP_INFO_DELTA_DELETE_ORPHAN, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, owner_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+}
+
 void unload_group_session_by_address(
     E2ees__E2eeAddress *session_owner,
     E2ees__E2eeAddress *group_address
 ) {
+    // the group info record, the decrypted sequences and the shared group session references go with the group sessions
+    sqlite_int64 owner_id = address_row_id(session_owner);
+    sqlite_int64 address_id = address_row_id(group_address);
+    if (owner_id != 0 && address_id != 0) {
+        unload_group_info_by_address(owner_id, address_id);
+        unload_group_session_sequences_by_address(owner_id, address_id);
+        unload_shared_group_session_refs_by_address(owner_id, address_id);
+        unload_orphan_shared_group_sessions();
+        unload_group_msg_skipped_keys_by_address(owner_id, address_id);
+    }
+
     // prepare
     sqlite3_stmt *stmt;
     sqlite_prepare(GROUP_SESSION_DELETE_DATA_BY_ADDRESS, &stmt);
@@ -2145,6 +2869,34 @@ void unload_group_session_by_id(
 
     // release
     sqlite_finalize(stmt);
+
+    // drop the group info version, the decrypted sequence, the shared group session reference and the skipped keys of the session,
+    // and the group info and the shared group sessions that nothing refers to
+    sqlite_int64 owner_id = address_row_id(session_owner);
+    if (owner_id == 0)
+        return;
+    sqlite_prepare(GROUP_SESSION_INFO_VERSION_DELETE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+    sqlite_prepare(GROUP_SESSION_SEQUENCE_DELETE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+    sqlite_prepare(GROUP_SESSION_SHARED_REF_DELETE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+    sqlite_prepare(GROUP_MSG_SKIPPED_KEY_DELETE_BY_ID, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+    unload_orphan_group_info(owner_id);
+    unload_orphan_shared_group_sessions();
 }
 
 void unload_group_session_with_no_session_id(
@@ -2173,52 +2925,648 @@ void unload_group_session_with_no_session_id(
     sqlite_finalize(stmt);
 }
 
-void store_pending_plaintext_data(
-    E2ees__E2eeAddress *from_address,
-    E2ees__E2eeAddress *to_address,
-    char *pending_plaintext_id,
-    uint8_t *group_pre_key_plaintext,
-    size_t group_pre_key_plaintext_len,
-    E2ees__NotifLevel notif_level
-) {
-    // insert the sender's and the receiver's address
-    sqlite_int64 from_address_id = insert_address(from_address);
-    sqlite_int64 to_address_id = insert_address(to_address);
+void store_group_info(E2ees__E2eeAddress *owner_address, E2ees__GroupInfo *group_info, uint64_t version) {
+    // pack
+    size_t group_info_data_len = e2ees__group_info__get_packed_size(group_info);
+    uint8_t *group_info_data = (uint8_t *)malloc(group_info_data_len);
+    e2ees__group_info__pack(group_info, group_info_data);
+
+    sqlite_int64 owner_id = insert_address(owner_address);
+    sqlite_int64 address_id = insert_address(group_info->group_address);
 
     // prepare
     sqlite3_stmt *stmt;
-    sqlite_prepare(PENDING_PLAINTEXT_DATA_INSERT, &stmt);
+    sqlite_prepare(GROUP_INFO_INSERT_OR_REPLACE, &stmt);
 
     // bind
-    sqlite3_bind_text(stmt, 1, pending_plaintext_id, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_int64(stmt, 2, from_address_id);
-    sqlite3_bind_int64(stmt, 3, to_address_id);
-    sqlite3_bind_blob(stmt, 4, group_pre_key_plaintext, (int)group_pre_key_plaintext_len, SQLITE_STATIC);
-    sqlite3_bind_int64(stmt, 5, notif_level);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)version);
+    sqlite3_bind_blob(stmt, 4, group_info_data, (int)group_info_data_len, SQLITE_STATIC);
 
     // step
     sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // the deltas before the full record are not needed any more
+    sqlite_prepare(GROUP_INFO_DELTA_DELETE_OLD, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)version);
+    sqlite_step(stmt, SQLITE_DONE);
 
     // release
     sqlite_finalize(stmt);
+    free_mem((void **)&group_info_data, group_info_data_len);
 }
 
-int load_n_group_pre_keys(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address) {
+void store_group_info_delta(
+    E2ees__E2eeAddress *owner_address,
+    uint64_t version,
+    E2ees__GroupInfo *added,
+    E2ees__GroupInfo *removed
+) {
+    // pack
+    size_t added_data_len = e2ees__group_info__get_packed_size(added);
+    uint8_t *added_data = (uint8_t *)malloc(added_data_len);
+    e2ees__group_info__pack(added, added_data);
+    size_t removed_data_len = e2ees__group_info__get_packed_size(removed);
+    uint8_t *removed_data = (uint8_t *)malloc(removed_data_len);
+    e2ees__group_info__pack(removed, removed_data);
+
+    sqlite_int64 owner_id = insert_address(owner_address);
+    sqlite_int64 address_id = insert_address(added->group_address);
+
     // prepare
     sqlite3_stmt *stmt;
-    sqlite_prepare(N_PENDING_PLAINTEXT_DATA_LOAD, &stmt);
-    sqlite3_bind_text(stmt, 1, from_address->domain, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 2, from_address->user->user_id, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 3, from_address->user->device_id, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 4, to_address->domain, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 5, to_address->user->user_id, -1, SQLITE_TRANSIENT);
-    sqlite3_bind_text(stmt, 6, to_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite_prepare(GROUP_INFO_DELTA_INSERT_OR_REPLACE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)version);
+    sqlite3_bind_blob(stmt, 4, added_data, (int)added_data_len, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 5, removed_data, (int)removed_data_len, SQLITE_STATIC);
 
     // step
-    sqlite_step(stmt, SQLITE_ROW);
+    sqlite_step(stmt, SQLITE_DONE);
 
-    // load
-    int n_group_pre_keys = (int)sqlite3_column_int(stmt, 0);
+    // release
+    sqlite_finalize(stmt);
+    free_mem((void **)&added_data, added_data_len);
+    free_mem((void **)&removed_data, removed_data_len);
+}
+
+size_t load_group_info(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *group_address,
+    E2ees__GroupInfo **group_info,
+    uint64_t *version,
+    E2ees__GroupInfo ***added_list,
+    E2ees__GroupInfo ***removed_list
+) {
+    *group_info = NULL;
+    *version = 0;
+    *added_list = NULL;
+    *removed_list = NULL;
+
+    sqlite_int64 owner_id = insert_address(owner_address);
+    sqlite_int64 address_id = insert_address(group_address);
+
+    // load the full record
+    sqlite3_stmt *stmt;
+    if (!sqlite_prepare(GROUP_INFO_LOAD, &stmt)) {
+        return 0;
+    }
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    if (!sqlite_step(stmt, SQLITE_ROW)) {
+        sqlite_finalize(stmt);
+        return 0;
+    }
+    *version = (uint64_t)sqlite3_column_int64(stmt, 0);
+    size_t group_info_data_len = sqlite3_column_bytes(stmt, 1);
+    uint8_t *group_info_data = (uint8_t *)sqlite3_column_blob(stmt, 1);
+    *group_info = e2ees__group_info__unpack(NULL, group_info_data_len, group_info_data);
+    sqlite_finalize(stmt);
+    if (*group_info == NULL) {
+        return 0;
+    }
+
+    // count the deltas after the full record
+    sqlite_prepare(N_GROUP_INFO_DELTA_LOAD, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)(*version));
+    sqlite_step(stmt, SQLITE_ROW);
+    size_t deltas_num = (size_t)sqlite3_column_int(stmt, 0);
+    sqlite_finalize(stmt);
+    if (deltas_num == 0) {
+        return 0;
+    }
+
+    // load the deltas in order
+    *added_list = (E2ees__GroupInfo **)malloc(sizeof(E2ees__GroupInfo *) * deltas_num);
+    *removed_list = (E2ees__GroupInfo **)malloc(sizeof(E2ees__GroupInfo *) * deltas_num);
+    sqlite_prepare(GROUP_INFO_DELTA_LOAD, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)(*version));
+    size_t i;
+    for (i = 0; i < deltas_num; i++) {
+        sqlite_step(stmt, SQLITE_ROW);
+        (*added_list)[i] = e2ees__group_info__unpack(
+            NULL, sqlite3_column_bytes(stmt, 0), (uint8_t *)sqlite3_column_blob(stmt, 0)
+        );
+        (*removed_list)[i] = e2ees__group_info__unpack(
+            NULL, sqlite3_column_bytes(stmt, 1), (uint8_t *)sqlite3_column_blob(stmt, 1)
+        );
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    return deltas_num;
+}
+
+void store_group_session_info_version(E2ees__E2eeAddress *owner_address, const char *session_id, uint64_t version) {
+    sqlite_int64 owner_id = insert_address(owner_address);
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_INFO_VERSION_INSERT_OR_REPLACE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)version);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+uint64_t load_group_session_info_version(E2ees__E2eeAddress *owner_address, const char *session_id) {
+    sqlite_int64 owner_id = address_row_id(owner_address);
+    if (owner_id == 0)
+        return 0;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_INFO_VERSION_LOAD, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    uint64_t version = 0;
+    if (sqlite_step(stmt, SQLITE_ROW))
+        version = (uint64_t)sqlite3_column_int64(stmt, 0);
+
+    // release
+    sqlite_finalize(stmt);
+
+    return version;
+}
+
+void store_group_session_sequence(E2ees__E2eeAddress *owner_address, const char *session_id, uint32_t sequence) {
+    sqlite_int64 owner_id = insert_address(owner_address);
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_SEQUENCE_RAISE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, (sqlite_int64)sequence);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+uint32_t load_group_session_sequence(E2ees__E2eeAddress *owner_address, const char *session_id) {
+    sqlite_int64 owner_id = address_row_id(owner_address);
+    if (owner_id == 0)
+        return 0;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_SEQUENCE_LOAD, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    uint32_t sequence = 0;
+    if (sqlite_step(stmt, SQLITE_ROW))
+        sequence = (uint32_t)sqlite3_column_int64(stmt, 0);
+
+    // release
+    sqlite_finalize(stmt);
+
+    return sequence;
+}
+
+void store_shared_group_session(
+    E2ees__E2eeAddress *owner_address,
+    const ProtobufCBinaryData *chain_id,
+    E2ees__GroupSession *shared_group_session
+) {
+    sqlite_int64 owner_id = insert_address(owner_address);
+    sqlite_int64 sender_id = insert_address(shared_group_session->sender);
+
+    // refer the owner to the chain, a reference that the owner already has is kept
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_SESSION_SHARED_REF_INSERT_OR_IGNORE, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, shared_group_session->session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, sender_id);
+    sqlite3_bind_blob(stmt, 4, chain_id->data, (int)chain_id->len, SQLITE_STATIC);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // pack
+    size_t group_session_data_len = e2ees__group_session__get_packed_size(shared_group_session);
+    uint8_t *group_session_data = (uint8_t *)malloc(group_session_data_len);
+    e2ees__group_session__pack(shared_group_session, group_session_data);
+
+    // the shared part is stored once for the chain the owner refers to
+    sqlite_prepare(SHARED_GROUP_SESSION_INSERT_OR_IGNORE, &stmt);
+    sqlite3_bind_text(stmt, 1, shared_group_session->session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, sender_id);
+    sqlite3_bind_blob(stmt, 3, chain_id->data, (int)chain_id->len, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 4, group_session_data, (int)group_session_data_len, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, owner_id);
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+    free_mem((void **)&group_session_data, group_session_data_len);
+}
+
+void load_shared_group_session(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    ProtobufCBinaryData *chain_id,
+    E2ees__GroupSession **shared_group_session
+) {
+    *shared_group_session = NULL;
+    sqlite_int64 owner_id = address_row_id(owner_address);
+    sqlite_int64 sender_id = address_row_id(sender_address);
+    if (owner_id == 0 || sender_id == 0)
+        return;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SHARED_GROUP_SESSION_LOAD, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_text(stmt, 2, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 3, sender_id);
+
+    // step
+    if (sqlite_step(stmt, SQLITE_ROW)) {
+        size_t chain_id_len = sqlite3_column_bytes(stmt, 0);
+        const uint8_t *chain_id_data = (const uint8_t *)sqlite3_column_blob(stmt, 0);
+        size_t group_session_data_len = sqlite3_column_bytes(stmt, 1);
+        const uint8_t *group_session_data = (const uint8_t *)sqlite3_column_blob(stmt, 1);
+        *shared_group_session = e2ees__group_session__unpack(NULL, group_session_data_len, group_session_data);
+        if (*shared_group_session != NULL) {
+            chain_id->len = chain_id_len;
+            chain_id->data = (uint8_t *)malloc(sizeof(uint8_t) * chain_id_len);
+            memcpy(chain_id->data, chain_id_data, chain_id_len);
+        }
+    }
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+void store_skipped_group_msg_key(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *msg_key
+) {
+    sqlite_int64 owner_id = insert_address(owner_address);
+    sqlite_int64 sender_id = insert_address(sender_address);
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_MSG_SKIPPED_KEY_INSERT_OR_REPLACE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, sender_id);
+    sqlite3_bind_text(stmt, 3, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 4, (sqlite_int64)sequence);
+    sqlite3_bind_blob(stmt, 5, msg_key->data, (int)msg_key->len, SQLITE_STATIC);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // keep the keys of the last sequences only
+    sqlite_prepare(GROUP_MSG_SKIPPED_KEY_DELETE_OLDEST, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, sender_id);
+    sqlite3_bind_text(stmt, 3, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 4, E2EES_GROUP_MSG_MAX_SKIPPED_KEYS);
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+bool take_skipped_group_msg_key(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    uint32_t sequence,
+    ProtobufCBinaryData *msg_key_out
+) {
+    sqlite_int64 owner_id = address_row_id(owner_address);
+    sqlite_int64 sender_id = address_row_id(sender_address);
+    if (owner_id == 0 || sender_id == 0)
+        return false;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(GROUP_MSG_SKIPPED_KEY_LOAD, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, sender_id);
+    sqlite3_bind_text(stmt, 3, session_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 4, (sqlite_int64)sequence);
+
+    // step
+    bool found = sqlite_step(stmt, SQLITE_ROW);
+    if (found) {
+        msg_key_out->len = sqlite3_column_bytes(stmt, 0);
+        msg_key_out->data = (uint8_t *)malloc(sizeof(uint8_t) * msg_key_out->len);
+        memcpy(msg_key_out->data, sqlite3_column_blob(stmt, 0), msg_key_out->len);
+    }
+    sqlite_finalize(stmt);
+
+    // a key is used once
+    if (found) {
+        sqlite_prepare(GROUP_MSG_SKIPPED_KEY_DELETE, &stmt);
+        sqlite3_bind_int64(stmt, 1, owner_id);
+        sqlite3_bind_int64(stmt, 2, sender_id);
+        sqlite3_bind_text(stmt, 3, session_id, -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 4, (sqlite_int64)sequence);
+        sqlite_step(stmt, SQLITE_DONE);
+        sqlite_finalize(stmt);
+    }
+
+    return found;
+}
+
+static sqlite_int64 next_pending_plaintext_seq(sqlite_int64 from_address_id, sqlite_int64 to_address_id) {
+    // increase
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_PLAINTEXT_SEQ_INCREASE, &stmt);
+    sqlite3_bind_int64(stmt, 1, from_address_id);
+    sqlite3_bind_int64(stmt, 2, to_address_id);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // load
+    sqlite_int64 seq = 0;
+    sqlite_prepare(PENDING_PLAINTEXT_SEQ_LOAD, &stmt);
+    sqlite3_bind_int64(stmt, 1, from_address_id);
+    sqlite3_bind_int64(stmt, 2, to_address_id);
+    if (sqlite_step(stmt, SQLITE_ROW))
+        seq = (sqlite_int64)sqlite3_column_int64(stmt, 0);
+
+    // release
+    sqlite_finalize(stmt);
+
+    return seq;
+}
+
+static void insert_pending_plaintext_data(
+    sqlite_int64 from_address_id,
+    sqlite_int64 to_address_id,
+    sqlite_int64 seq,
+    char *pending_plaintext_id,
+    uint8_t *group_pre_key_plaintext,
+    size_t group_pre_key_plaintext_len,
+    E2ees__NotifLevel notif_level
+) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_PLAINTEXT_DATA_INSERT, &stmt);
+
+    // bind
+    sqlite3_bind_text(stmt, 1, pending_plaintext_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, from_address_id);
+    sqlite3_bind_int64(stmt, 3, to_address_id);
+    sqlite3_bind_blob(stmt, 4, group_pre_key_plaintext, (int)group_pre_key_plaintext_len, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, notif_level);
+    sqlite3_bind_int64(stmt, 6, seq);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+void store_pending_plaintext_data(
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *to_address,
+    char *pending_plaintext_id,
+    uint8_t *group_pre_key_plaintext,
+    size_t group_pre_key_plaintext_len,
+    E2ees__NotifLevel notif_level
+) {
+    // insert the sender's and the receiver's address
+    sqlite_int64 from_address_id = insert_address(from_address);
+    sqlite_int64 to_address_id = insert_address(to_address);
+
+    insert_pending_plaintext_data(
+        from_address_id, to_address_id, next_pending_plaintext_seq(from_address_id, to_address_id),
+        pending_plaintext_id, group_pre_key_plaintext, group_pre_key_plaintext_len, notif_level
+    );
+}
+
+uint64_t append_pending_plaintext_data(
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext_data,
+    size_t plaintext_data_len,
+    E2ees__NotifLevel notif_level
+) {
+    // insert the sender's and the receiver's address
+    sqlite_int64 from_address_id = insert_address(from_address);
+    sqlite_int64 to_address_id = insert_address(to_address);
+
+    sqlite_int64 seq = next_pending_plaintext_seq(from_address_id, to_address_id);
+    if (seq <= 0)
+        return 0;
+
+    // the sequence number is unique for the pair of addresses
+    char pending_plaintext_id[32];
+    snprintf(pending_plaintext_id, sizeof(pending_plaintext_id), "%lld", (long long)seq);
+
+    insert_pending_plaintext_data(
+        from_address_id, to_address_id, seq,
+        pending_plaintext_id, plaintext_data, plaintext_data_len, notif_level
+    );
+
+    return (uint64_t)seq;
+}
+
+uint64_t append_pending_payload_ref(
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *to_address,
+    const uint8_t *payload_hash,
+    size_t payload_hash_len,
+    uint8_t *payload,
+    size_t payload_len,
+    E2ees__NotifLevel notif_level
+) {
+    // insert the sender's and the receiver's address
+    sqlite_int64 from_address_id = insert_address(from_address);
+    sqlite_int64 to_address_id = insert_address(to_address);
+
+    sqlite_int64 seq = next_pending_plaintext_seq(from_address_id, to_address_id);
+    if (seq <= 0)
+        return 0;
+
+    // store the payload once and count the reference
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_PAYLOAD_REF, &stmt);
+    sqlite3_bind_int64(stmt, 1, from_address_id);
+    sqlite3_bind_blob(stmt, 2, payload_hash, (int)payload_hash_len, SQLITE_STATIC);
+    sqlite3_bind_blob(stmt, 3, payload, (int)payload_len, SQLITE_STATIC);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // the sequence number is unique for the pair of addresses
+    char pending_plaintext_id[32];
+    snprintf(pending_plaintext_id, sizeof(pending_plaintext_id), "%lld", (long long)seq);
+
+    sqlite_prepare(PENDING_PLAINTEXT_REF_INSERT, &stmt);
+    sqlite3_bind_text(stmt, 1, pending_plaintext_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 2, from_address_id);
+    sqlite3_bind_int64(stmt, 3, to_address_id);
+    sqlite3_bind_blob(stmt, 4, payload_hash, (int)payload_hash_len, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 5, notif_level);
+    sqlite3_bind_int64(stmt, 6, seq);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    return (uint64_t)seq;
+}
+
+size_t count_pending_payloads(E2ees__E2eeAddress *from_address) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(N_PENDING_PAYLOAD_LOAD, &stmt);
+    sqlite3_bind_text(stmt, 1, from_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, from_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, from_address->user->device_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    size_t n_payloads = 0;
+    if (sqlite_step(stmt, SQLITE_ROW))
+        n_payloads = (size_t)sqlite3_column_int64(stmt, 0);
+
+    // release
+    sqlite_finalize(stmt);
+
+    return n_payloads;
+}
+
+size_t load_pending_plaintext_data_page(
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *to_address,
+    uint64_t after_seq,
+    size_t max_num,
+    e2ees_pending_plaintext_t **pending_plaintext_list
+) {
+    *pending_plaintext_list = NULL;
+    if (max_num == 0)
+        return 0;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_PLAINTEXT_DATA_PAGE_LOAD, &stmt);
+    sqlite3_bind_text(stmt, 1, from_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, from_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, from_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, to_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, to_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, to_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 7, (sqlite_int64)after_seq);
+    sqlite3_bind_int64(stmt, 8, (sqlite_int64)max_num);
+
+    // step
+    e2ees_pending_plaintext_t *list = (e2ees_pending_plaintext_t *)malloc(sizeof(e2ees_pending_plaintext_t) * max_num);
+    size_t n_pending_plaintext = 0;
+    while (n_pending_plaintext < max_num && sqlite3_step(stmt) == SQLITE_ROW) {
+        // load
+        e2ees_pending_plaintext_t *pending_plaintext = &(list[n_pending_plaintext]);
+        pending_plaintext->seq = (uint64_t)sqlite3_column_int64(stmt, 0);
+        size_t plaintext_data_len = sqlite3_column_bytes(stmt, 1);
+        uint8_t *plaintext_data = (uint8_t *)sqlite3_column_blob(stmt, 1);
+        pending_plaintext->notif_level = sqlite3_column_int(stmt, 2);
+
+        // assign
+        pending_plaintext->plaintext_data = (uint8_t *)malloc(plaintext_data_len * sizeof(uint8_t));
+        memcpy(pending_plaintext->plaintext_data, plaintext_data, plaintext_data_len);
+        pending_plaintext->plaintext_data_len = plaintext_data_len;
+        n_pending_plaintext++;
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    if (n_pending_plaintext == 0) {
+        free(list);
+        return 0;
+    }
+    *pending_plaintext_list = list;
+    return n_pending_plaintext;
+}
+
+void unload_pending_plaintext_data_range(
+    E2ees__E2eeAddress *from_address,
+    E2ees__E2eeAddress *to_address,
+    uint64_t first_seq,
+    uint64_t last_seq
+) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_PLAINTEXT_DATA_RANGE_DELETE, &stmt);
+
+    // bind
+    sqlite3_bind_text(stmt, 1, from_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, from_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, from_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, to_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, to_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, to_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(stmt, 7, (sqlite_int64)first_seq);
+    sqlite3_bind_int64(stmt, 8, (sqlite_int64)last_seq);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+int load_n_group_pre_keys(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address) {
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(N_PENDING_PLAINTEXT_DATA_LOAD, &stmt);
+    sqlite3_bind_text(stmt, 1, from_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, from_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, from_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, to_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 5, to_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 6, to_address->user->device_id, -1, SQLITE_TRANSIENT);
+
+    // step
+    sqlite_step(stmt, SQLITE_ROW);
+
+    // load
+    int n_group_pre_keys = (int)sqlite3_column_int(stmt, 0);
 
     // release
     sqlite_finalize(stmt);
@@ -2226,6 +3574,10 @@ int load_n_group_pre_keys(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *
     return n_group_pre_keys;
 }
 
+size_t count_pending_plaintext_data(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address) {
+    return (size_t)load_n_group_pre_keys(from_address, to_address);
+}
+
 size_t load_pending_plaintext_data(
     E2ees__E2eeAddress *from_address,
     E2ees__E2eeAddress *to_address,
@@ -2303,6 +3655,110 @@ void unload_pending_plaintext_data(E2ees__E2eeAddress *from_address, E2ees__E2ee
     sqlite_finalize(stmt);
 }
 
+void store_session_establishment(
+    E2ees__E2eeAddress *our_address,
+    E2ees__E2eeAddress *their_address,
+    uint32_t step,
+    int64_t updated_ts
+) {
+    sqlite_int64 owner_id = insert_address(our_address);
+    sqlite_int64 address_id = insert_address(their_address);
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SESSION_ESTABLISHMENT_INSERT_OR_REPLACE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+    sqlite3_bind_int64(stmt, 3, step);
+    sqlite3_bind_int64(stmt, 4, updated_ts);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
+size_t load_session_establishments(
+    E2ees__E2eeAddress *our_address,
+    e2ees_session_establishment_t **session_establishments
+) {
+    *session_establishments = NULL;
+    sqlite_int64 owner_id = address_row_id(our_address);
+    if (owner_id == 0)
+        return 0;
+
+    // count
+    sqlite3_stmt *stmt;
+    sqlite_prepare(N_SESSION_ESTABLISHMENT_LOAD, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    size_t max_num = 0;
+    if (sqlite_step(stmt, SQLITE_ROW))
+        max_num = (size_t)sqlite3_column_int64(stmt, 0);
+    sqlite_finalize(stmt);
+    if (max_num == 0)
+        return 0;
+
+    // load
+    e2ees_session_establishment_t *list = (e2ees_session_establishment_t *)malloc(
+        sizeof(e2ees_session_establishment_t) * max_num
+    );
+    size_t n_session_establishments = 0;
+    sqlite_prepare(SESSION_ESTABLISHMENT_LOAD, &stmt);
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    while (n_session_establishments < max_num && sqlite3_step(stmt) == SQLITE_ROW) {
+        e2ees_session_establishment_t *session_establishment = &(list[n_session_establishments]);
+        E2ees__E2eeAddress *their_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+        e2ees__e2ee_address__init(their_address);
+        their_address->user = (E2ees__PeerUser *)malloc(sizeof(E2ees__PeerUser));
+        e2ees__peer_user__init(their_address->user);
+        their_address->peer_case = E2EES__E2EE_ADDRESS__PEER_USER;
+        their_address->domain = strdup((char *)sqlite3_column_text(stmt, 0));
+        their_address->user->user_id = strdup((char *)sqlite3_column_text(stmt, 1));
+        // the device is not known before the pre-key bundles are fetched
+        if (sqlite3_column_type(stmt, 2) != SQLITE_NULL)
+            their_address->user->device_id = strdup((char *)sqlite3_column_text(stmt, 2));
+
+        session_establishment->their_address = their_address;
+        session_establishment->step = (e2ees_session_establishment_step_t)sqlite3_column_int(stmt, 3);
+        session_establishment->updated_ts = (int64_t)sqlite3_column_int64(stmt, 4);
+        n_session_establishments++;
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    if (n_session_establishments == 0) {
+        free(list);
+        return 0;
+    }
+    *session_establishments = list;
+    return n_session_establishments;
+}
+
+void unload_session_establishment(E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address) {
+    sqlite_int64 owner_id = address_row_id(our_address);
+    sqlite_int64 address_id = address_row_id(their_address);
+    if (owner_id == 0 || address_id == 0)
+        return;
+
+    // prepare
+    sqlite3_stmt *stmt;
+    sqlite_prepare(SESSION_ESTABLISHMENT_DELETE, &stmt);
+
+    // bind
+    sqlite3_bind_int64(stmt, 1, owner_id);
+    sqlite3_bind_int64(stmt, 2, address_id);
+
+    // step
+    sqlite_step(stmt, SQLITE_DONE);
+
+    // release
+    sqlite_finalize(stmt);
+}
+
 void store_pending_request_data(E2ees__E2eeAddress *user_address, char *pending_request_id, uint8_t request_type, uint8_t *request_data, size_t request_data_len) {
     // insert user's address
     sqlite_int64 user_address_id = insert_address(user_address);
@@ -2407,3 +3863,31 @@ void unload_pending_request_data(E2ees__E2eeAddress *user_address, char *pending
     // release
     sqlite_finalize(stmt);
 }
+
+uint32_t add_pending_request_attempt(E2ees__E2eeAddress *user_address, char *pending_request_id) {
+    // count
+    sqlite3_stmt *stmt;
+    sqlite_prepare(PENDING_REQUEST_DATA_ADD_ATTEMPT, &stmt);
+    sqlite3_bind_text(stmt, 1, user_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, user_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, user_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, pending_request_id, -1, SQLITE_TRANSIENT);
+    sqlite_step(stmt, SQLITE_DONE);
+    sqlite_finalize(stmt);
+
+    // load
+    uint32_t attempts = 0;
+    sqlite_prepare(PENDING_REQUEST_DATA_LOAD_ATTEMPTS, &stmt);
+    sqlite3_bind_text(stmt, 1, user_address->domain, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 2, user_address->user->user_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 3, user_address->user->device_id, -1, SQLITE_TRANSIENT);
+    sqlite3_bind_text(stmt, 4, pending_request_id, -1, SQLITE_TRANSIENT);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        attempts = (uint32_t)sqlite3_column_int64(stmt, 0);
+    }
+
+    // release
+    sqlite_finalize(stmt);
+
+    return attempts;
+}
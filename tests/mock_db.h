@@ -37,6 +37,7 @@ void load_identity_key_pair(uint64_t address_id, E2ees__IdentityKey **identity_k
 void load_signed_pre_key_pair(uint64_t address_id, E2ees__SignedPreKey **signed_pre_key);
 int load_n_one_time_pre_keys(uint64_t address_id);
 size_t load_one_time_pre_keys(uint64_t address_id, E2ees__OneTimePreKey ***one_time_pre_keys);
+void load_one_time_pre_key_pair(uint64_t address_id, uint32_t one_time_pre_key_id, E2ees__OneTimePreKey **one_time_pre_key);
 uint32_t load_next_one_time_pre_key_id(uint64_t address_id);
 bool load_address_id(E2ees__E2eeAddress *address, sqlite_int64 *address_id);
 sqlite_int64 insert_address(E2ees__E2eeAddress *address);
@@ -61,12 +62,19 @@ bool add_one_time_pre_key(E2ees__E2eeAddress *address, E2ees__OneTimePreKey *one
 void store_account(E2ees__Account *account);
 void load_account_by_address_id(uint64_t address_id, E2ees__Account **account);
 void load_auth(E2ees__E2eeAddress *address, char **auth); // new added
+void load_identity_key(E2ees__E2eeAddress *address, E2ees__IdentityKey **identity_key);
+void load_one_time_pre_key(E2ees__E2eeAddress *address, uint32_t one_time_pre_key_id, E2ees__OneTimePreKey **one_time_pre_key);
 void load_account_by_address(E2ees__E2eeAddress *address, E2ees__Account **account);
+void load_account_without_opks(E2ees__E2eeAddress *address, E2ees__Account **account);
 size_t load_accounts(E2ees__Account ***accounts);
+size_t load_account_headers(e2ees_account_header_t **account_headers);
 void load_inbound_session(char *session_id, E2ees__E2eeAddress *our_address, E2ees__Session **session);
 void load_outbound_session(E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address, E2ees__Session **session);
 int load_n_outbound_sessions(E2ees__E2eeAddress *our_address, const char *their_user_id);
 size_t load_outbound_sessions(E2ees__E2eeAddress *our_address, const char *their_user_id, const char *their_domain, E2ees__Session ***outbound_sessions);
+size_t load_outbound_sessions_by_users(E2ees__E2eeAddress *our_address, E2ees__GroupMember **their_users, size_t their_users_num, E2ees__Session ***outbound_sessions);
+int load_n_outbound_session_headers(E2ees__E2eeAddress *our_address, const char *their_user_id);
+size_t load_outbound_session_headers(E2ees__E2eeAddress *our_address, const char *their_user_id, const char *their_domain, e2ees_session_header_t **session_headers);
 void store_session(E2ees__Session *session);
 void unload_session(E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address);
 void unload_old_session(E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address, int64_t invite_t);
@@ -84,6 +92,44 @@ void unload_group_session_with_no_session_id(
     E2ees__E2eeAddress *session_owner,
     E2ees__E2eeAddress *group_address
 );
+void store_group_info(E2ees__E2eeAddress *owner_address, E2ees__GroupInfo *group_info, uint64_t version);
+void store_group_info_delta(E2ees__E2eeAddress *owner_address, uint64_t version, E2ees__GroupInfo *added, E2ees__GroupInfo *removed);
+size_t load_group_info(
+    E2ees__E2eeAddress *owner_address, E2ees__E2eeAddress *group_address,
+    E2ees__GroupInfo **group_info, uint64_t *version,
+    E2ees__GroupInfo ***added_list, E2ees__GroupInfo ***removed_list
+);
+void store_group_session_info_version(E2ees__E2eeAddress *owner_address, const char *session_id, uint64_t version);
+uint64_t load_group_session_info_version(E2ees__E2eeAddress *owner_address, const char *session_id);
+void store_group_session_sequence(E2ees__E2eeAddress *owner_address, const char *session_id, uint32_t sequence);
+uint32_t load_group_session_sequence(E2ees__E2eeAddress *owner_address, const char *session_id);
+void update_next_one_time_pre_key_id(E2ees__E2eeAddress *address, uint32_t next_one_time_pre_key_id);
+void store_shared_group_session(
+    E2ees__E2eeAddress *owner_address,
+    const ProtobufCBinaryData *chain_id,
+    E2ees__GroupSession *shared_group_session
+);
+void load_shared_group_session(
+    E2ees__E2eeAddress *sender_address,
+    E2ees__E2eeAddress *owner_address,
+    const char *session_id,
+    ProtobufCBinaryData *chain_id,
+    E2ees__GroupSession **shared_group_session
+);
+void store_skipped_group_msg_key(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    uint32_t sequence,
+    const ProtobufCBinaryData *msg_key
+);
+bool take_skipped_group_msg_key(
+    E2ees__E2eeAddress *owner_address,
+    E2ees__E2eeAddress *sender_address,
+    const char *session_id,
+    uint32_t sequence,
+    ProtobufCBinaryData *msg_key_out
+);
 void store_pending_plaintext_data(
     E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address, char *pending_plaintext_id,
     uint8_t *group_pre_key_plaintext, size_t group_pre_key_plaintext_len, E2ees__NotifLevel notif_level
@@ -93,8 +139,33 @@ size_t load_pending_plaintext_data(
     uint8_t ***e2ee_plaintext_data_list, size_t **e2ee_plaintext_data_len_list, E2ees__NotifLevel **notif_level_list
 );
 void unload_pending_plaintext_data(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address, char *pending_plaintext_id);
+uint64_t append_pending_plaintext_data(
+    E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint8_t *plaintext_data, size_t plaintext_data_len, E2ees__NotifLevel notif_level
+);
+size_t count_pending_plaintext_data(E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address);
+size_t load_pending_plaintext_data_page(
+    E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address,
+    uint64_t after_seq, size_t max_num, e2ees_pending_plaintext_t **pending_plaintext_list
+);
+void unload_pending_plaintext_data_range(
+    E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address, uint64_t first_seq, uint64_t last_seq
+);
+uint64_t append_pending_payload_ref(
+    E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *to_address, const uint8_t *payload_hash, size_t payload_hash_len,
+    uint8_t *payload, size_t payload_len, E2ees__NotifLevel notif_level
+);
+size_t count_pending_payloads(E2ees__E2eeAddress *from_address);
+void store_session_establishment(
+    E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address, uint32_t step, int64_t updated_ts
+);
+size_t load_session_establishments(
+    E2ees__E2eeAddress *our_address, e2ees_session_establishment_t **session_establishments
+);
+void unload_session_establishment(E2ees__E2eeAddress *our_address, E2ees__E2eeAddress *their_address);
 void store_pending_request_data(E2ees__E2eeAddress *user_address, char *request_id, uint8_t request_type, uint8_t *request_data, size_t request_data_len);
 size_t load_pending_request_data(E2ees__E2eeAddress *user_address, char ***request_id_list, uint8_t **request_type, uint8_t ***request_data_list, size_t **request_data_len_list);
 void unload_pending_request_data(E2ees__E2eeAddress *user_address, char *request_id);
+uint32_t add_pending_request_attempt(E2ees__E2eeAddress *user_address, char *request_id);
 
 #endif /* MOCK_DB_H_ */
@@ -19,6 +19,8 @@
 #include "mock_server.h"
 
 #include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -29,8 +31,8 @@
 #include "e2ees/validation.h"
 #include "test_util.h"
 
-#define user_data_max 205
-#define group_data_max 8
+#define index_not_found SIZE_MAX
+#define table_init_buckets 64
 
 static E2ees__Certificate *central_certificate = NULL;
 
@@ -40,6 +42,12 @@ static E2ees__KeyPair *central_key_pair = NULL;
 
 static E2ees__KeyPair *server_key_pair = NULL;
 
+typedef struct index_list {
+    size_t *indexes;
+    size_t indexes_num;
+    size_t capacity;
+} index_list;
+
 typedef struct user_data {
     char *authenticator;
     E2ees__E2eeAddress *address;
@@ -48,6 +56,11 @@ typedef struct user_data {
     E2ees__SignedPreKeyPublic *signed_pre_key_public;
     E2ees__OneTimePreKeyPublic **one_time_pre_key_list;
     size_t n_one_time_pre_key_list;
+    // the devices of the same user are chained in the order of registration
+    size_t next_device;
+    size_t last_device;
+    index_list friends;
+    index_list groups;
 } user_data;
 
 typedef struct group_data {
@@ -57,84 +70,317 @@ typedef struct group_data {
     E2ees__GroupMember **group_member_list;
 } group_data;
 
-/* TODO : LINKED LIST */
 typedef struct index_node {
     size_t index;
     E2ees__E2eeAddress *device_address;
     struct index_node *next;
 } index_node;
 
-static user_data user_data_set[user_data_max] = {
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0},
-    {NULL, NULL, 0, NULL, NULL, NULL, 0}};
-
-static group_data group_data_set[group_data_max] = {
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL},
-    {NULL, NULL, 0, NULL}};
-
-static bool session_record[user_data_max][user_data_max];
-
-static bool group_record[user_data_max][group_data_max];
-
-static bool device_invited_record[user_data_max][group_data_max];
-
-static uint8_t user_data_set_insert_pos = 0;
-
-static uint8_t group_data_set_insert_pos = 0;
-
-static user_data *find_user(char *authenticator, uint8_t *position) {
-    uint8_t i;
-    for (i = 0; i < user_data_max; i++) {
-        if (user_data_set[i].authenticator != NULL) {
-            if (strcmp(user_data_set[i].authenticator, authenticator) == 0) {
-                *position = i;
-                return &(user_data_set[i]);
-            }
+typedef struct table_entry {
+    char *key;
+    size_t value;
+    struct table_entry *next;
+} table_entry;
+
+typedef struct hash_table {
+    table_entry **buckets;
+    size_t buckets_num;
+    size_t entries_num;
+} hash_table;
+
+static user_data *user_data_set = NULL;
+
+static size_t user_data_set_capacity = 0;
+
+static size_t user_data_set_insert_pos = 0;
+
+static group_data *group_data_set = NULL;
+
+static size_t group_data_set_capacity = 0;
+
+static size_t group_data_set_insert_pos = 0;
+
+// authenticator -> the first device registered with it
+static hash_table authenticator_table = {NULL, 0, 0};
+
+// device address -> device
+static hash_table address_table = {NULL, 0, 0};
+
+// user_id -> the first device of the user
+static hash_table user_table = {NULL, 0, 0};
+
+// group address -> group
+static hash_table group_table = {NULL, 0, 0};
+
+// session, group membership and device invitation records keyed by index pairs
+static hash_table record_table = {NULL, 0, 0};
+
+// the sending thread calls back into the server while the tables above may be regrown
+static pthread_mutex_t mock_server_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t hash_key(const char *key) {
+    // FNV-1a
+    uint64_t hash = 14695981039346656037ULL;
+    while (*key != '\0') {
+        hash ^= (uint8_t)(*key++);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static table_entry **find_table_slot(hash_table *table, const char *key) {
+    if (table->buckets_num == 0) {
+        return NULL;
+    }
+    table_entry **slot = &(table->buckets[hash_key(key) & (table->buckets_num - 1)]);
+    while (*slot != NULL && strcmp((*slot)->key, key) != 0) {
+        slot = &((*slot)->next);
+    }
+    return slot;
+}
+
+static void grow_table(hash_table *table) {
+    size_t new_buckets_num = table->buckets_num == 0 ? table_init_buckets : table->buckets_num * 2;
+    table_entry **new_buckets = (table_entry **)calloc(new_buckets_num, sizeof(table_entry *));
+    size_t i;
+    for (i = 0; i < table->buckets_num; i++) {
+        table_entry *entry = table->buckets[i];
+        while (entry != NULL) {
+            table_entry *next = entry->next;
+            size_t bucket = hash_key(entry->key) & (new_buckets_num - 1);
+            entry->next = new_buckets[bucket];
+            new_buckets[bucket] = entry;
+            entry = next;
         }
     }
-    return NULL;
+    free(table->buckets);
+    table->buckets = new_buckets;
+    table->buckets_num = new_buckets_num;
 }
 
-static uint8_t find_address(E2ees__E2eeAddress *user_address) {
-    uint8_t i;
-    for (i = 0; i < user_data_max; i++) {
-        if (user_data_set[i].address != NULL) {
-            if (compare_address(user_data_set[i].address, user_address)) {
-                return i;
-            }
+static bool find_in_table(hash_table *table, const char *key, size_t *value_out) {
+    table_entry **slot = find_table_slot(table, key);
+    if (slot == NULL || *slot == NULL) {
+        return false;
+    }
+    if (value_out != NULL) {
+        *value_out = (*slot)->value;
+    }
+    return true;
+}
+
+static void insert_into_table(hash_table *table, const char *key, size_t value) {
+    if (table->entries_num >= table->buckets_num) {
+        grow_table(table);
+    }
+    table_entry **slot = find_table_slot(table, key);
+    if (*slot != NULL) {
+        (*slot)->value = value;
+        return;
+    }
+    table_entry *entry = (table_entry *)malloc(sizeof(table_entry));
+    entry->key = strdup(key);
+    entry->value = value;
+    entry->next = NULL;
+    *slot = entry;
+    table->entries_num++;
+}
+
+static void remove_from_table(hash_table *table, const char *key) {
+    table_entry **slot = find_table_slot(table, key);
+    if (slot == NULL || *slot == NULL) {
+        return;
+    }
+    table_entry *entry = *slot;
+    *slot = entry->next;
+    free(entry->key);
+    free(entry);
+    table->entries_num--;
+}
+
+static void free_table(hash_table *table) {
+    size_t i;
+    for (i = 0; i < table->buckets_num; i++) {
+        table_entry *entry = table->buckets[i];
+        while (entry != NULL) {
+            table_entry *next = entry->next;
+            free(entry->key);
+            free(entry);
+            entry = next;
+        }
+    }
+    free(table->buckets);
+    table->buckets = NULL;
+    table->buckets_num = 0;
+    table->entries_num = 0;
+}
+
+static char *address_key(const E2ees__E2eeAddress *address) {
+    const char *domain = address->domain != NULL ? address->domain : "";
+    size_t key_len;
+    char *key;
+    if (address->peer_case == E2EES__E2EE_ADDRESS__PEER_GROUP) {
+        const char *group_id = address->group->group_id != NULL ? address->group->group_id : "";
+        key_len = strlen(domain) + strlen(group_id) + 4;
+        key = (char *)malloc(key_len);
+        snprintf(key, key_len, "g\x1f%s\x1f%s", domain, group_id);
+    } else {
+        const char *user_id = address->user->user_id != NULL ? address->user->user_id : "";
+        const char *device_id = address->user->device_id != NULL ? address->user->device_id : "";
+        key_len = strlen(domain) + strlen(user_id) + strlen(device_id) + 5;
+        key = (char *)malloc(key_len);
+        snprintf(key, key_len, "u\x1f%s\x1f%s\x1f%s", domain, user_id, device_id);
+    }
+    return key;
+}
+
+static void record_key(char *key, size_t key_len, char record_type, size_t index_1, size_t index_2) {
+    snprintf(key, key_len, "%c:%zu:%zu", record_type, index_1, index_2);
+}
+
+static void append_index(index_list *list, size_t index) {
+    if (list->indexes_num == list->capacity) {
+        list->capacity = list->capacity == 0 ? 4 : list->capacity * 2;
+        list->indexes = (size_t *)realloc(list->indexes, sizeof(size_t) * list->capacity);
+    }
+    list->indexes[list->indexes_num++] = index;
+}
+
+static void remove_index(index_list *list, size_t index) {
+    size_t i;
+    for (i = 0; i < list->indexes_num; i++) {
+        if (list->indexes[i] == index) {
+            memmove(&(list->indexes[i]), &(list->indexes[i + 1]), sizeof(size_t) * (list->indexes_num - i - 1));
+            list->indexes_num--;
+            return;
         }
     }
-    return user_data_max;
+}
+
+static void free_index_list(index_list *list) {
+    free(list->indexes);
+    list->indexes = NULL;
+    list->indexes_num = 0;
+    list->capacity = 0;
+}
+
+static void reserve_user_data() {
+    if (user_data_set_insert_pos < user_data_set_capacity) {
+        return;
+    }
+    size_t new_capacity = user_data_set_capacity == 0 ? 64 : user_data_set_capacity * 2;
+    user_data_set = (user_data *)realloc(user_data_set, sizeof(user_data) * new_capacity);
+    memset(&(user_data_set[user_data_set_capacity]), 0, sizeof(user_data) * (new_capacity - user_data_set_capacity));
+    user_data_set_capacity = new_capacity;
+}
+
+static void reserve_group_data() {
+    if (group_data_set_insert_pos < group_data_set_capacity) {
+        return;
+    }
+    size_t new_capacity = group_data_set_capacity == 0 ? 8 : group_data_set_capacity * 2;
+    group_data_set = (group_data *)realloc(group_data_set, sizeof(group_data) * new_capacity);
+    memset(&(group_data_set[group_data_set_capacity]), 0, sizeof(group_data) * (new_capacity - group_data_set_capacity));
+    group_data_set_capacity = new_capacity;
+}
+
+static void set_session_record(size_t user_index_1, size_t user_index_2) {
+    char key[64];
+    record_key(key, sizeof(key), 's', user_index_1, user_index_2);
+    if (find_in_table(&record_table, key, NULL)) {
+        return;
+    }
+    insert_into_table(&record_table, key, 1);
+    append_index(&(user_data_set[user_index_1].friends), user_index_2);
+}
+
+static void set_group_record(size_t user_index, size_t group_index, bool in_group) {
+    char key[64];
+    record_key(key, sizeof(key), 'g', user_index, group_index);
+    bool recorded = find_in_table(&record_table, key, NULL);
+    if (in_group && !recorded) {
+        insert_into_table(&record_table, key, 1);
+        append_index(&(user_data_set[user_index].groups), group_index);
+    } else if (!in_group && recorded) {
+        remove_from_table(&record_table, key);
+        remove_index(&(user_data_set[user_index].groups), group_index);
+    }
+}
+
+static bool check_and_set_invited_record(size_t user_index, size_t group_index) {
+    char key[64];
+    record_key(key, sizeof(key), 'i', user_index, group_index);
+    if (find_in_table(&record_table, key, NULL)) {
+        return true;
+    }
+    insert_into_table(&record_table, key, 1);
+    return false;
+}
+
+static user_data *find_user(char *authenticator, size_t *position) {
+    if (find_in_table(&authenticator_table, authenticator, position)) {
+        return &(user_data_set[*position]);
+    }
+    return NULL;
+}
+
+static size_t find_address(E2ees__E2eeAddress *user_address) {
+    size_t position = index_not_found;
+    if (user_address == NULL) {
+        return position;
+    }
+    char *key = address_key(user_address);
+    find_in_table(&address_table, key, &position);
+    free(key);
+    return position;
+}
+
+static size_t find_group(E2ees__E2eeAddress *group_address) {
+    size_t position = index_not_found;
+    if (group_address == NULL || group_address->peer_case != E2EES__E2EE_ADDRESS__PEER_GROUP) {
+        return position;
+    }
+    char *key = address_key(group_address);
+    find_in_table(&group_table, key, &position);
+    free(key);
+    return position;
+}
+
+static size_t first_device(const char *user_id) {
+    size_t position = index_not_found;
+    if (user_id != NULL) {
+        find_in_table(&user_table, user_id, &position);
+    }
+    return position;
+}
+
+static void insert_user_data_index(size_t position) {
+    user_data *cur_data = &(user_data_set[position]);
+    cur_data->next_device = index_not_found;
+    cur_data->last_device = position;
+
+    char *key = address_key(cur_data->address);
+    if (!find_in_table(&address_table, key, NULL)) {
+        insert_into_table(&address_table, key, position);
+    }
+    free(key);
+    if (!find_in_table(&authenticator_table, cur_data->authenticator, NULL)) {
+        insert_into_table(&authenticator_table, cur_data->authenticator, position);
+    }
+
+    size_t head = first_device(cur_data->address->user->user_id);
+    if (head == index_not_found) {
+        insert_into_table(&user_table, cur_data->address->user->user_id, position);
+    } else {
+        user_data_set[user_data_set[head].last_device].next_device = position;
+        user_data_set[head].last_device = position;
+    }
 }
 
 static void insert_index_node(index_node **head, index_node **tail, size_t index, E2ees__E2eeAddress *device_address) {
     index_node *new_node = (index_node *)malloc(sizeof(index_node));
     new_node->index = index;
-    copy_address_from_address(&(new_node->device_address), device_address);
+    new_node->device_address = device_address;
     new_node->next = NULL;
 
     if (*head == NULL) {
@@ -148,40 +394,21 @@ static void insert_index_node(index_node **head, index_node **tail, size_t index
     return;
 }
 
-// NOTE: used when user delete a device, not yet used
-static size_t new_delete_node(index_node **head, size_t target_data) {
-    index_node *cur_node = *head;
-    index_node *prev_node = NULL;
-    while (cur_node != NULL) {
-        if (cur_node->index == target_data) {
-            if (prev_node == NULL) { // head
-                *head = cur_node->next;
-            } else {
-                prev_node->next = cur_node->next;
-            }
-            free(cur_node);
-            return 1;
-        }
-        prev_node = cur_node;
-        cur_node = cur_node->next;
-    }
-    return 0;
+static void free_index_nodes(index_node **index_node_list, size_t index_node_list_num) {
+    index_node *current, *next;
+    size_t i;
+    free_index_nodes(index_node_list, index_node_list_num);
 }
 
 static size_t find_device_index_and_addresses(const char *user_id, index_node **user_devices_addresses) {
     size_t user_addresses_num = 0;
     index_node *tail = NULL;
-    uint8_t i;
+    size_t i;
 
-    for (i = 0; i < user_data_max; i++) {
-        if (user_data_set[i].address != NULL) {
-            // return non-zero if not equal
-            if (safe_strcmp(user_data_set[i].address->user->user_id, user_id)) {
-                user_addresses_num++;
-                // input one user's device address, tail node and index , address
-                insert_index_node(user_devices_addresses, &(tail), i, user_data_set[i].address);
-            }
-        }
+    for (i = first_device(user_id); i != index_not_found; i = user_data_set[i].next_device) {
+        user_addresses_num++;
+        // the address is borrowed from the user data
+        insert_index_node(user_devices_addresses, &(tail), i, user_data_set[i].address);
     }
 
     return user_addresses_num;
@@ -189,69 +416,52 @@ static size_t find_device_index_and_addresses(const char *user_id, index_node **
 
 static size_t find_device_addresses(const char *user_id, E2ees__E2eeAddress ***user_addresses) {
     size_t user_addresses_num = 0;
-    uint8_t i;
-    for (i = 0; i < user_data_max; i++) {
-        if (user_data_set[i].address != NULL) {
-            // return non-zero if not equal
-            if (safe_strcmp(user_data_set[i].address->user->user_id, user_id))
-                user_addresses_num++;
-        }
+    size_t i;
+    for (i = first_device(user_id); i != index_not_found; i = user_data_set[i].next_device) {
+        user_addresses_num++;
     }
     *user_addresses = (E2ees__E2eeAddress **)malloc(sizeof(E2ees__E2eeAddress *) * user_addresses_num);
-    uint8_t j = 0;
-    for (i = 0; i < user_data_max; i++) {
-        if (user_data_set[i].address != NULL) {
-            if (safe_strcmp(user_data_set[i].address->user->user_id, user_id))
-                copy_address_from_address(&((*user_addresses)[j++]), user_data_set[i].address);
-        }
+    size_t j = 0;
+    for (i = first_device(user_id); i != index_not_found; i = user_data_set[i].next_device) {
+        copy_address_from_address(&((*user_addresses)[j++]), user_data_set[i].address);
     }
     return user_addresses_num;
 }
 /*------------------------------------*/
 
-static size_t find_friend_addresses(uint8_t user_index, E2ees__E2eeAddress ***friend_addresses) {
+static size_t find_friend_addresses(size_t user_index, E2ees__E2eeAddress ***friend_addresses) {
+    index_list *friends = &(user_data_set[user_index].friends);
+    const char *user_id = user_data_set[user_index].address->user->user_id;
     size_t friends_num = 0;
-    uint8_t i;
-    for (i = 0; i < user_data_max; i++) {
-        if (session_record[user_index][i] == true) {
-            if (!safe_strcmp(user_data_set[user_index].address->user->user_id, user_data_set[i].address->user->user_id))
-                friends_num++;
-        }
+    size_t i;
+    for (i = 0; i < friends->indexes_num; i++) {
+        if (!safe_strcmp(user_id, user_data_set[friends->indexes[i]].address->user->user_id))
+            friends_num++;
     }
     *friend_addresses = (E2ees__E2eeAddress **)malloc(sizeof(E2ees__E2eeAddress *) * friends_num);
-    uint8_t j = 0;
-    for (i = 0; i < user_data_max; i++) {
-        if (session_record[user_index][i] == true) {
-            if (!safe_strcmp(user_data_set[user_index].address->user->user_id, user_data_set[i].address->user->user_id))
-                copy_address_from_address(&((*friend_addresses)[j++]), user_data_set[i].address);
-        }
+    size_t j = 0;
+    for (i = 0; i < friends->indexes_num; i++) {
+        E2ees__E2eeAddress *friend_address = user_data_set[friends->indexes[i]].address;
+        if (!safe_strcmp(user_id, friend_address->user->user_id))
+            copy_address_from_address(&((*friend_addresses)[j++]), friend_address);
     }
     return friends_num;
 }
 
-static size_t find_group_data(uint8_t user_index, E2ees__GroupInfo ***group_info_list) {
-    size_t group_num = 0;
-    uint8_t i;
-    for (i = 0; i < group_data_max; i++) {
-        if (group_record[user_index][i] == true) {
-            group_num++;
-        }
-    }
+static size_t find_group_data(size_t user_index, E2ees__GroupInfo ***group_info_list) {
+    index_list *groups = &(user_data_set[user_index].groups);
+    size_t group_num = groups->indexes_num;
     *group_info_list = (E2ees__GroupInfo **)malloc(sizeof(E2ees__GroupInfo *) * group_num);
-    uint8_t j = 0;
-    for (i = 0; i < group_data_max; i++) {
-        if (group_record[user_index][i] == true) {
-            (*group_info_list)[j] = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
-            e2ees__group_info__init((*group_info_list)[j]);
-            // copy group data
-            group_data *cur_group_data = &(group_data_set[i]);
-            (*group_info_list)[j]->group_name = strdup(cur_group_data->group_name);
-            copy_address_from_address(&((*group_info_list)[j]->group_address), cur_group_data->group_address);
-            (*group_info_list)[j]->n_group_member_list = cur_group_data->group_members_num;
-            copy_group_members(&((*group_info_list)[j]->group_member_list), cur_group_data->group_member_list, cur_group_data->group_members_num);
-            // done
-            j++;
-        }
+    size_t j;
+    for (j = 0; j < group_num; j++) {
+        (*group_info_list)[j] = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+        e2ees__group_info__init((*group_info_list)[j]);
+        // copy group data
+        group_data *cur_group_data = &(group_data_set[groups->indexes[j]]);
+        (*group_info_list)[j]->group_name = strdup(cur_group_data->group_name);
+        copy_address_from_address(&((*group_info_list)[j]->group_address), cur_group_data->group_address);
+        (*group_info_list)[j]->n_group_member_list = cur_group_data->group_members_num;
+        copy_group_members(&((*group_info_list)[j]->group_member_list), cur_group_data->group_member_list, cur_group_data->group_members_num);
     }
     return group_num;
 }
@@ -396,22 +606,13 @@ void mock_server_signed_signature(
 }
 
 void mock_server_begin() {
-    uint8_t i, j;
-    for (i = 0; i < user_data_max; i++) {
-        for (j = 0; j < user_data_max; j++) {
-            session_record[i][j] = 0;
-        }
-        for (j = 0; j < group_data_max; j++) {
-            group_record[i][j] = 0;
-            device_invited_record[i][j] = 0;
-        }
-    }
+    reserve_user_data();
+    reserve_group_data();
     mock_certificate();
 }
 
 void mock_server_end() {
-    uint8_t i;
-    size_t j;
+    size_t i, j;
     for (i = 0; i < user_data_set_insert_pos; i++) {
         if (user_data_set[i].authenticator != NULL) {
             free(user_data_set[i].authenticator);
@@ -439,7 +640,11 @@ void mock_server_end() {
         user_data_set[i].signed_pre_key_public = NULL;
         user_data_set[i].one_time_pre_key_list = NULL;
         user_data_set[i].n_one_time_pre_key_list = 0;
+        free_index_list(&(user_data_set[i].friends));
+        free_index_list(&(user_data_set[i].groups));
     }
+    free_mem((void **)&user_data_set, sizeof(user_data) * user_data_set_capacity);
+    user_data_set_capacity = 0;
     user_data_set_insert_pos = 0;
     for (i = 0; i < group_data_set_insert_pos; i++) {
         e2ees__e2ee_address__free_unpacked(group_data_set[i].group_address, NULL);
@@ -456,7 +661,14 @@ void mock_server_end() {
         free_mem((void **)&(group_data_set[i].group_member_list), sizeof(E2ees__GroupMember *) * group_data_set[i].group_members_num);
         group_data_set[i].group_members_num = 0;
     }
+    free_mem((void **)&group_data_set, sizeof(group_data) * group_data_set_capacity);
+    group_data_set_capacity = 0;
     group_data_set_insert_pos = 0;
+    free_table(&authenticator_table);
+    free_table(&address_table);
+    free_table(&user_table);
+    free_table(&group_table);
+    free_table(&record_table);
     if (central_certificate != NULL) {
         e2ees__certificate__free_unpacked(central_certificate, NULL);
         central_certificate = NULL;
@@ -476,13 +688,18 @@ void mock_server_end() {
 }
 
 E2ees__RegisterUserResponse *mock_register_user(E2ees__RegisterUserRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     if ((request == NULL) || (request->authenticator == NULL)) {
         e2ees_notify_log(NULL, BAD_REGISTER_USER_REQUEST, "mock_register_user()");
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
 
+    // make room before any user data is referenced
+    reserve_user_data();
+
     // check if there is the user's data stored in the server's database
-    uint8_t user_data_find;
+    size_t user_data_find;
     user_data *client_data = find_user(request->authenticator, &user_data_find);
     E2ees__E2eeAddress **other_device_address_list, **friend_addresses, **receiver_addresses;
     E2ees__GroupInfo **group_info_list;
@@ -522,6 +739,7 @@ E2ees__RegisterUserResponse *mock_register_user(E2ees__RegisterUserRequest *requ
     cur_address->user->user_id = strdup(request->user_id);
     cur_address->user->device_id = strdup(request->device_id);
 
+    insert_user_data_index(user_data_set_insert_pos);
     user_data_set_insert_pos++;
 
     // prepare response
@@ -618,40 +836,42 @@ E2ees__RegisterUserResponse *mock_register_user(E2ees__RegisterUserRequest *requ
         free_mem((void **)&other_device_address_list, sizeof(E2ees__E2eeAddress *) * other_device_num);
     }
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__GetPreKeyBundleResponse *mock_get_pre_key_bundle(E2ees__E2eeAddress *from, const char *auth, E2ees__GetPreKeyBundleRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     if ((request->user_id == NULL) || (request->domain == NULL)) {
         e2ees_notify_log(from, BAD_GET_PRE_KEY_BUNDLE_REQUEST, "mock_get_pre_key_bundle()");
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
 
-    size_t user_device_num = 0;
-    uint8_t user_data_find[user_data_max] = {0};
-    uint8_t i;
+    size_t user_device_num = 0, user_devices_max = 0;
+    size_t i;
+    for (i = first_device(request->user_id); i != index_not_found; i = user_data_set[i].next_device) {
+        user_devices_max++;
+    }
+    size_t *user_data_find = (size_t *)malloc(sizeof(size_t) * (user_devices_max + 1));
     E2ees__E2eeAddress *cur_address;
-    if ((request->device_id)[0] == '\0') {
-        for (i = 0; i < user_data_set_insert_pos; i++) {
-            cur_address = user_data_set[i].address;
-            if ((cur_address != NULL) && compare_user_id(cur_address, request->user_id, request->domain)) {
-                user_data_find[user_device_num] = i;
-                user_device_num++;
-            }
-        }
-    } else {
-        for (i = 0; i < user_data_set_insert_pos; i++) {
-            cur_address = user_data_set[i].address;
-            if ((cur_address != NULL) && safe_strcmp(cur_address->domain, request->domain) && safe_strcmp(cur_address->user->user_id, request->user_id) &&
-                safe_strcmp(cur_address->user->device_id, request->device_id)) {
+    for (i = first_device(request->user_id); i != index_not_found; i = user_data_set[i].next_device) {
+        cur_address = user_data_set[i].address;
+        if ((request->device_id)[0] == '\0') {
+            if (compare_user_id(cur_address, request->user_id, request->domain)) {
                 user_data_find[user_device_num] = i;
                 user_device_num++;
             }
+        } else if (safe_strcmp(cur_address->domain, request->domain) && safe_strcmp(cur_address->user->device_id, request->device_id)) {
+            user_data_find[user_device_num] = i;
+            user_device_num++;
         }
     }
 
     if (user_device_num == 0) {
         // not found
+        free_mem((void **)&user_data_find, sizeof(size_t) * (user_devices_max + 1));
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
 
@@ -685,8 +905,10 @@ E2ees__GetPreKeyBundleResponse *mock_get_pre_key_bundle(E2ees__E2eeAddress *from
             }
         }
         // release the one-time pre-key
-        e2ees__one_time_pre_key_public__free_unpacked(cur_data->one_time_pre_key_list[k], NULL);
-        cur_data->one_time_pre_key_list[k] = NULL;
+        if (k < cur_data->n_one_time_pre_key_list) {
+            e2ees__one_time_pre_key_public__free_unpacked(cur_data->one_time_pre_key_list[k], NULL);
+            cur_data->one_time_pre_key_list[k] = NULL;
+        }
 
         // generate server signed signature
         pre_key_bundle_hash(
@@ -700,13 +922,16 @@ E2ees__GetPreKeyBundleResponse *mock_get_pre_key_bundle(E2ees__E2eeAddress *from
 
         free_mem((void **)&msg, msg_len);
     }
+    free_mem((void **)&user_data_find, sizeof(size_t) * (user_devices_max + 1));
 
     response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__InviteResponse *mock_invite(E2ees__E2eeAddress *from, const char *auth, E2ees__InviteRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     uint8_t *msg = NULL;
     size_t msg_len;
 
@@ -715,8 +940,8 @@ E2ees__InviteResponse *mock_invite(E2ees__E2eeAddress *from, const char *auth, E
     e2ees__invite_response__init(response);
 
     E2ees__InviteMsg *invite_msg = request->msg;
-    uint8_t inviter = find_address(invite_msg->from);
-    if (inviter != user_data_max) {
+    size_t inviter = find_address(invite_msg->from);
+    if (inviter != index_not_found) {
         copy_protobuf_from_protobuf(&(invite_msg->alice_identity_key), &(user_data_set[inviter].identity_key_public->asym_public_key));
 
         size_t invite_msg_data_len = e2ees__invite_msg__get_packed_size(invite_msg);
@@ -754,10 +979,25 @@ E2ees__InviteResponse *mock_invite(E2ees__E2eeAddress *from, const char *auth, E
     }
 
     // done
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
+E2ees__InviteResponse **mock_invites(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__InviteRequest **requests, size_t request_num
+) {
+    E2ees__InviteResponse **responses = (E2ees__InviteResponse **)malloc(
+        sizeof(E2ees__InviteResponse *) * request_num
+    );
+    size_t i;
+    for (i = 0; i < request_num; i++) {
+        responses[i] = mock_invite(from, auth, requests[i]);
+    }
+    return responses;
+}
+
 E2ees__AcceptResponse *mock_accept(E2ees__E2eeAddress *from, const char *auth, E2ees__AcceptRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     E2ees__AcceptMsg *accept_msg = request->msg;
     size_t accept_msg_data_len = e2ees__accept_msg__get_packed_size(accept_msg);
     uint8_t accept_msg_data[accept_msg_data_len];
@@ -787,10 +1027,12 @@ E2ees__AcceptResponse *mock_accept(E2ees__E2eeAddress *from, const char *auth, E
     send_proto_msg(proto_msg);
 
     // set the session record
-    uint8_t inviter = find_address(accept_msg->to);
-    uint8_t invitee = find_address(accept_msg->from);
-    session_record[inviter][invitee] = true;
-    session_record[invitee][inviter] = true;
+    size_t inviter = find_address(accept_msg->to);
+    size_t invitee = find_address(accept_msg->from);
+    if (inviter != index_not_found && invitee != index_not_found) {
+        set_session_record(inviter, invitee);
+        set_session_record(invitee, inviter);
+    }
 
     // prepare response
     E2ees__AcceptResponse *response = (E2ees__AcceptResponse *)malloc(sizeof(E2ees__AcceptResponse));
@@ -802,23 +1044,20 @@ E2ees__AcceptResponse *mock_accept(E2ees__E2eeAddress *from, const char *auth, E
     free_mem((void **)&msg, msg_len);
 
     // done
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__PublishSpkResponse *mock_publish_spk(E2ees__E2eeAddress *from, const char *auth, E2ees__PublishSpkRequest *request) {
-    uint8_t user_data_find = 0;
-    while (user_data_find < user_data_set_insert_pos) {
-        if ((user_data_set[user_data_find].address) && (request->user_address) && compare_address(user_data_set[user_data_find].address, request->user_address)) {
-            break;
-        }
-        user_data_find++;
-    }
+    pthread_mutex_lock(&mock_server_lock);
+    size_t user_data_find = find_address(request->user_address);
 
     // data not found
-    if (user_data_find == user_data_set_insert_pos) {
+    if (user_data_find == index_not_found) {
         E2ees__PublishSpkResponse *response = (E2ees__PublishSpkResponse *)malloc(sizeof(E2ees__PublishSpkResponse));
         e2ees__publish_spk_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
@@ -832,20 +1071,17 @@ E2ees__PublishSpkResponse *mock_publish_spk(E2ees__E2eeAddress *from, const char
     e2ees__publish_spk_response__init(response);
     response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__SupplyOpksResponse *mock_supply_opks(E2ees__E2eeAddress *from, const char *auth, E2ees__SupplyOpksRequest *request) {
-    uint8_t user_data_find = 0;
-    while (user_data_find < user_data_set_insert_pos) {
-        if ((user_data_set[user_data_find].address) && (request->user_address) && compare_address(user_data_set[user_data_find].address, request->user_address)) {
-            break;
-        }
-        user_data_find++;
-    }
+    pthread_mutex_lock(&mock_server_lock);
+    size_t user_data_find = find_address(request->user_address);
 
-    if (user_data_find == user_data_set_insert_pos) {
+    if (user_data_find == index_not_found) {
         // not found
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
 
@@ -875,10 +1111,12 @@ E2ees__SupplyOpksResponse *mock_supply_opks(E2ees__E2eeAddress *from, const char
     e2ees__supply_opks_response__init(response);
     response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__SendOne2oneMsgResponse *mock_send_one2one_msg(E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     E2ees__E2eeMsg *e2ee_msg = request->msg;
     size_t e2ee_msg_data_len = e2ees__e2ee_msg__get_packed_size(e2ee_msg);
     uint8_t e2ee_msg_data[e2ee_msg_data_len];
@@ -952,22 +1190,104 @@ E2ees__SendOne2oneMsgResponse *mock_send_one2one_msg(E2ees__E2eeAddress *from, c
     response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
 
     // done
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
+E2ees__SendOne2oneMsgResponse **mock_send_one2one_msgs(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest **requests, size_t request_num
+) {
+    E2ees__SendOne2oneMsgResponse **responses = (E2ees__SendOne2oneMsgResponse **)malloc(
+        sizeof(E2ees__SendOne2oneMsgResponse *) * request_num
+    );
+    size_t i;
+    for (i = 0; i < request_num; i++) {
+        responses[i] = mock_send_one2one_msg(from, auth, requests[i]);
+    }
+    return responses;
+}
+
+typedef struct mock_one2one_msg_submission {
+    E2ees__E2eeAddress *from;
+    char *auth;
+    E2ees__SendOne2oneMsgRequest *request;
+    e2ees_send_one2one_msg_completion_t completion;
+    void *context;
+    struct mock_one2one_msg_submission *next;
+} mock_one2one_msg_submission;
+
+static mock_one2one_msg_submission *one2one_msg_submissions = NULL;
+static mock_one2one_msg_submission *one2one_msg_submissions_tail = NULL;
+static pthread_mutex_t one2one_msg_submissions_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int mock_send_one2one_msg_async(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest *request,
+    e2ees_send_one2one_msg_completion_t completion, void *context
+) {
+    mock_one2one_msg_submission *submission = (mock_one2one_msg_submission *)malloc(sizeof(mock_one2one_msg_submission));
+    copy_address_from_address(&(submission->from), from);
+    submission->auth = strdup(auth);
+    submission->request = request;
+    submission->completion = completion;
+    submission->context = context;
+    submission->next = NULL;
+
+    pthread_mutex_lock(&one2one_msg_submissions_lock);
+    if (one2one_msg_submissions_tail == NULL) {
+        one2one_msg_submissions = submission;
+    } else {
+        one2one_msg_submissions_tail->next = submission;
+    }
+    one2one_msg_submissions_tail = submission;
+    pthread_mutex_unlock(&one2one_msg_submissions_lock);
+
+    return 0;
+}
+
+size_t mock_complete_one2one_msgs() {
+    pthread_mutex_lock(&one2one_msg_submissions_lock);
+    mock_one2one_msg_submission *submission = one2one_msg_submissions;
+    one2one_msg_submissions = NULL;
+    one2one_msg_submissions_tail = NULL;
+    pthread_mutex_unlock(&one2one_msg_submissions_lock);
+
+    size_t completed_num = 0;
+    while (submission != NULL) {
+        mock_one2one_msg_submission *next = submission->next;
+        E2ees__SendOne2oneMsgResponse *response = mock_send_one2one_msg(submission->from, submission->auth, submission->request);
+        submission->completion(submission->context, response);
+        completed_num++;
+
+        // release
+        e2ees__e2ee_address__free_unpacked(submission->from, NULL);
+        free(submission->auth);
+        free(submission);
+        submission = next;
+    }
+    return completed_num;
+}
+
 E2ees__CreateGroupResponse *mock_create_group(E2ees__E2eeAddress *from, const char *auth, E2ees__CreateGroupRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     if (request == NULL) {
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
     if (request->msg == NULL) {
+        pthread_mutex_unlock(&mock_server_lock);
         return NULL;
     }
 
     // create a new group
-    group_data *cur_group_data = &(group_data_set[group_data_set_insert_pos]);
+    reserve_group_data();
+    size_t group_data_find = group_data_set_insert_pos;
+    group_data *cur_group_data = &(group_data_set[group_data_find]);
 
     // generate a random address
     mock_random_group_address(&(cur_group_data->group_address));
+    char *group_key = address_key(cur_group_data->group_address);
+    insert_into_table(&group_table, group_key, group_data_find);
+    free(group_key);
 
     // prepare to store
     E2ees__GroupInfo *group_info = request->msg->group_info;
@@ -1011,7 +1331,7 @@ E2ees__CreateGroupResponse *mock_create_group(E2ees__E2eeAddress *from, const ch
 
     index_node *ptr;
     E2ees__E2eeAddress *to_member_address;
-    uint8_t member_pos;
+    size_t member_pos;
 
     // copy addresses and public key into common_member_ids
     for (i = 0; i < group_members_num; i++) {
@@ -1054,7 +1374,7 @@ E2ees__CreateGroupResponse *mock_create_group(E2ees__E2eeAddress *from, const ch
             to_member_address = ptr->device_address;
             member_pos = ptr->index;
 
-            group_record[member_pos][group_data_set_insert_pos] = true;
+            set_group_record(member_pos, group_data_find, true);
 
             if (safe_strcmp(sender_user_id, to_member_address->user->user_id)) {
                 if (compare_address(sender_address, to_member_address)) {
@@ -1111,41 +1431,28 @@ E2ees__CreateGroupResponse *mock_create_group(E2ees__E2eeAddress *from, const ch
     }
     free_mem((void **)&common_member_ids, sizeof(E2ees__GroupMemberInfo *) * to_member_addresses_total_num);
 
-    index_node *current, *next;
-    for (i = 0; i < group_members_num; i++) {
-        current = index_address_list[i];
-        while (current != NULL) {
-            next = current->next;
-            free_mem((void **)&current, sizeof(index_node));
-            current = next;
-        }
-    }
-    free_mem((void **)&index_address_list, sizeof(index_node *) * group_members_num);
+    free_index_nodes(index_address_list, group_members_num);
 
     // done
     group_data_set_insert_pos++;
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__AddGroupMembersResponse *mock_add_group_members(E2ees__E2eeAddress *from, const char *auth, E2ees__AddGroupMembersRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     E2ees__AddGroupMembersMsg *add_group_members_msg = NULL;
     copy_add_group_members_msg(&(add_group_members_msg), request->msg);
 
     // find the group
-    uint8_t group_data_find = 0;
-    while (group_data_find < group_data_set_insert_pos) {
-        if ((group_data_set[group_data_find].group_address) && (add_group_members_msg->group_info->group_address) &&
-            compare_address(group_data_set[group_data_find].group_address, add_group_members_msg->group_info->group_address)) {
-            break;
-        }
-        group_data_find++;
-    }
+    size_t group_data_find = find_group(add_group_members_msg->group_info->group_address);
 
     // data not found
-    if (group_data_find == group_data_set_insert_pos) {
+    if (group_data_find == index_not_found) {
         E2ees__AddGroupMembersResponse *response = (E2ees__AddGroupMembersResponse *)malloc(sizeof(E2ees__AddGroupMembersResponse));
         e2ees__add_group_members_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
@@ -1204,11 +1511,11 @@ E2ees__AddGroupMembersResponse *mock_add_group_members(E2ees__E2eeAddress *from,
 
     index_node *ptr;
     E2ees__E2eeAddress *to_member_address;
-    uint8_t member_pos;
+    size_t member_pos;
 
     // copy addresses and public key into adding_member_info_list
     size_t member_id_insert_pos = 0;
-    for (i = 0; i < adding_member_addresses_total_num; i++) {
+    for (i = 0; i < adding_members_num; i++) {
         ptr = adding_member_index_address_list[i];
 
         for (j = 0; j < adding_member_device_num_list[i]; j++) {
@@ -1250,7 +1557,7 @@ E2ees__AddGroupMembersResponse *mock_add_group_members(E2ees__E2eeAddress *from,
             to_member_address = ptr->device_address;
             member_pos = ptr->index;
 
-            group_record[member_pos][group_data_find] = true;
+            set_group_record(member_pos, group_data_find, true);
             if (safe_strcmp(sender_user_id, to_member_address->user->user_id)) {
                 if (compare_address(sender_address, to_member_address)) {
                     ptr = ptr->next;
@@ -1312,62 +1619,40 @@ E2ees__AddGroupMembersResponse *mock_add_group_members(E2ees__E2eeAddress *from,
     free_mem((void **)&adding_member_device_num_list, sizeof(size_t) * adding_members_num);
     free_mem((void **)&to_member_addresses_num_list, sizeof(size_t) * new_group_members_num);
 
-    index_node *current, *next;
-    for (i = 0; i < adding_members_num; i++) {
-        current = adding_member_index_address_list[i];
-        while (current != NULL) {
-            next = current->next;
-            free_mem((void **)&current, sizeof(index_node));
-            current = next;
-        }
-    }
-    free_mem((void **)&adding_member_index_address_list, sizeof(index_node *) * adding_members_num);
+    free_index_nodes(adding_member_index_address_list, adding_members_num);
 
-    for (i = 0; i < new_group_members_num; i++) {
-        current = index_address_list[i];
-        while (current != NULL) {
-            next = current->next;
-            free_mem((void **)&current, sizeof(index_node));
-            current = next;
-        }
-    }
-    free_mem((void **)&index_address_list, sizeof(index_node *) * new_group_members_num);
+    free_index_nodes(index_address_list, new_group_members_num);
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__AddGroupMemberDeviceResponse *mock_add_group_member_device(
     E2ees__E2eeAddress *from, const char *auth, E2ees__AddGroupMemberDeviceRequest *request
 ) {
-    uint8_t device_pos = find_address(request->msg->adding_member_device->member_address);
+    pthread_mutex_lock(&mock_server_lock);
+    size_t device_pos = find_address(request->msg->adding_member_device->member_address);
 
     // find the group
-    uint8_t group_data_find = 0;
-    while (group_data_find < group_data_set_insert_pos) {
-        if ((group_data_set[group_data_find].group_address) && (request->msg->group_info->group_address) &&
-            compare_address(group_data_set[group_data_find].group_address, request->msg->group_info->group_address)) {
-            break;
-        }
-        group_data_find++;
-    }
+    size_t group_data_find = find_group(request->msg->group_info->group_address);
 
     // data not found
-    if (group_data_find == group_data_set_insert_pos) {
+    if (group_data_find == index_not_found) {
         E2ees__AddGroupMemberDeviceResponse *response = (E2ees__AddGroupMemberDeviceResponse *)malloc(sizeof(E2ees__AddGroupMemberDeviceResponse));
         e2ees__add_group_member_device_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
-    if (device_invited_record[device_pos][group_data_find] == true) {
+    if (device_pos == index_not_found || check_and_set_invited_record(device_pos, group_data_find)) {
         E2ees__AddGroupMemberDeviceResponse *response = (E2ees__AddGroupMemberDeviceResponse *)malloc(sizeof(E2ees__AddGroupMemberDeviceResponse));
         e2ees__add_group_member_device_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_NOT_FOUND;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
-    device_invited_record[device_pos][group_data_find] = true;
-
     group_data *cur_group_data = &(group_data_set[group_data_find]);
 
     size_t group_members_num = cur_group_data->group_members_num;
@@ -1406,7 +1691,7 @@ E2ees__AddGroupMemberDeviceResponse *mock_add_group_member_device(
     size_t msg_len;
     index_node *ptr;
     E2ees__E2eeAddress *to_member_address;
-    uint8_t member_pos;
+    size_t member_pos;
     // send msg to all the other members in the group, including added members
     for (i = 0; i < group_members_num; i++) {
         ptr = index_address_list[i];
@@ -1415,7 +1700,7 @@ E2ees__AddGroupMemberDeviceResponse *mock_add_group_member_device(
             to_member_address = ptr->device_address;
             member_pos = ptr->index;
 
-            group_record[member_pos][group_data_find] = true;
+            set_group_record(member_pos, group_data_find, true);
             if (safe_strcmp(sender_user_id, to_member_address->user->user_id)) {
                 if (compare_address(sender_address, to_member_address)) {
                     ptr = ptr->next;
@@ -1472,23 +1757,16 @@ E2ees__AddGroupMemberDeviceResponse *mock_add_group_member_device(
 
     free_mem((void **)&to_member_addresses_num_list, sizeof(size_t) * group_members_num);
 
-    index_node *current, *next;
-    for (i = 0; i < group_members_num; i++) {
-        current = index_address_list[i];
-        while (current != NULL) {
-            next = current->next;
-            free_mem((void **)&current, sizeof(index_node));
-            current = next;
-        }
-    }
-    free_mem((void **)&index_address_list, sizeof(index_node *) * group_members_num);
+    free_index_nodes(index_address_list, group_members_num);
 
     e2ees__group_member_info__free_unpacked(adding_member_device_info, NULL);
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__RemoveGroupMembersResponse *mock_remove_group_members(E2ees__E2eeAddress *from, const char *auth, E2ees__RemoveGroupMembersRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     // remove_group_members_msg
     E2ees__RemoveGroupMembersMsg *remove_group_members_msg_to_remained = NULL;
     E2ees__RemoveGroupMembersMsg *remove_group_members_msg_to_removed = NULL;
@@ -1497,20 +1775,14 @@ E2ees__RemoveGroupMembersResponse *mock_remove_group_members(E2ees__E2eeAddress
     copy_remove_group_members_msg(&(remove_group_members_msg_to_removed), request->msg);
 
     // find the group
-    uint8_t group_data_find = 0;
-    while (group_data_find < group_data_set_insert_pos) {
-        if ((group_data_set[group_data_find].group_address) && (request->msg->group_info->group_address) &&
-            compare_address(group_data_set[group_data_find].group_address, request->msg->group_info->group_address)) {
-            break;
-        }
-        group_data_find++;
-    }
+    size_t group_data_find = find_group(request->msg->group_info->group_address);
 
     // data not found
-    if (group_data_find == group_data_set_insert_pos) {
+    if (group_data_find == index_not_found) {
         E2ees__RemoveGroupMembersResponse *response = (E2ees__RemoveGroupMembersResponse *)malloc(sizeof(E2ees__RemoveGroupMembersResponse));
         e2ees__remove_group_members_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
@@ -1567,7 +1839,7 @@ E2ees__RemoveGroupMembersResponse *mock_remove_group_members(E2ees__E2eeAddress
     // copy data into member_id
     index_node *ptr;
     E2ees__E2eeAddress *to_member_address;
-    uint8_t member_pos;
+    size_t member_pos;
     for (i = 0; i < new_group_members_num; i++) {
         ptr = index_address_list[i];
 
@@ -1619,11 +1891,13 @@ E2ees__RemoveGroupMembersResponse *mock_remove_group_members(E2ees__E2eeAddress
             to_member_address = ptr->device_address;
             member_pos = ptr->index;
 
-            group_record[member_pos][group_data_find] = false;
+            set_group_record(member_pos, group_data_find, false);
 
             if (safe_strcmp(sender_user_id, to_member_address->user->user_id)) {
-                if (compare_address(sender_address, to_member_address))
+                if (compare_address(sender_address, to_member_address)) {
+                    ptr = ptr->next;
                     continue;
+                }
             }
             E2ees__ProtoMsg *proto_msg = (E2ees__ProtoMsg *)malloc(sizeof(E2ees__ProtoMsg));
             e2ees__proto_msg__init(proto_msg);
@@ -1723,22 +1997,17 @@ E2ees__RemoveGroupMembersResponse *mock_remove_group_members(E2ees__E2eeAddress
     e2ees__remove_group_members_msg__free_unpacked(remove_group_members_msg_to_removed, NULL);
 
     free_mem((void **)&to_member_addresses_num_list, sizeof(size_t) * new_group_members_num);
+    free_mem((void **)&removed_member_addresses_num_list, sizeof(size_t) * removed_group_members_num);
 
-    index_node *current, *next;
-    for (i = 0; i < new_group_members_num; i++) {
-        current = index_address_list[i];
-        while (current != NULL) {
-            next = current->next;
-            free_mem((void **)&current, sizeof(index_node));
-            current = next;
-        }
-    }
-    free_mem((void **)&index_address_list, sizeof(index_node *) * new_group_members_num);
+    free_index_nodes(index_address_list, new_group_members_num);
+    free_index_nodes(removed_index_address_list, removed_group_members_num);
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
 E2ees__LeaveGroupResponse *mock_leave_group(E2ees__E2eeAddress *from, const char *auth, E2ees__LeaveGroupRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     E2ees__E2eeAddress *sender_address = request->msg->user_address;
     char *user_id = request->msg->user_address->user->user_id;
 
@@ -1748,22 +2017,16 @@ E2ees__LeaveGroupResponse *mock_leave_group(E2ees__E2eeAddress *from, const char
     copy_leave_group_msg(&(leave_group_msg), request->msg);
 
     // find the group
-    uint8_t group_data_find = 0;
-    while (group_data_find < group_data_set_insert_pos) {
-        if ((group_data_set[group_data_find].group_address) && (request->msg->group_address) &&
-            compare_address(group_data_set[group_data_find].group_address, request->msg->group_address)) {
-            break;
-        }
-        group_data_find++;
-    }
+    size_t group_data_find = find_group(request->msg->group_address);
 
     // data not found
-    if (group_data_find == group_data_set_insert_pos) {
+    if (group_data_find == index_not_found) {
         e2ees__leave_group_msg__free_unpacked(leave_group_msg, NULL);
 
         E2ees__LeaveGroupResponse *response = (E2ees__LeaveGroupResponse *)malloc(sizeof(E2ees__LeaveGroupResponse));
         e2ees__leave_group_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
@@ -1790,6 +2053,7 @@ E2ees__LeaveGroupResponse *mock_leave_group(E2ees__E2eeAddress *from, const char
                 E2ees__LeaveGroupResponse *response = (E2ees__LeaveGroupResponse *)malloc(sizeof(E2ees__LeaveGroupResponse));
                 e2ees__leave_group_response__init(response);
                 response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+                pthread_mutex_unlock(&mock_server_lock);
                 return response;
             }
             copy_group_member(&(temp_group_members[j]), (cur_group_data->group_member_list)[i]);
@@ -1863,10 +2127,27 @@ E2ees__LeaveGroupResponse *mock_leave_group(E2ees__E2eeAddress *from, const char
     e2ees__proto_msg__free_unpacked(proto_msg, NULL);
     free_mem((void **)&msg, msg_len);
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
+static bool is_address_in_list(E2ees__E2eeAddress *address, E2ees__E2eeAddress **address_list, size_t address_list_len) {
+    size_t i;
+    for (i = 0; i < address_list_len; i++) {
+        E2ees__E2eeAddress *cur = address_list[i];
+        if (cur->user != NULL && cur->user->device_id == NULL) {
+            // a user address covers all of the devices of the user
+            if (safe_strcmp(cur->domain, address->domain) && safe_strcmp(cur->user->user_id, address->user->user_id))
+                return true;
+        } else if (compare_address(cur, address)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 E2ees__SendGroupMsgResponse *mock_send_group_msg(E2ees__E2eeAddress *from, const char *auth, E2ees__SendGroupMsgRequest *request) {
+    pthread_mutex_lock(&mock_server_lock);
     E2ees__E2eeMsg *e2ee_msg = request->msg;
     size_t e2ee_msg_data_len = e2ees__e2ee_msg__get_packed_size(e2ee_msg);
     uint8_t e2ee_msg_data[e2ee_msg_data_len];
@@ -1877,19 +2158,14 @@ E2ees__SendGroupMsgResponse *mock_send_group_msg(E2ees__E2eeAddress *from, const
     E2ees__E2eeAddress *group_address = e2ee_msg->to;
 
     // find the group
-    uint8_t group_data_find = 0;
-    while (group_data_find < group_data_set_insert_pos) {
-        if ((group_data_set[group_data_find].group_address) && group_address && compare_address(group_data_set[group_data_find].group_address, group_address)) {
-            break;
-        }
-        group_data_find++;
-    }
+    size_t group_data_find = find_group(group_address);
 
     // data not found
-    if (group_data_find == group_data_set_insert_pos) {
+    if (group_data_find == index_not_found) {
         E2ees__SendGroupMsgResponse *response = (E2ees__SendGroupMsgResponse *)malloc(sizeof(E2ees__SendGroupMsgResponse));
         e2ees__send_group_msg_response__init(response);
         response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_INTERNAL_SERVER_ERROR;
+        pthread_mutex_unlock(&mock_server_lock);
         return response;
     }
 
@@ -1908,8 +2184,16 @@ E2ees__SendGroupMsgResponse *mock_send_group_msg(E2ees__E2eeAddress *from, const
         for (j = 0; j < to_member_addresses_num; j++) {
             E2ees__E2eeAddress *to_member_address = to_member_addresses[j];
             if (safe_strcmp(sender_user_id, to_member_address->user->user_id)) {
-                if (compare_address(sender_address, to_member_address))
+                if (compare_address(sender_address, to_member_address)) {
+                    e2ees__e2ee_address__free_unpacked(to_member_address, NULL);
                     continue;
+                }
+            }
+            // only the allowed and not denied devices receive the message
+            if ((request->n_allow_list > 0 && !is_address_in_list(to_member_address, request->allow_list, request->n_allow_list))
+                || is_address_in_list(to_member_address, request->deny_list, request->n_deny_list)) {
+                e2ees__e2ee_address__free_unpacked(to_member_address, NULL);
+                continue;
             }
             E2ees__ProtoMsg *proto_msg = (E2ees__ProtoMsg *)malloc(sizeof(E2ees__ProtoMsg));
             e2ees__proto_msg__init(proto_msg);
@@ -1946,6 +2230,7 @@ E2ees__SendGroupMsgResponse *mock_send_group_msg(E2ees__E2eeAddress *from, const
     e2ees__send_group_msg_response__init(response);
     response->code = E2EES__RESPONSE_CODE__RESPONSE_CODE_OK;
 
+    pthread_mutex_unlock(&mock_server_lock);
     return response;
 }
 
@@ -1960,3 +2245,16 @@ E2ees__ConsumeProtoMsgResponse *mock_consume_proto_msg(E2ees__E2eeAddress *from,
 
     return response;
 }
+
+E2ees__ConsumeProtoMsgResponse **mock_consume_proto_msgs(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__ConsumeProtoMsgRequest **requests, size_t request_num
+) {
+    E2ees__ConsumeProtoMsgResponse **responses = (E2ees__ConsumeProtoMsgResponse **)malloc(
+        sizeof(E2ees__ConsumeProtoMsgResponse *) * request_num
+    );
+    size_t i;
+    for (i = 0; i < request_num; i++) {
+        responses[i] = mock_consume_proto_msg(from, auth, requests[i]);
+    }
+    return responses;
+}
@@ -95,6 +95,54 @@ E2ees__SupplyOpksResponse *mock_supply_opks(E2ees__E2eeAddress *from, const char
  */
 E2ees__SendOne2oneMsgResponse *mock_send_one2one_msg(E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest *request);
 
+/**
+ * @brief Send a batch of one2one messages.
+ *
+ * @param from
+ * @param auth
+ * @param requests
+ * @param request_num
+ * @return E2ees__SendOne2oneMsgResponse**
+ */
+E2ees__SendOne2oneMsgResponse **mock_send_one2one_msgs(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest **requests, size_t request_num
+);
+
+/**
+ * @brief Invite a batch of devices.
+ *
+ * @param from
+ * @param auth
+ * @param requests
+ * @param request_num
+ * @return E2ees__InviteResponse**
+ */
+E2ees__InviteResponse **mock_invites(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__InviteRequest **requests, size_t request_num
+);
+
+/**
+ * @brief Submit a one2one message, which is delivered by mock_complete_one2one_msgs.
+ *
+ * @param from
+ * @param auth
+ * @param request
+ * @param completion
+ * @param context
+ * @return 0
+ */
+int mock_send_one2one_msg_async(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SendOne2oneMsgRequest *request,
+    e2ees_send_one2one_msg_completion_t completion, void *context
+);
+
+/**
+ * @brief Deliver the submitted one2one messages and call their completions.
+ *
+ * @return number of completed messages
+ */
+size_t mock_complete_one2one_msgs();
+
 /**
  * @brief Create a group object
  * 
@@ -167,4 +215,17 @@ E2ees__SendGroupMsgResponse *mock_send_group_msg(E2ees__E2eeAddress *from, const
  */
 E2ees__ConsumeProtoMsgResponse *mock_consume_proto_msg(E2ees__E2eeAddress *from, const char *auth, E2ees__ConsumeProtoMsgRequest *request);
 
+/**
+ * @brief Consume a batch of proto messages.
+ *
+ * @param from
+ * @param auth
+ * @param requests
+ * @param request_num
+ * @return E2ees__ConsumeProtoMsgResponse**
+ */
+E2ees__ConsumeProtoMsgResponse **mock_consume_proto_msgs(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__ConsumeProtoMsgRequest **requests, size_t request_num
+);
+
 #endif /* MOCK_SERVER_H_ */
@@ -20,79 +20,93 @@
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <pthread.h>
 #include <unistd.h>
 
 #include "e2ees/e2ees_client.h"
 
-#define QUEUE_SIZE 16384
+typedef struct proto_msg_node {
+    E2ees__ProtoMsg *proto_msg;
+    struct proto_msg_node *next;
+} proto_msg_node;
 
 pthread_mutex_t lock;
 bool running;
 pthread_t thread;
 
-E2ees__ProtoMsg *proto_msg_queue[QUEUE_SIZE];
-int proto_msg_queue_insert_head = 0;
-int proto_msg_queue_insert_tail = 0;
+// the queue grows with the traffic so that large groups can be fanned out
+static proto_msg_node *proto_msg_queue_head = NULL;
+static proto_msg_node *proto_msg_queue_tail = NULL;
 
 void send_proto_msg(E2ees__ProtoMsg *proto_msg) {
     // clone proto_msg
     size_t proto_msg_data_len = e2ees__proto_msg__get_packed_size(proto_msg);
-    uint8_t proto_msg_data[proto_msg_data_len];
+    uint8_t *proto_msg_data = (uint8_t *)malloc(proto_msg_data_len);
     e2ees__proto_msg__pack(proto_msg, proto_msg_data);
-    E2ees__ProtoMsg *cloned_proto_msg = e2ees__proto_msg__unpack(NULL, proto_msg_data_len, proto_msg_data);
+    proto_msg_node *node = (proto_msg_node *)malloc(sizeof(proto_msg_node));
+    node->proto_msg = e2ees__proto_msg__unpack(NULL, proto_msg_data_len, proto_msg_data);
+    node->next = NULL;
+    free(proto_msg_data);
 
     // keep proto_msg in proto_msg_queue
-    // printf("tail: %d", proto_msg_queue_insert_tail);
-    proto_msg_queue[proto_msg_queue_insert_tail] = cloned_proto_msg;
     pthread_mutex_lock(&lock);
-    proto_msg_queue_insert_tail++;
-    if (proto_msg_queue_insert_tail == QUEUE_SIZE)
-        proto_msg_queue_insert_tail = 0;
+    if (proto_msg_queue_tail == NULL) {
+        proto_msg_queue_head = node;
+    } else {
+        proto_msg_queue_tail->next = node;
+    }
+    proto_msg_queue_tail = node;
     pthread_mutex_unlock(&lock);
-    assert(proto_msg_queue_insert_tail != proto_msg_queue_insert_head);
-    // printf(" -> %d\n", proto_msg_queue_insert_tail);
 }
 
 static bool has_proto_msg_data() {
     bool has_data = false;
     pthread_mutex_lock(&lock);
-    has_data = (proto_msg_queue_insert_tail != proto_msg_queue_insert_head);
+    has_data = (proto_msg_queue_head != NULL);
     pthread_mutex_unlock(&lock);
     return has_data;    
 }
 
 void process_outgoing_queue() {
     while (running || has_proto_msg_data()) {
-        E2ees__ProtoMsg *proto_msg = proto_msg_queue[proto_msg_queue_insert_head];
+        // the head stays in the queue until it is processed
+        pthread_mutex_lock(&lock);
+        proto_msg_node *node = proto_msg_queue_head;
+        pthread_mutex_unlock(&lock);
 
-        if (proto_msg != NULL) {
-            // printf("head: %d", proto_msg_queue_insert_head);
+        if (node != NULL) {
             // send proto_msg to client
+            E2ees__ProtoMsg *proto_msg = node->proto_msg;
             size_t proto_msg_data_len = e2ees__proto_msg__get_packed_size(proto_msg);
-            uint8_t proto_msg_data[proto_msg_data_len];
+            uint8_t *proto_msg_data = (uint8_t *)malloc(proto_msg_data_len);
             e2ees__proto_msg__pack(proto_msg, proto_msg_data);
             E2ees__ConsumeProtoMsgResponse *consume_proto_msg_response = process_proto_msg(proto_msg_data, proto_msg_data_len);
 
             // release
+            free(proto_msg_data);
             e2ees__proto_msg__free_unpacked(proto_msg, NULL);
             e2ees__consume_proto_msg_response__free_unpacked(consume_proto_msg_response, NULL);
-            // remove processed proto_msg
-            proto_msg_queue[proto_msg_queue_insert_head] = NULL;
 
+            // remove processed proto_msg
             pthread_mutex_lock(&lock);
-            proto_msg_queue_insert_head++;
-            if (proto_msg_queue_insert_head == QUEUE_SIZE)
-                proto_msg_queue_insert_head = 0;
+            proto_msg_queue_head = node->next;
+            if (proto_msg_queue_head == NULL)
+                proto_msg_queue_tail = NULL;
             pthread_mutex_unlock(&lock);
-            // printf(" -> %d\n", proto_msg_queue_insert_head);
+            free(node);
         } else {
-            // printf("sleep\n");
-            usleep(100000);
+            usleep(1000);
         }
     }
 }
 
+void wait_mock_server_sending() {
+    while (has_proto_msg_data()) {
+        usleep(1000);
+    }
+}
+
 void start_mock_server_sending() {
     if (pthread_mutex_init(&lock, NULL) != 0) {
         printf("\n mutex init failed\n");
@@ -27,4 +27,6 @@ void start_mock_server_sending();
 
 void stop_mock_server_sending();
 
+void wait_mock_server_sending();
+
 #endif /* MOCK_SERVER_SENDING_H_ */
@@ -31,6 +31,12 @@
  * @section test_supply_opks
  * The client will be notified to generate a number of one-time pre-keys if the server finds that the one-time pre-keys are used up.
  * 
+ * @section test_lookup_opks
+ * The one-time pre-keys can be looked up and marked as used by id after new keys are appended and the used keys are released.
+ * 
+ * @section test_key_maintenance
+ * With a host scheduler, the one-time pre-keys asked by the server are generated in a scheduled task, and the signed pre-keys that are due are rotated by the key maintenance, which schedules its next pass.
+ * 
  * 
  * 
  * @defgroup Unit Unit test
@@ -219,6 +225,7 @@
 #include "e2ees/e2ees.h"
 #include "e2ees/e2ees_client.h"
 #include "e2ees/e2ees_client_internal.h"
+#include "e2ees/key_maintenance.h"
 
 #include "test_plugin.h"
 #include "test_util.h"
@@ -437,6 +444,12 @@ E2ees__ProtoMsg *mock_supply_opks_msg(E2ees__E2eeAddress *user_address, uint32_t
     return proto_msg;
 }
 
+static E2ees__SupplyOpksResponse *unavailable_supply_opks(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__SupplyOpksRequest *request
+) {
+    return NULL;
+}
+
 static void test_supply_opks() {
     // test start
     printf("====== test_supply_opks ======\n");
@@ -472,6 +485,46 @@ static void test_supply_opks() {
     E2ees__Account *account_new = NULL;
     get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account_new);
     assert(account_new->n_one_time_pre_key_list == (E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + supply_opks_num));
+    // the next one-time pre-key id is kept
+    assert(account_new->next_one_time_pre_key_id == account->next_one_time_pre_key_id + supply_opks_num);
+
+    // the second supply does not reuse the one-time pre-key ids
+    E2ees__ConsumeProtoMsgResponse *consume_proto_msg_response_2 = process_proto_msg(proto_msg_data, proto_msg_data_len);
+    E2ees__Account *account_new_2 = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account_new_2);
+    assert(account_new_2->n_one_time_pre_key_list == (E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + supply_opks_num * 2));
+    assert(account_new_2->next_one_time_pre_key_id == account->next_one_time_pre_key_id + supply_opks_num * 2);
+    size_t i, j;
+    for (i = 0; i < account_new_2->n_one_time_pre_key_list; i++) {
+        for (j = i + 1; j < account_new_2->n_one_time_pre_key_list; j++) {
+            assert(account_new_2->one_time_pre_key_list[i]->opk_id != account_new_2->one_time_pre_key_list[j]->opk_id);
+        }
+    }
+
+    // a supply that the server does not take keeps its private keys
+    E2ees__SupplyOpksResponse *(*real_supply_opks)(
+        E2ees__E2eeAddress *, const char *, E2ees__SupplyOpksRequest *
+    ) = get_e2ees_plugin()->proto_handler.supply_opks;
+    get_e2ees_plugin()->proto_handler.supply_opks = unavailable_supply_opks;
+    E2ees__Account *account_without_opks = NULL;
+    load_account_without_opks_internal(&account_without_opks, user_address);
+    E2ees__SupplyOpksResponse *supply_opks_response = NULL;
+    supply_opks_internal(&supply_opks_response, account_without_opks, supply_opks_num);
+    assert(supply_opks_response == NULL);
+    e2ees__account__free_unpacked(account_without_opks, NULL);
+    E2ees__Account *account_new_3 = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account_new_3);
+    assert(account_new_3->n_one_time_pre_key_list == (E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + supply_opks_num * 3));
+
+    // the pending supply is replayed with an account that is loaded without its one-time pre-keys
+    get_e2ees_plugin()->proto_handler.supply_opks = real_supply_opks;
+    load_account_without_opks_internal(&account_without_opks, user_address);
+    resume_connection_internal(account_without_opks);
+    e2ees__account__free_unpacked(account_without_opks, NULL);
+    E2ees__Account *account_new_4 = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account_new_4);
+    assert(account_new_4->n_one_time_pre_key_list == account_new_3->n_one_time_pre_key_list);
+    assert(account_new_4->next_one_time_pre_key_id == account_new_3->next_one_time_pre_key_id);
 
     // release
     free_proto(register_user_response);
@@ -480,6 +533,13 @@ static void test_supply_opks() {
         e2ees__account__free_unpacked(account_new, NULL);
         account_new = NULL;
     }
+    e2ees__account__free_unpacked(account_new_2, NULL);
+    e2ees__account__free_unpacked(account_new_3, NULL);
+    e2ees__account__free_unpacked(account_new_4, NULL);
+    free_proto(consume_proto_msg_response);
+    if (consume_proto_msg_response_2 != NULL) {
+        e2ees__consume_proto_msg_response__free_unpacked(consume_proto_msg_response_2, NULL);
+    }
     free_proto(proto_msg);
 
     // test stop
@@ -540,6 +600,174 @@ static void test_free_opks() {
     printf("====================================\n");
 }
 
+static void test_lookup_opks() {
+    // test start
+    printf("====== test_lookup_opks ======\n");
+    tear_up();
+    get_e2ees_plugin()->event_handler = test_event_handler;
+
+    uint32_t e2ees_pack_id = gen_e2ees_pack_id_ecc();
+    const char *user_name = "alice";
+    const char *user_id = "alice";
+    const char *device_id = generate_uuid_str();
+    const char *authenticator = "email";
+    const char *auth_code = "123456";
+    int ret = 0;
+    E2ees__RegisterUserResponse *register_user_response = NULL;
+    ret = register_user(
+        &register_user_response, e2ees_pack_id, user_name, user_id, device_id, authenticator, auth_code
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+
+    // load account
+    E2ees__Account *account = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account);
+    assert(account->n_one_time_pre_key_list == E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM);
+
+    uint32_t first_opk_id = account->one_time_pre_key_list[0]->opk_id;
+    size_t i;
+    for (i = 0; i < E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM; i++) {
+        assert(lookup_one_time_pre_key(account, first_opk_id + i) == account->one_time_pre_key_list[i]);
+    }
+
+    // the new keys are appended without being copied
+    size_t new_opks = 20;
+    E2ees__OneTimePreKey **one_time_pre_key_list = NULL;
+    ret = generate_opks(&one_time_pre_key_list, new_opks, e2ees_pack_id, account->next_one_time_pre_key_id);
+    assert(ret == E2EES_RESULT_SUCC);
+    E2ees__OneTimePreKey *last_opk = one_time_pre_key_list[new_opks - 1];
+    ret = insert_opks(account, one_time_pre_key_list, new_opks);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(account->n_one_time_pre_key_list == E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + new_opks);
+    assert(account->next_one_time_pre_key_id == last_opk->opk_id + 1);
+    assert(lookup_one_time_pre_key(account, last_opk->opk_id) == last_opk);
+
+    // mark the leading keys as used and release them
+    size_t used_opks = 60;
+    for (i = 0; i < used_opks; i++) {
+        assert(mark_opk_as_used(account, first_opk_id + i) == (int)(first_opk_id + i));
+    }
+    assert(lookup_one_time_pre_key(account, first_opk_id)->used == true);
+    free_one_time_pre_key(account);
+    assert(account->n_one_time_pre_key_list == E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + new_opks - used_opks);
+    assert(account->one_time_pre_key_list[0]->opk_id == first_opk_id + used_opks);
+    assert(lookup_one_time_pre_key(account, first_opk_id + used_opks) == account->one_time_pre_key_list[0]);
+    assert(lookup_one_time_pre_key(account, last_opk->opk_id) == last_opk);
+    assert(lookup_one_time_pre_key(account, first_opk_id) == NULL);
+    assert(mark_opk_as_used(account, first_opk_id) < 0);
+
+    // release
+    free_proto(register_user_response);
+    free_proto(account);
+
+    // test stop
+    tear_down();
+    printf("====================================\n");
+}
+
+#define MAX_SCHEDULED_TASKS 8
+
+static void (*scheduled_tasks[MAX_SCHEDULED_TASKS])(void *);
+static void *scheduled_task_args[MAX_SCHEDULED_TASKS];
+static size_t scheduled_tasks_num = 0;
+static int64_t (*real_gen_ts)() = NULL;
+
+static void mock_schedule_task(void (*task)(void *), void *task_arg, int64_t delay_ms) {
+    assert(scheduled_tasks_num < MAX_SCHEDULED_TASKS);
+    scheduled_tasks[scheduled_tasks_num] = task;
+    scheduled_task_args[scheduled_tasks_num] = task_arg;
+    scheduled_tasks_num++;
+}
+
+static size_t run_scheduled_tasks() {
+    // the tasks may schedule new tasks
+    size_t tasks_num = scheduled_tasks_num, i;
+    void (*tasks[MAX_SCHEDULED_TASKS])(void *);
+    void *task_args[MAX_SCHEDULED_TASKS];
+    memcpy(tasks, scheduled_tasks, sizeof(tasks[0]) * tasks_num);
+    memcpy(task_args, scheduled_task_args, sizeof(task_args[0]) * tasks_num);
+    scheduled_tasks_num = 0;
+    for (i = 0; i < tasks_num; i++) {
+        tasks[i](task_args[i]);
+    }
+    return tasks_num;
+}
+
+static int64_t mock_gen_ts_after_expiration() {
+    return real_gen_ts() + E2EES_SIGNED_PRE_KEY_EXPIRATION_MS;
+}
+
+static void test_key_maintenance() {
+    // test start
+    printf("====== test_key_maintenance ======\n");
+    tear_up();
+    get_e2ees_plugin()->event_handler = test_event_handler;
+    get_e2ees_plugin()->common_handler.schedule_task = mock_schedule_task;
+    real_gen_ts = get_e2ees_plugin()->common_handler.gen_ts;
+    scheduled_tasks_num = 0;
+
+    uint32_t e2ees_pack_id = gen_e2ees_pack_id_ecc();
+    const char *user_name = "alice";
+    const char *user_id = "alice";
+    const char *device_id = generate_uuid_str();
+    const char *authenticator = "email";
+    const char *auth_code = "123456";
+    int ret = 0;
+    E2ees__RegisterUserResponse *register_user_response = NULL;
+    ret = register_user(
+        &register_user_response, e2ees_pack_id, user_name, user_id, device_id, authenticator, auth_code
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+
+    // the one-time pre-keys are generated in the scheduled task
+    uint32_t supply_opks_num = 50;
+    E2ees__ProtoMsg *proto_msg = mock_supply_opks_msg(register_user_response->address, supply_opks_num);
+    size_t proto_msg_data_len = e2ees__proto_msg__get_packed_size(proto_msg);
+    uint8_t proto_msg_data[proto_msg_data_len];
+    e2ees__proto_msg__pack(proto_msg, proto_msg_data);
+    E2ees__ConsumeProtoMsgResponse *consume_proto_msg_response = process_proto_msg(proto_msg_data, proto_msg_data_len);
+    assert(scheduled_tasks_num == 1);
+
+    E2ees__Account *account = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account);
+    assert(account->n_one_time_pre_key_list == E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM);
+    free_proto(account);
+
+    assert(run_scheduled_tasks() == 1);
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account);
+    assert(account->n_one_time_pre_key_list == E2EES_ONE_TIME_PRE_KEY_INITIAL_NUM + supply_opks_num);
+    uint32_t old_spk_id = account->signed_pre_key->spk_id;
+    free_proto(account);
+
+    // nothing is due yet, the next pass is scheduled
+    assert(maintain_keys() == 0);
+    assert(scheduled_tasks_num == 1);
+
+    // the signed pre-key is rotated by the scheduled pass once it is due
+    get_e2ees_plugin()->common_handler.gen_ts = mock_gen_ts_after_expiration;
+    assert(run_scheduled_tasks() == 1);
+    get_e2ees_plugin()->db_handler.load_account_by_address(register_user_response->address, &account);
+    assert(account->signed_pre_key->spk_id == old_spk_id + 1);
+    assert(scheduled_tasks_num == 1);
+
+    // only one pass is scheduled at a time
+    assert(maintain_keys() == 0);
+    assert(scheduled_tasks_num == 1);
+
+    // release
+    get_e2ees_plugin()->common_handler.gen_ts = real_gen_ts;
+    get_e2ees_plugin()->common_handler.schedule_task = NULL;
+    scheduled_tasks_num = 0;
+    free_proto(register_user_response);
+    free_proto(account);
+    free_proto(proto_msg);
+    free_proto(consume_proto_msg_response);
+
+    // test stop
+    tear_down();
+    printf("====================================\n");
+}
+
 int main() {
     // unit test
     test_generate_identity_key();
@@ -553,6 +781,8 @@ int main() {
     test_publish_spk();
     test_supply_opks();
     test_free_opks();
+    test_lookup_opks();
+    test_key_maintenance();
 
     return 0;
 }
@@ -24,6 +24,7 @@
 #include "e2ees/account.h"
 #include "e2ees/cipher.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/e2ees.h"
 
@@ -135,9 +136,145 @@ void test_store_and_load_account() {
     tear_down();
 }
 
+void test_load_account_headers() {
+    fprintf(stderr, "test_load_account_headers\n");
+    tear_up();
+
+    // mock
+    E2ees__Account *account = NULL;
+    mock_account(&account);
+    store_account(account);
+
+    // no pending request yet
+    e2ees_account_header_t *account_headers = NULL;
+    size_t account_headers_num = load_account_headers(&account_headers);
+    assert(account_headers_num == 1);
+    assert(compare_address(account_headers[0].address, account->address));
+    assert(account_headers[0].e2ees_pack_id == account->e2ees_pack_id);
+    assert(account_headers[0].pending_request_num == 0);
+    assert(account_headers[0].session_establishment_num == 0);
+    free_account_headers(&account_headers, account_headers_num);
+
+    // store two pending requests
+    uint8_t request_data[] = {1, 2, 3};
+    store_pending_request_data(
+        account->address, "request_1",
+        E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG, request_data, sizeof(request_data)
+    );
+    store_pending_request_data(
+        account->address, "request_2",
+        E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG, request_data, sizeof(request_data)
+    );
+    account_headers_num = load_account_headers(&account_headers);
+    assert(account_headers_num == 1);
+    assert(account_headers[0].pending_request_num == 2);
+    assert(account_headers[0].session_establishment_num == 0);
+    free_account_headers(&account_headers, account_headers_num);
+
+    // store an unfinished session establishment
+    E2ees__E2eeAddress *their_address = NULL;
+    mock_address(&their_address, "bob", "bob's domain", "bob's device");
+    store_session_establishment(account->address, their_address, E2EES_SESSION_ESTABLISHMENT_STEP_INVITE, 1);
+    account_headers_num = load_account_headers(&account_headers);
+    assert(account_headers_num == 1);
+    assert(account_headers[0].session_establishment_num == 1);
+
+    // release
+    free_account_headers(&account_headers, account_headers_num);
+    e2ees__e2ee_address__free_unpacked(their_address, NULL);
+    free_proto(account);
+
+    tear_down();
+}
+
+void test_load_identity_key_and_opk() {
+    fprintf(stderr, "test_load_identity_key_and_opk\n");
+    tear_up();
+
+    // mock
+    E2ees__Account *account = NULL;
+    mock_account(&account);
+    store_account(account);
+
+    // load identity key only
+    E2ees__IdentityKey *identity_key = NULL;
+    load_identity_key(account->address, &identity_key);
+    assert(is_equal_ik(identity_key, account->identity_key));
+
+    // load one-time pre-key by id
+    E2ees__OneTimePreKey *expected_opk = account->one_time_pre_key_list[account->n_one_time_pre_key_list - 1];
+    E2ees__OneTimePreKey *one_time_pre_key = NULL;
+    load_one_time_pre_key(account->address, expected_opk->opk_id, &one_time_pre_key);
+    assert(is_equal_opk(one_time_pre_key, expected_opk));
+
+    E2ees__OneTimePreKey *one_time_pre_key_null = NULL;
+    load_one_time_pre_key(account->address, account->next_one_time_pre_key_id + 100, &one_time_pre_key_null);
+    assert(one_time_pre_key_null == NULL);
+
+    // lookup falls back to the db if the account is loaded without one-time pre-keys
+    E2ees__Account *account_without_opks = NULL;
+    copy_account_from_account(&account_without_opks, account);
+    size_t i;
+    for (i = 0; i < account_without_opks->n_one_time_pre_key_list; i++) {
+        e2ees__one_time_pre_key__free_unpacked(account_without_opks->one_time_pre_key_list[i], NULL);
+    }
+    free(account_without_opks->one_time_pre_key_list);
+    account_without_opks->one_time_pre_key_list = NULL;
+    account_without_opks->n_one_time_pre_key_list = 0;
+    E2ees__OneTimePreKey *found_opk = lookup_one_time_pre_key(account_without_opks, expected_opk->opk_id);
+    assert(is_equal_opk(found_opk, expected_opk));
+    assert(account_without_opks->n_one_time_pre_key_list == 1);
+
+    // release
+    e2ees__identity_key__free_unpacked(identity_key, NULL);
+    e2ees__one_time_pre_key__free_unpacked(one_time_pre_key, NULL);
+    e2ees__account__free_unpacked(account_without_opks, NULL);
+    free_proto(account);
+
+    tear_down();
+}
+
+void test_load_account_without_opks() {
+    fprintf(stderr, "test_load_account_without_opks\n");
+    tear_up();
+
+    // mock
+    E2ees__Account *account = NULL;
+    mock_account(&account);
+    store_account(account);
+
+    // the account is loaded without the one-time pre-keys
+    E2ees__Account *account_without_opks = NULL;
+    int ret = load_account_without_opks_internal(&account_without_opks, account->address);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(is_equal_ik(account_without_opks->identity_key, account->identity_key));
+    assert(account_without_opks->n_one_time_pre_key_list == 0);
+    assert(account_without_opks->next_one_time_pre_key_id == account->next_one_time_pre_key_id);
+
+    // the used one-time pre-keys are loaded on demand and kept in the order of the ids
+    E2ees__OneTimePreKey *last_opk = account->one_time_pre_key_list[account->n_one_time_pre_key_list - 1];
+    E2ees__OneTimePreKey *first_opk = account->one_time_pre_key_list[0];
+    assert(is_equal_opk(lookup_one_time_pre_key(account_without_opks, last_opk->opk_id), last_opk));
+    assert(is_equal_opk(lookup_one_time_pre_key(account_without_opks, first_opk->opk_id), first_opk));
+    assert(account_without_opks->n_one_time_pre_key_list == 2);
+    assert(account_without_opks->one_time_pre_key_list[0]->opk_id == first_opk->opk_id);
+    assert(account_without_opks->one_time_pre_key_list[1]->opk_id == last_opk->opk_id);
+    assert(mark_opk_as_used(account_without_opks, last_opk->opk_id) == (int)(last_opk->opk_id));
+    assert(account_without_opks->one_time_pre_key_list[1]->used == true);
+
+    // release
+    e2ees__account__free_unpacked(account_without_opks, NULL);
+    free_proto(account);
+
+    tear_down();
+}
+
 int main() {
     test_setup();
     test_setup_call_twice();
     test_insert_address();
     test_store_and_load_account();
+    test_load_account_headers();
+    test_load_identity_key_and_opk();
+    test_load_account_without_opks();
 }
@@ -17,6 +17,7 @@
  * along with E2EE Security.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -25,6 +26,7 @@
 #include "e2ees/account.h"
 #include "e2ees/account_manager.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/session_manager.h"
 
@@ -254,6 +256,148 @@ static void test_e2ees_pack_id() {
     printf("====================================\n");
 }
 
+#define e2ees_pack_task_num 8
+
+typedef struct e2ees_pack_task_t {
+    e2ees_pack_t *e2ees_packs[
+        (sizeof(digital_signature_data_all) / sizeof(unsigned)) * (sizeof(kem_data_all) / sizeof(unsigned))
+    ];
+} e2ees_pack_task_t;
+
+static void *run_thread(void *arg) {
+    void **thread_args = (void **)arg;
+    ((void (*)(void *))thread_args[0])(thread_args[1]);
+    return NULL;
+}
+
+static void threaded_run_tasks(void (*task)(void *), void **task_args, size_t task_num, size_t max_concurrency) {
+    pthread_t threads[e2ees_pack_task_num];
+    void *thread_args[e2ees_pack_task_num][2];
+    size_t i;
+
+    assert(task_num <= e2ees_pack_task_num);
+    for (i = 0; i < task_num; i++) {
+        thread_args[i][0] = (void *)task;
+        thread_args[i][1] = task_args[i];
+        pthread_create(&threads[i], NULL, run_thread, thread_args[i]);
+    }
+    for (i = 0; i < task_num; i++) {
+        pthread_join(threads[i], NULL);
+    }
+}
+
+static void resolve_e2ees_packs_task(void *arg) {
+    e2ees_pack_task_t *task = (e2ees_pack_task_t *)arg;
+    size_t ds_num = sizeof(digital_signature_data_all) / sizeof(unsigned);
+    size_t kem_num = sizeof(kem_data_all) / sizeof(unsigned);
+    size_t i, j;
+
+    for (i = 0; i < ds_num; i++) {
+        for (j = 0; j < kem_num; j++) {
+            uint32_t e2ees_pack_id_raw = mock_e2ees_pack_id(digital_signature_data_all[i], kem_data_all[j]);
+            e2ees_pack_t *e2ees_pack = get_e2ees_pack(e2ees_pack_id_raw);
+            // the pack of another id resolved in the meantime must not change this one
+            assert(get_e2ees_pack(mock_e2ees_pack_id(E2EES_PACK_ALG_DS_CURVE25519, E2EES_PACK_ALG_KEM_CURVE25519)) != e2ees_pack);
+            assert(e2ees_pack->cipher_suite->ds_suite == get_ds_suite(digital_signature_data_all[i]));
+            assert(e2ees_pack->cipher_suite->kem_suite == get_kem_suite(kem_data_all[j]));
+            task->e2ees_packs[i * kem_num + j] = e2ees_pack;
+        }
+    }
+}
+
+static void test_e2ees_pack_threads() {
+    // test start
+    printf("test_e2ees_pack_threads begin!!!\n");
+    tear_up();
+
+    e2ees_plugin_t *plugin = get_e2ees_plugin();
+    plugin->common_handler.run_tasks = threaded_run_tasks;
+
+    e2ees_pack_task_t tasks[e2ees_pack_task_num];
+    void *task_args[e2ees_pack_task_num];
+    size_t i, j;
+    for (i = 0; i < e2ees_pack_task_num; i++) {
+        task_args[i] = &tasks[i];
+    }
+    run_tasks_internal(resolve_e2ees_packs_task, task_args, e2ees_pack_task_num, e2ees_pack_task_num);
+
+    // every thread gets the same pack for the same id
+    size_t pack_num = (sizeof(digital_signature_data_all) / sizeof(unsigned)) * (sizeof(kem_data_all) / sizeof(unsigned));
+    for (i = 1; i < e2ees_pack_task_num; i++) {
+        for (j = 0; j < pack_num; j++) {
+            assert(tasks[i].e2ees_packs[j] == tasks[0].e2ees_packs[j]);
+        }
+    }
+    for (j = 0; j < pack_num; j++) {
+        assert(tasks[0].e2ees_packs[j]->session_suite == get_e2ees_pack(E2EES_PACK_ID_V_0_DEFAULT)->session_suite);
+    }
+
+    // test stop
+    plugin->common_handler.run_tasks = NULL;
+    tear_down();
+    printf("====================================\n");
+}
+
+static ds_suite_t counting_ds_suite;
+static size_t counting_ds_verify_calls = 0;
+
+static int counting_ds_verify(
+    const uint8_t *signature_in, size_t signature_in_len,
+    const uint8_t *msg, size_t msg_len,
+    const uint8_t *public_key
+) {
+    counting_ds_verify_calls++;
+    return get_ds_suite(E2EES_PACK_ALG_DS_MLDSA87)->verify(signature_in, signature_in_len, msg, msg_len, public_key);
+}
+
+static void test_verified_signature_cache() {
+    // test start
+    printf("test_verified_signature_cache begin!!!\n");
+    tear_up();
+
+    counting_ds_suite = *get_ds_suite(E2EES_PACK_ALG_DS_MLDSA87);
+    counting_ds_suite.verify = counting_ds_verify;
+    counting_ds_verify_calls = 0;
+
+    ProtobufCBinaryData public_key = {0, NULL}, private_key = {0, NULL};
+    counting_ds_suite.sign_key_gen(&public_key, &private_key);
+    size_t signature_len = counting_ds_suite.get_crypto_param().sig_len;
+    uint8_t *signature = (uint8_t *)malloc(sizeof(uint8_t) * signature_len);
+    counting_ds_suite.sign(signature, &signature_len, test_plaintext, sizeof(test_plaintext) - 1, private_key.data);
+
+    // the second verification is answered by the cache
+    int ret = verify_signature_internal(
+        &counting_ds_suite, signature, signature_len, test_plaintext, sizeof(test_plaintext) - 1, public_key.data
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+    ret = verify_signature_internal(
+        &counting_ds_suite, signature, signature_len, test_plaintext, sizeof(test_plaintext) - 1, public_key.data
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(counting_ds_verify_calls == 1);
+
+    // a tampered signature is verified and rejected every time
+    signature[0] ^= 0x01;
+    ret = verify_signature_internal(
+        &counting_ds_suite, signature, signature_len, test_plaintext, sizeof(test_plaintext) - 1, public_key.data
+    );
+    assert(ret != E2EES_RESULT_SUCC);
+    ret = verify_signature_internal(
+        &counting_ds_suite, signature, signature_len, test_plaintext, sizeof(test_plaintext) - 1, public_key.data
+    );
+    assert(ret != E2EES_RESULT_SUCC);
+    assert(counting_ds_verify_calls == 3);
+
+    // release
+    free_mem((void **)&signature, counting_ds_suite.get_crypto_param().sig_len);
+    free_protobuf(&public_key);
+    free_protobuf(&private_key);
+
+    // test stop
+    tear_down();
+    printf("====================================\n");
+}
+
 static void test_one_to_one_session_selected() {
     // test start
     printf("test_one_to_one_session_selected begin!!!\n");
@@ -365,6 +509,8 @@ static void test_one_to_one_session_all() {
 
 int main() {
     test_e2ees_pack_id();
+    test_e2ees_pack_threads();
+    test_verified_signature_cache();
     test_one_to_one_session_selected();
     // test_one_to_one_session_all();
 
@@ -244,6 +244,7 @@
  * @}
  * 
  */
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -346,6 +347,9 @@ static E2ees__Account *account_data[account_data_max];
 
 static uint8_t account_data_insert_pos;
 
+// the number of group messages received by each account
+static atomic_size_t group_msg_received_num[account_data_max];
+
 typedef struct store_group {
     E2ees__E2eeAddress *group_address;
     char *group_name;
@@ -387,6 +391,13 @@ static void on_other_device_msg_received(E2ees__E2eeAddress *user_address, E2ees
 }
 
 static void on_group_msg_received(E2ees__E2eeAddress *user_address, E2ees__E2eeAddress *from_address, E2ees__E2eeAddress *group_address, uint8_t *plaintext, size_t plaintext_len) {
+    size_t i;
+    for (i = 0; i < account_data_max; i++) {
+        if (account_data[i] != NULL && compare_address(account_data[i]->address, user_address)) {
+            atomic_fetch_add(&(group_msg_received_num[i]), 1);
+            break;
+        }
+    }
     if (safe_strcmp(user_address->user->user_id, from_address->user->user_id)) {
         print_msg("on_group_msg_received(from other devices): plaintext", plaintext, plaintext_len);
     } else {
@@ -448,6 +459,7 @@ static void test_begin() {
     int i;
     for (i = 0; i < account_data_max; i++) {
         account_data[i] = NULL;
+        atomic_store(&(group_msg_received_num[i]), 0);
     }
     account_data_insert_pos = 0;
 
@@ -524,6 +536,95 @@ static void test_encryption(
     }
 }
 
+static E2ees__GroupMember *mock_indexed_group_member(size_t i, E2ees__GroupRole role) {
+    char user_id[32];
+    snprintf(user_id, sizeof(user_id), "user_%zu", i);
+    E2ees__GroupMember *member = (E2ees__GroupMember *)malloc(sizeof(E2ees__GroupMember));
+    e2ees__group_member__init(member);
+    member->user_id = strdup(user_id);
+    member->domain = strdup(E2EELAB_DOMAIN);
+    member->role = role;
+    return member;
+}
+
+static void test_group_member_index() {
+    // test start
+    printf("test_group_member_index begin!!!\n");
+
+    size_t old_members_num = 10000, i;
+    E2ees__GroupInfo *group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_info);
+    group_info->group_name = strdup("index group");
+    group_info->n_group_member_list = old_members_num;
+    group_info->group_member_list = (E2ees__GroupMember **)malloc(sizeof(E2ees__GroupMember *) * old_members_num);
+    for (i = 0; i < old_members_num; i++)
+        group_info->group_member_list[i] = mock_indexed_group_member(i, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER);
+
+    // two of the adding members are in the group already
+    E2ees__GroupMember *adding_members[4] = {
+        mock_indexed_group_member(old_members_num, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER),
+        mock_indexed_group_member(7, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER),
+        mock_indexed_group_member(old_members_num + 1, E2EES__GROUP_ROLE__GROUP_ROLE_MANAGER),
+        mock_indexed_group_member(old_members_num - 1, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER)
+    };
+    E2ees__GroupInfo *added_group_info = NULL;
+    add_group_members_to_group_info(&added_group_info, group_info, adding_members, 4);
+    assert(added_group_info->n_group_member_list == old_members_num + 2);
+    assert(safe_strcmp(added_group_info->group_member_list[old_members_num]->user_id, adding_members[0]->user_id));
+    assert(safe_strcmp(added_group_info->group_member_list[old_members_num + 1]->user_id, adding_members[2]->user_id));
+
+    // the removing members do not need to follow the order of the group
+    E2ees__GroupMember *removing_members[3] = {
+        mock_indexed_group_member(old_members_num + 1, E2EES__GROUP_ROLE__GROUP_ROLE_MANAGER),
+        mock_indexed_group_member(3, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER),
+        mock_indexed_group_member(0, E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER)
+    };
+    E2ees__GroupInfo *removed_group_info = NULL;
+    remove_group_members_from_group_info(&removed_group_info, added_group_info, removing_members, 3);
+    assert(removed_group_info->n_group_member_list == old_members_num - 1);
+    group_member_index_t index;
+    init_group_member_index(&index, removed_group_info->group_member_list, removed_group_info->n_group_member_list);
+    size_t position;
+    assert(!find_group_member_in_index(&index, "user_0", E2EELAB_DOMAIN, NULL));
+    assert(!find_group_member_in_index(&index, "user_3", E2EELAB_DOMAIN, NULL));
+    assert(find_group_member_in_index(&index, "user_1", E2EELAB_DOMAIN, &position) && position == 0);
+    assert(find_group_member_in_index(&index, "user_4", E2EELAB_DOMAIN, &position) && position == 2);
+    assert(!find_group_member_in_index(&index, "user_4", "other.domain", NULL));
+    free_group_member_index(&index);
+
+    // duplicated member info is collapsed and the role is taken from the member list
+    E2ees__GroupMemberInfo *member_info_list[3];
+    for (i = 0; i < 3; i++) {
+        member_info_list[i] = (E2ees__GroupMemberInfo *)malloc(sizeof(E2ees__GroupMemberInfo));
+        e2ees__group_member_info__init(member_info_list[i]);
+    }
+    mock_address(&(member_info_list[0]->member_address), adding_members[2]->user_id, E2EELAB_DOMAIN, "device_1");
+    mock_address(&(member_info_list[1]->member_address), adding_members[2]->user_id, E2EELAB_DOMAIN, "device_2");
+    mock_address(&(member_info_list[2]->member_address), "user_5", E2EELAB_DOMAIN, "device_1");
+    E2ees__GroupMember **converted_members = NULL;
+    size_t converted_members_num = member_info_to_group_members(
+        &converted_members, member_info_list, 3,
+        added_group_info->group_member_list, added_group_info->n_group_member_list
+    );
+    assert(converted_members_num == 2);
+    assert(converted_members[0]->role == E2EES__GROUP_ROLE__GROUP_ROLE_MANAGER);
+    assert(safe_strcmp(converted_members[1]->user_id, "user_5"));
+
+    // release
+    for (i = 0; i < 3; i++)
+        e2ees__group_member_info__free_unpacked(member_info_list[i], NULL);
+    free_group_members(&converted_members, converted_members_num);
+    for (i = 0; i < 4; i++)
+        e2ees__group_member__free_unpacked(adding_members[i], NULL);
+    for (i = 0; i < 3; i++)
+        e2ees__group_member__free_unpacked(removing_members[i], NULL);
+    e2ees__group_info__free_unpacked(group_info, NULL);
+    e2ees__group_info__free_unpacked(added_group_info, NULL);
+    e2ees__group_info__free_unpacked(removed_group_info, NULL);
+
+    printf("====================================\n");
+}
+
 static void test_create_group() {
     // test start
     printf("test_create_group begin!!!\n");
@@ -946,6 +1047,191 @@ static void test_continual() {
     printf("====================================\n");
 }
 
+static void test_pipelined_send() {
+    // test start
+    printf("test_pipelined_send begin!!!\n");
+    tear_up();
+    test_begin();
+
+    // prepare account
+    mock_user_pqc_account("Alice", "alice@domain.com.tw", "123456");
+    mock_user_pqc_account("Bob", "bob@domain.com.tw", "234567");
+    mock_user_pqc_account("Claire", "claire@domain.com.tw", "345678");
+
+    size_t i;
+    E2ees__E2eeAddress *address_list[3];
+    char *user_id_list[3];
+    char *domain_list[3];
+    for (i = 0; i < 3; i++) {
+        address_list[i] = account_data[i]->address;
+        user_id_list[i] = account_data[i]->address->user->user_id;
+        domain_list[i] = account_data[i]->address->domain;
+    }
+
+    sleep(2);
+    E2ees__GroupMember **group_members = NULL;
+    malloc_group_members(3);
+
+    // create the group
+    E2ees__CreateGroupResponse *create_group_response = NULL;
+    ret = create_group(&create_group_response, address_list[0], "Group name", group_members, 3);
+    E2ees__E2eeAddress *group_address = create_group_response->group_address;
+
+    sleep(2);
+
+    E2ees__GroupSession *outbound_group_session = NULL;
+    get_e2ees_plugin()->db_handler.load_group_session_by_address(
+        address_list[0], address_list[0], group_address, &outbound_group_session
+    );
+    uint32_t first_sequence = outbound_group_session->sequence;
+    e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+
+    // Alice sends a batch of messages without waiting for each ack
+    size_t msg_num = 32;
+    uint8_t plaintext_data[] = "This message is sent in a batch.";
+    const uint8_t *plaintext_data_list[32];
+    size_t plaintext_data_len_list[32];
+    for (i = 0; i < msg_num; i++) {
+        plaintext_data_list[i] = plaintext_data;
+        plaintext_data_len_list[i] = sizeof(plaintext_data) - 1;
+    }
+    E2ees__SendGroupMsgResponse **responses = NULL;
+    ret = send_group_msgs(
+        &responses, address_list[0], group_address, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
+        plaintext_data_list, plaintext_data_len_list, msg_num
+    );
+    assert(ret == 0);
+    for (i = 0; i < msg_num; i++) {
+        assert(responses[i] != NULL);
+        e2ees__send_group_msg_response__free_unpacked(responses[i], NULL);
+    }
+    free(responses);
+
+    // every message took its own sequence
+    get_e2ees_plugin()->db_handler.load_group_session_by_address(
+        address_list[0], address_list[0], group_address, &outbound_group_session
+    );
+    assert(outbound_group_session->sequence == first_sequence + msg_num);
+    e2ees__group_session__free_unpacked(outbound_group_session, NULL);
+
+    // a single message continues after the batch
+    test_encryption(address_list[0], group_address, plaintext_data, sizeof(plaintext_data) - 1);
+
+    // release
+    free_group_members(&group_members, 3);
+    free_proto(create_group_response);
+
+    // test stop
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
+static void test_recipient_filter() {
+    // test start
+    printf("test_recipient_filter begin!!!\n");
+    tear_up();
+    test_begin();
+
+    // prepare account
+    mock_user_pqc_account("Alice", "alice@domain.com.tw", "123456");
+    mock_user_pqc_account("Bob", "bob@domain.com.tw", "234567");
+    mock_user_pqc_account("Claire", "claire@domain.com.tw", "345678");
+
+    size_t i;
+    E2ees__E2eeAddress *address_list[3];
+    char *user_id_list[3];
+    char *domain_list[3];
+    for (i = 0; i < 3; i++) {
+        address_list[i] = account_data[i]->address;
+        user_id_list[i] = account_data[i]->address->user->user_id;
+        domain_list[i] = account_data[i]->address->domain;
+    }
+
+    sleep(2);
+    E2ees__GroupMember **group_members = NULL;
+    malloc_group_members(3);
+
+    // create the group
+    E2ees__CreateGroupResponse *create_group_response = NULL;
+    ret = create_group(&create_group_response, address_list[0], "Group name", group_members, 3);
+    E2ees__E2eeAddress *group_address = create_group_response->group_address;
+
+    sleep(2);
+
+    // the lists are sorted and the duplicated addresses are dropped
+    e2ees_group_msg_filter_t *filter = NULL, *deny_filter = NULL, *filter_1 = NULL, *filter_2 = NULL;
+    E2ees__E2eeAddress *bob_and_claire[3] = {address_list[1], address_list[2], address_list[1]};
+    E2ees__E2eeAddress *claire_and_bob[2] = {address_list[2], address_list[1]};
+    ret = new_group_msg_filter(&filter_1, bob_and_claire, 3, NULL, 0);
+    assert(ret == 0);
+    ret = new_group_msg_filter(&filter_2, claire_and_bob, 2, NULL, 0);
+    assert(ret == 0);
+    assert(filter_1->allow_list_len == 2);
+    assert(filter_2->allow_list_len == 2);
+    for (i = 0; i < 2; i++) {
+        assert(compare_address(filter_1->allow_list[i], filter_2->allow_list[i]));
+    }
+
+    ret = new_group_msg_filter(&filter, &(address_list[1]), 1, NULL, 0);
+    assert(ret == 0);
+    ret = new_group_msg_filter(&deny_filter, NULL, 0, &(address_list[1]), 1);
+    assert(ret == 0);
+
+    // an empty filter is refused
+    e2ees_group_msg_filter_t *empty_filter = NULL;
+    ret = new_group_msg_filter(&empty_filter, NULL, 0, NULL, 0);
+    assert(ret != 0);
+    assert(empty_filter == NULL);
+
+    // Alice sends messages to Bob only, reusing the filter
+    uint8_t plaintext_data[] = "This message will be sent to Bob only.";
+    size_t plaintext_data_len = sizeof(plaintext_data) - 1;
+    for (i = 0; i < 10; i++) {
+        E2ees__SendGroupMsgResponse *response = NULL;
+        ret = send_group_msg_with_recipient_filter(
+            &response, address_list[0], group_address, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
+            plaintext_data, plaintext_data_len, filter
+        );
+        assert(ret == 0);
+        e2ees__send_group_msg_response__free_unpacked(response, NULL);
+    }
+    sleep(2);
+    assert(atomic_load(&(group_msg_received_num[0])) == 0);
+    assert(atomic_load(&(group_msg_received_num[1])) == 10);
+    assert(atomic_load(&(group_msg_received_num[2])) == 0);
+
+    // the filter is intact after being lent to the requests
+    assert(filter->allow_list_len == 1);
+    assert(compare_address(filter->allow_list[0], address_list[1]));
+
+    // Alice sends a message to everyone but Bob
+    E2ees__SendGroupMsgResponse *deny_response = NULL;
+    ret = send_group_msg_with_recipient_filter(
+        &deny_response, address_list[0], group_address, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL,
+        plaintext_data, plaintext_data_len, deny_filter
+    );
+    assert(ret == 0);
+    e2ees__send_group_msg_response__free_unpacked(deny_response, NULL);
+    sleep(2);
+    assert(atomic_load(&(group_msg_received_num[0])) == 0);
+    assert(atomic_load(&(group_msg_received_num[1])) == 10);
+    assert(atomic_load(&(group_msg_received_num[2])) == 1);
+
+    // release
+    free_group_msg_filter(&filter);
+    free_group_msg_filter(&deny_filter);
+    free_group_msg_filter(&filter_1);
+    free_group_msg_filter(&filter_2);
+    free_group_members(&group_members, 3);
+    free_proto(create_group_response);
+
+    // test stop
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
 static void test_multiple_devices() {
     // test start
     printf("test_multiple_devices begin!!!\n");
@@ -1238,12 +1524,15 @@ static void test_create_group_time() {
 }
 
 int main() {
+    test_group_member_index();
     test_create_group();
     test_add_group_members();
     test_remove_group_members();
     test_create_add_remove();
     test_leave_group();
     test_continual();
+    test_pipelined_send();
+    test_recipient_filter();
     test_multiple_devices();
     test_add_new_device();
     test_medium_group();
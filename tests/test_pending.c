@@ -22,11 +22,15 @@
 
 #include "e2ees/cipher.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/crypto.h"
 #include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session.h"
 #include "e2ees/mem_util.h"
+#include "e2ees/pending_request_cache.h"
 #include "e2ees/session_manager.h"
 
+#include "mock_db.h"
+#include "mock_server.h"
 #include "test_util.h"
 #include "test_plugin.h"
 
@@ -352,6 +356,289 @@ static void test_pending_request_data() {
     tear_down();
 }
 
+static void test_pending_plaintext_outbox() {
+    // test start
+    tear_up();
+
+    // mock address
+    E2ees__E2eeAddress *user_address, *member_address;
+    mock_address(&user_address, "alice", "alice's domain", "alice's device");
+    mock_address(&member_address, "bob", "bob's domain", "bob's device");
+
+    // fill the outbox
+    size_t i;
+    uint8_t plaintext[8];
+    for (i = 0; i < E2EES_PENDING_PLAINTEXT_MAX_NUM; i++) {
+        memset(plaintext, (int)(i & 0xff), sizeof(plaintext));
+        assert(store_pending_common_plaintext_data_internal(
+            user_address, member_address, plaintext, sizeof(plaintext), E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL
+        ) == E2EES_RESULT_SUCC);
+    }
+    // back-pressure
+    assert(store_pending_common_plaintext_data_internal(
+        user_address, member_address, plaintext, sizeof(plaintext), E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL
+    ) == E2EES_RESULT_FAIL);
+    assert(get_e2ees_plugin()->db_handler.count_pending_plaintext_data(user_address, member_address) == E2EES_PENDING_PLAINTEXT_MAX_NUM);
+
+    // load the first page in order
+    e2ees_pending_plaintext_t *page = NULL;
+    size_t page_num = get_e2ees_plugin()->db_handler.load_pending_plaintext_data_page(
+        user_address, member_address, 0, E2EES_PENDING_PLAINTEXT_PAGE_SIZE, &page
+    );
+    assert(page_num == E2EES_PENDING_PLAINTEXT_PAGE_SIZE);
+    for (i = 0; i < page_num; i++) {
+        assert(page[i].seq == i + 1);
+        assert(page[i].plaintext_data[0] == (uint8_t)(i & 0xff));
+    }
+
+    // delete the page twice, the second deletion has no effect
+    uint64_t last_seq = page[page_num - 1].seq;
+    get_e2ees_plugin()->db_handler.unload_pending_plaintext_data_range(user_address, member_address, page[0].seq, last_seq);
+    get_e2ees_plugin()->db_handler.unload_pending_plaintext_data_range(user_address, member_address, page[0].seq, last_seq);
+    assert(get_e2ees_plugin()->db_handler.count_pending_plaintext_data(user_address, member_address)
+        == E2EES_PENDING_PLAINTEXT_MAX_NUM - E2EES_PENDING_PLAINTEXT_PAGE_SIZE);
+    free_pending_plaintext_list(&page, page_num);
+
+    // the sequence keeps increasing
+    page_num = get_e2ees_plugin()->db_handler.load_pending_plaintext_data_page(
+        user_address, member_address, last_seq, 1, &page
+    );
+    assert(page_num == 1);
+    assert(page[0].seq == last_seq + 1);
+    free_pending_plaintext_list(&page, page_num);
+
+    // a message that can not be sent is kept in the outbox instead of being dropped
+    E2ees__Session *outbound_session = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    e2ees__session__init(outbound_session);
+    copy_address_from_address(&(outbound_session->our_address), user_address);
+    copy_address_from_address(&(outbound_session->their_address), member_address);
+    send_pending_plaintext_data_internal(outbound_session);
+    assert(get_e2ees_plugin()->db_handler.count_pending_plaintext_data(user_address, member_address)
+        == E2EES_PENDING_PLAINTEXT_MAX_NUM - E2EES_PENDING_PLAINTEXT_PAGE_SIZE);
+
+    // release
+    e2ees__session__free_unpacked(outbound_session, NULL);
+    e2ees__e2ee_address__free_unpacked(user_address, NULL);
+    e2ees__e2ee_address__free_unpacked(member_address, NULL);
+
+    // test stop
+    tear_down();
+}
+
+static void test_pending_shared_payload() {
+    // test start
+    tear_up();
+
+    // mock address
+    E2ees__E2eeAddress *user_address, *member_addresses[3];
+    mock_address(&user_address, "alice", "alice's domain", "alice's device");
+    mock_address(&(member_addresses[0]), "bob", "bob's domain", "bob's device");
+    mock_address(&(member_addresses[1]), "bob", "bob's domain", "bob's other device");
+    mock_address(&(member_addresses[2]), "claire", "claire's domain", "claire's device");
+
+    // the same payload for all the recipients is stored once
+    uint8_t payload[] = "The group pre-key shared by all members.";
+    size_t payload_len = sizeof(payload) - 1;
+    uint8_t payload_hash[SHA256_OUTPUT_LENGTH];
+    crypto_sha256(payload, payload_len, payload_hash);
+    size_t i;
+    for (i = 0; i < 3; i++) {
+        assert(store_pending_shared_plaintext_data_internal(
+            user_address, member_addresses[i], payload_hash, payload, payload_len, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
+        ) == E2EES_RESULT_SUCC);
+    }
+    assert(count_pending_payloads(user_address) == 1);
+
+    // each recipient loads the payload in place of the reference
+    e2ees_pending_plaintext_t *page = NULL;
+    size_t page_num = get_e2ees_plugin()->db_handler.load_pending_plaintext_data_page(
+        user_address, member_addresses[0], 0, E2EES_PENDING_PLAINTEXT_PAGE_SIZE, &page
+    );
+    assert(page_num == 1);
+    assert(page[0].plaintext_data_len == payload_len);
+    assert(memcmp(page[0].plaintext_data, payload, payload_len) == 0);
+    get_e2ees_plugin()->db_handler.unload_pending_plaintext_data_range(user_address, member_addresses[0], page[0].seq, page[0].seq);
+    free_pending_plaintext_list(&page, page_num);
+    assert(count_pending_payloads(user_address) == 1);
+
+    char **plaintext_id_list = NULL;
+    uint8_t **plaintext_data_list = NULL;
+    size_t *plaintext_data_len_list = NULL;
+    E2ees__NotifLevel *notif_level_list = NULL;
+    size_t plaintext_num = get_e2ees_plugin()->db_handler.load_pending_plaintext_data(
+        user_address, member_addresses[1], &plaintext_id_list, &plaintext_data_list, &plaintext_data_len_list, &notif_level_list
+    );
+    assert(plaintext_num == 1);
+    assert(plaintext_data_len_list[0] == payload_len);
+    assert(memcmp(plaintext_data_list[0], payload, payload_len) == 0);
+    get_e2ees_plugin()->db_handler.unload_pending_plaintext_data(user_address, member_addresses[1], plaintext_id_list[0]);
+    free(plaintext_id_list[0]);
+    free(plaintext_data_list[0]);
+    free(plaintext_id_list);
+    free(plaintext_data_list);
+    free(plaintext_data_len_list);
+    free(notif_level_list);
+    assert(count_pending_payloads(user_address) == 1);
+
+    // the payload is deleted together with the last reference
+    get_e2ees_plugin()->db_handler.unload_pending_plaintext_data_range(user_address, member_addresses[2], 1, 1);
+    assert(get_e2ees_plugin()->db_handler.count_pending_plaintext_data(user_address, member_addresses[2]) == 0);
+    assert(count_pending_payloads(user_address) == 0);
+
+    // a full outbox refuses the reference, and the payload is not stored
+    uint8_t plaintext[8];
+    for (i = 0; i < E2EES_PENDING_PLAINTEXT_MAX_NUM; i++) {
+        memset(plaintext, (int)(i & 0xff), sizeof(plaintext));
+        assert(store_pending_common_plaintext_data_internal(
+            user_address, member_addresses[0], plaintext, sizeof(plaintext), E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL
+        ) == E2EES_RESULT_SUCC);
+    }
+    assert(store_pending_shared_plaintext_data_internal(
+        user_address, member_addresses[0], payload_hash, payload, payload_len, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_SESSION
+    ) == E2EES_RESULT_FAIL);
+    assert(get_e2ees_plugin()->db_handler.count_pending_plaintext_data(user_address, member_addresses[0]) == E2EES_PENDING_PLAINTEXT_MAX_NUM);
+    assert(count_pending_payloads(user_address) == 0);
+
+    // release
+    e2ees__e2ee_address__free_unpacked(user_address, NULL);
+    for (i = 0; i < 3; i++) {
+        e2ees__e2ee_address__free_unpacked(member_addresses[i], NULL);
+    }
+
+    // test stop
+    tear_down();
+}
+
+static void test_pending_request_backoff() {
+    E2ees__E2eeAddress *address = NULL;
+    mock_address(&address, "alice", "alice's domain", "alice's device");
+
+    uint8_t one2one_type = E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG;
+    uint8_t group_type = E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_CREATE_GROUP;
+    int64_t base_ms = get_pending_request_retry_base_ms(one2one_type);
+    int64_t now = 1000000;
+
+    // a new type is ready
+    assert(is_pending_request_type_ready(address, one2one_type, now));
+
+    // the backoff time is doubled after each failure
+    mark_pending_request_type_failed(address, one2one_type, now);
+    assert(!is_pending_request_type_ready(address, one2one_type, now + base_ms - 1));
+    assert(is_pending_request_type_ready(address, one2one_type, now + base_ms));
+    mark_pending_request_type_failed(address, one2one_type, now);
+    assert(!is_pending_request_type_ready(address, one2one_type, now + base_ms));
+    assert(is_pending_request_type_ready(address, one2one_type, now + 2 * base_ms));
+
+    // the other types are not affected
+    assert(is_pending_request_type_ready(address, group_type, now));
+
+    // a retry is due when the earliest backed-off type is ready
+    assert(get_pending_request_next_retry_ts(address) == now + 2 * base_ms);
+    assert(mark_pending_request_retry_scheduled(address));
+    assert(!mark_pending_request_retry_scheduled(address));
+    clear_pending_request_retry_scheduled(address);
+    assert(mark_pending_request_retry_scheduled(address));
+    clear_pending_request_retry_scheduled(address);
+
+    // the backoff time is reset after a success
+    mark_pending_request_type_succeeded(address, one2one_type);
+    assert(is_pending_request_type_ready(address, one2one_type, now));
+    assert(get_pending_request_next_retry_ts(address) == INT64_MAX);
+
+    // attempt counts
+    assert(get_pending_request_attempts("request_1") == 0);
+    assert(increase_pending_request_attempts("request_1") == 1);
+    assert(increase_pending_request_attempts("request_1") == 2);
+    remove_pending_request_attempts("request_1");
+    assert(get_pending_request_attempts("request_1") == 0);
+
+    // release
+    e2ees__e2ee_address__free_unpacked(address, NULL);
+    free_pending_request_cache();
+}
+
+static size_t consume_proto_msgs_calls = 0;
+static size_t consume_proto_msgs_request_num = 0;
+
+static E2ees__ConsumeProtoMsgResponse **count_consume_proto_msgs(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__ConsumeProtoMsgRequest **requests, size_t request_num
+) {
+    consume_proto_msgs_calls++;
+    consume_proto_msgs_request_num += request_num;
+    return mock_consume_proto_msgs(from, auth, requests, request_num);
+}
+
+static void store_pending_consume_ack(E2ees__E2eeAddress *user_address, const char *proto_msg_id) {
+    E2ees__ProtoMsg *proto_msg = (E2ees__ProtoMsg *)malloc(sizeof(E2ees__ProtoMsg));
+    e2ees__proto_msg__init(proto_msg);
+    copy_address_from_address(&(proto_msg->to), user_address);
+    proto_msg->tag = (E2ees__ProtoMsgTag *)malloc(sizeof(E2ees__ProtoMsgTag));
+    e2ees__proto_msg_tag__init(proto_msg->tag);
+    proto_msg->tag->proto_msg_id = strdup(proto_msg_id);
+
+    size_t request_data_len = e2ees__proto_msg__get_packed_size(proto_msg);
+    uint8_t *request_data = (uint8_t *)malloc(sizeof(uint8_t) * request_data_len);
+    e2ees__proto_msg__pack(proto_msg, request_data);
+    store_pending_request_internal(
+        user_address, E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_PROTO_MSG, request_data, request_data_len, NULL, 0
+    );
+
+    // release
+    free_mem((void **)&request_data, request_data_len);
+    free_proto(proto_msg);
+}
+
+static void test_pending_consume_acks() {
+    // test start
+    tear_up();
+    get_e2ees_plugin()->proto_handler.consume_proto_msgs = count_consume_proto_msgs;
+    consume_proto_msgs_calls = 0;
+    consume_proto_msgs_request_num = 0;
+
+    // mock account
+    E2ees__Account *account = (E2ees__Account *)malloc(sizeof(E2ees__Account));
+    e2ees__account__init(account);
+    mock_address(&(account->address), "alice", "alice's domain", "alice's device");
+    account->auth = strdup("alice's auth");
+
+    // the attempt counts are kept with the pending requests
+    uint8_t request_data[] = {1, 2, 3};
+    get_e2ees_plugin()->db_handler.store_pending_request_data(
+        account->address, "request_1",
+        E2EES__PENDING_REQUEST_TYPE__PENDING_REQUEST_TYPE_SEND_ONE2ONE_MSG, request_data, sizeof(request_data)
+    );
+    assert(get_e2ees_plugin()->db_handler.add_pending_request_attempt(account->address, "request_1") == 1);
+    assert(get_e2ees_plugin()->db_handler.add_pending_request_attempt(account->address, "request_1") == 2);
+    get_e2ees_plugin()->db_handler.unload_pending_request_data(account->address, "request_1");
+    assert(get_e2ees_plugin()->db_handler.add_pending_request_attempt(account->address, "request_1") == 0);
+
+    // three consume-acks and a duplicate are consumed in one batch of three requests
+    store_pending_consume_ack(account->address, "proto_msg_1");
+    store_pending_consume_ack(account->address, "proto_msg_2");
+    store_pending_consume_ack(account->address, "proto_msg_1");
+    store_pending_consume_ack(account->address, "proto_msg_3");
+    resume_connection_internal(account);
+    assert(consume_proto_msgs_calls == 1);
+    assert(consume_proto_msgs_request_num == 3);
+
+    // all of them are unloaded
+    char **pending_request_id_list = NULL;
+    uint8_t *request_type_list = NULL;
+    uint8_t **request_data_list = NULL;
+    size_t *request_data_len_list = NULL;
+    assert(get_e2ees_plugin()->db_handler.load_pending_request_data(
+        account->address, &pending_request_id_list, &request_type_list, &request_data_list, &request_data_len_list
+    ) == 0);
+
+    // release
+    free_proto(account);
+
+    // test stop
+    get_e2ees_plugin()->proto_handler.consume_proto_msgs = mock_consume_proto_msgs;
+    free_pending_request_cache();
+    tear_down();
+}
+
 static void test_sending_before_accept() {
     // test start
     tear_up();
@@ -406,6 +693,10 @@ int main(){
     test_one_group_pre_key();
     test_multiple_group_pre_keys();
     test_pending_request_data();
+    test_pending_plaintext_outbox();
+    test_pending_shared_payload();
+    test_pending_request_backoff();
+    test_pending_consume_acks();
 
     return 0;
 }
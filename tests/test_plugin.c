@@ -121,7 +121,35 @@ struct e2ees_plugin_t mock_plugin = {
         unload_pending_plaintext_data,
         store_pending_request_data,
         load_pending_request_data,
-        unload_pending_request_data
+        unload_pending_request_data,
+        // optional
+        load_outbound_session_headers,
+        append_pending_plaintext_data,
+        count_pending_plaintext_data,
+        load_pending_plaintext_data_page,
+        unload_pending_plaintext_data_range,
+        load_account_headers,
+        load_identity_key,
+        load_one_time_pre_key,
+        load_outbound_sessions_by_users,
+        store_group_info,
+        store_group_info_delta,
+        load_group_info,
+        append_pending_payload_ref,
+        store_session_establishment,
+        load_session_establishments,
+        unload_session_establishment,
+        load_account_without_opks,
+        store_group_session_info_version,
+        load_group_session_info_version,
+        store_group_session_sequence,
+        load_group_session_sequence,
+        update_next_one_time_pre_key_id,
+        store_shared_group_session,
+        load_shared_group_session,
+        store_skipped_group_msg_key,
+        take_skipped_group_msg_key,
+        add_pending_request_attempt
     },
     {
         mock_register_user,
@@ -137,7 +165,13 @@ struct e2ees_plugin_t mock_plugin = {
         mock_remove_group_members,
         mock_leave_group,
         mock_send_group_msg,
-        mock_consume_proto_msg
+        mock_consume_proto_msg,
+        // optional
+        mock_send_one2one_msgs,
+        mock_invites,
+        NULL,
+        NULL,
+        mock_consume_proto_msgs
     },
     {
         NULL,
@@ -164,8 +198,9 @@ void tear_up() {
 
 void tear_down() {
     invite_time = 0;
-    mock_db_end();
     mock_server_end();
     stop_mock_server_sending();
+    // e2ees_end() writes the cached group sessions back to the db
     e2ees_end();
+    mock_db_end();
 }
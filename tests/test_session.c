@@ -43,6 +43,18 @@
  * @section test_add_a_device
  * Both Alice and Bob have two devices. Alice adds a new device. Then Alice sends a message to Bob. Next, Bob sends a message to Alice.
  * 
+ * @section test_invite_devices_in_batch
+ * Alice has one device, and Bob has four devices. Alice invites all of Bob's devices with one batched invite request.
+ * 
+ * @section test_pre_key_bundle_fetch
+ * Alice invites Bob twice, and Bob's pre-key bundles are fetched from the server both times so that they carry one-time pre-keys.
+ * 
+ * @section test_async_one2one_msgs
+ * Alice submits three messages to Bob without waiting for the responses, and the messages are completed when the server responds.
+ * 
+ * @section test_resume_session_establishment
+ * Alice's session establishment with Bob is interrupted after its first step, and it is resumed from the stored step until Bob accepts.
+ * 
  * 
  * 
  * @defgroup session_int session integration test
@@ -263,12 +275,15 @@
 #include "e2ees/account.h"
 #include "e2ees/account_manager.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/ratchet.h"
 #include "e2ees/session.h"
+#include "e2ees/session_establishment.h"
 #include "e2ees/session_manager.h"
 #include "e2ees/e2ees.h"
 
+#include "mock_server.h"
 #include "mock_server_sending.h"
 #include "test_plugin.h"
 #include "test_util.h"
@@ -883,6 +898,233 @@ static void test_invite_interaction() {
     printf("====================================\n");
 }
 
+static size_t invites_calls = 0;
+static size_t invites_request_num = 0;
+
+static E2ees__InviteResponse **count_invites(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__InviteRequest **requests, size_t request_num
+) {
+    invites_calls++;
+    invites_request_num += request_num;
+    return mock_invites(from, auth, requests, request_num);
+}
+
+static void test_invite_devices_in_batch() {
+    // test start
+    printf("test_invite_devices_in_batch begin!!!\n");
+    tear_up();
+    test_begin();
+    get_e2ees_plugin()->proto_handler.invites = count_invites;
+    invites_calls = 0;
+    invites_request_num = 0;
+
+    mock_alice_account("Alice");
+    mock_bob_account("Bob");
+    mock_bob_account("Bob");
+    mock_bob_account("Bob");
+    mock_bob_account("Bob");
+
+    sleep(3);
+
+    E2ees__E2eeAddress *alice_address = account_data[0]->address;
+    char *bob_user_id = account_data[1]->address->user->user_id;
+    char *bob_domain = account_data[1]->address->domain;
+
+    // Alice invites all of Bob's devices in one round trip
+    E2ees__InviteResponse *response = invite(alice_address, bob_user_id, bob_domain);
+    assert(invites_calls == 1);
+    assert(invites_request_num == 4);
+
+    sleep(3);
+    E2ees__Session **outbound_sessions = NULL;
+    size_t outbound_sessions_num = get_e2ees_plugin()->db_handler.load_outbound_sessions(
+        alice_address, bob_user_id, bob_domain, &outbound_sessions
+    );
+    assert(outbound_sessions_num == 4);
+
+    // Alice sends an encrypted message to Bob, and Bob decrypts the message
+    test_encryption(alice_address, bob_user_id, bob_domain, test_plaintext, test_plaintext_len);
+
+    // test stop
+    size_t i;
+    for (i = 0; i < outbound_sessions_num; i++) {
+        e2ees__session__free_unpacked(outbound_sessions[i], NULL);
+    }
+    free_mem((void **)&outbound_sessions, sizeof(E2ees__Session *) * outbound_sessions_num);
+    if (response != NULL)
+        e2ees__invite_response__free_unpacked(response, NULL);
+    get_e2ees_plugin()->proto_handler.invites = mock_invites;
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
+static size_t get_pre_key_bundle_calls = 0;
+
+static E2ees__GetPreKeyBundleResponse *count_get_pre_key_bundle(
+    E2ees__E2eeAddress *from, const char *auth, E2ees__GetPreKeyBundleRequest *request
+) {
+    get_pre_key_bundle_calls++;
+    return mock_get_pre_key_bundle(from, auth, request);
+}
+
+static void test_pre_key_bundle_fetch() {
+    // test start
+    printf("test_pre_key_bundle_fetch begin!!!\n");
+    tear_up();
+    test_begin();
+    get_e2ees_plugin()->proto_handler.get_pre_key_bundle = count_get_pre_key_bundle;
+    get_pre_key_bundle_calls = 0;
+
+    mock_alice_account("alice");
+    mock_bob_account("bob");
+
+    E2ees__E2eeAddress *alice_address = account_data[0]->address;
+    E2ees__E2eeAddress *bob_address = account_data[1]->address;
+    char *bob_user_id = bob_address->user->user_id;
+    char *bob_domain = bob_address->domain;
+
+    // Alice invites Bob twice, the bundles are always fetched for their one-time pre-keys
+    E2ees__InviteResponse *response = invite(alice_address, bob_user_id, bob_domain);
+    if (response != NULL)
+        e2ees__invite_response__free_unpacked(response, NULL);
+    sleep(1);
+    response = invite(alice_address, bob_user_id, bob_domain);
+    if (response != NULL)
+        e2ees__invite_response__free_unpacked(response, NULL);
+    assert(get_pre_key_bundle_calls == 2);
+    sleep(1);
+
+    // Alice sends an encrypted message to Bob, and Bob decrypts the message
+    test_encryption(alice_address, bob_user_id, bob_domain, test_plaintext, test_plaintext_len);
+
+    // test stop
+    get_e2ees_plugin()->proto_handler.get_pre_key_bundle = mock_get_pre_key_bundle;
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
+static void test_async_one2one_msgs() {
+    // test start
+    printf("test_async_one2one_msgs begin!!!\n");
+    tear_up();
+    test_begin();
+
+    mock_alice_account("alice");
+    mock_bob_account("bob");
+
+    E2ees__E2eeAddress *alice_address = account_data[0]->address;
+    E2ees__E2eeAddress *bob_address = account_data[1]->address;
+
+    // Alice invites Bob to create a session
+    E2ees__InviteResponse *response = invite(alice_address, bob_address->user->user_id, bob_address->domain);
+    sleep(2);
+
+    get_e2ees_plugin()->proto_handler.send_one2one_msg_async = mock_send_one2one_msg_async;
+    E2ees__Session *outbound_session = NULL;
+    get_e2ees_plugin()->db_handler.load_outbound_session(alice_address, bob_address, &outbound_session);
+    assert(outbound_session != NULL);
+    assert(outbound_session->responded);
+
+    uint8_t *common_plaintext_data = NULL;
+    size_t common_plaintext_data_len;
+    pack_common_plaintext(
+        test_plaintext, test_plaintext_len,
+        E2EES__PLAINTEXT__PAYLOAD_COMMON_MSG,
+        &common_plaintext_data, &common_plaintext_data_len
+    );
+
+    // all the messages are outstanding at once
+    size_t i;
+    for (i = 0; i < 3; i++) {
+        assert(send_one2one_msg_async_internal(
+            outbound_session, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL, common_plaintext_data, common_plaintext_data_len
+        ) == E2EES_RESULT_SUCC);
+    }
+    assert(count_outstanding_one2one_msgs_internal() == 3);
+
+    // the server responds, and Bob decrypts the messages
+    assert(mock_complete_one2one_msgs() == 3);
+    assert(count_outstanding_one2one_msgs_internal() == 0);
+    sleep(1);
+
+    // the wait gives up if nobody completes the messages
+    assert(send_one2one_msg_async_internal(
+        outbound_session, E2EES__NOTIF_LEVEL__NOTIF_LEVEL_NORMAL, common_plaintext_data, common_plaintext_data_len
+    ) == E2EES_RESULT_SUCC);
+    assert(wait_outstanding_one2one_msgs_internal(100) == 1);
+
+    // the host completes them on the waiting thread
+    get_e2ees_plugin()->proto_handler.complete_one2one_msgs = mock_complete_one2one_msgs;
+    assert(wait_outstanding_one2one_msgs_internal(100) == 0);
+    get_e2ees_plugin()->proto_handler.complete_one2one_msgs = NULL;
+    sleep(1);
+
+    // test stop
+    free_mem((void **)&common_plaintext_data, common_plaintext_data_len);
+    e2ees__session__free_unpacked(outbound_session, NULL);
+    if (response != NULL)
+        e2ees__invite_response__free_unpacked(response, NULL);
+    get_e2ees_plugin()->proto_handler.send_one2one_msg_async = NULL;
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
+static void test_resume_session_establishment() {
+    // test start
+    printf("test_resume_session_establishment begin!!!\n");
+    tear_up();
+    test_begin();
+
+    mock_alice_account("alice");
+    mock_bob_account("bob");
+
+    E2ees__E2eeAddress *alice_address = account_data[0]->address;
+    E2ees__E2eeAddress *bob_address = account_data[1]->address;
+    char *bob_user_id = bob_address->user->user_id;
+    char *bob_domain = bob_address->domain;
+
+    // the session establishment of Alice is interrupted before fetching Bob's pre-key bundles
+    E2ees__E2eeAddress *bob_user_address = NULL;
+    copy_address_from_address(&bob_user_address, bob_address);
+    free_string(bob_user_address->user->device_id);
+    store_session_establishment_step(alice_address, bob_user_address, E2EES_SESSION_ESTABLISHMENT_STEP_GET_PRE_KEY_BUNDLE);
+
+    e2ees_session_establishment_t *session_establishments = NULL;
+    size_t session_establishments_num = get_e2ees_plugin()->db_handler.load_session_establishments(
+        alice_address, &session_establishments
+    );
+    assert(session_establishments_num == 1);
+    assert(session_establishments[0].step == E2EES_SESSION_ESTABLISHMENT_STEP_GET_PRE_KEY_BUNDLE);
+    assert(session_establishments[0].their_address->user->device_id == NULL);
+    free_session_establishments(&session_establishments, session_establishments_num);
+
+    // resume from the stored step
+    E2ees__Account *alice_account = NULL;
+    get_e2ees_plugin()->db_handler.load_account_by_address(alice_address, &alice_account);
+    assert(resume_session_establishments(alice_account) == 1);
+    sleep(2);
+
+    // Bob has accepted, so nothing is left to resume
+    session_establishments_num = get_e2ees_plugin()->db_handler.load_session_establishments(
+        alice_address, &session_establishments
+    );
+    assert(session_establishments_num == 0);
+
+    // Alice sends an encrypted message to Bob, and Bob decrypts the message
+    test_encryption(alice_address, bob_user_id, bob_domain, test_plaintext, test_plaintext_len);
+    sleep(1);
+
+    // test stop
+    e2ees__e2ee_address__free_unpacked(bob_user_address, NULL);
+    e2ees__account__free_unpacked(alice_account, NULL);
+    test_end();
+    tear_down();
+    printf("====================================\n");
+}
+
 int main() {
     test_basic_session();
     test_interaction();
@@ -894,6 +1136,10 @@ int main() {
     test_session_no_opk();
     test_invite_twice();
     test_invite_interaction();
+    test_invite_devices_in_batch();
+    test_pre_key_bundle_fetch();
+    test_async_one2one_msgs();
+    test_resume_session_establishment();
 
     return 0;
 }
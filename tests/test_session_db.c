@@ -25,7 +25,9 @@
 #include "e2ees/account.h"
 #include "e2ees/crypto.h"
 #include "e2ees/e2ees_client.h"
+#include "e2ees/e2ees_client_internal.h"
 #include "e2ees/group_session.h"
+#include "e2ees/group_session_cache.h"
 #include "e2ees/mem_util.h"
 #include "e2ees/ratchet.h"
 #include "e2ees/session.h"
@@ -38,6 +40,9 @@
 
 static const cipher_suite_t *test_cipher_suite;
 
+// lose the chain state that would be written back, as if the process stopped
+static void skip_store_group_session(E2ees__GroupSession *group_session) {}
+
 void test_load_outbound_session(uint32_t e2ees_pack_id)
 {
     tear_up();
@@ -175,6 +180,148 @@ void test_load_outbound_sessions(uint32_t e2ees_pack_id)
     tear_down();
 }
 
+void test_load_outbound_session_headers(uint32_t e2ees_pack_id)
+{
+    tear_up();
+
+    // create addresses
+    E2ees__E2eeAddress *from, *to_1, *to_2;
+    mock_address(&from, "alice", "alice's domain", "alice's device");
+    mock_address(&to_1, "bob", "bob's domain", "bob's device 1");
+    mock_address(&to_2, "bob", "bob's domain", "bob's device 2");
+
+    // an old and a new session with bob's device 1, and a session with bob's device 2
+    E2ees__Session *session_1_old, *session_1_new, *session_2;
+    session_1_old = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    session_1_new = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    session_2 = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    initialise_session(session_1_old, e2ees_pack_id, from, to_1);
+    initialise_session(session_1_new, e2ees_pack_id, from, to_1);
+    initialise_session(session_2, e2ees_pack_id, from, to_2);
+
+    session_1_old->session_id = generate_uuid_str();
+    session_1_old->invite_t = 1;
+    session_1_old->responded = true;
+    session_1_new->session_id = generate_uuid_str();
+    session_1_new->invite_t = 2;
+    session_1_new->responded = false;
+    session_2->session_id = generate_uuid_str();
+    session_2->invite_t = 3;
+    session_2->responded = true;
+
+    // insert to the db
+    store_session(session_1_old);
+    store_session(session_1_new);
+    store_session(session_2);
+
+    // load_outbound_session_headers
+    e2ees_session_header_t *session_headers = NULL;
+    size_t session_headers_num = load_outbound_session_headers(from, to_1->user->user_id, to_1->domain, &session_headers);
+
+    // only the lastest session of each device is returned
+    bool result = (session_headers_num == 2);
+    size_t i;
+    for (i = 0; result && i < session_headers_num; i++) {
+        e2ees_session_header_t *session_header = &(session_headers[i]);
+        result = compare_address(session_header->our_address, from) && (session_header->session == NULL);
+        if (compare_address(session_header->their_address, to_1)) {
+            result = result
+                && (strcmp(session_header->session_id, session_1_new->session_id) == 0)
+                && (session_header->invite_t == session_1_new->invite_t)
+                && (session_header->responded == false);
+        } else if (compare_address(session_header->their_address, to_2)) {
+            result = result
+                && (strcmp(session_header->session_id, session_2->session_id) == 0)
+                && (session_header->invite_t == session_2->invite_t)
+                && (session_header->responded == true);
+        } else {
+            result = false;
+        }
+    }
+
+    print_result("test_load_outbound_session_headers", result);
+
+    // free
+    free_session_headers(&session_headers, session_headers_num);
+    e2ees__e2ee_address__free_unpacked(from, NULL);
+    e2ees__e2ee_address__free_unpacked(to_1, NULL);
+    e2ees__e2ee_address__free_unpacked(to_2, NULL);
+    e2ees__session__free_unpacked(session_1_old, NULL);
+    e2ees__session__free_unpacked(session_1_new, NULL);
+    e2ees__session__free_unpacked(session_2, NULL);
+
+    tear_down();
+}
+
+void test_load_outbound_sessions_by_users(uint32_t e2ees_pack_id)
+{
+    tear_up();
+
+    // create addresses
+    E2ees__E2eeAddress *from, *to_1, *to_2, *to_3;
+    mock_address(&from, "alice", "alice's domain", "alice's device");
+    mock_address(&to_1, "bob", "bob's domain", "bob's device 1");
+    mock_address(&to_2, "bob", "bob's domain", "bob's device 2");
+    mock_address(&to_3, "claire", "claire's domain", "claire's device");
+
+    // sessions with two devices of bob and one device of claire
+    E2ees__Session *session_1, *session_2, *session_3;
+    session_1 = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    session_2 = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    session_3 = (E2ees__Session *)malloc(sizeof(E2ees__Session));
+    initialise_session(session_1, e2ees_pack_id, from, to_1);
+    initialise_session(session_2, e2ees_pack_id, from, to_2);
+    initialise_session(session_3, e2ees_pack_id, from, to_3);
+    session_1->session_id = generate_uuid_str();
+    session_2->session_id = generate_uuid_str();
+    session_3->session_id = generate_uuid_str();
+
+    // insert to the db
+    store_session(session_1);
+    store_session(session_2);
+    store_session(session_3);
+
+    // bob and david are asked, david has no session
+    E2ees__GroupMember *users[2];
+    users[0] = (E2ees__GroupMember *)malloc(sizeof(E2ees__GroupMember));
+    e2ees__group_member__init(users[0]);
+    users[0]->user_id = strdup("bob");
+    users[0]->domain = strdup("bob's domain");
+    users[1] = (E2ees__GroupMember *)malloc(sizeof(E2ees__GroupMember));
+    e2ees__group_member__init(users[1]);
+    users[1]->user_id = strdup("david");
+    users[1]->domain = strdup("david's domain");
+
+    E2ees__Session **sessions_copy = NULL;
+    size_t sessions_num = load_outbound_sessions_by_users(from, users, 2, &sessions_copy);
+
+    bool result = (sessions_num == 2);
+    size_t i;
+    for (i = 0; result && i < sessions_num; i++) {
+        result = compare_address(sessions_copy[i]->their_address, to_1)
+            || compare_address(sessions_copy[i]->their_address, to_2);
+    }
+
+    print_result("test_load_outbound_sessions_by_users", result);
+
+    // free
+    for (i = 0; i < sessions_num; i++) {
+        e2ees__session__free_unpacked(sessions_copy[i], NULL);
+    }
+    free(sessions_copy);
+    e2ees__group_member__free_unpacked(users[0], NULL);
+    e2ees__group_member__free_unpacked(users[1], NULL);
+    e2ees__e2ee_address__free_unpacked(from, NULL);
+    e2ees__e2ee_address__free_unpacked(to_1, NULL);
+    e2ees__e2ee_address__free_unpacked(to_2, NULL);
+    e2ees__e2ee_address__free_unpacked(to_3, NULL);
+    e2ees__session__free_unpacked(session_1, NULL);
+    e2ees__session__free_unpacked(session_2, NULL);
+    e2ees__session__free_unpacked(session_3, NULL);
+
+    tear_down();
+}
+
 void test_load_inbound_session(uint32_t e2ees_pack_id)
 {
     tear_up();
@@ -386,6 +533,736 @@ void test_load_group_session_by_id(uint32_t e2ees_pack_id)
     tear_down();
 }
 
+void test_group_session_cache(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create two addresses
+    E2ees__E2eeAddress *Alice, *Bob;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+
+    // mock group address
+    E2ees__E2eeAddress *group_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+    e2ees__e2ee_address__init(group_address);
+    group_address->group = (E2ees__PeerGroup *)malloc(sizeof(E2ees__PeerGroup));
+    e2ees__peer_group__init(group_address->group);
+    group_address->peer_case = E2EES__E2EE_ADDRESS__PEER_GROUP;
+    group_address->domain = mock_domain_str();
+    group_address->group->group_id = generate_uuid_str();
+
+    // create inbound group session
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+
+    copy_address_from_address(&(group_session->sender), Bob);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    copy_address_from_address(&(group_session->group_info->group_address), group_address);
+
+    group_session->sequence = 0;
+
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+
+    group_session->associated_data.len = 64;
+    group_session->associated_data.data = (uint8_t *)malloc(sizeof(uint8_t) * 64);
+    memcpy(group_session->associated_data.data, group_session->chain_key.data, 32);
+    memcpy((group_session->associated_data.data) + 32, group_session->chain_key.data, 32);
+
+    // insert to the db
+    store_group_session(group_session);
+
+    // the first access loads the session from the db
+    group_session_cacheer *cacheer = NULL;
+    int ret = load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(cacheer->sequence == 0);
+    assert(compare_address(cacheer->group_address, group_address));
+    assert(compare_protobuf(&(cacheer->associated_data), &(group_session->associated_data)));
+
+    // the chain state is not written back until the interval is reached
+    uint32_t i;
+    E2ees__GroupSession *group_session_copy = NULL;
+    for (i = 1; i <= E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL; i++) {
+        advance_group_chain_key(test_cipher_suite, &(cacheer->chain_key));
+        cacheer->sequence += 1;
+        update_group_session_cacheer(cacheer);
+
+        load_group_session_by_id(Bob, Alice, group_session->session_id, &group_session_copy);
+        assert(group_session_copy->sequence == ((i < E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL) ? 0 : i));
+        e2ees__group_session__free_unpacked(group_session_copy, NULL);
+        group_session_copy = NULL;
+        // only the sequence is stored in between
+        if (i < E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL)
+            assert(load_group_session_sequence(Alice, group_session->session_id) == i);
+    }
+    free_group_session_cacheer(&cacheer);
+
+    // the cached state is newer than the db
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->sequence == E2EES_GROUP_SESSION_WRITE_BACK_INTERVAL);
+    advance_group_chain_key(test_cipher_suite, &(cacheer->chain_key));
+    cacheer->sequence += 1;
+    update_group_session_cacheer(cacheer);
+
+    // flushing writes back the latest chain state
+    flush_group_session_cache(Alice);
+    load_group_session_by_id(Bob, Alice, group_session->session_id, &group_session_copy);
+    assert(group_session_copy->sequence == cacheer->sequence);
+    assert(compare_protobuf(&(group_session_copy->chain_key), &(cacheer->chain_key)));
+    e2ees__group_session__free_unpacked(group_session_copy, NULL);
+    group_session_copy = NULL;
+    free_group_session_cacheer(&cacheer);
+
+    // a restart before the chain state is written back resumes from the stored sequence
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    advance_group_chain_key(test_cipher_suite, &(cacheer->chain_key));
+    cacheer->sequence += 1;
+    update_group_session_cacheer(cacheer);
+    uint32_t decrypted_sequence = cacheer->sequence;
+    ProtobufCBinaryData decrypted_chain_key;
+    copy_protobuf_from_protobuf(&decrypted_chain_key, &(cacheer->chain_key));
+    free_group_session_cacheer(&cacheer);
+    get_e2ees_plugin()->db_handler.store_group_session = skip_store_group_session;
+    flush_group_session_cache(Alice);
+    get_e2ees_plugin()->db_handler.store_group_session = store_group_session;
+    load_group_session_by_id(Bob, Alice, group_session->session_id, &group_session_copy);
+    assert(group_session_copy->sequence < decrypted_sequence);
+    e2ees__group_session__free_unpacked(group_session_copy, NULL);
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->sequence == decrypted_sequence);
+    assert(compare_protobuf(&(cacheer->chain_key), &decrypted_chain_key));
+    free_protobuf(&decrypted_chain_key);
+    free_group_session_cacheer(&cacheer);
+
+    // unknown session
+    ret = load_group_session_cacheer(&cacheer, Alice, Bob, group_session->session_id);
+    assert(ret != E2EES_RESULT_SUCC);
+    assert(cacheer == NULL);
+
+    print_result("test_group_session_cache", true);
+
+    // free
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__e2ee_address__free_unpacked(group_address, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    tear_down();
+}
+
+void test_group_chain_checkpoint(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create two addresses
+    E2ees__E2eeAddress *Alice, *Bob;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+
+    // mock group address
+    E2ees__E2eeAddress *group_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+    e2ees__e2ee_address__init(group_address);
+    group_address->group = (E2ees__PeerGroup *)malloc(sizeof(E2ees__PeerGroup));
+    e2ees__peer_group__init(group_address->group);
+    group_address->peer_case = E2EES__E2EE_ADDRESS__PEER_GROUP;
+    group_address->domain = mock_domain_str();
+    group_address->group->group_id = generate_uuid_str();
+
+    // create inbound group session
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+
+    copy_address_from_address(&(group_session->sender), Bob);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    copy_address_from_address(&(group_session->group_info->group_address), group_address);
+
+    group_session->sequence = 0;
+
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+
+    group_session->associated_data.len = 64;
+    group_session->associated_data.data = (uint8_t *)malloc(sizeof(uint8_t) * 64);
+    memcpy(group_session->associated_data.data, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+    memcpy((group_session->associated_data.data) + 32, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+
+    // insert to the db
+    store_group_session(group_session);
+
+    // the sender's chain state at the checkpoint and a bit further
+    uint32_t checkpoint_sequence = E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL;
+    uint32_t target_sequence = checkpoint_sequence + 5;
+    ProtobufCBinaryData checkpoint_chain_key = {0, NULL}, expected_chain_key = {0, NULL};
+    uint32_t sequence = 0;
+    copy_protobuf_from_protobuf(&checkpoint_chain_key, &(group_session->chain_key));
+    advance_group_chain_key_to_sequence(test_cipher_suite, &checkpoint_chain_key, &sequence, checkpoint_sequence, NULL, 0);
+    copy_protobuf_from_protobuf(&expected_chain_key, &checkpoint_chain_key);
+    advance_group_chain_key_to_sequence(test_cipher_suite, &expected_chain_key, &sequence, target_sequence, NULL, 0);
+    assert(sequence == target_sequence);
+
+    // a checkpoint signed by another key is ignored
+    ProtobufCBinaryData sign_public_key = {32, (uint8_t *)"abcdefghijklmnopqrstuvwxyzabcdef"};
+    ProtobufCBinaryData wrong_sign_public_key = {32, (uint8_t *)"bcdefghijklmnopqrstuvwxyzabcdefg"};
+    int ret = store_group_chain_checkpoint(
+        Bob, Alice, group_session->session_id, &wrong_sign_public_key, &checkpoint_chain_key, checkpoint_sequence
+    );
+    assert(ret != E2EES_RESULT_SUCC);
+    ret = store_group_chain_checkpoint(
+        Bob, Alice, group_session->session_id, &sign_public_key, &checkpoint_chain_key, checkpoint_sequence
+    );
+    assert(ret == E2EES_RESULT_SUCC);
+
+    // jump to the checkpoint and step the remaining distance
+    group_session_cacheer *cacheer = NULL;
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->checkpoint_sequence == checkpoint_sequence);
+    advance_group_chain_key_to_sequence(
+        test_cipher_suite, &(cacheer->chain_key), &(cacheer->sequence), target_sequence,
+        &(cacheer->checkpoint_chain_key), cacheer->checkpoint_sequence
+    );
+    assert(cacheer->sequence == target_sequence);
+    assert(compare_protobuf(&(cacheer->chain_key), &expected_chain_key));
+    update_group_session_cacheer(cacheer);
+    free_group_session_cacheer(&cacheer);
+
+    // the checkpoint is dropped once reached, and an old checkpoint is ignored
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->checkpoint_chain_key.len == 0);
+    free_group_session_cacheer(&cacheer);
+    ret = store_group_chain_checkpoint(
+        Bob, Alice, group_session->session_id, &sign_public_key, &checkpoint_chain_key, checkpoint_sequence
+    );
+    assert(ret != E2EES_RESULT_SUCC);
+
+    // the message key of a skipped sequence can be taken once
+    ProtobufCBinaryData skipped_msg_key = {32, (uint8_t *)"0123456789abcdef0123456789abcdef"};
+    ProtobufCBinaryData taken_msg_key = {0, NULL};
+    store_group_msg_skipped_key(Bob, Alice, group_session->session_id, target_sequence - 2, &skipped_msg_key);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, target_sequence - 1);
+    assert(ret != E2EES_RESULT_SUCC);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, target_sequence - 2);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(compare_protobuf(&taken_msg_key, &skipped_msg_key));
+    free_protobuf(&taken_msg_key);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, target_sequence - 2);
+    assert(ret != E2EES_RESULT_SUCC);
+
+    // the skipped keys are kept in the db over a flush of the cache, the oldest ones are dropped
+    uint32_t i;
+    for (i = 0; i <= E2EES_GROUP_MSG_MAX_SKIPPED_KEYS; i++) {
+        store_group_msg_skipped_key(Bob, Alice, group_session->session_id, i, &skipped_msg_key);
+    }
+    flush_group_session_cache(Alice);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, 0);
+    assert(ret != E2EES_RESULT_SUCC);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, 1);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(compare_protobuf(&taken_msg_key, &skipped_msg_key));
+    free_protobuf(&taken_msg_key);
+
+    // and only in the cache without the db handlers
+    e2ees_db_handler_t *db_handler = &(get_e2ees_plugin()->db_handler);
+    void (*store_skipped_group_msg_key_handler)(
+        E2ees__E2eeAddress *, E2ees__E2eeAddress *, const char *, uint32_t, const ProtobufCBinaryData *
+    ) = db_handler->store_skipped_group_msg_key;
+    db_handler->store_skipped_group_msg_key = NULL;
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    free_group_session_cacheer(&cacheer);
+    store_group_msg_skipped_key(Bob, Alice, group_session->session_id, target_sequence - 2, &skipped_msg_key);
+    flush_group_session_cache(Alice);
+    ret = take_group_msg_skipped_key(&taken_msg_key, Bob, Alice, group_session->session_id, target_sequence - 2);
+    assert(ret != E2EES_RESULT_SUCC);
+    db_handler->store_skipped_group_msg_key = store_skipped_group_msg_key_handler;
+
+    print_result("test_group_chain_checkpoint", true);
+
+    // free
+    free_protobuf(&checkpoint_chain_key);
+    free_protobuf(&expected_chain_key);
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__e2ee_address__free_unpacked(group_address, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    tear_down();
+}
+
+void test_signed_group_chain_checkpoint(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create two addresses
+    E2ees__E2eeAddress *Alice, *Bob;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+
+    // Bob's signing key
+    ProtobufCBinaryData sign_public_key = {0, NULL}, sign_private_key = {0, NULL};
+    test_cipher_suite->ds_suite->sign_key_gen(&sign_public_key, &sign_private_key);
+
+    // create inbound group session, the associated data starts with Bob's signing key
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+
+    copy_address_from_address(&(group_session->sender), Bob);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    mock_random_group_address(&(group_session->group_info->group_address));
+
+    group_session->sequence = 0;
+
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+
+    group_session->associated_data.len = sign_public_key.len * 2;
+    group_session->associated_data.data = (uint8_t *)malloc(sizeof(uint8_t) * sign_public_key.len * 2);
+    memcpy(group_session->associated_data.data, sign_public_key.data, sign_public_key.len);
+    memcpy((group_session->associated_data.data) + sign_public_key.len, sign_public_key.data, sign_public_key.len);
+
+    // insert to the db
+    store_group_session(group_session);
+
+    // Bob's checkpoint
+    E2ees__GroupUpdateKeyBundle *checkpoint = (E2ees__GroupUpdateKeyBundle *)malloc(sizeof(E2ees__GroupUpdateKeyBundle));
+    e2ees__group_update_key_bundle__init(checkpoint);
+    checkpoint->version = strdup(E2EES_PROTOCOL_VERSION);
+    checkpoint->e2ees_pack_id = e2ees_pack_id;
+    copy_address_from_address(&(checkpoint->sender), Bob);
+    checkpoint->adding = false;
+    checkpoint->session_id = strdup(group_session->session_id);
+    checkpoint->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(checkpoint->group_info);
+    checkpoint->group_info->group_name = strdup("test_group");
+    copy_address_from_address(&(checkpoint->group_info->group_address), group_session->group_info->group_address);
+    checkpoint->sequence = E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL;
+    uint32_t sequence = 0;
+    copy_protobuf_from_protobuf(&(checkpoint->chain_key), &(group_session->chain_key));
+    advance_group_chain_key_to_sequence(test_cipher_suite, &(checkpoint->chain_key), &sequence, checkpoint->sequence, NULL, 0);
+    ProtobufCBinaryData expected_chain_key = {0, NULL};
+    copy_protobuf_from_protobuf(&expected_chain_key, &(checkpoint->chain_key));
+    copy_protobuf_from_protobuf(&(checkpoint->sign_public_key), &sign_public_key);
+
+    int ret = sign_group_chain_checkpoint(checkpoint, &sign_private_key);
+    assert(ret == E2EES_RESULT_SUCC);
+    assert(checkpoint->chain_key.len > expected_chain_key.len);
+
+    // a checkpoint relayed by another device is ignored
+    ret = consume_group_chain_checkpoint(checkpoint, Alice, Alice);
+    assert(ret != E2EES_RESULT_SUCC);
+
+    // a checkpoint that does not match its signature is ignored
+    checkpoint->sequence++;
+    ret = consume_group_chain_checkpoint(checkpoint, Bob, Alice);
+    assert(ret != E2EES_RESULT_SUCC);
+    checkpoint->sequence--;
+
+    group_session_cacheer *cacheer = NULL;
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->checkpoint_chain_key.len == 0);
+    free_group_session_cacheer(&cacheer);
+
+    // the signed checkpoint from the sender is kept without its signature
+    ret = consume_group_chain_checkpoint(checkpoint, Bob, Alice);
+    assert(ret == E2EES_RESULT_SUCC);
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(cacheer->checkpoint_sequence == E2EES_GROUP_CHAIN_CHECKPOINT_INTERVAL);
+    assert(compare_protobuf(&(cacheer->checkpoint_chain_key), &expected_chain_key));
+    free_group_session_cacheer(&cacheer);
+
+    print_result("test_signed_group_chain_checkpoint", true);
+
+    // free
+    free_protobuf(&sign_public_key);
+    free_protobuf(&sign_private_key);
+    free_protobuf(&expected_chain_key);
+    e2ees__group_update_key_bundle__free_unpacked(checkpoint, NULL);
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    tear_down();
+}
+
+void test_shared_group_chain(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create three addresses, Alice and Claire are hosted together
+    E2ees__E2eeAddress *Alice, *Bob, *Claire;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+    mock_address(&Claire, "claire", E2EELAB_DOMAIN, "claire's device");
+
+    // Alice's inbound group session from Bob
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+    copy_address_from_address(&(group_session->sender), Bob);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    E2ees__E2eeAddress *group_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+    e2ees__e2ee_address__init(group_address);
+    group_address->group = (E2ees__PeerGroup *)malloc(sizeof(E2ees__PeerGroup));
+    e2ees__peer_group__init(group_address->group);
+    group_address->peer_case = E2EES__E2EE_ADDRESS__PEER_GROUP;
+    group_address->domain = mock_domain_str();
+    group_address->group->group_id = generate_uuid_str();
+    copy_address_from_address(&(group_session->group_info->group_address), group_address);
+    group_session->sequence = 0;
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+    group_session->associated_data.len = 64;
+    group_session->associated_data.data = (uint8_t *)malloc(sizeof(uint8_t) * 64);
+    memcpy(group_session->associated_data.data, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+    memcpy((group_session->associated_data.data) + 32, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+    store_group_session(group_session);
+
+    ProtobufCBinaryData chain_key = {0, NULL};
+    uint32_t sequence = 0;
+    copy_protobuf_from_protobuf(&chain_key, &(group_session->chain_key));
+    advance_group_chain_key_to_sequence(test_cipher_suite, &chain_key, &sequence, 5, NULL, 0);
+
+    // the chain id of a session stored without sharing is taken over the chain state loaded
+    ProtobufCBinaryData chain_id = {0, NULL};
+    get_group_chain_id(test_cipher_suite, group_session, &chain_id);
+    ProtobufCBinaryData other_chain_id = {0, NULL};
+    copy_protobuf_from_protobuf(&other_chain_id, &chain_id);
+    other_chain_id.data[0] ^= 0xff;
+
+    // nothing is shared by default
+    ProtobufCBinaryData shared_chain_key = {0, NULL};
+    store_shared_group_chain_key(Bob, group_session->session_id, &chain_id, 5, &chain_key);
+    assert(!load_shared_group_chain_key(&shared_chain_key, Bob, group_session->session_id, &chain_id, 5));
+
+    // a chain key derived for Alice is taken for Claire
+    set_group_chain_sharing(true);
+    group_session_cacheer *cacheer = NULL;
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(compare_protobuf(&(cacheer->chain_id), &chain_id));
+    store_shared_group_chain_key(Bob, group_session->session_id, &chain_id, 5, &chain_key);
+    assert(load_shared_group_chain_key(&shared_chain_key, Bob, group_session->session_id, &chain_id, 5));
+    assert(compare_protobuf(&shared_chain_key, &chain_key));
+    assert(!load_shared_group_chain_key(&shared_chain_key, Bob, group_session->session_id, &chain_id, 5 + E2EES_GROUP_SHARED_CHAIN_KEYS));
+    assert(!load_shared_group_chain_key(&shared_chain_key, Claire, group_session->session_id, &chain_id, 5));
+    // another chain under the same session id and sender is not taken for this one
+    assert(!load_shared_group_chain_key(&shared_chain_key, Bob, group_session->session_id, &other_chain_id, 5));
+    free_group_session_cacheer(&cacheer);
+
+    // the shared chain is dropped once no owner has a cursor on it
+    flush_group_session_cache(Alice);
+    assert(!load_shared_group_chain_key(&shared_chain_key, Bob, group_session->session_id, &chain_id, 5));
+    set_group_chain_sharing(false);
+
+    print_result("test_shared_group_chain", true);
+
+    // free
+    free_protobuf(&chain_id);
+    free_protobuf(&other_chain_id);
+    free_protobuf(&chain_key);
+    free_protobuf(&shared_chain_key);
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__e2ee_address__free_unpacked(Claire, NULL);
+    e2ees__e2ee_address__free_unpacked(group_address, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    tear_down();
+}
+
+void test_shared_group_session(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create three addresses, Alice and Claire get the same group session from Bob
+    E2ees__E2eeAddress *Alice, *Bob, *Claire;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+    mock_address(&Claire, "claire", E2EELAB_DOMAIN, "claire's device");
+
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+    copy_address_from_address(&(group_session->sender), Bob);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    E2ees__E2eeAddress *group_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+    e2ees__e2ee_address__init(group_address);
+    group_address->group = (E2ees__PeerGroup *)malloc(sizeof(E2ees__PeerGroup));
+    e2ees__peer_group__init(group_address->group);
+    group_address->peer_case = E2EES__E2EE_ADDRESS__PEER_GROUP;
+    group_address->domain = mock_domain_str();
+    group_address->group->group_id = generate_uuid_str();
+    copy_address_from_address(&(group_session->group_info->group_address), group_address);
+    group_session->sequence = 0;
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+    group_session->associated_data.len = 64;
+    group_session->associated_data.data = (uint8_t *)malloc(sizeof(uint8_t) * 64);
+    memcpy(group_session->associated_data.data, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+    memcpy((group_session->associated_data.data) + 32, "abcdefghijklmnopqrstuvwxyzabcdef", 32);
+    store_group_session_internal(group_session);
+    // the session of the caller is left as it is
+    assert(group_session->associated_data.len == 64);
+
+    // Claire gets the same chain, and Alice keeps her reference once her chain has moved on
+    E2ees__E2eeAddress *alice_address = group_session->session_owner;
+    copy_address_from_address(&(group_session->session_owner), Claire);
+    store_group_session_internal(group_session);
+    e2ees__e2ee_address__free_unpacked(group_session->session_owner, NULL);
+    group_session->session_owner = alice_address;
+    advance_group_chain_key(test_cipher_suite, &(group_session->chain_key));
+    group_session->sequence = 1;
+    store_group_session_internal(group_session);
+
+    // the group sessions of the owners are stored without the associated data
+    E2ees__GroupSession *alice_group_session = NULL;
+    load_group_session_by_id(Bob, Alice, group_session->session_id, &alice_group_session);
+    assert(alice_group_session != NULL);
+    assert(alice_group_session->associated_data.len == 0);
+    assert(alice_group_session->sequence == 1);
+    e2ees__group_session__free_unpacked(alice_group_session, NULL);
+
+    // and loaded with it, both owners refer to the same chain
+    ProtobufCBinaryData alice_chain_id = {0, NULL};
+    ProtobufCBinaryData claire_chain_id = {0, NULL};
+    load_group_session_by_id(Bob, Alice, group_session->session_id, &alice_group_session);
+    assert(fill_shared_group_session_internal(alice_group_session, &alice_chain_id));
+    assert(compare_protobuf(&(alice_group_session->associated_data), &(group_session->associated_data)));
+    E2ees__GroupSession *claire_group_session = NULL;
+    load_group_session_by_id_internal(Bob, Claire, group_session->session_id, &claire_group_session);
+    assert(claire_group_session != NULL);
+    assert(compare_protobuf(&(claire_group_session->associated_data), &(group_session->associated_data)));
+    e2ees__group_session__free_unpacked(claire_group_session, NULL);
+    claire_group_session = NULL;
+    load_group_session_by_id(Bob, Claire, group_session->session_id, &claire_group_session);
+    assert(fill_shared_group_session_internal(claire_group_session, &claire_chain_id));
+    assert(compare_protobuf(&alice_chain_id, &claire_chain_id));
+
+    // the cached sessions of the owners share the chain keys
+    set_group_chain_sharing(true);
+    group_session_cacheer *cacheer = NULL;
+    load_group_session_cacheer(&cacheer, Bob, Alice, group_session->session_id);
+    assert(compare_protobuf(&(cacheer->associated_data), &(group_session->associated_data)));
+    assert(compare_protobuf(&(cacheer->chain_id), &alice_chain_id));
+    free_group_session_cacheer(&cacheer);
+    flush_group_session_cache(Alice);
+    set_group_chain_sharing(false);
+
+    // the shared part is kept as long as an owner refers to it
+    unload_group_session_by_id(Alice, group_session->session_id);
+    e2ees__group_session__free_unpacked(claire_group_session, NULL);
+    claire_group_session = NULL;
+    load_group_session_by_id_internal(Bob, Claire, group_session->session_id, &claire_group_session);
+    assert(claire_group_session != NULL);
+    assert(compare_protobuf(&(claire_group_session->associated_data), &(group_session->associated_data)));
+
+    print_result("test_shared_group_session", true);
+
+    // free
+    free_protobuf(&alice_chain_id);
+    free_protobuf(&claire_chain_id);
+    e2ees__group_session__free_unpacked(alice_group_session, NULL);
+    e2ees__group_session__free_unpacked(claire_group_session, NULL);
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__e2ee_address__free_unpacked(Claire, NULL);
+    e2ees__e2ee_address__free_unpacked(group_address, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+
+    tear_down();
+}
+
+void test_group_info_record(uint32_t e2ees_pack_id) {
+    tear_up();
+
+    // create two addresses
+    E2ees__E2eeAddress *Alice, *Bob;
+    mock_address(&Alice, "alice", E2EELAB_DOMAIN, "alice's device");
+    mock_address(&Bob, "bob", E2EELAB_DOMAIN, "bob's device");
+
+    // Alice's outbound group session with two members
+    E2ees__GroupSession *group_session = (E2ees__GroupSession *)malloc(sizeof(E2ees__GroupSession));
+    e2ees__group_session__init(group_session);
+    group_session->version = strdup(E2EES_PROTOCOL_VERSION);
+    group_session->e2ees_pack_id = e2ees_pack_id;
+    copy_address_from_address(&(group_session->sender), Alice);
+    copy_address_from_address(&(group_session->session_owner), Alice);
+    group_session->session_id = generate_uuid_str();
+    group_session->group_info = (E2ees__GroupInfo *)malloc(sizeof(E2ees__GroupInfo));
+    e2ees__group_info__init(group_session->group_info);
+    group_session->group_info->group_name = strdup("test_group");
+    E2ees__E2eeAddress *group_address = (E2ees__E2eeAddress *)malloc(sizeof(E2ees__E2eeAddress));
+    e2ees__e2ee_address__init(group_address);
+    group_address->group = (E2ees__PeerGroup *)malloc(sizeof(E2ees__PeerGroup));
+    e2ees__peer_group__init(group_address->group);
+    group_address->peer_case = E2EES__E2EE_ADDRESS__PEER_GROUP;
+    group_address->domain = mock_domain_str();
+    group_address->group->group_id = generate_uuid_str();
+    copy_address_from_address(&(group_session->group_info->group_address), group_address);
+    E2ees__GroupMember *group_members[3];
+    const char *user_ids[3] = {"alice", "bob", "claire"};
+    size_t i;
+    for (i = 0; i < 3; i++) {
+        group_members[i] = (E2ees__GroupMember *)malloc(sizeof(E2ees__GroupMember));
+        e2ees__group_member__init(group_members[i]);
+        group_members[i]->user_id = strdup(user_ids[i]);
+        group_members[i]->domain = strdup(E2EELAB_DOMAIN);
+        group_members[i]->role = i == 0 ? E2EES__GROUP_ROLE__GROUP_ROLE_MANAGER : E2EES__GROUP_ROLE__GROUP_ROLE_MEMBER;
+    }
+    group_session->group_info->n_group_member_list = 2;
+    copy_group_members(&(group_session->group_info->group_member_list), group_members, 2);
+    group_session->sequence = 0;
+    group_session->chain_key.len = 32;
+    group_session->chain_key.data = (uint8_t *)malloc(sizeof(uint8_t) * 32);
+    memcpy(group_session->chain_key.data, "01234567890123456789012345678901", 32);
+    store_group_session_internal(group_session);
+
+    // the member list is kept out of the stored session
+    E2ees__GroupSession *group_session_copy = NULL;
+    load_group_session_by_address(Alice, Alice, group_address, &group_session_copy);
+    assert(group_session_copy != NULL);
+    assert(group_session_copy->group_info->n_group_member_list == 0);
+    e2ees__group_session__free_unpacked(group_session_copy, NULL);
+    group_session_copy = NULL;
+
+    load_group_session_by_address_internal(Alice, Alice, group_address, &group_session_copy);
+    assert(group_session_copy != NULL);
+    assert(compare_group_member(
+        group_session_copy->group_info->group_member_list, group_session_copy->group_info->n_group_member_list,
+        group_session->group_info->group_member_list, group_session->group_info->n_group_member_list
+    ));
+    e2ees__group_session__free_unpacked(group_session_copy, NULL);
+    group_session_copy = NULL;
+
+    E2ees__GroupInfo *group_info = NULL;
+    uint64_t version = 0;
+    assert(load_group_info_internal(&group_info, &version, Alice, group_address) == E2EES_RESULT_SUCC);
+    assert(version == 1);
+    e2ees__group_info__free_unpacked(group_info, NULL);
+
+    // Claire joins, only a delta is stored
+    E2ees__GroupInfo *new_group_info = NULL;
+    add_group_members_to_group_info(&new_group_info, group_session->group_info, &(group_members[2]), 1);
+    e2ees__group_info__free_unpacked(group_session->group_info, NULL);
+    group_session->group_info = new_group_info;
+    store_group_session_internal(group_session);
+
+    // an unchanged member list does not make a new version
+    store_group_session_internal(group_session);
+
+    // load the record and the delta from the db
+    flush_group_session_cache(Alice);
+    assert(load_group_info_internal(&group_info, &version, Alice, group_address) == E2EES_RESULT_SUCC);
+    assert(version == 2);
+    assert(compare_group_member(
+        group_info->group_member_list, group_info->n_group_member_list,
+        group_session->group_info->group_member_list, group_session->group_info->n_group_member_list
+    ));
+    e2ees__group_info__free_unpacked(group_info, NULL);
+
+    // Bob leaves
+    remove_group_members_from_group_info(&new_group_info, group_session->group_info, &(group_members[1]), 1);
+    e2ees__group_info__free_unpacked(group_session->group_info, NULL);
+    group_session->group_info = new_group_info;
+    store_group_session_internal(group_session);
+
+    flush_group_session_cache(Alice);
+    load_group_session_by_address_internal(Alice, Alice, group_address, &group_session_copy);
+    assert(group_session_copy != NULL);
+    assert(compare_group_member(
+        group_session_copy->group_info->group_member_list, group_session_copy->group_info->n_group_member_list,
+        group_session->group_info->group_member_list, group_session->group_info->n_group_member_list
+    ));
+    assert(load_group_info_internal(&group_info, &version, Alice, group_address) == E2EES_RESULT_SUCC);
+    assert(version == 3);
+    e2ees__group_info__free_unpacked(group_info, NULL);
+
+    // a second session of the group is stored with the same member list
+    free(group_session_copy->session_id);
+    group_session_copy->session_id = generate_uuid_str();
+    store_group_session_internal(group_session_copy);
+
+    // Bob joins again through the first session
+    add_group_members_to_group_info(&new_group_info, group_session->group_info, &(group_members[1]), 1);
+    e2ees__group_info__free_unpacked(group_session->group_info, NULL);
+    group_session->group_info = new_group_info;
+    store_group_session_internal(group_session);
+
+    // the older member list of the second session does not replace the newer one
+    store_group_session_internal(group_session_copy);
+    flush_group_session_cache(Alice);
+    assert(load_group_info_internal(&group_info, &version, Alice, group_address) == E2EES_RESULT_SUCC);
+    assert(version == 4);
+    assert(compare_group_member(
+        group_info->group_member_list, group_info->n_group_member_list,
+        group_session->group_info->group_member_list, group_session->group_info->n_group_member_list
+    ));
+    e2ees__group_info__free_unpacked(group_info, NULL);
+
+    // the second session picks up the newer member list when it is loaded
+    E2ees__GroupSession *group_session_2 = NULL;
+    load_group_session_by_id_internal(Alice, Alice, group_session_copy->session_id, &group_session_2);
+    assert(group_session_2 != NULL);
+    assert(compare_group_member(
+        group_session_2->group_info->group_member_list, group_session_2->group_info->n_group_member_list,
+        group_session->group_info->group_member_list, group_session->group_info->n_group_member_list
+    ));
+    assert(load_group_session_info_version(Alice, group_session_2->session_id) == 4);
+    e2ees__group_session__free_unpacked(group_session_2, NULL);
+
+    // the record goes with the group sessions
+    flush_group_session_cache(Alice);
+    unload_group_session_by_address(Alice, group_address);
+    assert(load_group_info_internal(&group_info, &version, Alice, group_address) == E2EES_RESULT_FAIL);
+    assert(load_group_session_info_version(Alice, group_session->session_id) == 0);
+
+    print_result("test_group_info_record", true);
+
+    // free
+    for (i = 0; i < 3; i++) {
+        e2ees__group_member__free_unpacked(group_members[i], NULL);
+    }
+    e2ees__e2ee_address__free_unpacked(Alice, NULL);
+    e2ees__e2ee_address__free_unpacked(Bob, NULL);
+    e2ees__e2ee_address__free_unpacked(group_address, NULL);
+    e2ees__group_session__free_unpacked(group_session, NULL);
+    e2ees__group_session__free_unpacked(group_session_copy, NULL);
+
+    tear_down();
+}
+
 void test_load_group_addresses(uint32_t e2ees_pack_id) {
     tear_up();
 
@@ -766,9 +1643,17 @@ int main(){
 
     test_load_outbound_session(e2ees_pack_id);
     test_load_outbound_sessions(e2ees_pack_id);
+    test_load_outbound_session_headers(e2ees_pack_id);
+    test_load_outbound_sessions_by_users(e2ees_pack_id);
     test_load_inbound_session(e2ees_pack_id);
     test_load_group_session_by_address(e2ees_pack_id);
     test_load_group_session_by_id(e2ees_pack_id);
+    test_group_session_cache(e2ees_pack_id);
+    test_group_chain_checkpoint(e2ees_pack_id);
+    test_signed_group_chain_checkpoint(e2ees_pack_id);
+    test_shared_group_chain(e2ees_pack_id);
+    test_shared_group_session(e2ees_pack_id);
+    test_group_info_record(e2ees_pack_id);
     test_load_group_addresses(e2ees_pack_id);
     test_store_session(e2ees_pack_id);
     test_equal_ratchet_outbound(e2ees_pack_id);